@@ -0,0 +1,268 @@
+/* fbandgen.c
+   ==========
+
+   Reads the licensed bands in freqband.def and the site's restricted
+   frequencies and writes them out as the binary database that the
+   control programs load with FreqBandLoad:
+
+     fbandgen freqband.def [restrict.dat] freqband.dat
+
+   The restricted ranges are sorted and merged, and each band is split
+   into the clear windows that lie outside all of them, so that none
+   of this has to be done by the radar. A band that is restricted
+   throughout is reported but kept, so the band numbers the schedules
+   use do not move. Without a restrict file every band is one window.
+
+   Each band must have a positive start and width and a number that is
+   not used twice in its table; anything else stops the build.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rtypes.h"
+#include "freqband.h"
+
+
+#define FBANDGEN_MAXTAB 32
+#define FBANDGEN_MAXBAND 1024
+#define FBANDGEN_MAXRES 1024
+#define FBANDGEN_MAXWIN (FBANDGEN_MAXBAND+FBANDGEN_MAXRES)
+
+static struct FreqBandTab tab[FBANDGEN_MAXTAB];
+static struct FreqBand band[FBANDGEN_MAXBAND];
+static struct FreqBandWin win[FBANDGEN_MAXWIN];
+static struct FreqBandRes res[FBANDGEN_MAXRES];
+static int tnum=0,bnum=0,wnum=0,rnum=0;
+static char *fname;
+
+
+static void FbandError(int line,char *txt,char *name) {
+  if (name !=NULL) fprintf(stderr,"%s:%d: %s: %s\n",fname,line,name,txt);
+  else fprintf(stderr,"%s:%d: %s\n",fname,line,txt);
+  exit(1);
+}
+
+
+static void FbandRead(FILE *fp) {
+  struct FreqBandTab *ptr=NULL;
+  char buf[1024];
+  char *tok;
+  int line=0;
+  int num,start,width,n;
+
+  while (fgets(buf,sizeof(buf),fp) !=NULL) {
+    line++;
+    if (strchr(buf,'#') !=NULL) *strchr(buf,'#')=0;
+    tok=strtok(buf," \t\r\n");
+    if (tok==NULL) continue;
+
+    if (strcmp(tok,"table")==0) {
+      if (tnum==FBANDGEN_MAXTAB) FbandError(line,"too many tables",NULL);
+      tok=strtok(NULL," \t\r\n");
+      if (tok==NULL) FbandError(line,"table has no name",NULL);
+      if (strlen(tok)>=FBAND_NAME) FbandError(line,"name is too long",tok);
+      for (n=0;n<tnum;n++)
+        if (strcmp(tab[n].name,tok)==0)
+          FbandError(line,"table is defined twice",tok);
+      ptr=&tab[tnum];
+      memset(ptr,0,sizeof(struct FreqBandTab));
+      strcpy(ptr->name,tok);
+      ptr->boff=bnum;
+      tnum++;
+      continue;
+    }
+
+    if (ptr==NULL) FbandError(line,"expected table",NULL);
+
+    if (strcmp(tok,"band")==0) {
+      if (bnum==FBANDGEN_MAXBAND) FbandError(line,"too many bands",ptr->name);
+      tok=strtok(NULL," \t\r\n");
+      if ((tok==NULL) || (sscanf(tok,"%d",&num) !=1) || (num<0))
+        FbandError(line,"bad band number",ptr->name);
+      tok=strtok(NULL," \t\r\n");
+      if ((tok==NULL) || (sscanf(tok,"%d",&start) !=1) || (start<=0))
+        FbandError(line,"bad start frequency",ptr->name);
+      tok=strtok(NULL," \t\r\n");
+      if ((tok==NULL) || (sscanf(tok,"%d",&width) !=1) || (width<=0))
+        FbandError(line,"bad width",ptr->name);
+      for (n=0;n<ptr->bnum;n++)
+        if (band[ptr->boff+n].num==num)
+          FbandError(line,"band number is used twice",ptr->name);
+      memset(&band[bnum],0,sizeof(struct FreqBand));
+      band[bnum].num=num;
+      band[bnum].start=start;
+      band[bnum].width=width;
+      bnum++;
+      ptr->bnum++;
+    } else FbandError(line,"expected table or band",ptr->name);
+  }
+}
+
+
+/* the restrict file has one range per line as start and end in kHz;
+   the default frequency line and comments are skipped */
+
+static void FbandRestrict(FILE *fp) {
+  char buf[1024];
+  char *tok;
+  int line=0;
+  int start,end;
+
+  while (fgets(buf,sizeof(buf),fp) !=NULL) {
+    line++;
+    if (strchr(buf,'#') !=NULL) *strchr(buf,'#')=0;
+    tok=strtok(buf," \t\r\n");
+    if (tok==NULL) continue;
+    if (strcmp(tok,"default")==0) continue;
+    if (sscanf(tok,"%d",&start) !=1)
+      FbandError(line,"bad restricted range",NULL);
+    tok=strtok(NULL," \t\r\n");
+    if ((tok==NULL) || (sscanf(tok,"%d",&end) !=1) || (end<start))
+      FbandError(line,"bad restricted range",NULL);
+    if (rnum==FBANDGEN_MAXRES) FbandError(line,"too many ranges",NULL);
+    res[rnum].start=start;
+    res[rnum].end=end;
+    rnum++;
+  }
+}
+
+
+static int FbandCompare(const void *a,const void *b) {
+  const struct FreqBandRes *x=a,*y=b;
+
+  if (x->start !=y->start) return (x->start<y->start) ? -1 : 1;
+  return (x->end<y->end) ? -1 : (x->end>y->end);
+}
+
+
+static void FbandMerge(void) {
+  int n,m=0;
+
+  if (rnum==0) return;
+  qsort(res,rnum,sizeof(struct FreqBandRes),FbandCompare);
+  for (n=1;n<rnum;n++) {
+    if (res[n].start<=res[m].end+1) {
+      if (res[n].end>res[m].end) res[m].end=res[n].end;
+    } else res[++m]=res[n];
+  }
+  rnum=m+1;
+}
+
+
+static void FbandWindow(struct FreqBand *ptr,int start,int end) {
+  if (end<=start) return;
+  if (wnum==FBANDGEN_MAXWIN) {
+    fprintf(stderr,"%s: too many clear windows\n",fname);
+    exit(1);
+  }
+  win[wnum].start=start;
+  win[wnum].width=end-start;
+  if ((ptr->wmax<0) || (win[wnum].width>win[ptr->woff+ptr->wmax].width))
+    ptr->wmax=wnum-ptr->woff;
+  ptr->wnum++;
+  wnum++;
+}
+
+
+/* splits the band into the windows outside the restricted ranges */
+
+static void FbandSplit(struct FreqBand *ptr) {
+  int cur,end,n;
+
+  ptr->woff=wnum;
+  ptr->wnum=0;
+  ptr->wmax=-1;
+  cur=ptr->start;
+  end=ptr->start+ptr->width;
+  for (n=0;n<rnum;n++) {
+    if (res[n].end<cur) continue;
+    if (res[n].start>end) break;
+    FbandWindow(ptr,cur,res[n].start-1);
+    cur=res[n].end+1;
+  }
+  FbandWindow(ptr,cur,end);
+}
+
+
+static void FbandWrite(FILE *fp) {
+  struct FreqBandHdr hdr;
+
+  memset(&hdr,0,sizeof(struct FreqBandHdr));
+  hdr.magic=FBAND_MAGIC;
+  hdr.version=FBAND_VERSION;
+  hdr.tnum=tnum;
+  hdr.bnum=bnum;
+  hdr.wnum=wnum;
+  hdr.rnum=rnum;
+  hdr.size=sizeof(struct FreqBandHdr)+tnum*sizeof(struct FreqBandTab)+
+           bnum*sizeof(struct FreqBand)+wnum*sizeof(struct FreqBandWin)+
+           rnum*sizeof(struct FreqBandRes);
+
+  fwrite(&hdr,sizeof(struct FreqBandHdr),1,fp);
+  fwrite(tab,sizeof(struct FreqBandTab),tnum,fp);
+  fwrite(band,sizeof(struct FreqBand),bnum,fp);
+  fwrite(win,sizeof(struct FreqBandWin),wnum,fp);
+  fwrite(res,sizeof(struct FreqBandRes),rnum,fp);
+}
+
+
+int main(int argc,char *argv[]) {
+  struct FreqBand *ptr;
+  FILE *fp;
+  int t,n;
+
+  if ((argc<3) || (argc>4)) {
+    fprintf(stderr,"fbandgen freqband.def [restrict.dat] freqband.dat\n");
+    exit(1);
+  }
+
+  fname=argv[1];
+  fp=fopen(fname,"r");
+  if (fp==NULL) {
+    fprintf(stderr,"cannot open %s\n",fname);
+    exit(1);
+  }
+  FbandRead(fp);
+  fclose(fp);
+
+  if (argc==4) {
+    fname=argv[2];
+    fp=fopen(fname,"r");
+    if (fp==NULL) {
+      fprintf(stderr,"cannot open %s\n",fname);
+      exit(1);
+    }
+    FbandRestrict(fp);
+    fclose(fp);
+    FbandMerge();
+  }
+
+  for (t=0;t<tnum;t++) {
+    for (n=0;n<tab[t].bnum;n++) {
+      ptr=&band[tab[t].boff+n];
+      FbandSplit(ptr);
+      if (ptr->wmax<0) {
+        fprintf(stderr,"%s: band %d (%d kHz) is restricted throughout\n",
+                tab[t].name,ptr->num,ptr->start);
+        tab[t].bfull++;
+      } else if ((ptr->wnum>1) || (win[ptr->woff].width !=ptr->width))
+        tab[t].bcut++;
+    }
+  }
+
+  fname=argv[argc-1];
+  fp=fopen(fname,"w");
+  if (fp==NULL) {
+    fprintf(stderr,"cannot open %s\n",fname);
+    exit(1);
+  }
+  FbandWrite(fp);
+  fclose(fp);
+
+  for (t=0;t<tnum;t++)
+    fprintf(stderr,"%s: %d bands, %d cut, %d restricted throughout\n",
+            tab[t].name,tab[t].bnum,tab[t].bcut,tab[t].bfull);
+  return 0;
+}
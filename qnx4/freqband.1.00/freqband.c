@@ -0,0 +1,192 @@
+/* freqband.c
+   ==========
+
+   Reads the licensed-band database that fbandgen writes from
+   freqband.def and the site's restricted frequencies. The file is
+   read whole into one block when the program starts and the tables
+   are used in place, so looking up a band costs nothing at run time.
+   Each band carries its clear windows, the parts of the band outside
+   every restricted range, worked out by fbandgen; FreqBandClear gives
+   the widest of them so that a clear frequency search is never made
+   over restricted frequencies.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rtypes.h"
+#include "freqband.h"
+
+
+static int FreqBandCheck(struct FreqBandDB *ptr,int size) {
+  struct FreqBandHdr *hdr=ptr->hdr;
+  struct FreqBand *band;
+  int n;
+
+  if (size<(int) sizeof(struct FreqBandHdr)) return -1;
+  if ((hdr->magic !=FBAND_MAGIC) || (hdr->version !=FBAND_VERSION))
+    return -1;
+  if ((hdr->size !=size) || (hdr->tnum<0) || (hdr->bnum<0) ||
+      (hdr->wnum<0) || (hdr->rnum<0)) return -1;
+  if (size !=(int) (sizeof(struct FreqBandHdr)+
+                    hdr->tnum*sizeof(struct FreqBandTab)+
+                    hdr->bnum*sizeof(struct FreqBand)+
+                    hdr->wnum*sizeof(struct FreqBandWin)+
+                    hdr->rnum*sizeof(struct FreqBandRes))) return -1;
+
+  ptr->tab=(struct FreqBandTab *) (ptr->buf+sizeof(struct FreqBandHdr));
+  ptr->band=(struct FreqBand *) (ptr->tab+hdr->tnum);
+  ptr->win=(struct FreqBandWin *) (ptr->band+hdr->bnum);
+  ptr->res=(struct FreqBandRes *) (ptr->win+hdr->wnum);
+
+  for (n=0;n<hdr->tnum;n++) {
+    ptr->tab[n].name[FBAND_NAME-1]=0;
+    if ((ptr->tab[n].boff<0) || (ptr->tab[n].bnum<0) ||
+        (ptr->tab[n].boff+ptr->tab[n].bnum>hdr->bnum)) return -1;
+  }
+  for (n=0;n<hdr->bnum;n++) {
+    band=&ptr->band[n];
+    if ((band->woff<0) || (band->wnum<0) ||
+        (band->woff+band->wnum>hdr->wnum)) return -1;
+    if ((band->wmax<-1) || (band->wmax>=band->wnum)) return -1;
+  }
+  return 0;
+}
+
+
+/* reads the database; fname NULL reads FBAND_FILE from $SD_HDWPATH */
+
+struct FreqBandDB *FreqBandLoad(char *fname) {
+  struct FreqBandDB *ptr;
+  struct stat st;
+  char path[1024];
+  char *env;
+  FILE *fp;
+
+  if (fname==NULL) {
+    env=getenv("SD_HDWPATH");
+    if (env==NULL) return NULL;
+    sprintf(path,"%s/%s",env,FBAND_FILE);
+    fname=path;
+  }
+
+  fp=fopen(fname,"r");
+  if (fp==NULL) return NULL;
+  if ((fstat(fileno(fp),&st) !=0) || (st.st_size<=0)) {
+    fclose(fp);
+    return NULL;
+  }
+
+  ptr=malloc(sizeof(struct FreqBandDB));
+  if (ptr==NULL) {
+    fclose(fp);
+    return NULL;
+  }
+  memset(ptr,0,sizeof(struct FreqBandDB));
+  ptr->buf=malloc(st.st_size);
+  if ((ptr->buf==NULL) ||
+      (fread(ptr->buf,st.st_size,1,fp) !=1)) {
+    fclose(fp);
+    FreqBandFree(ptr);
+    return NULL;
+  }
+  fclose(fp);
+
+  ptr->hdr=(struct FreqBandHdr *) ptr->buf;
+  if (FreqBandCheck(ptr,st.st_size) !=0) {
+    FreqBandFree(ptr);
+    return NULL;
+  }
+  return ptr;
+}
+
+
+void FreqBandFree(struct FreqBandDB *ptr) {
+  if (ptr==NULL) return;
+  if (ptr->buf !=NULL) free(ptr->buf);
+  free(ptr);
+}
+
+
+struct FreqBandTab *FreqBandTable(struct FreqBandDB *ptr,char *name) {
+  int n;
+
+  if ((ptr==NULL) || (name==NULL)) return NULL;
+  for (n=0;n<ptr->hdr->tnum;n++)
+    if (strcmp(ptr->tab[n].name,name)==0) return &ptr->tab[n];
+  return NULL;
+}
+
+
+struct FreqBand *FreqBandFind(struct FreqBandDB *ptr,
+                              struct FreqBandTab *tab,int num) {
+  int n;
+
+  if ((ptr==NULL) || (tab==NULL)) return NULL;
+  for (n=0;n<tab->bnum;n++)
+    if (ptr->band[tab->boff+n].num==num) return &ptr->band[tab->boff+n];
+  return NULL;
+}
+
+
+/* sets stfrq and frqrng to the widest clear window of the band;
+   returns 0 if that is the whole band, 1 if restricted frequencies
+   were cut out, or -1 if the band is restricted throughout, in which
+   case the whole band is given */
+
+int FreqBandClear(struct FreqBandDB *ptr,struct FreqBand *band,
+                  int *stfrq,int *frqrng) {
+  struct FreqBandWin *win;
+
+  if (band->wmax<0) {
+    *stfrq=band->start;
+    *frqrng=band->width;
+    return -1;
+  }
+  win=&ptr->win[band->woff+band->wmax];
+  *stfrq=win->start;
+  *frqrng=win->width;
+  if ((win->start==band->start) && (win->width==band->width)) return 0;
+  return 1;
+}
+
+
+/* fills the arrays the control programs index by band number; bands
+   numbered max or above are left out. Returns the number of bands
+   filled */
+
+int FreqBandFill(struct FreqBandDB *ptr,struct FreqBandTab *tab,
+                 int *stfrq,int *frqrng,int max) {
+  struct FreqBand *band;
+  int n,cnt=0;
+
+  if ((ptr==NULL) || (tab==NULL)) return 0;
+  for (n=0;n<tab->bnum;n++) {
+    band=&ptr->band[tab->boff+n];
+    if ((band->num<0) || (band->num>=max)) continue;
+    FreqBandClear(ptr,band,&stfrq[band->num],&frqrng[band->num]);
+    cnt++;
+  }
+  return cnt;
+}
+
+
+/* returns non-zero if freq is restricted; the ranges are sorted and
+   do not overlap */
+
+int FreqBandTest(struct FreqBandDB *ptr,int freq) {
+  int lo=0,hi,mid;
+
+  if (ptr==NULL) return 0;
+  hi=ptr->hdr->rnum-1;
+  while (lo<=hi) {
+    mid=(lo+hi)/2;
+    if (freq<ptr->res[mid].start) hi=mid-1;
+    else if (freq>ptr->res[mid].end) lo=mid+1;
+    else return 1;
+  }
+  return 0;
+}
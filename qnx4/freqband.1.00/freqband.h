@@ -0,0 +1,74 @@
+/* freqband.h
+   ==========
+*/
+
+
+#ifndef _FREQBAND_H
+#define _FREQBAND_H
+
+#define FBAND_MAGIC 0x444e4246     /* "FBND" */
+#define FBAND_VERSION 1
+#define FBAND_NAME 16
+#define FBAND_FILE "freqband.dat"  /* in $SD_HDWPATH */
+
+/* the database is written by fbandgen and read back as one block, so
+   every field is a 32-bit integer and nothing is padded */
+
+struct FreqBandHdr {
+  int32 magic;
+  int32 version;
+  int32 size;                /* bytes in the file */
+  int32 tnum;                /* tables */
+  int32 bnum;                /* bands in all of the tables */
+  int32 wnum;                /* clear windows in all of the bands */
+  int32 rnum;                /* restricted ranges */
+};
+
+struct FreqBandTab {
+  char name[FBAND_NAME];
+  int32 bnum;
+  int32 boff;                /* first band */
+  int32 bcut;                /* bands with restricted frequencies cut out */
+  int32 bfull;               /* bands that are restricted throughout */
+};
+
+struct FreqBand {
+  int32 num;                 /* band number used by the schedule */
+  int32 start;               /* kHz */
+  int32 width;               /* kHz */
+  int32 wnum;
+  int32 woff;                /* first clear window */
+  int32 wmax;                /* widest clear window, or -1 for none */
+};
+
+struct FreqBandWin {
+  int32 start;
+  int32 width;
+};
+
+struct FreqBandRes {
+  int32 start;               /* restricted from start to end inclusive */
+  int32 end;
+};
+
+struct FreqBandDB {
+  struct FreqBandHdr *hdr;
+  struct FreqBandTab *tab;
+  struct FreqBand *band;
+  struct FreqBandWin *win;
+  struct FreqBandRes *res;
+  char *buf;
+};
+
+struct FreqBandDB *FreqBandLoad(char *fname);
+void FreqBandFree(struct FreqBandDB *ptr);
+struct FreqBandTab *FreqBandTable(struct FreqBandDB *ptr,char *name);
+struct FreqBand *FreqBandFind(struct FreqBandDB *ptr,
+                              struct FreqBandTab *tab,int num);
+int FreqBandClear(struct FreqBandDB *ptr,struct FreqBand *band,
+                  int *stfrq,int *frqrng);
+int FreqBandFill(struct FreqBandDB *ptr,struct FreqBandTab *tab,
+                 int *stfrq,int *frqrng,int max);
+int FreqBandTest(struct FreqBandDB *ptr,int freq);
+
+#endif
@@ -26,6 +26,7 @@
 #include "taskid.h"
 #include "errlog.h"
 #include "freq.h"
+#include "freqband.h"
 #include "rmsg.h"
 #include "radarshell.h"
 #include "rmsgsnd.h"
@@ -46,6 +47,9 @@
 
 /*
  $Log: interleavesound_stereo.c,v $
+ Revision 1.1  2026/10/17 12:00:00  code
+ Frequency bands read from the freqband database, table chosen by station.
+
  Revision 1.0  2020/10/09 egthomas
  Initial revision from stereoscan and stereo_interleave
  
@@ -110,6 +114,7 @@ struct TaskID *errlog;
 
 int usfreq[121];
 int ufreq_range[121];
+char *freq_table=NULL;
 
 pid_t uucont_proxy;
 
@@ -251,8 +256,6 @@ int main(int argc,char *argv[]) {
     perror("cannot attach proxy");
   }
 
-  u_init_freq_bands();
-
   strcpy(cmdlne,argv[0]);
   for (n=1;n<argc;n++) {
     strcat(cmdlne," ");
@@ -350,6 +353,7 @@ int main(int argc,char *argv[]) {
   OpsLogStart(errlog,progname,argc,argv);
 
   if (stid == 9) {
+    freq_table = "cutlass";
     ifreqsB[0] = 23;
     ifreqsB[1] = 26;
     ifreqsB[2] = 28;
@@ -358,6 +362,7 @@ int main(int argc,char *argv[]) {
     ifreqsB[5] = 34;
     ifreqsB[6] = 35;
   } else if (stid == 10) {
+    freq_table = "cutlass";
     ifreqsB[0] = 2;
     ifreqsB[1] = 4;
     ifreqsB[2] = 5;
@@ -366,6 +371,7 @@ int main(int argc,char *argv[]) {
     ifreqsB[5] = 8;
     ifreqsB[6] = 10;
   } else if (stid == 41) {
+    freq_table = "hkw";
     ifreqsB[0] = 1;
     ifreqsB[1] = 2;
     ifreqsB[2] = 3;
@@ -378,6 +384,8 @@ int main(int argc,char *argv[]) {
     exit(-1);
   }
 
+  u_init_freq_bands();
+
   frangA = FRANG_A;
   rsepA  = RSEP_A;
   frangB = FRANG_B;
@@ -691,66 +699,27 @@ int main(int argc,char *argv[]) {
 
 /***************************************************************************/
 
-/* Sets up the licenced frequency bands for [your radar] */
+/* Sets up the licenced frequency bands for the radar from the site's
+   freqband database, with the restricted frequencies cut out */
 
 void u_init_freq_bands() {
+  struct FreqBandDB *fband;
+  struct FreqBandTab *tab;
+  char logtxt[256];
 
-/* start freq of each band */
-
-   /* HKW */
-
-   usfreq[0] = 9150;	//keep bands 0 and 1 the same to avoid use of 0
-   usfreq[1] = 9150;
-   usfreq[2] = 10790;
-/* remove 11.07 MHz band because it is for HOK East
-   usfreq[3] = 11050;
-   usfreq[4] = 15830;
-*/
-   usfreq[3] = 15830;
-   usfreq[4] = 18180;
-
-   usfreq[5] = 18180;
-   usfreq[6] = 18180;
-   usfreq[7] = 18180;
-   usfreq[8] = 18180;
-   usfreq[9] = 18180;
-   usfreq[10] = 18180;
-   usfreq[11] = 18180;
-   usfreq[12] = 18180;
-   usfreq[13] = 18180;
-   usfreq[14] = 18180;
-   usfreq[15] = 18180;
-   usfreq[16] = 18180;
-   usfreq[17] = 18180;
-   usfreq[18] = 18180;
-   usfreq[19] = 18180;
-   usfreq[20] = 18180;
-
-   /* width of each band */
-
-   /* HKW */
-
-   ufreq_range[0] = 40;
-   ufreq_range[1] = 40;
-   ufreq_range[2] = 40;
-   ufreq_range[3] = 40;
-   ufreq_range[4] = 40;
-   ufreq_range[5] = 40;
-   ufreq_range[6] = 40;
-   ufreq_range[7] = 40;
-   ufreq_range[8] = 40;
-   ufreq_range[9] = 40;
-   ufreq_range[10] = 40;
-   ufreq_range[11] = 40;
-   ufreq_range[12] = 40;
-   ufreq_range[13] = 40;
-   ufreq_range[14] = 40;
-   ufreq_range[15] = 40;
-   ufreq_range[16] = 40;
-   ufreq_range[17] = 40;
-   ufreq_range[18] = 40;
-   ufreq_range[19] = 40;
-   ufreq_range[20] = 40;
+  fband=FreqBandLoad(NULL);
+  tab=FreqBandTable(fband,freq_table);
+  if (tab==NULL) {
+    fprintf(stderr,"Frequency band table %s missing from the freqband "
+                   "database.\n",freq_table);
+    exit(-1);
+  }
+  FreqBandFill(fband,tab,usfreq,ufreq_range,sizeof(usfreq)/sizeof(int));
+  sprintf(logtxt,"Frequency bands from table %s: %d cut around restricted "
+          "frequencies, %d restricted throughout",tab->name,tab->bcut,
+          tab->bfull);
+  ErrLog(errlog,progname,logtxt);
+  FreqBandFree(fband);
 }
 
 /* Sends a proxy message to the microcontroller monitoring 
@@ -0,0 +1,33 @@
+/* intrec.h
+   ========
+*/
+
+
+#ifndef _INTREC_H
+#define _INTREC_H
+
+#define INTREC_RETRY 0      /* integrate again as it stands */
+#define INTREC_TSG 1        /* reload the timing sequence */
+#define INTREC_HDW 2        /* reset the hardware in process */
+#define INTREC_FAIL 3       /* nothing worked; restart the radar */
+#define INTREC_NTIER 4
+
+struct IntRecStats {
+  int faults;
+  int num[INTREC_NTIER];     /* faults cleared at each tier */
+  double tsum[INTREC_NTIER]; /* seconds from fault to recovery */
+  double tmax;
+};
+
+struct IntRec {
+  struct TaskID *errlog;
+  char *progname;
+  struct IntRecStats stats;
+};
+
+void IntRecSet(struct IntRec *ptr,struct TaskID *errlog,char *progname);
+int IntRecIntegrate(struct IntRec *ptr,int nave,int *ptab,
+                    int (*lags)[2]);
+void IntRecLog(struct IntRec *ptr);
+
+#endif
@@ -38,8 +38,29 @@
 #include "interface.h"
 #include "hdw.h"
 #include "freq.h"
+#include "intrec.h"
+#include "pulseseq.h"
+#include "tsgcache.h"
+#include "mseq.h"
 /*
  * $Log: iwdscan.c,v $ 
+ * Revision 1.04 2026/10/17 12:00:00
+ * Added interleave option: the 8-pulse and 7-pulse marker sequences
+ * are integrated together on every beam (mseq.c) and sent as two
+ * records
+ *
+ * Revision 1.03 2026/10/17 12:00:00
+ * Timing sequences are preloaded and switched through a cache
+ * (tsgcache.c) rather than by calling SiteTimeSeq on every beam
+ *
+ * Revision 1.02 2026/10/17 12:00:00
+ * The 7-pulse marker and 8-pulse sequences come from the pulseseq
+ * library
+ *
+ * Revision 1.01 2026/10/17 12:00:00
+ * Recover from integration errors in process (intrec.c) and only
+ * restart the radar if that fails
+ *
  * Revision 1.00 2016/09/15 21:00:00 KKrieger
  * Initial revision. Based off epopsound.1.02
  * 
@@ -70,74 +91,29 @@ int main(int argc, char *argv[])
 	We will use the 7 pulse sequence for this and have
 	command line flags to enable and configure the period of
 	this marker pulse sequence */
-	int ptab_7[7] = { 0, 9, 12, 20, 22, 26, 27};
-
-	int lags_7[LAG_SIZE][2] = {
-		{0,0},
-		{26,27},
-		{20,22},
-		{9,12},
-		{22,26},
-		{22,27},
-		{20,26},
-		{20,27},
-		{12,20},
-		{0,9},
-		{12,22},
-		{9,20},
-		{0,12},
-		{9,22},
-		{12,26},
-		{12,27},
-		
-		{9,26},
-		{9,27},
-
-		{27,27}};
+	struct PulseSeq *seq_7;
+	int *ptab_7;
+	int (*lags_7)[2];
 
-	int mppul_7 = 7;
-	int mplgs_7 = 18;
+	int mppul_7;
+	int mplgs_7;
 	int mpinc_7 = 2400;
 	int dmpinc_7 = 2400;
 	int nmpinc_7 = 2400;
 	int use_marker = 0; /* Default do not use marker */
 	int marker_period = 15; /* Default every 15 beams marker period */
 	int marker_counter = marker_period; /* Counter for the marker periods */
+	int interleave = 0; /* Both sequences on every beam instead of the marker */
+	int rounds = MSEQ_ROUNDS; /* Passes through the sequences on a beam */
+	int mixed = 0;
+	struct MSeq *mseq = NULL;
+
+	struct PulseSeq *seq_8;
+	int *ptab_8;
+	int (*lags_8)[2];
 
-	int ptab_8[8] = { 0, 14, 22, 24, 27, 31, 42, 43 };
-
-	int lags_8[LAG_SIZE][2] = {
-		{0, 0},		/* 0 */
-		{42, 43},	/* 1 */
-		{22, 24},	/* 2 */
-		{24, 27},	/* 3 */
-		{27, 31},	/* 4 */
-		{22, 27},	/* 5 */
-
-		{24, 31},	/* 7 */
-		{14, 22},	/* 8 */
-		{22, 31},	/* 9 */
-		{14, 24},	/* 10 */
-		{31, 42},	/* 11 */
-		{31, 43},	/* 12 */
-		{14, 27},	/* 13 */
-		{0, 14},	/* 14 */
-		{27, 42},	/* 15 */
-		{27, 43},	/* 16 */
-		{14, 31},	/* 17 */
-		{24, 42},	/* 18 */
-		{24, 43},	/* 19 */
-		{22, 42},	/* 20 */
-		{22, 43},	/* 21 */
-		{0, 22},	/* 22 */
-
-		{0, 24},	/* 24 */
-
-		{43, 43}
-	};			/* alternate lag-0 */
-
-	int mppul_8 = 8;
-	int mplgs_8 = 23;
+	int mppul_8;
+	int mplgs_8;
 	int mpinc_8 = 1500;
 	int dmpinc_8 = 1500;
 	int nmpinc_8 = 1500;
@@ -151,6 +127,8 @@ int main(int argc, char *argv[])
 	int n;
 	pid_t sid;
 	int exitpoll = 0;
+	struct IntRec irec;
+	struct TSGCache tcache;
 
 	int scnsc = 10;
 	int scnus = 0;
@@ -169,6 +147,22 @@ int main(int argc, char *argv[])
 
 	unsigned char discretion = 0;
 
+	/* the sequences come from the pulseseq library */
+	seq_7 = PulseSeqFind("normal7");
+	seq_8 = PulseSeqFind("katscan8");
+	if ((seq_7 == NULL) || (seq_8 == NULL)) {
+		fprintf(stderr, "Pulse sequence missing from the pulseseq library.\n");
+		exit(-1);
+	}
+	ptab_7 = seq_7->ptab;
+	lags_7 = seq_7->lags;
+	mppul_7 = seq_7->mppul;
+	mplgs_7 = seq_7->mplgs;
+	ptab_8 = seq_8->ptab;
+	lags_8 = seq_8->lags;
+	mppul_8 = seq_8->mppul;
+	mplgs_8 = seq_8->mplgs;
+
 	/*
 	 * Get the command line arguments 
 	 */
@@ -218,6 +212,8 @@ int main(int argc, char *argv[])
 	OptionAdd(&opt, "fixfreq", 'i', &fixfrq); /* different spelling of fixfrq */
 	OptionAdd(&opt, "use_marker", 'i',&use_marker);
 	OptionAdd(&opt, "marker_period",'i',&marker_period);
+	OptionAdd(&opt, "interleave", 'i', &interleave);
+	OptionAdd(&opt, "rounds", 'i', &rounds);
 	OptionAdd(&opt, "dayfreq", 'i', &dfrq);
 	OptionAdd(&opt, "nightfreq", 'i', &nfrq);
 	OptionAdd(&opt, "dayfrq", 'i', &dfrq); /* Different spelling */
@@ -234,6 +230,10 @@ int main(int argc, char *argv[])
     }
 	if(marker_period < 0) {
         marker_period = 0;
+    }
+	if(interleave != 0) {
+        interleave = 1;
+        use_marker = 0;
     }
 	/* Set marker counter to the period so we send marker
        on the first beam */
@@ -268,12 +268,27 @@ int main(int argc, char *argv[])
 
 	errlog = TaskIDMake(ename);
 	OpsLogStart(errlog, progname, argc, argv);
+	IntRecSet(&irec, errlog, progname);
 	sprintf(logtxt, "startbeam: %d, stopbeam: %d", startbeam, stopbeam);
 	ErrLog(errlog,progname,logtxt);	
 	if(use_marker) {
 		sprintf(logtxt, "Using marker sequence. Every %d beams",marker_period);
 		ErrLog(errlog,progname,logtxt);
 	}
+	if(interleave) {
+		mseq = MSeqMake(rounds);
+		if ((mseq == NULL) ||
+			(MSeqAdd(mseq, ptab_8, lags_8, mppul_8, mplgs_8, mpinc_8) != 0) ||
+			(MSeqAdd(mseq, ptab_7, lags_7, mppul_7, mplgs_7, mpinc_7) != 0)) {
+			ErrLog(errlog, progname, "Could not set up interleaved integration.");
+			MSeqFree(mseq);
+			mseq = NULL;
+			interleave = 0;
+		} else {
+			sprintf(logtxt, "Interleaving 8 and 7 pulse sequences on every beam. %d rounds", mseq->rounds);
+			ErrLog(errlog,progname,logtxt);
+		}
+	}
 	SiteSetupHardware();
 
 	if (discretion) {
@@ -291,6 +306,20 @@ int main(int argc, char *argv[])
 
 	OpsFitACFStart();
 
+	/* make every sequence the scan will use before it starts */
+	TSGCacheSet(&tcache);
+	TSGCacheAdd(&tcache, ptab_8, mppul_8, mpinc_8, frang);
+	if (use_marker || interleave) {
+		TSGCacheAdd(&tcache, ptab_7, mppul_7, mpinc_7, frang);
+	}
+	n = TSGCachePreload(&tcache);
+	if (n < 0) {
+		ErrLog(errlog, progname, "TSG cache: preload failed, sequences will be made as needed.");
+	} else {
+		sprintf(logtxt, "TSG cache: %d sequences preloaded in %.3fs", n, tcache.stats.tload);
+		ErrLog(errlog, progname, logtxt);
+	}
+
 	OpsSetupTask(tasklist);
 	for (n = 0; n < tnum; n++) {
 		RMsgSndReset(tlist[n]);
@@ -369,6 +398,7 @@ int main(int argc, char *argv[])
 
             ErrLog(errlog, progname, "Setting beam.");
             SiteSetIntt(intsc, intus);
+            if (interleave) MSeqStart(mseq);
             SiteSetBeam(bmnum);
             
             /* If we're not in fixed frequency mode, do clear freq search */
@@ -399,18 +429,44 @@ int main(int argc, char *argv[])
             }
 			ErrLog(errlog, progname, logtxt);
 
-            if(use_marker) {
+            mixed = 0;
+            if(interleave) {
+                nave = MSeqIntegrate(mseq, &tcache);
+                if(nave < 0) {
+                    /* recover on the 8 pulse sequence and send that */
+                    mppul = mppul_8;
+                    mplgs = mplgs_8;
+                    mpinc = mpinc_8;
+                    tsgid = TSGCacheSeq(&tcache, ptab_8);
+                    nave = IntRecIntegrate(&irec, nave, ptab_8, lags_8);
+                    TSGCacheClear(&tcache);
+                    if(nave < 0) {
+                        spawnl(P_WAIT,"/home/radar/script/restart.radar",NULL);
+                        exit(nave);
+                    }
+                    sprintf(logtxt, "Number of sequences: %d", nave);
+                    ErrLog(errlog, progname, logtxt);
+                    OpsBuildPrm(&prm, ptab_8, lags_8);
+                } else {
+                    sprintf(logtxt,"Number of sequences [8]: %d [7]: %d",
+                            mseq->seq[0].nave, mseq->seq[1].nave);
+                    ErrLog(errlog,progname,logtxt);
+                    mixed = 1;
+                }
+            } else if(use_marker) {
                 ErrLog(errlog,progname, "Using marker pulse sequence");
                 if(marker_counter == marker_period) {
                     /* Use the 7 pulse sequence */
                     mppul = mppul_7;
                     mplgs = mplgs_7;
                     mpinc = mpinc_7;
-                    tsgid = SiteTimeSeq(ptab_7);
+                    tsgid = TSGCacheSeq(&tcache,ptab_7);
                     nave = SiteIntegrate(lags_7);
                     if(nave < 0) {
-                        sprintf(logtxt, "Integration error:%d",nave);
-                        ErrLog(errlog,progname,logtxt);
+                        nave = IntRecIntegrate(&irec,nave,ptab_7,lags_7);
+                        TSGCacheClear(&tcache);
+                    }
+                    if(nave < 0) {
                         spawnl(P_WAIT,"/home/radar/script/restart.radar",NULL);
                         exit(nave);
                     }
@@ -423,11 +479,13 @@ int main(int argc, char *argv[])
                     mppul = mppul_8;
                     mplgs = mplgs_8;
                     mpinc = mpinc_8;
-                    tsgid = SiteTimeSeq(ptab_8);
+                    tsgid = TSGCacheSeq(&tcache,ptab_8);
                     nave = SiteIntegrate(lags_8);
                     if(nave < 0) {
-                        sprintf(logtxt, "Integration error:%d",nave);
-                        ErrLog(errlog,progname,logtxt);
+                        nave = IntRecIntegrate(&irec,nave,ptab_8,lags_8);
+                        TSGCacheClear(&tcache);
+                    }
+                    if(nave < 0) {
                         spawnl(P_WAIT,"/home/radar/script/restart.radar",NULL);
                         exit(nave);
                     }
@@ -438,11 +496,13 @@ int main(int argc, char *argv[])
                 }
             } else {
                 ErrLog(errlog,progname, "Not using marker pulse sequence");
-                tsgid = SiteTimeSeq(ptab_8);
+                tsgid = TSGCacheSeq(&tcache, ptab_8);
                 nave = SiteIntegrate(lags_8);
                 if (nave < 0) {
-                    sprintf(logtxt, "Integration error:%d", nave);
-                    ErrLog(errlog, progname, logtxt);
+                    nave = IntRecIntegrate(&irec, nave, ptab_8, lags_8);
+                    TSGCacheClear(&tcache);
+                }
+                if (nave < 0) {
                     spawnl(P_WAIT,"/home/radar/script/restart.radar",NULL);
                     exit(nave);
                 }
@@ -453,21 +513,37 @@ int main(int argc, char *argv[])
                 OpsBuildPrm(&prm, ptab_8, lags_8);
             }
 
-            OpsBuildIQ(&iq);
-            OpsBuildRaw(&raw);
-
-            FitACF(&prm, &raw, &fblk, &fit);
-            ErrLog(errlog, progname, "Sending messages.");
-
-            msg.num = 0;
-            msg.tsize = 0;
-            RMsgSndAdd(&msg, sizeof(struct RadarParm),(unsigned char *)&prm, PRM_TYPE, 0);
-            RMsgSndAdd(&msg, sizeof(struct IQData),(unsigned char *)&iq, IQ_TYPE, 0);
-            RMsgSndAdd(&msg, strlen(sharedmemory) + 1, sharedmemory,IQS_TYPE, 0);
-            RMsgSndAdd(&msg, sizeof(struct RawData),(unsigned char *)&raw, RAW_TYPE, 0);
-            RMsgSndAdd(&msg, sizeof(struct FitData),(unsigned char *)&fit, FIT_TYPE, 0);
-            RMsgSndAdd(&msg, strlen(progname) + 1, progname,NME_TYPE, 0);
-            for (n = 0; n < tnum; n++) RMsgSndSend(tlist[n], &msg);
+            if (mixed) {
+                /* one record for each sequence; there are no I&Q samples */
+                ErrLog(errlog, progname, "Sending messages.");
+                for (temp = 0; temp < mseq->num; temp++) {
+                    if (mseq->seq[temp].nave == 0) continue;
+                    FitACF(mseq->seq[temp].prm, mseq->seq[temp].raw, &fblk, &fit);
+                    msg.num = 0;
+                    msg.tsize = 0;
+                    RMsgSndAdd(&msg, sizeof(struct RadarParm),(unsigned char *)mseq->seq[temp].prm, PRM_TYPE, 0);
+                    RMsgSndAdd(&msg, sizeof(struct RawData),(unsigned char *)mseq->seq[temp].raw, RAW_TYPE, 0);
+                    RMsgSndAdd(&msg, sizeof(struct FitData),(unsigned char *)&fit, FIT_TYPE, 0);
+                    RMsgSndAdd(&msg, strlen(progname) + 1, progname,NME_TYPE, 0);
+                    for (n = 0; n < tnum; n++) RMsgSndSend(tlist[n], &msg);
+                }
+            } else {
+                OpsBuildIQ(&iq);
+                OpsBuildRaw(&raw);
+
+                FitACF(&prm, &raw, &fblk, &fit);
+                ErrLog(errlog, progname, "Sending messages.");
+
+                msg.num = 0;
+                msg.tsize = 0;
+                RMsgSndAdd(&msg, sizeof(struct RadarParm),(unsigned char *)&prm, PRM_TYPE, 0);
+                RMsgSndAdd(&msg, sizeof(struct IQData),(unsigned char *)&iq, IQ_TYPE, 0);
+                RMsgSndAdd(&msg, strlen(sharedmemory) + 1, sharedmemory,IQS_TYPE, 0);
+                RMsgSndAdd(&msg, sizeof(struct RawData),(unsigned char *)&raw, RAW_TYPE, 0);
+                RMsgSndAdd(&msg, sizeof(struct FitData),(unsigned char *)&fit, FIT_TYPE, 0);
+                RMsgSndAdd(&msg, strlen(progname) + 1, progname,NME_TYPE, 0);
+                for (n = 0; n < tnum; n++) RMsgSndSend(tlist[n], &msg);
+            }
 
             ErrLog(errlog, progname, "Polling for exit.");
             exitpoll = RadarShell(sid, &rstable);
@@ -508,6 +584,12 @@ int main(int argc, char *argv[])
 	
 	SiteEnd();
 	for (n = 0; n < tnum; n++) RMsgSndClose(tlist[n]);
+	IntRecLog(&irec);
+	TSGCacheLog(&tcache, errlog, progname);
+	if (mseq != NULL) {
+		MSeqLog(mseq, errlog, progname);
+		MSeqFree(mseq);
+	}
 	ErrLog(errlog, progname, "Ending program.");
 	RShellTerminate(sid);
 	return 0;
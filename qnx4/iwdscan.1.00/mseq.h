@@ -0,0 +1,50 @@
+/* mseq.h
+   ======
+*/
+
+
+#ifndef _MSEQ_H
+#define _MSEQ_H
+
+#define MSEQ_MAX 4           /* sequences in one integration */
+#define MSEQ_ROUNDS 2        /* default passes through the sequences */
+#define MSEQ_MINSUB 100000   /* shortest sub-integration in microseconds */
+
+struct MSeqSeq {
+  int *ptab;
+  int (*lags)[2];
+  int mppul;
+  int mplgs;
+  int mpinc;
+  int nave;                  /* sequences integrated this beam */
+  double noise;              /* sum of nave*noise.search */
+  double mean;               /* sum of nave*noise.mean */
+  struct RadarParm *prm;
+  struct RawData *raw;       /* sum of nave*ACF, then the average */
+};
+
+struct MSeqStats {
+  int beams;
+  int sub;                   /* sub-integrations */
+  int empty;                 /* records with no sequences in them */
+  double tover;              /* seconds past the end of the window */
+};
+
+struct MSeq {
+  int num;
+  int rounds;
+  double tstart;             /* start of the window, from MSeqStart */
+  struct MSeqSeq seq[MSEQ_MAX];
+  struct RawData *tmp;
+  struct MSeqStats stats;
+};
+
+struct MSeq *MSeqMake(int rounds);
+void MSeqFree(struct MSeq *ptr);
+int MSeqAdd(struct MSeq *ptr,int *ptab,int (*lags)[2],int mppul,
+            int mplgs,int mpinc);
+void MSeqStart(struct MSeq *ptr);
+int MSeqIntegrate(struct MSeq *ptr,struct TSGCache *tcache);
+void MSeqLog(struct MSeq *ptr,struct TaskID *errlog,char *progname);
+
+#endif
@@ -43,9 +43,14 @@
 #include "hdw.h"
 
 #include "sndwrite.h"
+#include "sndbudget.h"
 
 /*
  $Log: normalsound.c,v $
+ Revision 3.3  2026/10/17
+ Added -sndq option to learn the time needed for each sounding
+ instead of allowing a fixed 1.25s
+
  Revision 3.2  2021/12/03 egthomas
  Modification to set default scan duration to 1-min
  (fast) and allow 2-min operation via -slow option
@@ -204,6 +209,9 @@ int main(int argc,char *argv[]) {
   int snd_frqrng=100;
   int snd_nrang=75;
   float snd_time, snd_intt, time_needed=1.25;
+  float snd_q=0;
+  struct SndBudget *sbudget=NULL;
+  struct SndBudgetStats sbstats;
   int normal_intt_sc, normal_intt_us;
   int fast_intt_sc, fast_intt_us;
   int snd_intt_sc, snd_intt_us;
@@ -307,6 +315,8 @@ int main(int argc,char *argv[]) {
   OptionAdd(&opt, "lf", 'x', &limit_fswitch);  /* limit amount of frequency switching
                                                   by iterating over all sounding beams
                                                   before proceeding to next frequency */
+  OptionAdd(&opt, "sndq", 'f', &snd_q);        /* learn time_needed, allowing for this
+                                                  quantile of the sounding overhead */
 
   arg=OptionProcess(1,argc,argv,&opt,NULL);
 
@@ -318,6 +328,12 @@ int main(int argc,char *argv[]) {
   errlog=TaskIDMake(ename);
   OpsLogStart(errlog,progname,argc,argv);
 
+  if (snd_q>0) {
+    sbudget=SndBudgetMake(time_needed,snd_q);
+    if (sbudget==NULL)
+      ErrLog(errlog,progname,"Invalid sounding quantile; using a fixed time_needed.");
+  }
+
   SiteSetupHardware();
 
   if (slow) fast = 0;
@@ -481,8 +497,13 @@ int main(int argc,char *argv[]) {
       /* minus a safety factor given in time_needed */
       TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
       snd_time = 60.0 - (sc + us*1e-6);
+      if (sbudget !=NULL) {
+        SndBudgetStart(sbudget,snd_time);
+        time_needed=SndBudgetNeed(sbudget);
+      }
 
       while (snd_time-snd_intt > time_needed) {
+        if (sbudget !=NULL) SndBudgetBegin(sbudget);
 
         /* set the beam */
         bmnum = snd_bms[snd_bm_cnt] + odd_beams;
@@ -551,6 +572,7 @@ int main(int argc,char *argv[]) {
 
         /* save the sounding mode data */
         write_snd_record(progname, &prm, &fit);
+        if (sbudget !=NULL) SndBudgetEnd(sbudget,snd_intt);
 
         ErrLog(errlog, progname, "Polling SND for exit.\n");
         exitpoll=RadarShell(sid,&rstable);
@@ -585,6 +607,20 @@ int main(int argc,char *argv[]) {
         /* see if we have enough time for another go round */
         TimeReadClock(&yr, &mo, &dy, &hr, &mt, &sc, &us);
         snd_time = 60.0 - (sc + us*1e-6);
+        if (sbudget !=NULL) time_needed=SndBudgetNeed(sbudget);
+      }
+
+      if (sbudget !=NULL) {
+        SndBudgetDone(sbudget,&sbstats);
+        sprintf(logtxt,"Sounding budget: %d soundings, overhead %.3f+/-%.3fs, "
+                "allowing %.3fs, ",sbstats.num,sbstats.mean,sbstats.sdev,
+                sbstats.need);
+        if (sbstats.slack<0)
+          sprintf(logtxt+strlen(logtxt),"overran minute by %.3fs",-sbstats.slack);
+        else sprintf(logtxt+strlen(logtxt),"%.3fs slack",sbstats.slack);
+        sprintf(logtxt+strlen(logtxt)," (%d of %d minutes overran)",
+                sbstats.overrun,sbstats.minutes);
+        ErrLog(errlog,progname,logtxt);
       }
 
       /* now wait for the next normalscan */
@@ -607,6 +643,7 @@ int main(int argc,char *argv[]) {
   for (n=0;n<tnum;n++) RMsgSndClose(tlist[n]);
   ErrLog(errlog,progname,"Ending program.");
   RShellTerminate(sid);
+  SndBudgetFree(sbudget);
   return 0;
 }
 
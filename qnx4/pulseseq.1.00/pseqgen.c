@@ -0,0 +1,266 @@
+/* pseqgen.c
+   =========
+
+   Reads the pulse sequences in pulseseq.def, checks them and writes
+   them out as the C tables of pseqtab.c. It is run by the makefile
+   when the library is built, so that a lag table that does not match
+   its pulse table stops the build:
+
+     pseqgen pulseseq.def pseqtab.c
+
+   Each lag must be a pair of pulses that are in the pulse table, the
+   lags must start with lag-0, run in order of lag and end with the
+   alternate lag-0 on the last pulse, and the whole table must fit in
+   LAG_SIZE entries. The pulse index of each lag and the first entry
+   for each lag are worked out here too, so that nothing is left to
+   do at run time.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "limit.h"
+#include "pulseseq.h"
+
+
+#define PSEQGEN_MAXSEQ 64
+
+static struct PulseSeq seq[PSEQGEN_MAXSEQ];
+static int seqline[PSEQGEN_MAXSEQ];
+static int seqnum=0;
+static int lagnum[PSEQGEN_MAXSEQ];
+static char *fname;
+
+
+static void PseqError(int line,char *txt,char *name) {
+  if (name !=NULL) fprintf(stderr,"%s:%d: %s: %s\n",fname,line,name,txt);
+  else fprintf(stderr,"%s:%d: %s\n",fname,line,txt);
+  exit(1);
+}
+
+
+static int PseqPulse(struct PulseSeq *ptr,int pos) {
+  int n;
+
+  for (n=0;n<ptr->mppul;n++) if (ptr->ptab[n]==pos) return n;
+  return -1;
+}
+
+
+static void PseqRead(FILE *fp) {
+  struct PulseSeq *ptr=NULL;
+  char buf[1024];
+  char name[256];
+  char *tok;
+  int line=0;
+  int a,b,n;
+
+  while (fgets(buf,sizeof(buf),fp) !=NULL) {
+    line++;
+    if (strchr(buf,'#') !=NULL) *strchr(buf,'#')=0;
+    tok=strtok(buf," \t\r\n");
+    if (tok==NULL) continue;
+
+    if (strcmp(tok,"seq")==0) {
+      if (seqnum==PSEQGEN_MAXSEQ) PseqError(line,"too many sequences",NULL);
+      ptr=&seq[seqnum];
+      memset(ptr,0,sizeof(struct PulseSeq));
+      tok=strtok(NULL," \t\r\n");
+      if (tok==NULL) PseqError(line,"sequence has no name",NULL);
+      for (n=0;n<seqnum;n++)
+        if (strcmp(seq[n].name,tok)==0)
+          PseqError(line,"sequence is defined twice",tok);
+      ptr->name=strdup(tok);
+      tok=strtok(NULL," \t\r\n");
+      if ((tok==NULL) || (sscanf(tok,"%d",&ptr->mplgs) !=1) ||
+          (ptr->mplgs<1)) PseqError(line,"bad mplgs",ptr->name);
+      seqline[seqnum]=line;
+      lagnum[seqnum]=0;
+      seqnum++;
+      continue;
+    }
+
+    if (ptr==NULL) PseqError(line,"expected seq",NULL);
+    sprintf(name,"%s",ptr->name);
+
+    if (strcmp(tok,"ptab")==0) {
+      if (ptr->mppul !=0) PseqError(line,"pulse table given twice",name);
+      while ((tok=strtok(NULL," \t\r\n")) !=NULL) {
+        if (ptr->mppul==PSEQ_MAXPUL)
+          PseqError(line,"too many pulses",name);
+        if (sscanf(tok,"%d",&ptr->ptab[ptr->mppul]) !=1)
+          PseqError(line,"bad pulse position",name);
+        ptr->mppul++;
+      }
+    } else if (strcmp(tok,"lags")==0) {
+      if (ptr->mppul==0) PseqError(line,"lags given before ptab",name);
+      while ((tok=strtok(NULL," \t\r\n")) !=NULL) {
+        if (lagnum[seqnum-1]==LAG_SIZE)
+          PseqError(line,"more lags than LAG_SIZE",name);
+        if (sscanf(tok,"%d:%d",&a,&b) !=2)
+          PseqError(line,"bad lag, expected first:second",name);
+        ptr->lags[lagnum[seqnum-1]][0]=a;
+        ptr->lags[lagnum[seqnum-1]][1]=b;
+        lagnum[seqnum-1]++;
+      }
+    } else PseqError(line,"expected seq, ptab or lags",name);
+  }
+}
+
+
+static void PseqCheck(int s) {
+  struct PulseSeq *ptr=&seq[s];
+  char txt[256];
+  int line=seqline[s];
+  int n,i,lag,last=0;
+
+  if (ptr->mppul<2) PseqError(line,"fewer than two pulses",ptr->name);
+  if (ptr->ptab[0] !=0) PseqError(line,"first pulse is not at 0",ptr->name);
+  for (n=1;n<ptr->mppul;n++)
+    if (ptr->ptab[n]<=ptr->ptab[n-1])
+      PseqError(line,"pulse table is not in order",ptr->name);
+
+  if (lagnum[s]<2) PseqError(line,"fewer than two lags",ptr->name);
+  if ((ptr->lags[0][0] !=0) || (ptr->lags[0][1] !=0))
+    PseqError(line,"first lag is not 0:0",ptr->name);
+  n=lagnum[s]-1;
+  if ((ptr->lags[n][0] !=ptr->ptab[ptr->mppul-1]) ||
+      (ptr->lags[n][1] !=ptr->ptab[ptr->mppul-1]))
+    PseqError(line,"last lag is not the alternate lag-0 on the last pulse",
+              ptr->name);
+
+  ptr->lagnum=lagnum[s]-1;
+  if (ptr->mplgs>ptr->lagnum) PseqError(line,"mplgs is more than the lags",
+                                        ptr->name);
+  for (n=0;n<PSEQ_MAXLAG;n++) ptr->lagidx[n]=-1;
+
+  for (n=0;n<lagnum[s];n++) {
+    ptr->lagpul[n][0]=PseqPulse(ptr,ptr->lags[n][0]);
+    ptr->lagpul[n][1]=PseqPulse(ptr,ptr->lags[n][1]);
+    if ((ptr->lagpul[n][0]<0) || (ptr->lagpul[n][1]<0)) {
+      sprintf(txt,"lag %d:%d is not a pair of pulses",
+              ptr->lags[n][0],ptr->lags[n][1]);
+      PseqError(line,txt,ptr->name);
+    }
+    if (n==lagnum[s]-1) break;
+
+    lag=ptr->lags[n][1]-ptr->lags[n][0];
+    if ((lag<0) || ((n>0) && (lag==0))) {
+      sprintf(txt,"lag %d:%d is not a positive lag",
+              ptr->lags[n][0],ptr->lags[n][1]);
+      PseqError(line,txt,ptr->name);
+    }
+    if (lag<last) {
+      sprintf(txt,"lag %d:%d is out of order",
+              ptr->lags[n][0],ptr->lags[n][1]);
+      PseqError(line,txt,ptr->name);
+    }
+    if (lag>=PSEQ_MAXLAG) PseqError(line,"lag is too long",ptr->name);
+    for (i=0;i<n;i++) {
+      if ((ptr->lags[i][0]==ptr->lags[n][0]) &&
+          (ptr->lags[i][1]==ptr->lags[n][1])) {
+        sprintf(txt,"lag %d:%d is given twice",
+                ptr->lags[n][0],ptr->lags[n][1]);
+        PseqError(line,txt,ptr->name);
+      }
+    }
+    if (ptr->lagidx[lag]==-1) ptr->lagidx[lag]=n;
+    last=lag;
+  }
+  ptr->lagmax=last;
+}
+
+
+static void PseqList(FILE *fp,int *val,int num) {
+  int n;
+
+  fprintf(fp,"   {");
+  for (n=0;n<num;n++) {
+    if ((n>0) && (n % 16==0)) fprintf(fp,"\n    ");
+    fprintf(fp,"%d%s",val[n],(n<num-1) ? "," : "");
+  }
+  fprintf(fp,"}");
+}
+
+
+static void PseqPairs(FILE *fp,int (*val)[2],int num) {
+  int n;
+
+  fprintf(fp,"   {");
+  for (n=0;n<num;n++) {
+    if ((n>0) && (n % 8==0)) fprintf(fp,"\n    ");
+    fprintf(fp,"{%d,%d}%s",val[n][0],val[n][1],(n<num-1) ? "," : "");
+  }
+  fprintf(fp,"}");
+}
+
+
+static void PseqWrite(FILE *fp) {
+  struct PulseSeq *ptr;
+  int n,mxlag=0;
+
+  for (n=0;n<seqnum;n++)
+    if (seq[n].lagnum+1>mxlag) mxlag=seq[n].lagnum+1;
+
+  fprintf(fp,"/* pseqtab.c\n   =========\n\n"
+             "   Written by pseqgen from %s; do not edit.\n*/\n\n\n",fname);
+  fprintf(fp,"#include <stdio.h>\n#include \"limit.h\"\n"
+             "#include \"pulseseq.h\"\n\n\n");
+  fprintf(fp,"/* the longest table is %d lags; stop the build if LAG_SIZE "
+             "has shrunk\n   since pseqgen checked it */\n\n",mxlag);
+  fprintf(fp,"typedef char PulseSeqLagSize[(%d<=LAG_SIZE) ? 1 : -1];\n\n",
+          mxlag);
+
+  fprintf(fp,"struct PulseSeq PulseSeqTable[]={\n");
+  for (n=0;n<seqnum;n++) {
+    ptr=&seq[n];
+    fprintf(fp,"  {\"%s\",%d,%d,%d,%d,\n",ptr->name,ptr->mppul,ptr->mplgs,
+            ptr->lagnum,ptr->lagmax);
+    PseqList(fp,ptr->ptab,ptr->mppul);
+    fprintf(fp,",\n");
+    PseqPairs(fp,ptr->lags,ptr->lagnum+1);
+    fprintf(fp,",\n");
+    PseqPairs(fp,ptr->lagpul,ptr->lagnum+1);
+    fprintf(fp,",\n");
+    PseqList(fp,ptr->lagidx,PSEQ_MAXLAG);
+    fprintf(fp,"}%s\n",(n<seqnum-1) ? "," : "");
+  }
+  fprintf(fp,"};\n\nint PulseSeqNum=%d;\n",seqnum);
+}
+
+
+int main(int argc,char *argv[]) {
+  FILE *fp;
+  int n;
+
+  if (argc<3) {
+    fprintf(stderr,"pseqgen pulseseq.def pseqtab.c\n");
+    exit(1);
+  }
+
+  fname=argv[1];
+  fp=fopen(fname,"r");
+  if (fp==NULL) {
+    fprintf(stderr,"Unable to open %s.\n",fname);
+    exit(1);
+  }
+  PseqRead(fp);
+  fclose(fp);
+
+  if (seqnum==0) PseqError(0,"no sequences",NULL);
+  for (n=0;n<seqnum;n++) PseqCheck(n);
+
+  fp=fopen(argv[2],"w");
+  if (fp==NULL) {
+    fprintf(stderr,"Unable to create %s.\n",argv[2]);
+    exit(1);
+  }
+  PseqWrite(fp);
+  if (fclose(fp) !=0) {
+    remove(argv[2]);
+    exit(1);
+  }
+  fprintf(stderr,"%d pulse sequences written to %s\n",seqnum,argv[2]);
+  return 0;
+}
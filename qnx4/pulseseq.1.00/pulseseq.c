@@ -0,0 +1,37 @@
+/* pulseseq.c
+   ==========
+
+   Looks up the pulse sequences built into the library. The tables
+   themselves are in pseqtab.c, which pseqgen writes from
+   pulseseq.def when the library is built, so a lag table that does
+   not match its pulse table stops the build rather than a radar.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "limit.h"
+#include "pulseseq.h"
+
+
+struct PulseSeq *PulseSeqFind(char *name) {
+  int n;
+
+  if (name==NULL) return NULL;
+  for (n=0;n<PulseSeqNum;n++)
+    if (strcmp(PulseSeqTable[n].name,name)==0) return &PulseSeqTable[n];
+  return NULL;
+}
+
+
+/* sample offset of each pulse from the first; mpinc must be a
+   multiple of smsep for the pulses to fall on samples */
+
+int PulseSeqSamples(struct PulseSeq *ptr,int mpinc,int smsep,int *off) {
+  int n;
+
+  if ((ptr==NULL) || (smsep<=0) || (mpinc % smsep !=0)) return -1;
+  for (n=0;n<ptr->mppul;n++) off[n]=ptr->ptab[n]*(mpinc/smsep);
+  return 0;
+}
@@ -0,0 +1,33 @@
+/* pulseseq.h
+   ==========
+*/
+
+
+#ifndef _PULSESEQ_H
+#define _PULSESEQ_H
+
+#define PSEQ_MAXPUL 32
+#define PSEQ_MAXLAG 128     /* longest lag, in units of mpinc */
+
+/* the tables are shared by every program that uses the sequence and
+   must not be changed */
+
+struct PulseSeq {
+  char *name;
+  int mppul;
+  int mplgs;
+  int lagnum;                /* entries in lags before the alternate lag-0 */
+  int lagmax;                /* longest lag, in units of mpinc */
+  int ptab[PSEQ_MAXPUL];
+  int lags[LAG_SIZE][2];     /* pulse pairs, in units of mpinc */
+  int lagpul[LAG_SIZE][2];   /* the same pairs as indices into ptab */
+  int lagidx[PSEQ_MAXLAG];   /* first entry in lags for each lag, or -1 */
+};
+
+extern struct PulseSeq PulseSeqTable[];
+extern int PulseSeqNum;
+
+struct PulseSeq *PulseSeqFind(char *name);
+int PulseSeqSamples(struct PulseSeq *ptr,int mpinc,int smsep,int *off);
+
+#endif
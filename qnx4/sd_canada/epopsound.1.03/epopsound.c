@@ -38,8 +38,14 @@
 #include "interface.h"
 #include "hdw.h"
 #include "freq.h"
+#include "epoptab.h"
 /*
  * $Log: epopsound.c,v $ 
+ * Revision 1.04 2026/10/17
+ * The conjunction file is read into a table sorted by start time
+ * and the pass found with a binary search; the file is read again
+ * in the background when it changes
+ *
  * Revision 1.03 2018/07/26 22:00:00 KKrieger
  * Addition of option to change integration time
  *
@@ -66,21 +72,6 @@ char cmdlne[1024];
 char progid[80] = { "$Id: epopsound.c,v 1.03 2018/07/26 22:00:00 KKrieger Exp $" };
 char progname[256];
 
-/*
- * Keep track of all details of an epop pass frequency in kHz beam number 
- * (indexed from 0) start time, stop time, duration that epop is in beam, in
- * float seconds
- * 
- * define an Epop_Pass by: Epop_Pass some_epop_pass 
- */
-typedef struct Epop_Pass {
-	int freq_khz;
-	int beam;
-	struct tm start;
-	struct tm stop;
-	float duration_s;
-} Epop_Pass;
-
 /*
  * Get a file descriptor to open up the epop_passes file 
  */
@@ -177,8 +168,6 @@ int main(int argc, char *argv[])
 	char *sdname = { SCHEDULER };
 	char *edname = { ERRLOG };
 	char logtxt[1024];
-	char pass_buffer[1024];	/* Buffer to store passes information */
-	FILE *fp = NULL;
 
 	/*
 	 * What is the file name for the epop passes file? 
@@ -189,8 +178,14 @@ int main(int argc, char *argv[])
 	/*
 	 * Keep track of current pass and next pass 
 	 */
-	Epop_Pass current_pass;
-	Epop_Pass next_pass;
+	struct EpopPass current_pass;
+	struct EpopPass next_pass;
+	struct EpopPass *pass;
+
+	/*
+	 * The passes read from the file, sorted by start time
+	 */
+	struct EpopTable *passes = NULL;
 
 	int n;
 	pid_t sid;
@@ -207,8 +202,8 @@ int main(int argc, char *argv[])
 	int freq_counter = 0; /* Counter to decide when to transmit what frequency */
 
 	/*
-	 * Flags for default_mode and next_pass_found are set while scanning
-	 * conjunction file, as well as current_conjunction
+	 * Flags for default_mode and next_pass_found are set from the
+	 * pass table at the start of each scan, as well as current_conjunction
 	 */
 	int default_mode = 0;
 	int next_pass_found = 0;
@@ -217,11 +212,6 @@ int main(int argc, char *argv[])
 	/* variable for temporary use */
 	int temp = 0;
 
-	/* Double to store time diffs */
-	double time_diff = 0;
-	/* Time structure to store time */
-	time_t time_of_day;
-
 	unsigned char discretion = 0;
 
 	/*
@@ -351,11 +341,18 @@ int main(int argc, char *argv[])
 		ErrLog(errlog, progname, logtxt);
 		epop_passes_fname = default_epop_passes_fname;
 	}
-	fp = fopen(epop_passes_fname, "r");
-	if (fp == NULL) {
-		sprintf(logtxt,"Error # %d opening epop conjuction file: %s",errno, epop_passes_fname);
+	passes = EpopTableMake(epop_passes_fname);
+	if (passes == NULL) {
+		ErrLog(errlog, progname, "Unable to allocate epop pass table.");
+		default_mode = 1;
+	} else if (passes->list.num == 0) {
+		sprintf(logtxt,"No passes read from epop conjuction file: %s",epop_passes_fname);
 		ErrLog(errlog, progname, logtxt);
 		default_mode = 1;
+	} else {
+		sprintf(logtxt,"Read %d passes from epop conjunction file: %s (%d lines rejected, %d overlapping passes dropped)",
+			passes->list.num, epop_passes_fname, passes->list.bad, passes->list.overlap);
+		ErrLog(errlog, progname, logtxt);
 	}
 	OpsFitACFStart();
 
@@ -366,177 +363,40 @@ int main(int argc, char *argv[])
 	}
 
 	do {/* while(exitpoll == 0) */
-		/* Check state here */
-		if(!default_mode) {
-			if (current_conjunction) {
-				if (difftime(time(NULL),mktime(&current_pass.stop)) > 0) {
-					current_conjunction = 0;
-				}
-			}
-			if (next_pass_found) {
-				if (difftime(time(NULL),mktime(&next_pass.start)) > 0) {
-					current_conjunction = 1;
-					current_pass = next_pass;
-					next_pass_found = 0;
-				}
-			}
-		}
-		if (current_conjunction) ErrLog(errlog, progname, "state: current_conjunction");
-		if (default_mode) ErrLog(errlog, progname, "state: default_mode");
-		if (next_pass_found) ErrLog(errlog, progname, "state: next_pass_found");
-		
-		/* Only if we have a file open and no current conjunction or next pass should we check the file*/
-		if (fp != NULL &&  current_conjunction == 0 && next_pass_found == 0) {
-			sprintf(logtxt,"Scanning epop conjunction file: %s",epop_passes_fname);
-			ErrLog(errlog, progname, logtxt);
-
-			/*
-			 * Read lines until you find one that has a stop time in the
-			 * future, in which case: if start time is in past, then set mode
-			 * to that freq and beam else go to default mode until start time
-			 * or until you reach EOF, in which case you just go to default
-			 * mode. 
-			 */
-			do { /*while (!next_pass_found && !default_mode);*/
-
-				/* Need to set dst bits to 0 or they will make our time values incorrect */
-				current_pass.start.tm_isdst = 0;
-				current_pass.stop.tm_isdst = 0;
-				next_pass.start.tm_isdst = 0;
-				next_pass.stop.tm_isdst = 0;
-			
-				if (fgets(pass_buffer, 1024, fp) == NULL) {
-					if (!feof(fp)) {
-						ErrLog(errlog, progname,"Unable to successfully read all of conjunction.");
-						/*
-						 * Set status to default, since we couldn't read conjunction  
-						 */
-						default_mode = 1;
-						next_pass_found = 0;
-						current_conjunction = 0;
-					} else {
-						/*
-						 * Reached eof, so set status to default mode
-						 */
-						ErrLog(errlog, progname,"Reached end of file without finding a current or future pass.");
-						ErrLog(errlog, progname,"Setting default mode.");
-						default_mode = 1;
-						next_pass_found = 0;
-						current_conjunction = 0;
-					}
-				} else {
-					ErrLog(errlog, progname,"Read pass successfully, scanning with sscanf");
-					ErrLog(errlog, progname,pass_buffer);
-					if (sscanf
-					    (pass_buffer,
-					     "%d %d %d %d %d %d %d %d %d %d %d %d %d %d %f",
-					     &next_pass.freq_khz,
-					     &next_pass.beam,
-					     &next_pass.start.tm_year,
-					     &next_pass.start.tm_mon,
-					     &next_pass.start.tm_mday,
-					     &next_pass.start.tm_hour,
-					     &next_pass.start.tm_min,
-					     &next_pass.start.tm_sec,
-					     &next_pass.stop.tm_year,
-					     &next_pass.stop.tm_mon,
-					     &next_pass.stop.tm_mday,
-					     &next_pass.stop.tm_hour,
-					     &next_pass.stop.tm_min,
-					     &next_pass.stop.tm_sec,
-					     &next_pass.duration_s) != 15) {
-						/*
-						 * error scanning input file. Print message to errlog
-						 * and go to default mode. 
-						 */
-						sprintf(logtxt,
-							"ERROR: Unsuccessfully scanned input pass! Going to default mode");
-						ErrLog(errlog, progname,
-						       logtxt);
-						default_mode = 1;
-						next_pass_found = 0;
-						current_conjunction = 0;
-					} else {
-						/*
-						 * The month is indexed from 0 in the tm struct, so
-						 * remove 1 from the structs. The year is indexed from 1900
-						 * so remove 1900 from year. 
-						 */
-						next_pass.start.tm_mon = next_pass.start.tm_mon - 1;
-						next_pass.stop.tm_mon = next_pass.stop.tm_mon - 1;
-						next_pass.start.tm_year = next_pass.start.tm_year - 1900;
-						next_pass.stop.tm_year = next_pass.stop.tm_year - 1900;
-						sprintf(logtxt,
-							"Freq kHz: %d\nBeam: %d\nStart: %d %d %d %d %d %d\nStop: %d %d %d %d %d %d\nDuration: %f",
-							next_pass.freq_khz,
-							next_pass.beam,
-							next_pass.start.tm_year+1900,
-							next_pass.start.tm_mon+1,
-							next_pass.start.tm_mday,
-							next_pass.start.tm_hour,
-							next_pass.start.tm_min,
-							next_pass.start.tm_sec,
-							next_pass.stop.tm_year+1900,
-							next_pass.stop.tm_mon+1,
-							next_pass.stop.tm_mday,
-							next_pass.stop.tm_hour,
-							next_pass.stop.tm_min,
-							next_pass.stop.tm_sec,
-							next_pass.duration_s);
-						ErrLog(errlog, progname,logtxt);
-
-						sprintf(logtxt,"Duration calculated: %d seconds", (int)difftime(mktime(&next_pass.stop),mktime(&next_pass.start)));
-						ErrLog(errlog, progname,logtxt);
-						
-						/* Compare stop time with current time */
-						time_of_day = time(NULL);
-						sprintf(logtxt, "Current time: %s ", ctime(&time_of_day));
-						ErrLog(errlog,progname,logtxt);
-						time_of_day = mktime(&next_pass.stop);
-						sprintf(logtxt, "Pass stop time: %s ", ctime(&time_of_day));
-						ErrLog(errlog,progname,logtxt);
-						time_diff = difftime(mktime(&next_pass.stop),time(NULL));
-						sprintf(logtxt, "Difference in time from now to pass: %f seconds", time_diff);
-						ErrLog(errlog,progname, logtxt);
-						if(time_diff > 0.0) {
-							/*
-							 * Stop time is in the future, so we found our next pass
-							 */
-							next_pass_found = 1;
-							default_mode = 0;
-							ErrLog(errlog, progname,"Next pass found");
-						} else {
-							ErrLog(errlog,progname, "Stop time is in the past..keep looking.");
-						}
-					}
-				}
-				/*
-				 * we don't have a current or future pass yet, or we haven't
-				 * reached EOF yet 
-				 */
-			} while (!next_pass_found && !default_mode);
-		}
-
 		/*
-		 * Here we should either be in default mode or have a next pass to
-		 * wait for 
+		 * Find the pass under way, or the next one to start, in the
+		 * pass table; the file is only read again when it changes
 		 */
-		if (!default_mode) {
-			if (time_diff = difftime(time(NULL), mktime(&next_pass.start)) > 0.0) {
-				/* IF the next pass' start time is in the past... then we should make it the current pass */
-				current_pass = next_pass;
-				current_conjunction = 1;
+		if (passes != NULL) {
+			if (EpopTablePoll(passes)) {
+				sprintf(logtxt,"Reloaded epop conjunction file: %d passes (%d lines rejected, %d overlapping passes dropped)",
+					passes->list.num, passes->list.bad, passes->list.overlap);
+				ErrLog(errlog, progname, logtxt);
+			}
+			pass = EpopTableFind(passes, time(NULL), &current_conjunction);
+			if (pass == NULL) {
+				if (!default_mode)
+					ErrLog(errlog, progname,"No current or future pass. Setting default mode.");
+				default_mode = 1;
+				next_pass_found = 0;
+			} else if (current_conjunction) {
+				current_pass = *pass;
+				default_mode = 0;
 				next_pass_found = 0;
 				sprintf(logtxt,"Current pass: %d seconds left, beam %d at freq %d kHz",
-					(int)difftime(mktime(&current_pass.stop),time(NULL)), current_pass.beam,current_pass.freq_khz);
+					(int)difftime(current_pass.stop,time(NULL)), current_pass.beam,current_pass.freq_khz);
 				ErrLog(errlog, progname, logtxt);
 			} else {
+				next_pass = *pass;
+				default_mode = 0;
 				next_pass_found = 1;
-				current_conjunction = 0;
-				sprintf(logtxt,"Next pass is %d seconds in future",(int)difftime(time(NULL),mktime(&next_pass.start)));
+				sprintf(logtxt,"Next pass is %d seconds in future",(int)difftime(next_pass.start,time(NULL)));
 				ErrLog(errlog, progname, logtxt);
 			}
 		}
+		if (current_conjunction) ErrLog(errlog, progname, "state: current_conjunction");
+		if (default_mode) ErrLog(errlog, progname, "state: default_mode");
+		if (next_pass_found) ErrLog(errlog, progname, "state: next_pass_found");
 
 		/*
 		 * Currently SiteStartScan() just returns 1 
@@ -754,6 +614,6 @@ int main(int argc, char *argv[])
 	for (n = 0; n < tnum; n++) RMsgSndClose(tlist[n]);
 	ErrLog(errlog, progname, "Ending program.");
 	RShellTerminate(sid);
-	if ((fp != NULL) && (fp != stderr))	fclose(fp);
+	EpopTableFree(passes);
 	return 0;
 }
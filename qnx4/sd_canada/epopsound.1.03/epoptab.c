@@ -0,0 +1,180 @@
+/* epoptab.c
+   =========
+
+   The EPOP conjunction schedule. The pass file is read once into a
+   table of passes with their start and stop times as epoch seconds,
+   sorted by start time, so the pass for the current time is found
+   with a binary search instead of reading on through the file.
+
+   EpopTablePoll is called once a scan and checks the modification
+   time of the file. If it has changed the file is read again there
+   and then; it is a few hundred lines at most and only changes when
+   a new schedule is installed. If it cannot be opened the old table
+   is kept and the file is tried again on the next poll.
+
+   Each line of the file is the frequency [kHz], beam, start and stop
+   time as year month day hour minute second, and the duration [s].
+   Lines that cannot be read are skipped and counted. The search
+   relies on the passes not overlapping, so a pass that starts before
+   the one ahead of it has stopped is dropped and counted as well.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "epoptab.h"
+
+
+static time_t EpopTableMtime(char *fname) {
+  struct stat buf;
+
+  if (stat(fname,&buf) !=0) return 0;
+  return buf.st_mtime;
+}
+
+
+static int EpopTableCmp(const void *a,const void *b) {
+  struct EpopPass *x=(struct EpopPass *) a;
+  struct EpopPass *y=(struct EpopPass *) b;
+
+  if (x->start<y->start) return -1;
+  if (x->start>y->start) return 1;
+  return 0;
+}
+
+
+/* returns -1 if the file could not be opened */
+
+static int EpopTableRead(char *fname,struct EpopList *list) {
+  FILE *fp;
+  char buf[1024];
+  struct EpopPass *tmp;
+  struct tm start,stop;
+  int max=0;
+  int n,m;
+
+  memset(list,0,sizeof(struct EpopList));
+  list->mtime=EpopTableMtime(fname);
+  fp=fopen(fname,"r");
+  if (fp==NULL) return -1;
+
+  while (fgets(buf,1024,fp) !=NULL) {
+    if (list->num==max) {
+      max+=64;
+      tmp=realloc(list->pass,sizeof(struct EpopPass)*max);
+      if (tmp==NULL) break;
+      list->pass=tmp;
+    }
+    memset(&start,0,sizeof(struct tm));
+    memset(&stop,0,sizeof(struct tm));
+    if (sscanf(buf,"%d %d %d %d %d %d %d %d %d %d %d %d %d %d %f",
+               &list->pass[list->num].freq_khz,
+               &list->pass[list->num].beam,
+               &start.tm_year,&start.tm_mon,&start.tm_mday,
+               &start.tm_hour,&start.tm_min,&start.tm_sec,
+               &stop.tm_year,&stop.tm_mon,&stop.tm_mday,
+               &stop.tm_hour,&stop.tm_min,&stop.tm_sec,
+               &list->pass[list->num].duration_s) !=15) {
+      list->bad++;
+      continue;
+    }
+    start.tm_mon-=1;
+    stop.tm_mon-=1;
+    start.tm_year-=1900;
+    stop.tm_year-=1900;
+    list->pass[list->num].start=mktime(&start);
+    list->pass[list->num].stop=mktime(&stop);
+    list->num++;
+  }
+  fclose(fp);
+  if (list->num<2) return 0;
+
+  qsort(list->pass,list->num,sizeof(struct EpopPass),EpopTableCmp);
+  for (n=1,m=1;n<list->num;n++) {
+    if (list->pass[n].start<list->pass[m-1].stop) {
+      list->overlap++;
+      continue;
+    }
+    if (m !=n) list->pass[m]=list->pass[n];
+    m++;
+  }
+  list->num=m;
+  return 0;
+}
+
+
+struct EpopTable *EpopTableMake(char *fname) {
+  struct EpopTable *ptr;
+
+  ptr=malloc(sizeof(struct EpopTable));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct EpopTable));
+  ptr->fname=malloc(strlen(fname)+1);
+  if (ptr->fname==NULL) {
+    free(ptr);
+    return NULL;
+  }
+  strcpy(ptr->fname,fname);
+
+  EpopTableRead(ptr->fname,&ptr->list);
+  ptr->mtime=ptr->list.mtime;
+  return ptr;
+}
+
+
+void EpopTableFree(struct EpopTable *ptr) {
+  if (ptr==NULL) return;
+  if (ptr->list.pass !=NULL) free(ptr->list.pass);
+  free(ptr->fname);
+  free(ptr);
+}
+
+
+/* returns 1 if the file has changed and been read again */
+
+int EpopTablePoll(struct EpopTable *ptr) {
+  struct EpopList list;
+  time_t mtime;
+
+  mtime=EpopTableMtime(ptr->fname);
+  if (mtime==ptr->mtime) return 0;
+
+  if (EpopTableRead(ptr->fname,&list) !=0) {
+    if (list.pass !=NULL) free(list.pass);
+    return 0;
+  }
+  if (ptr->list.pass !=NULL) free(ptr->list.pass);
+  memcpy(&ptr->list,&list,sizeof(struct EpopList));
+  ptr->mtime=ptr->list.mtime;
+  return 1;
+}
+
+
+/* returns the pass under way at tval, setting current, or else the
+   next one to start; NULL if there are no more passes */
+
+struct EpopPass *EpopTableFind(struct EpopTable *ptr,time_t tval,
+                               int *current) {
+  int lo=0,hi,mid;
+
+  *current=0;
+
+  /* lo is the first pass starting after tval */
+  hi=ptr->list.num;
+  while (lo<hi) {
+    mid=(lo+hi)/2;
+    if (ptr->list.pass[mid].start<=tval) lo=mid+1;
+    else hi=mid;
+  }
+
+  if ((lo>0) && (ptr->list.pass[lo-1].stop>tval)) {
+    *current=1;
+    return &ptr->list.pass[lo-1];
+  }
+  if (lo<ptr->list.num) return &ptr->list.pass[lo];
+  return NULL;
+}
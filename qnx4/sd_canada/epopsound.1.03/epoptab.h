@@ -0,0 +1,36 @@
+/* epoptab.h
+   =========
+*/
+
+
+#ifndef _EPOPTAB_H
+#define _EPOPTAB_H
+
+struct EpopPass {
+  int freq_khz;
+  int beam;
+  time_t start;
+  time_t stop;
+  float duration_s;
+};
+
+struct EpopList {
+  int num;
+  int bad;           /* lines that could not be read */
+  int overlap;       /* passes dropped for overlapping the one before */
+  time_t mtime;
+  struct EpopPass *pass;
+};
+
+struct EpopTable {
+  char *fname;
+  time_t mtime;      /* modification time of the file last loaded */
+  struct EpopList list;
+};
+
+struct EpopTable *EpopTableMake(char *fname);
+void EpopTableFree(struct EpopTable *ptr);
+int EpopTablePoll(struct EpopTable *ptr);
+struct EpopPass *EpopTableFind(struct EpopTable *ptr,time_t tval,int *current);
+
+#endif
@@ -0,0 +1,125 @@
+/* intrec.c
+   ========
+
+   Recovers from a failed integration without restarting the radar.
+   The failure is worked through in steps, each more drastic than the
+   last: the integration is tried again as it stands, then the timing
+   sequence is reloaded with SiteTimeSeq, then the hardware is reset
+   with SiteSetupHardware and the beam and frequency are set again.
+   The failed integration has used up the window that SiteSetIntt
+   armed, so every step arms it again before it integrates, and a
+   step only counts as a recovery if it transmits at least one
+   sequence. Only if all of those fail does the caller fall back on
+   restart.radar.
+
+   Each step costs at most one integration, so a fault that clears at
+   the first step loses one beam rather than the rest of the scan and
+   the time taken to restart. The step that cleared each fault and the
+   time it took are kept and written to the error log by IntRecLog.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "radar.h"
+#include "rprm.h"
+#include "iqdata.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "taskid.h"
+#include "errlog.h"
+#include "tsg.h"
+#include "global.h"
+#include "setup.h"
+#include "tmseq.h"
+#include "interface.h"
+#include "hdw.h"
+#include "intrec.h"
+
+
+static char *intrec_name[]={"retry","timing sequence","hardware reset",
+                            "restart"};
+
+
+static double IntRecTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_REALTIME,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+void IntRecSet(struct IntRec *ptr,struct TaskID *errlog,char *progname) {
+  memset(ptr,0,sizeof(struct IntRec));
+  ptr->errlog=errlog;
+  ptr->progname=progname;
+}
+
+
+/* called with the nave of the failed SiteIntegrate; returns the nave
+   of the first integration that transmits any sequences, or a
+   negative value if none did and the radar has to be restarted */
+
+int IntRecIntegrate(struct IntRec *ptr,int nave,int *ptab,
+                    int (*lags)[2]) {
+  char logtxt[256];
+  double tval,dt;
+  int tier;
+
+  tval=IntRecTime();
+  ptr->stats.faults++;
+
+  for (tier=INTREC_RETRY;tier<INTREC_FAIL;tier++) {
+    sprintf(logtxt,"Integration error:%d, trying %s.",nave,
+            intrec_name[tier]);
+    ErrLog(ptr->errlog,ptr->progname,logtxt);
+
+    if (tier==INTREC_HDW) {
+      SiteSetupHardware();
+      SiteSetBeam(bmnum);
+      SiteSetFreq(tfreq);
+    }
+    if (tier>=INTREC_TSG) tsgid=SiteTimeSeq(ptab);
+
+    SiteSetIntt(intsc,intus);
+    nave=SiteIntegrate(lags);
+    if (nave>0) break;
+  }
+  if ((tier==INTREC_FAIL) && (nave>=0)) nave=-1;
+
+  dt=IntRecTime()-tval;
+  ptr->stats.num[tier]++;
+  ptr->stats.tsum[tier]+=dt;
+  if (dt>ptr->stats.tmax) ptr->stats.tmax=dt;
+
+  if (tier<INTREC_FAIL)
+    sprintf(logtxt,"Integration recovered by %s in %.2fs.",
+            intrec_name[tier],dt);
+  else sprintf(logtxt,"Integration not recovered after %.2fs.",dt);
+  ErrLog(ptr->errlog,ptr->progname,logtxt);
+  IntRecLog(ptr);
+  return nave;
+}
+
+
+void IntRecLog(struct IntRec *ptr) {
+  char logtxt[256];
+  int tier;
+
+  if (ptr->stats.faults==0) return;
+  sprintf(logtxt,"Integration faults:%d",ptr->stats.faults);
+  for (tier=0;tier<INTREC_NTIER;tier++) {
+    if (ptr->stats.num[tier]==0) continue;
+    sprintf(logtxt+strlen(logtxt),", %s %d (mean %.2fs)",
+            intrec_name[tier],ptr->stats.num[tier],
+            ptr->stats.tsum[tier]/ptr->stats.num[tier]);
+  }
+  sprintf(logtxt+strlen(logtxt),", max %.2fs",ptr->stats.tmax);
+  ErrLog(ptr->errlog,ptr->progname,logtxt);
+}
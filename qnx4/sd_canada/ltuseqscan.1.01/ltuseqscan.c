@@ -78,9 +78,14 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "intrec.h"
 
 /*
  $Log: ltuseqscan.c,v $
+ Revision 1.2  2026/10/17 12:00:00
+ Recover from integration errors in process (intrec.c) and only
+ restart the radar if that fails
+
  Revision 1.1  2012/07/25 18:30:00  DAndre
  Initial Modification from normalscan
  
@@ -162,6 +167,8 @@ int main(int argc,char *argv[]) {
   int ltuStartFreqs[] = {9050, 10210, 10950, 11800, 13420, 14420, 16160, 17420};
   int ltuNoOfFreqs = 0;
 
+  struct IntRec irec;
+
   strcpy(cmdlne,argv[0]);
   for (n=1;n<argc;n++) {
     strcat(cmdlne," ");
@@ -227,6 +234,7 @@ int main(int argc,char *argv[]) {
 
   errlog=TaskIDMake(ename);  
   OpsLogStart(errlog,progname,argc,argv);  
+  IntRecSet(&irec,errlog,progname);
 
   SiteSetupHardware();
 
@@ -320,9 +328,8 @@ int main(int argc,char *argv[]) {
       tsgid=SiteTimeSeq(ptab);
 
       nave=SiteIntegrate(lags);   
+      if (nave<0) nave=IntRecIntegrate(&irec,nave,ptab,lags);
       if (nave<0) {
-        sprintf(logtxt,"Integration error:%d",nave);
-        ErrLog(errlog,progname,logtxt); 
         /* restart the radar */
         spawnl( P_WAIT, "/home/radar/script/restart.radar", NULL);
         /* continue; */
@@ -387,6 +394,7 @@ int main(int argc,char *argv[]) {
   } while (exitpoll==0);
   SiteEnd();
   for (n=0;n<tnum;n++) RMsgSndClose(tlist[n]);
+  IntRecLog(&irec);
   ErrLog(errlog,progname,"Ending program.");
   RShellTerminate(sid);
   return 0;   
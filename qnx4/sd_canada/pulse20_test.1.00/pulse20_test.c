@@ -38,9 +38,14 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "pulseseq.h"
 
 /*
  $Log: pulse20_test.c,v $
+ Revision 1.01  2026/10/17
+ The pulse and lag table come from the pulseseq library, which
+ corrects the first lag 22 pair from 14:46 to 14:36
+
  Revision 1.00  2014/10/16 20:00:00 KKrieger
  Adapted from tauscan_can.1.01 to test 20 pulse 
  sequences
@@ -66,62 +71,10 @@ int arg=0;
 struct OptionData opt;
       
 int main(int argc,char *argv[]) {
-  int i;
-
-  /* we use just a random 20 pulse sequence and lag table */
-  int ptab[20]={0,14,15,18,19,22,25,27,30,31,36,45,49,51,54,60,61,62,63,64};
-
-
-  int lags[LAG_SIZE][2] = {
-	{ 0, 0}, /* 0 */
-	{14,15}, /* 1 */
-	{61,62}, /* 1 */
-	{25,27}, /* 2 */
-	{49,51}, /* 2 */
-	{22,25}, /* 3 */
-	{51,54}, /* 3 */
-	{27,31}, /* 4 */
-	{45,49}, /* 4 */
-	{22,27}, /* 5 */
-	{49,54}, /* 5 */
-	{25,31}, /* 6 */
-	{45,51}, /* 6 */
-	{15,22}, /* 7 */
-	{54,61}, /* 7 */
-	{14,22}, /* 8 */
-	{54,62}, /* 8 */
-	{22,31}, /* 9 */
-	{45,54}, /* 9 */
-	{15,25}, /* 10 */
-	{51,61}, /* 10 */
-	{14,25}, /* 11 */
-	{51,62}, /* 11 */
-	{15,27}, /* 12 */
-	{49,61}, /* 12 */
-	{14,27}, /* 13 */
-	{49,62}, /* 13 */
-	{ 0,14}, /* 14 */
-	{31,45}, /* 14 */
-    { 0,15}, /* 15 */
-	{15,30}, /* 15  */
-	{15,31}, /* 16 */
-	{45,61}, /* 16 */
-	{14,31}, /* 17 */
-	{45,62}, /* 17 */
-	{0 ,18}, /* 18 */
-	{18,36}, /* 18 */
-	{0 ,19}, /* 19 */
-	{30,49}, /* 19 */
-	{25,45}, /* 20 */
-	{31,51}, /* 20 */
-	{15,36}, /* 21 */
-	{30,51}, /* 21 */
-	{14,46}, /* 22 */
-	{0 ,22}, /* 22 */
-	{22,45}, /* 23 */
-	{31,54}, /* 23 */
-	{ 64,64} /* alternate lag-0 */
-  };
+  /* we use just a random 20 pulse sequence and lag table, from the pulseseq library */
+  struct PulseSeq *seq;
+  int *ptab;
+  int (*lags)[2];
 
   char *sname=NULL;
   char *ename=NULL;
@@ -146,6 +99,14 @@ int main(int argc,char *argv[]) {
 
 
 
+  seq=PulseSeqFind("pulse20");
+  if (seq==NULL) {
+    fprintf(stderr,"Pulse sequence missing from the pulseseq library.\n");
+    exit(-1);
+  }
+  ptab=seq->ptab;
+  lags=seq->lags;
+
   strcpy(cmdlne,argv[0]);
   for (n=1;n<argc;n++) {
     strcat(cmdlne," ");
@@ -169,8 +130,8 @@ int main(int argc,char *argv[]) {
   cp=3600;
   intsc=7;
   intus=0;
-  mppul=20;
-  mplgs=24;     /* Total # of lags including 0 and missing 15 */
+  mppul=seq->mppul;
+  mplgs=seq->mplgs;
   nmpinc=1800;
   dmpinc=1800;
   nrang=75;
@@ -184,11 +145,7 @@ int main(int argc,char *argv[]) {
   frqrng=240;
 */
 
-  lagnum=0;
-  for (i=0;i<256;i++) {
-    if ((lags[i][0]==ptab[mppul-1]) && (lags[i][1]==ptab[mppul-1])) break;   
-    lagnum++;
-  }
+  lagnum=seq->lagnum;
   fprintf(stderr,"%d\n",lagnum);
 
 
@@ -40,9 +40,15 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "scanplan.h"
 
 /*
  $Log: rbspscan.c,v $
+ Revision 1.11  2026/10/17 12:00:00
+ The beam to start on is taken from a slot table built from the
+ beam lists at start up rather than worked out from the clock
+ at the start of every scan.
+
  Revision 1.10 2014/12/24 20:00:00 KKrieger
  Added total scan time checking to prevent
  delays at the end of a scan
@@ -73,6 +79,9 @@ char *tasklist[]= { TASK_NAMES, 0};
 int arg=0;
 struct OptionData opt;
 
+struct ScanPlan fplan;
+struct ScanPlan bplan;
+
 int main(int argc,char *argv[]) {
 
   int ptab[8] = {0,14,22,24,27,31,42,43};
@@ -122,6 +131,7 @@ int main(int argc,char *argv[]) {
   time_t scanstarttime;
   time_t scanstoptime;
   int skip;
+  struct ScanPlan *plan;
   int cnt=0;
   int fixfrq=0;
 
@@ -231,6 +241,15 @@ int main(int argc,char *argv[]) {
   backward_beams[ 25]= eastbm;
   backward_beams[ 27]= meribm;
   backward_beams[ 29]= westbm;
+
+  /* build the slot tables; each beam starts one integration after the last */
+  if ((ScanPlanMake(&fplan,scnsc,scnus,num_scans,forward_beams,NULL,
+                    intsc*1000+intus/1000,meribm) !=0) ||
+      (ScanPlanMake(&bplan,scnsc,scnus,num_scans,backward_beams,NULL,
+                    intsc*1000+intus/1000,meribm) !=0)) {
+    fprintf(stderr,"Invalid scan plan.\n");
+    exit(-1);
+  }
  
   if (sname==NULL) sname=sdname;
   if (ename==NULL) ename=edname;
@@ -280,30 +299,15 @@ int main(int argc,char *argv[]) {
       } else xcf=0;
     } else xcf=0;
 
-    /* skip=OpsFindSkip(scnsc,scnus); */
-    /* I did not want to modify OpsFindSkip */
-    /* but skip is now the index into the beam list */
-    /* and has to run to num_scans - 1 */
-    {
-      int tv;
-      int bv;
-      int iv;
-      TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
-      iv= intsc*1000000 + intus;
-      bv= scnsc* 1000000 + scnus;
-      tv=(mt* 60 + sc)* 1000000 + us + iv/2 - 100000;
-      skip=(tv % bv)/iv;
-      if (skip> num_scans-1) skip=0;
-      if (skip<0) skip=0;
-    }
-   sprintf( logtxt, "Beam skip: %d", skip);
-   ErrLog( errlog, progname, logtxt);
+    /* skip is the index into the slot table */
+    if (backward) plan=&bplan;
+    else plan=&fplan;
+    TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
+    skip=ScanPlanFind(plan,mt,sc,us);
+    sprintf( logtxt, "Beam skip: %d", skip);
+    ErrLog( errlog, progname, logtxt);
 
-    if (backward) {
-      bmnum= backward_beams[ skip];
-    } else {
-      bmnum=  forward_beams[ skip];
-    }
+    bmnum=plan->slot[skip].bmnum;
 
     do {
 
@@ -379,13 +383,9 @@ int main(int argc,char *argv[]) {
       exitpoll=RadarShell(sid,&rstable);
       if (exitpoll !=0) break;
       scan=0;
-      if (skip == (num_scans-1)) break;
+      if (skip == (plan->num-1)) break;
       skip= skip + 1;
-      if (backward) {
-        bmnum= backward_beams[ skip];
-      } else {
-        bmnum=  forward_beams[ skip];
-      }
+      bmnum= plan->slot[ skip].bmnum;
     } while (1);
 	scanstoptime = time(NULL);
 	totalscantime = difftime(scanstoptime, scanstarttime);
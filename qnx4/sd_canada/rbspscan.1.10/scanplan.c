@@ -0,0 +1,94 @@
+/* scanplan.c
+   ==========
+
+   Turns the beam list of a scan, and the times at which each beam is
+   to start, into a table of slots when the program starts. The slot
+   to run at any moment is then found from the clock with a single
+   table lookup, so a program started, or restarted, part way through
+   a scan picks up at the right beam rather than working it out with
+   its own arithmetic.
+
+   The start times are either given for each slot in seconds from the
+   scan boundary or spaced step ms apart. A beam of SCANPLAN_CAMP is
+   replaced by the camping beam.
+
+   The slot for a time is the first one starting no more than
+   SCANPLAN_TOL ms before it; tab holds, for each SCANPLAN_RES ms of
+   the scan, the first slot starting at or after that time. The slots
+   must start at least SCANPLAN_RES ms apart.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scanplan.h"
+
+
+/* start is NULL for slots spaced step ms apart; returns -1 if the
+   plan does not fit in the tables or the start times are out of order */
+
+int ScanPlanMake(struct ScanPlan *ptr,int scnsc,int scnus,int num,
+                 int *bmnum,int *start,int step,int camp) {
+  int n,t,i;
+
+  memset(ptr,0,sizeof(struct ScanPlan));
+  ptr->period=scnsc*1000+scnus/1000;
+  if ((num<1) || (num>SCANPLAN_MAXSLOT)) return -1;
+  if (ptr->period<=0) return -1;
+  ptr->ntab=(ptr->period+SCANPLAN_RES-1)/SCANPLAN_RES;
+  if (ptr->ntab>SCANPLAN_MAXTAB) return -1;
+
+  for (n=0;n<num;n++) {
+    ptr->slot[n].bmnum=(bmnum[n]==SCANPLAN_CAMP) ? camp : bmnum[n];
+    if (start !=NULL) ptr->slot[n].start=start[n]*1000;
+    else ptr->slot[n].start=n*step;
+    if (ptr->slot[n].start>=ptr->period) return -1;
+    if ((n>0) &&
+        (ptr->slot[n].start-ptr->slot[n-1].start<SCANPLAN_RES)) return -1;
+  }
+  ptr->num=num;
+
+  /* past the last slot the table points at num, meaning none */
+  i=0;
+  for (n=0;n<ptr->ntab;n++) {
+    t=n*SCANPLAN_RES;
+    while ((i<num) && (ptr->slot[i].start<t)) i++;
+    ptr->tab[n]=i;
+  }
+  return 0;
+}
+
+
+static int ScanPlanTime(struct ScanPlan *ptr,int mt,int sc,int us) {
+  return ((mt*60+sc)*1000+us/1000) % ptr->period;
+}
+
+
+/* returns the slot to run at mt:sc.us; a time after the last slot
+   gives the first slot of the next scan */
+
+int ScanPlanFind(struct ScanPlan *ptr,int mt,int sc,int us) {
+  int t,n;
+
+  t=ScanPlanTime(ptr,mt,sc,us)-SCANPLAN_TOL;
+  if (t<0) return 0;
+  n=ptr->tab[t/SCANPLAN_RES];
+  if ((n<ptr->num) && (ptr->slot[n].start<t)) n++;
+  if (n>=ptr->num) return 0;
+  return n;
+}
+
+
+/* returns the time [ms] from mt:sc.us until slot n should start, or 0
+   if it is already due. A slot running late is started at once; one
+   more than half a scan away in the past is taken to be the first
+   slot of the next scan and waited for */
+
+int ScanPlanDelay(struct ScanPlan *ptr,int n,int mt,int sc,int us) {
+  int t;
+
+  t=ptr->slot[n].start-ScanPlanTime(ptr,mt,sc,us);
+  if (t<-ptr->period/2) t+=ptr->period;
+  return (t>0) ? t : 0;
+}
@@ -0,0 +1,33 @@
+/* scanplan.h
+   ==========
+*/
+
+
+#ifndef _SCANPLAN_H
+#define _SCANPLAN_H
+
+#define SCANPLAN_MAXSLOT 64
+#define SCANPLAN_RES 100        /* lookup table resolution [ms] */
+#define SCANPLAN_MAXTAB 3600    /* lookup table entries; a 6 minute scan */
+#define SCANPLAN_TOL 100        /* a slot this late [ms] is still run */
+#define SCANPLAN_CAMP -1        /* stands for the camping beam in a plan */
+
+struct ScanPlanSlot {
+  int bmnum;
+  int start;   /* ms from the scan boundary */
+};
+
+struct ScanPlan {
+  int period;  /* ms */
+  int num;
+  struct ScanPlanSlot slot[SCANPLAN_MAXSLOT];
+  int ntab;
+  unsigned char tab[SCANPLAN_MAXTAB];
+};
+
+int ScanPlanMake(struct ScanPlan *ptr,int scnsc,int scnus,int num,
+                 int *bmnum,int *start,int step,int camp);
+int ScanPlanFind(struct ScanPlan *ptr,int mt,int sc,int us);
+int ScanPlanDelay(struct ScanPlan *ptr,int n,int mt,int sc,int us);
+
+#endif
@@ -0,0 +1,212 @@
+/* chnproc.c
+   =========
+
+   Builds the records for one stereo channel and fits them. Channel B
+   is given a thread of its own so that it is built and fitted while
+   the main thread builds and fits channel A. FitACF keeps its working
+   buffers in the FitBlock, so channel B is given a FitBlock of its own
+   by ChnProcFitStart, set up from the site's hardware file as
+   OpsFitACFStart sets up the one used by channel A. If that cannot be
+   done the channels share the one block and channel A is only fitted
+   once ChnProcWait has seen channel B finish. The thread only does the
+   build and the fit - errors are logged by the main thread, and the
+   timings are kept and written out once a scan by ChnProcLog.
+
+   If the thread cannot be started the channel is processed in line
+   by ChnProcPost, so the program behaves as it did before.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <process.h>
+#include <semaphore.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "radar.h"
+#include "rprm.h"
+#include "iqdata.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "fitacf.h"
+#include "rtime.h"
+#include "builds.h"
+#include "taskid.h"
+#include "errlog.h"
+#include "chnproc.h"
+
+
+static double ChnProcTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_REALTIME,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+void ChnProcSet(struct ChnProc *ptr,int chn,struct RadarParm *prm,
+                struct IQData *iq,struct RawData *raw,
+                struct FitBlock *fblk,struct FitData *fit,
+                int *ptab,int (*lags)[2]) {
+  memset(ptr,0,sizeof(struct ChnProc));
+  ptr->chn=chn;
+  ptr->prm=prm;
+  ptr->iq=iq;
+  ptr->raw=raw;
+  ptr->fblk=fblk;
+  ptr->fit=fit;
+  ptr->ptab=ptab;
+  ptr->lags=lags;
+  ptr->tid=-1;
+}
+
+
+void ChnProcBuild(struct ChnProc *ptr) {
+  double tval;
+
+  tval=ChnProcTime();
+  OpsBuildPrmS(ptr->chn,ptr->prm,ptr->ptab,ptr->lags);
+  OpsBuildIQS(ptr->chn,ptr->iq);
+  OpsBuildRawS(ptr->chn,ptr->raw);
+  tval=ChnProcTime()-tval;
+
+  ptr->stats.beams++;
+  ptr->stats.tbuild+=tval;
+  if (tval>ptr->stats.mxbuild) ptr->stats.mxbuild=tval;
+}
+
+
+void ChnProcFit(struct ChnProc *ptr) {
+  double tval;
+
+  tval=ChnProcTime();
+  FitACF(ptr->prm,ptr->raw,ptr->fblk,ptr->fit);
+  tval=ChnProcTime()-tval;
+
+  ptr->stats.tfit+=tval;
+  if (tval>ptr->stats.mxfit) ptr->stats.mxfit=tval;
+}
+
+
+/* sets up fblk, which must be zeroed, for the station stid at the
+   current time; returns 0 on success */
+
+int ChnProcFitStart(struct FitBlock *fblk,int stid) {
+  struct RadarNetwork *network;
+  struct Radar *radar;
+  struct RadarSite *site;
+  char *envstr;
+  FILE *fp;
+  int yr,mo,dy,hr,mt,sc,us;
+
+  envstr=getenv("SD_RADAR");
+  if (envstr==NULL) return -1;
+  fp=fopen(envstr,"r");
+  if (fp==NULL) return -1;
+  network=RadarLoad(fp);
+  fclose(fp);
+  if (network==NULL) return -1;
+
+  envstr=getenv("SD_HDWPATH");
+  if (envstr==NULL) return -1;
+  RadarLoadHardware(envstr,network);
+
+  radar=RadarGetRadar(network,stid);
+  if (radar==NULL) return -1;
+  TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
+  site=RadarYMDHMSGetSite(radar,yr,mo,dy,hr,mt,sc);
+  if (site==NULL) return -1;
+  FitACFStart(site,yr,fblk);
+  return 0;
+}
+
+
+static void ChnProcThread(void *arg) {
+  struct ChnProc *ptr=(struct ChnProc *) arg;
+
+  while (1) {
+    sem_wait(&ptr->go);
+    if (ptr->quit) break;
+    ChnProcBuild(ptr);
+    ChnProcFit(ptr);
+    sem_post(&ptr->done);
+  }
+  sem_post(&ptr->done);
+}
+
+
+int ChnProcStart(struct ChnProc *ptr) {
+  if (sem_init(&ptr->go,1,0) !=0) return -1;
+  if (sem_init(&ptr->done,1,0) !=0) {
+    sem_destroy(&ptr->go);
+    return -1;
+  }
+  ptr->tid=_beginthread(ChnProcThread,NULL,CHNPROC_STACK,ptr);
+  if (ptr->tid==-1) {
+    sem_destroy(&ptr->done);
+    sem_destroy(&ptr->go);
+    return -1;
+  }
+  return 0;
+}
+
+
+void ChnProcStop(struct ChnProc *ptr) {
+  if (ptr->tid==-1) return;
+  ptr->quit=1;
+  sem_post(&ptr->go);
+  sem_wait(&ptr->done);
+  sem_destroy(&ptr->done);
+  sem_destroy(&ptr->go);
+  ptr->tid=-1;
+}
+
+
+/* builds and fits the channel; pair with ChnProcWait */
+
+void ChnProcPost(struct ChnProc *ptr) {
+  if (ptr->tid !=-1) {
+    sem_post(&ptr->go);
+    return;
+  }
+  ChnProcBuild(ptr);
+  ChnProcFit(ptr);
+}
+
+
+void ChnProcWait(struct ChnProc *ptr) {
+  if (ptr->tid==-1) return;
+  sem_wait(&ptr->done);
+}
+
+
+static void ChnProcLogChn(char *txt,struct ChnProc *ptr) {
+  struct ChnProcStats *st=&ptr->stats;
+
+  sprintf(txt+strlen(txt),"%c build %.1f/%.1fms fit %.1f/%.1fms",
+          'A'+ptr->chn,1e3*st->tbuild/st->beams,1e3*st->mxbuild,
+          1e3*st->tfit/st->beams,1e3*st->mxfit);
+}
+
+
+/* writes the mean and longest build and fit times of both channels
+   since the last call and resets them */
+
+void ChnProcLog(struct ChnProc *a,struct ChnProc *b,
+                struct TaskID *errlog,char *progname) {
+  char logtxt[256];
+
+  if ((a->stats.beams==0) || (b->stats.beams==0)) return;
+  sprintf(logtxt,"Channel processing, %d beams, mean/max: ",
+          a->stats.beams);
+  ChnProcLogChn(logtxt,a);
+  strcat(logtxt,", ");
+  ChnProcLogChn(logtxt,b);
+  ErrLog(errlog,progname,logtxt);
+  memset(&a->stats,0,sizeof(struct ChnProcStats));
+  memset(&b->stats,0,sizeof(struct ChnProcStats));
+}
@@ -0,0 +1,49 @@
+/* chnproc.h
+   =========
+*/
+
+
+#ifndef _CHNPROC_H
+#define _CHNPROC_H
+
+#define CHNPROC_STACK 131072
+
+struct ChnProcStats {
+  int beams;
+  double tbuild;     /* seconds spent building the records */
+  double tfit;       /* seconds spent in FitACF */
+  double mxbuild;
+  double mxfit;
+};
+
+struct ChnProc {
+  int chn;
+  struct RadarParm *prm;
+  struct IQData *iq;
+  struct RawData *raw;
+  struct FitBlock *fblk;
+  struct FitData *fit;
+  int *ptab;
+  int (*lags)[2];
+  struct ChnProcStats stats;
+  int tid;           /* thread, or -1 if the channel runs in line */
+  int quit;
+  sem_t go;
+  sem_t done;
+};
+
+void ChnProcSet(struct ChnProc *ptr,int chn,struct RadarParm *prm,
+                struct IQData *iq,struct RawData *raw,
+                struct FitBlock *fblk,struct FitData *fit,
+                int *ptab,int (*lags)[2]);
+int ChnProcFitStart(struct FitBlock *fblk,int stid);
+int ChnProcStart(struct ChnProc *ptr);
+void ChnProcStop(struct ChnProc *ptr);
+void ChnProcBuild(struct ChnProc *ptr);
+void ChnProcFit(struct ChnProc *ptr);
+void ChnProcPost(struct ChnProc *ptr);
+void ChnProcWait(struct ChnProc *ptr);
+void ChnProcLog(struct ChnProc *a,struct ChnProc *b,
+                struct TaskID *errlog,char *progname);
+
+#endif
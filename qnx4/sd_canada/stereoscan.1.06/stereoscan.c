@@ -50,6 +50,7 @@
 #include <sys/kernel.h>
 #include <string.h>
 #include <time.h>
+#include <semaphore.h>
 #include "rtypes.h"
 #include "option.h"
 #include "rtime.h"
@@ -65,6 +66,7 @@
 #include "taskid.h"
 #include "errlog.h"
 #include "freq.h"
+#include "freqband.h"
 #include "rmsg.h"
 #include "radarshell.h"
 #include "rmsgsnd.h"
@@ -80,6 +82,8 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "chnproc.h"
+#include "stfclr.h"
 
 /*
  $Log: stereoscan.c,v $
@@ -180,6 +184,27 @@
 	channel B scan, so that it is independent of the number of beams on
 	channel A.
 
+	Modified 17/10/26
+
+	The records for channel B are built and fitted on a thread of their
+	own, with a fit block of their own, while the main thread builds
+	and fits channel A. If channel B's fit block cannot be set up the
+	two share the one block and channel A is fitted once channel B is
+	done. The mean and longest build and fit times of each channel are
+	written to the error log once a scan.
+
+	Added -minsep to keep the two channels at least that many kHz
+	apart. If the clear frequency search puts them closer, each
+	channel searches again with the other's frequency cut out of its
+	band and the pair with the lowest combined noise is used
+	(stfclr.c). The search time and separation are logged for every
+	beam.
+
+	The frequency bands are read from the site's freqband database
+	(table cutlass) instead of being set in u_init_freq_bands, and
+	each band is cut down to its widest part clear of the restricted
+	frequencies, so the clear frequency search never covers them.
+
   Modified 7th Dec 2001 to add camp beam flags
   Modified 23 Nov 2001 to add new -ns and -fs flags and changed some defaults
   Modified 10th Aug to account for backwards scanning radars
@@ -226,6 +251,7 @@
 
 #define SCHEDULER "schedule"
 #define ERRLOG "errlog"
+#define FREQ_TABLE "cutlass"
 
 #define CONTROL_NAME "control_program"
 #define TASK_NAMES "echo_data","iqwrite","rawacfwrite","fitacfwrite","raw_write","fit_write"
@@ -253,6 +279,8 @@ int ufreq_range[42];
 
 pid_t uucont_proxy;
 
+struct FitBlock fblkB;
+
 int low_beam_A=LOW_BEAM_A;
 int high_beam_A=HIGH_BEAM_A;
 int low_beam_B=LOW_BEAM_B;
@@ -342,6 +370,10 @@ int main(int argc,char *argv[]) {
   
   int cpidA=0,cpidB=0;
 
+  struct ChnProc chnA,chnB;
+  struct StFCLR sfclr;
+  int minsep=0;
+
   for (i=0;i<NUMBANDS;i++) ifreqsA[i]=ifreqsB[i]=-1;
   for (i=0;i<NUMBEAMS;i++) ibeamsA[i]=ibeamsB[i]=-1;
   
@@ -361,8 +393,6 @@ int main(int argc,char *argv[]) {
     perror("cannot attach proxy");
   }
  
-  u_init_freq_bands();
-  
   strcpy(cmdlne,argv[0]);
   for (n=1;n<argc;n++) {
     strcat(cmdlne," ");
@@ -436,6 +466,7 @@ int main(int argc,char *argv[]) {
 
   OptionAdd(&opt, "cpidA", 'i', &cpidA);
   OptionAdd(&opt, "cpidB", 'i', &cpidB);
+  OptionAdd(&opt, "minsep", 'i', &minsep);
 
   /* set up remaining shell variables */
 
@@ -518,6 +549,10 @@ int main(int argc,char *argv[]) {
   errlog=TaskIDMake(ename);  
   OpsLogStart(errlog,progname,argc,argv);  
 
+  u_init_freq_bands();
+
+  StFCLRSet(&sfclr,minsep);
+
   /* handle CTs */
 
   if ((cts2) || (cts4) || (cts6) || (cts8)) {
@@ -736,6 +771,18 @@ int main(int argc,char *argv[]) {
 
   OpsFitACFStart();
 
+  memset(&fblkB,0,sizeof(struct FitBlock));
+  ChnProcSet(&chnA,0,&prmA,&iqA,&rawA,&fblk,&fitA,ptab,lags);
+  if (ChnProcFitStart(&fblkB,stid)==0)
+    ChnProcSet(&chnB,1,&prmB,&iqB,&rawB,&fblkB,&fitB,ptab,lags);
+  else {
+    ErrLog(errlog,progname,
+           "Unable to set up channel B fit block; fitting in turn.");
+    ChnProcSet(&chnB,1,&prmB,&iqB,&rawB,&fblk,&fitB,ptab,lags);
+  }
+  if (ChnProcStart(&chnB) !=0)
+    ErrLog(errlog,progname,"Unable to start channel B thread.");
+
   OpsSetupTask(tasklist);
   for (n=0;n<tnum;n++) {
     RMsgSndReset(tlist[n]);
@@ -805,9 +852,10 @@ int main(int argc,char *argv[]) {
  
       SiteSetIntt(intsc,intus);
  
-      if (SiteFCLRS(stfrqA,stfrqA+frqrngA,stfrqB,
-                    stfrqB+frqrngB)==FREQ_LOCAL)
+      if (StFCLRSearch(&sfclr,stfrqA,stfrqA+frqrngA,stfrqB,
+                       stfrqB+frqrngB)==FREQ_LOCAL)
       ErrLog(errlog,progname,"Frequency Synthesizer in local mode.");
+      StFCLRLogLast(&sfclr,errlog,progname);
 
 
       if (tfreqA==-1) tfreqA=ftable->dfrq;
@@ -861,16 +909,18 @@ int main(int argc,char *argv[]) {
       ErrLog(errlog,progname,logtxt);
 
 
-      OpsBuildPrmS(0,&prmA,ptab,lags);
-      OpsBuildIQS(0,&iqA);
-      OpsBuildRawS(0,&rawA);
+      /* channel B is built and fitted alongside channel A, unless
+         the two share a fit block */
 
-      OpsBuildPrmS(1,&prmB,ptab,lags);
-      OpsBuildIQS(1,&iqB);
-      OpsBuildRawS(1,&rawB);
-
-      FitACF(&prmA,&rawA,&fblk,&fitA);
-      FitACF(&prmB,&rawB,&fblk,&fitB);
+      ChnProcPost(&chnB);
+      ChnProcBuild(&chnA);
+      if (chnB.fblk==chnA.fblk) {
+        ChnProcWait(&chnB);
+        ChnProcFit(&chnA);
+      } else {
+        ChnProcFit(&chnA);
+        ChnProcWait(&chnB);
+      }
 
       ErrLog(errlog,progname,"Sending messages."); 
   
@@ -979,12 +1029,16 @@ int main(int argc,char *argv[]) {
       if (ifreqsA_index >= numfreqbandsA) ifreqsA_index = 0;
     }
 
+    ChnProcLog(&chnA,&chnB,errlog,progname);
+
     ErrLog(errlog,progname,"Waiting for scan boundary."); 
     if ((scnsc !=0) || (scnus !=0)) {
       if (exitpoll==0) OpsWaitBoundary(scnsc,scnus);
     }
   } while (exitpoll==0);
+  ChnProcStop(&chnB);
   SiteEnd();
+  StFCLRLog(&sfclr,errlog,progname);
   for (n=0;n<tnum;n++) RMsgSndClose(tlist[n]);
   ErrLog(errlog,progname,"Ending program.");
   RShellTerminate(sid);
@@ -994,95 +1048,27 @@ int main(int argc,char *argv[]) {
 
 /***************************************************************************/
 
-/* Sets up the licenced frequency bands for Iceland & finland */
+/* Sets up the licenced frequency bands for Iceland & Finland from the site's
+   freqband database, with the restricted frequencies cut out */
 
 void u_init_freq_bands() {
+  struct FreqBandDB *fband;
+  struct FreqBandTab *tab;
+  char logtxt[256];
 
-/* start freq of each band */
-
-   /* Finland */
-
-   usfreq[0] = 8305;
-   usfreq[1] = 8965;
-   usfreq[2] = 9900;
-   usfreq[3] = 11075;
-   usfreq[4] = 11550;
-   usfreq[5] = 12370;
-   usfreq[6] = 13200;
-   usfreq[7] = 15010;
-   usfreq[8] = 16210;
-   usfreq[9] = 16555;
-   usfreq[10] = 17970;
-   usfreq[11] = 18850;
-   usfreq[12] = 19415;
-   usfreq[13] = 19705;
-   usfreq[14] = 19800;
-
-   /* Iceland */
-
-   usfreq[20] = 8000;
-   usfreq[21] = 8430;
-   usfreq[22] = 8985;
-   usfreq[23] = 10155;
-   usfreq[24] = 10655;
-   usfreq[25] = 11290;
-   usfreq[26] = 11475;
-   usfreq[27] = 12105;
-   usfreq[28] = 12305;
-   usfreq[29] = 12590;
-   usfreq[30] = 13360;
-   usfreq[31] = 13875;
-   usfreq[32] = 14400;
-   usfreq[33] = 15805;
-   usfreq[34] = 16500;
-   usfreq[35] = 16820;
-   usfreq[36] = 18175;
-   usfreq[37] = 18835;
-   usfreq[38] = 19910;
-   usfreq[39] = 10155;
-
-   /* width of each band */
-
-   /* Finland */
-
-   ufreq_range[0] = 30;
-   ufreq_range[1] = 75;
-   ufreq_range[2] = 85;
-   ufreq_range[3] = 200;
-   ufreq_range[4] = 50;
-   ufreq_range[5] = 45;
-   ufreq_range[6] = 60;
-   ufreq_range[7] = 70;
-   ufreq_range[8] = 150;
-   ufreq_range[9] = 60;
-   ufreq_range[10] = 80;
-   ufreq_range[11] = 15;
-   ufreq_range[12] = 265;
-   ufreq_range[13] = 50;
-   ufreq_range[14] = 190; 
-
-   /* Iceland */
-
-   ufreq_range[20] = 195;
-   ufreq_range[21] = 420;
-   ufreq_range[22] = 410;
-   ufreq_range[23] = 500;
-   ufreq_range[24] = 520;
-   ufreq_range[25] = 160;
-   ufreq_range[26] = 120;
-   ufreq_range[27] = 130;
-   ufreq_range[28] = 205;
-   ufreq_range[29] = 690;
-   ufreq_range[30] = 205;
-   ufreq_range[31] = 120;
-   ufreq_range[32] = 615;
-   ufreq_range[33] = 560;
-   ufreq_range[34] = 185;
-   ufreq_range[35] = 655;
-   ufreq_range[36] = 595;
-   ufreq_range[37] = 50;
-   ufreq_range[38] = 90;
-   ufreq_range[39] = 1020;
+  fband=FreqBandLoad(NULL);
+  tab=FreqBandTable(fband,FREQ_TABLE);
+  if (tab==NULL) {
+    fprintf(stderr,"Frequency band table %s missing from the freqband "
+                   "database.\n",FREQ_TABLE);
+    exit(-1);
+  }
+  FreqBandFill(fband,tab,usfreq,ufreq_range,sizeof(usfreq)/sizeof(int));
+  sprintf(logtxt,"Frequency bands from table %s: %d cut around restricted "
+          "frequencies, %d restricted throughout",tab->name,tab->bcut,
+          tab->bfull);
+  ErrLog(errlog,progname,logtxt);
+  FreqBandFree(fband);
 }
 
 /* Sends a proxy message to the microcontroller monitoring 
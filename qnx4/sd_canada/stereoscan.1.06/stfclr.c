@@ -0,0 +1,196 @@
+/* stfclr.c
+   ========
+
+   Clear frequency search for the two stereo channels, keeping their
+   frequencies at least minsep kHz apart. Both bands are swept at the
+   same time by SiteFCLRS. If the quietest frequencies it finds are
+   too close, a second SiteFCLRS is made in which each channel searches
+   its own band with the other channel's frequency, plus and minus
+   minsep, cut out. That gives three candidate pairs: A moved, B moved,
+   or both moved. The pair with the lowest combined noise that is far
+   enough apart is used. If none of them is, the first pass is kept
+   and the failure is counted.
+
+   With minsep set to zero this is just SiteFCLRS with a timer around
+   it.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "taskid.h"
+#include "errlog.h"
+#include "global.h"
+#include "globals.h"
+#include "interface.h"
+#include "stfclr.h"
+
+
+static char *stfclr_name[]={"kept","A moved","B moved","both moved",
+                            "failed"};
+
+
+static double StFCLRTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_REALTIME,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+/* cuts freq-sep to freq+sep out of the band and leaves the larger of
+   the pieces either side in st,ed; returns -1 if nothing is left */
+
+static int StFCLRCut(int *st,int *ed,int freq,int sep) {
+  int lo,hi;
+
+  lo=freq-sep;
+  hi=freq+sep;
+  if ((lo-*st)<0 && (*ed-hi)<0) return -1;
+  if ((lo-*st)>=(*ed-hi)) *ed=lo;
+  else *st=hi;
+  return 0;
+}
+
+
+void StFCLRSet(struct StFCLR *ptr,int minsep) {
+  memset(ptr,0,sizeof(struct StFCLR));
+  ptr->minsep=(minsep>0) ? minsep : 0;
+  ptr->stats.sepmin=-1;
+}
+
+
+/* replaces SiteFCLRS and returns what it did; tfreqA, tfreqB, noiseA
+   and noiseB are left set to the pair chosen */
+
+int StFCLRSearch(struct StFCLR *ptr,int stfrqA,int edfrqA,
+                 int stfrqB,int edfrqB) {
+  int status;
+  int fA,fB,gA,gB;
+  float nA,nB,mA,mB;
+  int okA,okB;
+  int stA,edA,stB,edB;
+  double tval,cost,best=-1;
+
+  tval=StFCLRTime();
+  status=SiteFCLRS(stfrqA,edfrqA,stfrqB,edfrqB);
+  ptr->tpass=StFCLRTime()-tval;
+  ptr->tfix=0;
+  ptr->res=STFCLR_KEEP;
+
+  fA=tfreqA;
+  fB=tfreqB;
+  nA=noiseA;
+  nB=noiseB;
+
+  if ((ptr->minsep>0) && (fA !=-1) && (fB !=-1) &&
+      (abs(fA-fB)<ptr->minsep)) {
+    stA=stfrqA;
+    edA=edfrqA;
+    stB=stfrqB;
+    edB=edfrqB;
+    okA=(StFCLRCut(&stA,&edA,fB,ptr->minsep)==0);
+    okB=(StFCLRCut(&stB,&edB,fA,ptr->minsep)==0);
+
+    ptr->res=STFCLR_FAIL;
+    if (okA || okB) {
+      tval=StFCLRTime();
+      SiteFCLRS(stA,edA,stB,edB);
+      ptr->tfix=StFCLRTime()-tval;
+      gA=tfreqA;
+      gB=tfreqB;
+      mA=noiseA;
+      mB=noiseB;
+      if (gA==-1) okA=0;
+      if (gB==-1) okB=0;
+
+      tfreqA=fA;
+      tfreqB=fB;
+      noiseA=nA;
+      noiseB=nB;
+
+      if ((okA) && (abs(gA-fB)>=ptr->minsep)) {
+        best=mA+nB;
+        tfreqA=gA;
+        noiseA=mA;
+        ptr->res=STFCLR_MOVEA;
+      }
+      cost=nA+mB;
+      if ((okB) && (abs(fA-gB)>=ptr->minsep) &&
+          ((best<0) || (cost<best))) {
+        best=cost;
+        tfreqA=fA;
+        noiseA=nA;
+        tfreqB=gB;
+        noiseB=mB;
+        ptr->res=STFCLR_MOVEB;
+      }
+      cost=mA+mB;
+      if ((okA) && (okB) && (abs(gA-gB)>=ptr->minsep) &&
+          ((best<0) || (cost<best))) {
+        best=cost;
+        tfreqA=gA;
+        noiseA=mA;
+        tfreqB=gB;
+        noiseB=mB;
+        ptr->res=STFCLR_MOVEAB;
+      }
+    }
+    if (ptr->res==STFCLR_FAIL) {
+      tfreqA=fA;
+      tfreqB=fB;
+      noiseA=nA;
+      noiseB=nB;
+    }
+  }
+
+  ptr->sep=abs(tfreqA-tfreqB);
+  ptr->stats.num++;
+  ptr->stats.res[ptr->res]++;
+  ptr->stats.tpass+=ptr->tpass;
+  ptr->stats.tfix+=ptr->tfix;
+  ptr->stats.sepsum+=ptr->sep;
+  if ((ptr->stats.sepmin<0) || (ptr->sep<ptr->stats.sepmin))
+    ptr->stats.sepmin=ptr->sep;
+  return status;
+}
+
+
+/* writes the time and separation of the last search */
+
+void StFCLRLogLast(struct StFCLR *ptr,struct TaskID *errlog,
+                   char *progname) {
+  char logtxt[256];
+
+  sprintf(logtxt,"Clear frequency search: %.3fs, separation %d kHz",
+          ptr->tpass,ptr->sep);
+  if (ptr->res !=STFCLR_KEEP)
+    sprintf(logtxt+strlen(logtxt)," (%s, %.3fs re-searching)",
+            stfclr_name[ptr->res],ptr->tfix);
+  ErrLog(errlog,progname,logtxt);
+}
+
+
+void StFCLRLog(struct StFCLR *ptr,struct TaskID *errlog,char *progname) {
+  char logtxt[256];
+  int i;
+
+  if (ptr->stats.num==0) return;
+  sprintf(logtxt,"Stereo FCLR: %d searches, mean %.3fs",ptr->stats.num,
+          ptr->stats.tpass/ptr->stats.num);
+  for (i=STFCLR_MOVEA;i<STFCLR_NRES;i++) {
+    if (ptr->stats.res[i]==0) continue;
+    sprintf(logtxt+strlen(logtxt),", %s %d",stfclr_name[i],
+            ptr->stats.res[i]);
+  }
+  if (ptr->stats.tfix>0)
+    sprintf(logtxt+strlen(logtxt),", %.3fs re-searching",ptr->stats.tfix);
+  sprintf(logtxt+strlen(logtxt),", separation mean %d min %d kHz",
+          (int) (ptr->stats.sepsum/ptr->stats.num),ptr->stats.sepmin);
+  ErrLog(errlog,progname,logtxt);
+}
@@ -38,9 +38,13 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "pulseseq.h"
 
 /*
  $Log: tauscan.c,v $
+ Revision 1.2  2026/10/17
+ The pulse and lag table come from the pulseseq library
+
  Revision 1.1  2014/01/30 19:30:00  ASReimer
  Changed pulse sequence
 
@@ -69,48 +73,10 @@ int arg=0;
 struct OptionData opt;
       
 int main(int argc,char *argv[]) {
-  int i;
-
-  /* we use VT's (Ray's) pulse and lag table */
-  int ptab[13]={0,15,16,23,27,29,32,47,50,52,56,63,64};
-
-
-  int lags[LAG_SIZE][2] = {
-	{ 0, 0}, /* 0 */
-	{15,16}, /* 1 */
-	{63,64}, /* 1 */
-	{27,29}, /* 2 */
-	{50,52}, /* 2 */
-	{29,32}, /* 3 */
-	{47,50}, /* 3 */
-	{23,27}, /* 4 */
-	{52,56}, /* 4 */
-	{27,32}, /* 5 */
-	{47,52}, /* 5 */
-	{23,29}, /* 6 */
-	{50,56}, /* 6 */
-	{16,23}, /* 7 */
-	{56,63}, /* 7 */
-	{15,23}, /* 8 */
-	{56,64}, /* 8 */
-	{23,32}, /* 9 */
-	{47,56}, /* 9 */
-	{16,27}, /* 11 */
-	{52,63}, /* 11 */
-	{15,27}, /* 12 */
-	{52,64}, /* 12 */
-	{16,29}, /* 13 */
-	{50,63}, /* 13 */
-	{15,29}, /* 14 */
-	{50,64}, /* 14 */
-        { 0,15}, /* 15 */
-        {32,47}, /* 15 */
-	{ 0,16}, /* 16 */
-	{47,63}, /* 16 */
-	{15,32}, /* 17 */
-	{47,64}, /* 17 */
-	{64,64} /* alternate lag-0 */
-  };
+  /* we use VT's (Ray's) pulse and lag table, from the pulseseq library */
+  struct PulseSeq *seq;
+  int *ptab;
+  int (*lags)[2];
 
   char *sname=NULL;
   char *ename=NULL;
@@ -135,6 +101,14 @@ int main(int argc,char *argv[]) {
 
 
 
+  seq=PulseSeqFind("tauscan13");
+  if (seq==NULL) {
+    fprintf(stderr,"Pulse sequence missing from the pulseseq library.\n");
+    exit(-1);
+  }
+  ptab=seq->ptab;
+  lags=seq->lags;
+
   strcpy(cmdlne,argv[0]);
   for (n=1;n<argc;n++) {
     strcat(cmdlne," ");
@@ -158,8 +132,8 @@ int main(int argc,char *argv[]) {
   cp=3610;
   intsc=7;
   intus=0;
-  mppul=13;
-  mplgs=17;     /* Total # of lags including 0 and missing 15 */
+  mppul=seq->mppul;
+  mplgs=seq->mplgs;
   nmpinc=1800;
   dmpinc=1800;
   nrang=75;
@@ -173,11 +147,7 @@ int main(int argc,char *argv[]) {
   frqrng=240;
 */
 
-  lagnum=0;
-  for (i=0;i<256;i++) {
-    if ((lags[i][0]==ptab[mppul-1]) && (lags[i][1]==ptab[mppul-1])) break;   
-    lagnum++;
-  }
+  lagnum=seq->lagnum;
   fprintf(stderr,"%d\n",lagnum);
 
 
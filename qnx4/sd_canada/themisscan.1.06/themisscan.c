@@ -79,9 +79,16 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "scanplan.h"
 
 /*
  $Log: themisscan.c,v $
+ Revision 1.7  2026/10/17 12:00:00
+ The beam to start on and the start time of each beam are taken
+ from a slot table built from scan_times and the beam lists,
+ replacing the uniform 3s skip arithmetic that picked the wrong
+ beam after the 54s gap.
+
  Revision 1.6  2014/12/24 17:00:00 KKrieger
  Added total scan time checking to prevent
  delays at the end of a scan
@@ -121,6 +128,9 @@ char *tasklist[]= { TASK_NAMES, 0};
 int arg=0;
 struct OptionData opt;
 
+struct ScanPlan fplan;
+struct ScanPlan bplan;
+
 int main(int argc,char *argv[]) {
 
   int ptab[8] = {0,14,22,24,27,31,42,43};
@@ -170,9 +180,7 @@ int main(int argc,char *argv[]) {
   time_t scanstarttime;
   time_t scanstoptime;
   int skip;
-  /* we need these to skip to the right beam on startup */
-  int skipsc= 3;
-  int skipus= 0;
+  struct ScanPlan *plan;
   int cnt=0;
   int fixfrq=0;
   int camping_beam= 7; /* Default Camping Beam */
@@ -249,10 +257,13 @@ int main(int argc,char *argv[]) {
 
   /* make sure this is in the allowed range, otherwise set to default */
   if ( (camping_beam < 0) && (camping_beam > 15) ) camping_beam= 7;
-  /* replace the -1 with the camping beam value */
-  for (n=1; n<num_scans; n++) {
-    if ( forward_beams[ n] == -1)  forward_beams[ n]= camping_beam;
-    if (backward_beams[ n] == -1) backward_beams[ n]= camping_beam;
+  /* build the slot tables; the -1 is replaced with the camping beam */
+  if ((ScanPlanMake(&fplan,scnsc,scnus,num_scans,forward_beams,
+                    scan_times,0,camping_beam) !=0) ||
+      (ScanPlanMake(&bplan,scnsc,scnus,num_scans,backward_beams,
+                    scan_times,0,camping_beam) !=0)) {
+    fprintf(stderr,"Invalid scan plan.\n");
+    exit(-1);
   }
  
   if (sname==NULL) sname=sdname;
@@ -305,30 +316,15 @@ int main(int argc,char *argv[]) {
       } else xcf=0;
     } else xcf=0;
 
-    /* skip=OpsFindSkip(scnsc,scnus); */
-    /* I did not want to modify OpsFindSkip */
-    /* but skip is now the index into the beam list */
-    /* and has to run to num_scans - 1 */
-    {
-      int tv;
-      int bv;
-      int iv;
-      TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
-      iv= skipsc*1000000 + skipus;
-      bv= scnsc* 1000000 + scnus;
-      tv=(mt* 60 + sc)* 1000000 + us + iv/2 - 100000;
-      skip=(tv % bv)/iv;
-      if (skip> num_scans-1) skip=0;
-      if (skip<0) skip=0;
-    }
-   sprintf(logtxt, "Beam skip: %d", skip);
-   ErrLog(errlog, progname, logtxt);
+    /* skip is the index into the slot table */
+    if (backward) plan=&bplan;
+    else plan=&fplan;
+    TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
+    skip=ScanPlanFind(plan,mt,sc,us);
+    sprintf(logtxt, "Beam skip: %d", skip);
+    ErrLog(errlog, progname, logtxt);
 
-    if (backward) {
-      bmnum= backward_beams[ skip];
-    } else {
-      bmnum=  forward_beams[ skip];
-    }
+    bmnum=plan->slot[skip].bmnum;
 
     do {
 // TimeReadClock( &yr, &mo, &dy, &hr, &mt, &sc, &us);
@@ -339,11 +335,9 @@ int main(int argc,char *argv[]) {
       /* This will only work, if the total time through the do loop is < 3s */
       /* If this is not the case, decrease the Integration time */
       {
-        int t_now;
         int t_dly;
         TimeReadClock( &yr, &mo, &dy, &hr, &mt, &sc, &us);
-        t_now= ( (mt* 60 + sc)* 1000 + us/ 1000 ) % (scnsc* 1000 + scnus/ 1000);
-        t_dly= scan_times[ skip]* 1000 - t_now;
+        t_dly= ScanPlanDelay(plan, skip, mt, sc, us);
         if (t_dly > 0) delay( t_dly);
       }
 
@@ -359,7 +353,7 @@ int main(int argc,char *argv[]) {
         frang=nfrang;
       }
 
-      sprintf(logtxt,"Integrating beam:%d intt:%ds.%dus (%d:%d:%d:%d) %d %d",bmnum,intsc,intus,hr,mt,sc,us, skip, scan_times[ skip]);
+      sprintf(logtxt,"Integrating beam:%d intt:%ds.%dus (%d:%d:%d:%d) %d %d",bmnum,intsc,intus,hr,mt,sc,us, skip, plan->slot[ skip].start/ 1000);
       ErrLog(errlog,progname,logtxt);
 
       ErrLog(errlog,progname,"Setting beam.");
@@ -419,13 +413,9 @@ int main(int argc,char *argv[]) {
       exitpoll=RadarShell(sid,&rstable);
       if (exitpoll !=0) break;
       scan=0;
-      if (skip == (num_scans-1)) break;
+      if (skip == (plan->num-1)) break;
       skip= skip + 1;
-      if (backward) {
-        bmnum= backward_beams[ skip];
-      } else {
-        bmnum=  forward_beams[ skip];
-      }
+      bmnum= plan->slot[ skip].bmnum;
     } while (1);
     scanstoptime = time(NULL);
 	totalscantime = difftime(scanstoptime, scanstarttime);
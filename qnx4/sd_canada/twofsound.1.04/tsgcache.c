@@ -0,0 +1,184 @@
+/* tsgcache.c
+   ==========
+
+   Keeps the timing sequences a program switches between so that a
+   switch costs a table lookup rather than a call to SiteTimeSeq. Each
+   entry is keyed on the pulse table and every operating parameter the
+   sequence is made from (mppul, mpinc, txpl, smsep, nrang, frang and
+   rsep) and holds the tsgid that SiteTimeSeq returned together with
+   the lagfr, smsep and txpl it set. A hit puts those back; a miss
+   falls through to SiteTimeSeq, which makes and downloads the
+   sequence, and the result is added to the cache.
+
+   The sequences a program will use are registered with TSGCacheAdd
+   and made by TSGCachePreload before the first scan. SiteTimeSeq
+   adjusts smsep and txpl, and those feed into the key of the next
+   sequence, so the preload list is run through until a pass makes
+   nothing new; after that every switch in the scan loop is a hit.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "radar.h"
+#include "rprm.h"
+#include "iqdata.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "taskid.h"
+#include "errlog.h"
+#include "tsg.h"
+#include "global.h"
+#include "tmseq.h"
+#include "tsgcache.h"
+
+
+static double TSGCacheTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_REALTIME,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static int TSGCacheMakeKey(struct TSGCacheKey *key,int *ptab) {
+  int i;
+
+  if ((mppul<1) || (mppul>TSGCACHE_PULSE)) return -1;
+  memset(key,0,sizeof(struct TSGCacheKey));
+  key->mppul=mppul;
+  for (i=0;i<mppul;i++) key->ptab[i]=ptab[i];
+  key->mpinc=mpinc;
+  key->txpl=txpl;
+  key->smsep=smsep;
+  key->nrang=nrang;
+  key->frang=frang;
+  key->rsep=rsep;
+  return 0;
+}
+
+
+void TSGCacheSet(struct TSGCache *ptr) {
+  memset(ptr,0,sizeof(struct TSGCache));
+}
+
+
+/* forgets the sequences but keeps the preload list and the counters;
+   used after the hardware has been reset */
+
+void TSGCacheClear(struct TSGCache *ptr) {
+  ptr->num=0;
+}
+
+
+int TSGCacheAdd(struct TSGCache *ptr,int *ptab,int num,int inc,
+                int rng) {
+  if (ptr->pnum>=TSGCACHE_MAX) return -1;
+  ptr->pre[ptr->pnum].ptab=ptab;
+  ptr->pre[ptr->pnum].mppul=num;
+  ptr->pre[ptr->pnum].mpinc=inc;
+  ptr->pre[ptr->pnum].frang=rng;
+  ptr->pnum++;
+  return 0;
+}
+
+
+/* replaces tsgid=SiteTimeSeq(ptab) */
+
+int TSGCacheSeq(struct TSGCache *ptr,int *ptab) {
+  struct TSGCacheKey key;
+  struct TSGCacheEntry *ent;
+  double tval;
+  int n,id;
+
+  if (TSGCacheMakeKey(&key,ptab) !=0) return SiteTimeSeq(ptab);
+
+  for (n=0;n<ptr->num;n++) {
+    ent=&ptr->ent[n];
+    if (memcmp(&ent->key,&key,sizeof(struct TSGCacheKey)) !=0) continue;
+    lagfr=ent->lagfr;
+    smsep=ent->smsep;
+    txpl=ent->txpl;
+    ptr->stats.hit++;
+    return ent->id;
+  }
+
+  ptr->stats.miss++;
+  tval=TSGCacheTime();
+  id=SiteTimeSeq(ptab);
+  ptr->stats.tmiss+=TSGCacheTime()-tval;
+
+  if (id<0) {
+    ptr->stats.fail++;
+    return id;
+  }
+  if (ptr->num>=TSGCACHE_MAX) return id;
+
+  ent=&ptr->ent[ptr->num];
+  ent->key=key;
+  ent->id=id;
+  ent->lagfr=lagfr;
+  ent->smsep=smsep;
+  ent->txpl=txpl;
+  ptr->num++;
+  return id;
+}
+
+
+/* returns the number of sequences made, or -1 if one of them failed */
+
+int TSGCachePreload(struct TSGCache *ptr) {
+  int mppul_s,mpinc_s,frang_s,tsgid_s;
+  int pass,n,miss,fail,total=0;
+
+  mppul_s=mppul;
+  mpinc_s=mpinc;
+  frang_s=frang;
+  tsgid_s=tsgid;
+
+  for (pass=0;pass<TSGCACHE_PASS;pass++) {
+    miss=ptr->stats.miss;
+    fail=ptr->stats.fail;
+    for (n=0;n<ptr->pnum;n++) {
+      mppul=ptr->pre[n].mppul;
+      mpinc=ptr->pre[n].mpinc;
+      frang=ptr->pre[n].frang;
+      TSGCacheSeq(ptr,ptr->pre[n].ptab);
+    }
+    total+=ptr->stats.miss-miss;
+    if (ptr->stats.fail !=fail) break;
+    if (ptr->stats.miss==miss) break;
+  }
+
+  mppul=mppul_s;
+  mpinc=mpinc_s;
+  frang=frang_s;
+  tsgid=tsgid_s;
+
+  /* the preload is not counted against the scan loop */
+  ptr->stats.tload=ptr->stats.tmiss;
+  ptr->stats.hit=0;
+  if (pass<TSGCACHE_PASS && ptr->stats.fail==0) {
+    ptr->stats.miss=0;
+    ptr->stats.tmiss=0;
+    return total;
+  }
+  return -1;
+}
+
+
+void TSGCacheLog(struct TSGCache *ptr,struct TaskID *errlog,char *progname) {
+  char logtxt[256];
+
+  sprintf(logtxt,
+          "TSG cache: %d sequences, %d hits, %d misses (%d failed, %.3fs)",
+          ptr->num,ptr->stats.hit,ptr->stats.miss,ptr->stats.fail,
+          ptr->stats.tmiss);
+  ErrLog(errlog,progname,logtxt);
+}
@@ -0,0 +1,63 @@
+/* tsgcache.h
+   ==========
+*/
+
+
+#ifndef _TSGCACHE_H
+#define _TSGCACHE_H
+
+#define TSGCACHE_MAX 32      /* entries, matches the site TSG table */
+#define TSGCACHE_PULSE 32    /* longest pulse table that can be keyed */
+#define TSGCACHE_PASS 4      /* preload passes before giving up on settling */
+
+struct TSGCacheKey {
+  int mppul;
+  int ptab[TSGCACHE_PULSE];
+  int mpinc;
+  int txpl;
+  int smsep;
+  int nrang;
+  int frang;
+  int rsep;
+};
+
+struct TSGCacheEntry {
+  struct TSGCacheKey key;
+  int id;                    /* returned by SiteTimeSeq */
+  int lagfr;                 /* values SiteTimeSeq left behind */
+  int smsep;
+  int txpl;
+};
+
+struct TSGCacheStats {
+  int hit;
+  int miss;
+  int fail;                  /* misses where SiteTimeSeq failed */
+  double tmiss;              /* seconds spent in SiteTimeSeq on misses */
+  double tload;              /* seconds spent preloading */
+};
+
+struct TSGCachePre {
+  int *ptab;
+  int mppul;
+  int mpinc;
+  int frang;
+};
+
+struct TSGCache {
+  int num;
+  struct TSGCacheEntry ent[TSGCACHE_MAX];
+  int pnum;
+  struct TSGCachePre pre[TSGCACHE_MAX];
+  struct TSGCacheStats stats;
+};
+
+void TSGCacheSet(struct TSGCache *ptr);
+void TSGCacheClear(struct TSGCache *ptr);
+int TSGCacheAdd(struct TSGCache *ptr,int *ptab,int num,int inc,
+                int rng);
+int TSGCachePreload(struct TSGCache *ptr);
+int TSGCacheSeq(struct TSGCache *ptr,int *ptab);
+void TSGCacheLog(struct TSGCache *ptr,struct TaskID *errlog,char *progname);
+
+#endif
@@ -41,9 +41,23 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "pulseseq.h"
+#include "tsgcache.h"
+#include "mseq.h"
 
 /*
  $Log: twofsound.c,v $
+ Revision 1.07 2026/10/17
+ Added -interleave: the 8-pulse and 7-pulse sequences are integrated
+ together on every beam (mseq.c) and sent as two records
+
+ Revision 1.06 2026/10/17
+ The timing sequence is preloaded for the day and night first range
+ and switched through a cache (tsgcache.c)
+
+ Revision 1.05 2026/10/17
+ The 8-pulse and 7-pulse sequences come from the pulseseq library
+
  Revision 1.04 2016/11/08 KKrieger
  Added channel parameter
 
@@ -93,70 +107,24 @@ struct OptionData opt;
 
 int main(int argc,char *argv[]) {
 
-  int ptab_8[8] = {0,14,22,24,27,31,42,43};
-
-  int lags_8[LAG_SIZE][2] = {
-    { 0, 0},    /*  0 */
-    {42,43},    /*  1 */
-    {22,24},    /*  2 */
-    {24,27},    /*  3 */
-    {27,31},    /*  4 */
-    {22,27},    /*  5 */
-
-    {24,31},    /*  7 */
-    {14,22},    /*  8 */
-    {22,31},    /*  9 */
-    {14,24},    /* 10 */
-    {31,42},    /* 11 */
-    {31,43},    /* 12 */
-    {14,27},    /* 13 */
-    { 0,14},    /* 14 */
-    {27,42},    /* 15 */
-    {27,43},    /* 16 */
-    {14,31},    /* 17 */
-    {24,42},    /* 18 */
-    {24,43},    /* 19 */
-    {22,42},    /* 20 */
-    {22,43},    /* 21 */
-    { 0,22},    /* 22 */
-
-    { 0,24},    /* 24 */
-
-    {43,43}};   /* alternate lag-0  */
-
-  int mppul_8= 8;
-  int mplgs_8= 23;
+  /* the sequences come from the pulseseq library */
+
+  struct PulseSeq *seq_8;
+  int *ptab_8;
+  int (*lags_8)[2];
+
+  int mppul_8;
+  int mplgs_8;
   int mpinc_8= 1500;
   int dmpinc_8= 1500;
   int nmpinc_8= 1500;
 
-  int ptab_7[7] = { 0, 9, 12, 20, 22, 26, 27};
-
-  int lags_7[LAG_SIZE][2] = {
-    { 0, 0},        /*  0 */
-    {26,27},        /*  1 */
-    {20,22},        /*  2 */
-    { 9,12},        /*  3 */
-    {22,26},        /*  4 */
-    {22,27},        /*  5 */
-    {20,26},        /*  6 */
-    {20,27},        /*  7 */
-    {12,20},        /*  8 */
-    { 0, 9},        /*  9 */
-    {12,22},        /* 10 */
-    { 9,20},        /* 11 */
-    { 0,12},        /* 12 */
-    { 9,22},        /* 13 */
-    {12,26},        /* 14 */
-    {12,27},        /* 15 */
-
-    { 9,26},        /* 17 */
-    { 9,27},        /* 18 */
-
-    {27,27}};       /* alternate lag-0 */
-
-  int mppul_7= 7;
-  int mplgs_7= 18;
+  struct PulseSeq *seq_7;
+  int *ptab_7;
+  int (*lags_7)[2];
+
+  int mppul_7;
+  int mplgs_7;
   int mpinc_7= 2400;
   int dmpinc_7= 2400;
   int nmpinc_7= 2400;
@@ -170,6 +138,7 @@ int main(int argc,char *argv[]) {
   int n;
   pid_t sid;
   int exitpoll=0;
+  struct TSGCache tcache;
  
   int scnsc=120;
   int scnus=0;
@@ -182,6 +151,11 @@ int main(int argc,char *argv[]) {
   unsigned char fast=0;
   unsigned char discretion=0;
   unsigned char p7=0;
+  unsigned char interleave=0;
+  int rounds=MSEQ_ROUNDS;
+  int mixed=0;
+  int s;
+  struct MSeq *mseq=NULL;
 
   /* variables for twofsound */
   int st_id; /* Station id */
@@ -193,6 +167,21 @@ int main(int argc,char *argv[]) {
   int inv_freq[ 2]= { 10300, 12200};
   int cly_freq[ 2]= { 10500, 12500};
 
+  seq_8= PulseSeqFind("katscan8");
+  seq_7= PulseSeqFind("normal7");
+  if ((seq_8==NULL) || (seq_7==NULL)) {
+    fprintf(stderr,"Pulse sequence missing from the pulseseq library.\n");
+    exit(-1);
+  }
+  ptab_8= seq_8->ptab;
+  lags_8= seq_8->lags;
+  mppul_8= seq_8->mppul;
+  mplgs_8= seq_8->mplgs;
+  ptab_7= seq_7->ptab;
+  lags_7= seq_7->lags;
+  mppul_7= seq_7->mppul;
+  mplgs_7= seq_7->mplgs;
+
   strcpy(cmdlne,argv[0]);
   for (n=1;n<argc;n++) {
     strcat(cmdlne," ");
@@ -242,6 +231,8 @@ int main(int argc,char *argv[]) {
   OptionAdd( &opt, "rsep", 'i', &rsep);
   OptionAdd(&opt,"fast", 'x', &fast);
   OptionAdd(&opt,"p7", 'x', &p7);
+  OptionAdd(&opt,"interleave", 'x', &interleave);
+  OptionAdd( &opt, "rounds", 'i', &rounds);
 
   arg=OptionProcess(1,argc,argv,&opt,NULL);  
 
@@ -288,6 +279,42 @@ int main(int argc,char *argv[]) {
   else sprintf(progname,"twofsound");
 
   OpsFitACFStart();
+
+  if (interleave) {
+    mseq=MSeqMake(rounds);
+    if ((mseq==NULL) ||
+        (MSeqAdd(mseq,ptab_8,lags_8,mppul_8,mplgs_8,mpinc_8) !=0) ||
+        (MSeqAdd(mseq,ptab_7,lags_7,mppul_7,mplgs_7,mpinc_7) !=0)) {
+      ErrLog(errlog,progname,"Could not set up interleaved integration.");
+      MSeqFree(mseq);
+      mseq=NULL;
+      interleave=0;
+    } else {
+      sprintf(logtxt,"Interleaving 8 and 7 pulse sequences, %d rounds.",
+              mseq->rounds);
+      ErrLog(errlog,progname,logtxt);
+    }
+  }
+
+  /* make the sequence for both day and night before the first scan */
+  TSGCacheSet(&tcache);
+  if ( (p7 == 0) || interleave ) {
+    TSGCacheAdd(&tcache,ptab_8,mppul_8,mpinc_8,dfrang);
+    TSGCacheAdd(&tcache,ptab_8,mppul_8,mpinc_8,nfrang);
+  }
+  if ( (p7 != 0) || interleave ) {
+    TSGCacheAdd(&tcache,ptab_7,mppul_7,mpinc_7,dfrang);
+    TSGCacheAdd(&tcache,ptab_7,mppul_7,mpinc_7,nfrang);
+  }
+  n=TSGCachePreload(&tcache);
+  if (n<0) ErrLog(errlog,progname,
+                  "TSG cache: preload failed, sequences will be made as needed.");
+  else {
+    sprintf(logtxt,"TSG cache: %d sequences preloaded in %.3fs",n,
+            tcache.stats.tload);
+    ErrLog(errlog,progname,logtxt);
+  }
+
   OpsSetupTask(tasklist);
   for (n=0;n<tnum;n++) {
     RMsgSndReset(tlist[n]);
@@ -358,6 +385,7 @@ int main(int argc,char *argv[]) {
       ErrLog(errlog,progname,logtxt);
       ErrLog(errlog,progname,"Setting beam.");
       SiteSetIntt(intsc,intus);
+      if (interleave) MSeqStart(mseq);
       SiteSetBeam(bmnum);
 
       ErrLog(errlog,progname,"Doing clear frequency search."); 
@@ -367,11 +395,25 @@ int main(int argc,char *argv[]) {
 
       sprintf(logtxt,"Transmitting on: %d (Noise=%g)",tfreq,noise);
       ErrLog(errlog,progname,logtxt);
-      if ( p7 == 0 ) {
+      mixed=0;
+      if (interleave) {
+        nave= MSeqIntegrate(mseq,&tcache);
+        if (nave<0) {
+          sprintf(logtxt,"Integration error:%d",nave);
+          ErrLog(errlog,progname,logtxt);
+          /* restart the radar */
+          spawnl( P_WAIT, "/home/radar/script/restart.radar", NULL);
+          exit( nave);
+        }
+        sprintf(logtxt,"Number of sequences [8]: %d [7]: %d",
+                mseq->seq[0].nave,mseq->seq[1].nave);
+        ErrLog(errlog,progname,logtxt);
+        mixed=1;
+      } else if ( p7 == 0 ) {
         mppul= mppul_8;
         mplgs= mplgs_8;
         mpinc= mpinc_8;
-        tsgid= SiteTimeSeq(ptab_8);
+        tsgid= TSGCacheSeq(&tcache,ptab_8);
         nave= SiteIntegrate(lags_8);
         if (nave<0) {
           sprintf(logtxt,"Integration error:%d",nave);
@@ -388,7 +430,7 @@ int main(int argc,char *argv[]) {
         mppul= mppul_7;
         mplgs= mplgs_7;
         mpinc= mpinc_7;
-        tsgid= SiteTimeSeq(ptab_7);
+        tsgid= TSGCacheSeq(&tcache,ptab_7);
         nave= SiteIntegrate(lags_7);
         if (nave<0) {
           sprintf(logtxt,"Integration error:%d",nave);
@@ -403,21 +445,37 @@ int main(int argc,char *argv[]) {
         OpsBuildPrm(&prm,ptab_7,lags_7);
       }
 
-      OpsBuildIQ(&iq);
-      OpsBuildRaw(&raw);
-
-      FitACF(&prm,&raw,&fblk,&fit);
-
-      ErrLog(errlog,progname,"Sending messages."); 
-      msg.num=0;
-      msg.tsize=0;
-      RMsgSndAdd(&msg,sizeof(struct RadarParm),(unsigned char *) &prm, PRM_TYPE,0);
-      RMsgSndAdd(&msg,sizeof(struct IQData),(unsigned char *) &iq, IQ_TYPE,0);
-      RMsgSndAdd(&msg,strlen(sharedmemory)+1,sharedmemory, IQS_TYPE,0);
-      RMsgSndAdd(&msg,sizeof(struct RawData),(unsigned char *) &raw, RAW_TYPE,0);
-      RMsgSndAdd(&msg,sizeof(struct FitData),(unsigned char *) &fit, FIT_TYPE,0);
-      RMsgSndAdd(&msg,strlen(progname)+1,progname, NME_TYPE,0);
-      for (n=0;n<tnum;n++) RMsgSndSend(tlist[n],&msg);
+      if (mixed) {
+        /* one record for each sequence; there are no I&Q samples */
+        ErrLog(errlog,progname,"Sending messages."); 
+        for (s=0;s<mseq->num;s++) {
+          if (mseq->seq[s].nave==0) continue;
+          FitACF(mseq->seq[s].prm,mseq->seq[s].raw,&fblk,&fit);
+          msg.num=0;
+          msg.tsize=0;
+          RMsgSndAdd(&msg,sizeof(struct RadarParm),(unsigned char *) mseq->seq[s].prm, PRM_TYPE,0);
+          RMsgSndAdd(&msg,sizeof(struct RawData),(unsigned char *) mseq->seq[s].raw, RAW_TYPE,0);
+          RMsgSndAdd(&msg,sizeof(struct FitData),(unsigned char *) &fit, FIT_TYPE,0);
+          RMsgSndAdd(&msg,strlen(progname)+1,progname, NME_TYPE,0);
+          for (n=0;n<tnum;n++) RMsgSndSend(tlist[n],&msg);
+        }
+      } else {
+        OpsBuildIQ(&iq);
+        OpsBuildRaw(&raw);
+
+        FitACF(&prm,&raw,&fblk,&fit);
+
+        ErrLog(errlog,progname,"Sending messages."); 
+        msg.num=0;
+        msg.tsize=0;
+        RMsgSndAdd(&msg,sizeof(struct RadarParm),(unsigned char *) &prm, PRM_TYPE,0);
+        RMsgSndAdd(&msg,sizeof(struct IQData),(unsigned char *) &iq, IQ_TYPE,0);
+        RMsgSndAdd(&msg,strlen(sharedmemory)+1,sharedmemory, IQS_TYPE,0);
+        RMsgSndAdd(&msg,sizeof(struct RawData),(unsigned char *) &raw, RAW_TYPE,0);
+        RMsgSndAdd(&msg,sizeof(struct FitData),(unsigned char *) &fit, FIT_TYPE,0);
+        RMsgSndAdd(&msg,strlen(progname)+1,progname, NME_TYPE,0);
+        for (n=0;n<tnum;n++) RMsgSndSend(tlist[n],&msg);
+      }
   
       ErrLog(errlog,progname,"Polling for exit."); 
       exitpoll=RadarShell(sid,&rstable);
@@ -445,6 +503,11 @@ int main(int argc,char *argv[]) {
   } while (exitpoll==0);
   SiteEnd();
   for (n=0;n<tnum;n++) RMsgSndClose(tlist[n]);
+  TSGCacheLog(&tcache,errlog,progname);
+  if (mseq !=NULL) {
+    MSeqLog(mseq,errlog,progname);
+    MSeqFree(mseq);
+  }
   ErrLog(errlog,progname,"Ending program.");
   RShellTerminate(sid);
   return 0;
@@ -0,0 +1,244 @@
+/* mseq.c
+   ======
+
+   Integrates several timing sequences within one integration period.
+   The period is split into sub-integrations that take the sequences
+   in turn, a few rounds of each, and the ACFs of each sequence are
+   kept apart: after every sub-integration the record is built and its
+   ACFs are added to that sequence's sum, weighted by the number of
+   sequences, so that at the end of the beam each sequence has a
+   RadarParm and RawData of its own as if it had been integrated on
+   its own for the whole period. The caller fits and sends each of
+   them as a separate record.
+
+   Every SiteIntegrate uses up the window that SiteSetIntt arms, so
+   the window is armed again for the length of one sub-integration
+   just before each of them. The program calls MSeqStart when it arms
+   the window for the beam, and the sub-integrations share out what
+   is left of it once the clear frequency search is done, so the beam
+   still ends on time. Switching sequences goes through the TSG cache
+   (tsgcache.c), so the sequences should be preloaded there. The
+   sample buffer only holds the last sub-integration, so no I&Q record
+   can be made for an interleaved beam.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "radar.h"
+#include "rprm.h"
+#include "iqdata.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "taskid.h"
+#include "errlog.h"
+#include "tsg.h"
+#include "global.h"
+#include "setup.h"
+#include "tmseq.h"
+#include "build.h"
+#include "interface.h"
+#include "hdw.h"
+#include "tsgcache.h"
+#include "mseq.h"
+
+
+static double MSeqTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_REALTIME,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+struct MSeq *MSeqMake(int rounds) {
+  struct MSeq *ptr;
+
+  ptr=malloc(sizeof(struct MSeq));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct MSeq));
+  ptr->rounds=(rounds>0) ? rounds : MSEQ_ROUNDS;
+  ptr->tmp=malloc(sizeof(struct RawData));
+  if (ptr->tmp==NULL) {
+    free(ptr);
+    return NULL;
+  }
+  return ptr;
+}
+
+
+void MSeqFree(struct MSeq *ptr) {
+  int s;
+
+  if (ptr==NULL) return;
+  for (s=0;s<ptr->num;s++) {
+    if (ptr->seq[s].prm !=NULL) free(ptr->seq[s].prm);
+    if (ptr->seq[s].raw !=NULL) free(ptr->seq[s].raw);
+  }
+  if (ptr->tmp !=NULL) free(ptr->tmp);
+  free(ptr);
+}
+
+
+int MSeqAdd(struct MSeq *ptr,int *ptab,int (*lags)[2],int mppul,
+            int mplgs,int mpinc) {
+  struct MSeqSeq *sq;
+
+  if (ptr->num>=MSEQ_MAX) return -1;
+  sq=&ptr->seq[ptr->num];
+  memset(sq,0,sizeof(struct MSeqSeq));
+  sq->prm=malloc(sizeof(struct RadarParm));
+  sq->raw=malloc(sizeof(struct RawData));
+  if ((sq->prm==NULL) || (sq->raw==NULL)) {
+    if (sq->prm !=NULL) free(sq->prm);
+    if (sq->raw !=NULL) free(sq->raw);
+    return -1;
+  }
+  sq->ptab=ptab;
+  sq->lags=lags;
+  sq->mppul=mppul;
+  sq->mplgs=mplgs;
+  sq->mpinc=mpinc;
+  ptr->num++;
+  return 0;
+}
+
+
+static void MSeqSum(struct MSeqSeq *sq,struct RawData *raw,int nave) {
+  int r,l;
+
+  sq->raw->thr=raw->thr;
+  for (r=0;r<nrang;r++) {
+    sq->raw->pwr0[r]+=nave*raw->pwr0[r];
+    for (l=0;l<sq->mplgs;l++) {
+      sq->raw->acfd[r][l][0]+=nave*raw->acfd[r][l][0];
+      sq->raw->acfd[r][l][1]+=nave*raw->acfd[r][l][1];
+      sq->raw->xcfd[r][l][0]+=nave*raw->xcfd[r][l][0];
+      sq->raw->xcfd[r][l][1]+=nave*raw->xcfd[r][l][1];
+    }
+  }
+  sq->noise+=nave*sq->prm->noise.search;
+  sq->mean+=nave*sq->prm->noise.mean;
+  sq->nave+=nave;
+}
+
+
+static void MSeqAverage(struct MSeqSeq *sq) {
+  int r,l;
+  float w;
+
+  if (sq->nave==0) return;
+  w=1.0/sq->nave;
+  for (r=0;r<nrang;r++) {
+    sq->raw->pwr0[r]*=w;
+    for (l=0;l<sq->mplgs;l++) {
+      sq->raw->acfd[r][l][0]*=w;
+      sq->raw->acfd[r][l][1]*=w;
+      sq->raw->xcfd[r][l][0]*=w;
+      sq->raw->xcfd[r][l][1]*=w;
+    }
+  }
+  sq->prm->nave=sq->nave;
+  sq->prm->noise.search=sq->noise*w;
+  sq->prm->noise.mean=sq->mean*w;
+}
+
+
+/* marks the start of the beam's integration window; called next to
+   the program's SiteSetIntt */
+
+void MSeqStart(struct MSeq *ptr) {
+  ptr->tstart=MSeqTime();
+}
+
+
+/* returns the total number of sequences, or the negative value of
+   the first SiteIntegrate that failed */
+
+int MSeqIntegrate(struct MSeq *ptr,struct TSGCache *tcache) {
+  struct MSeqSeq *sq;
+  int isc,ius,intt,left,sub,rounds;
+  int r,s,nave,total=0;
+  double tval,tend;
+
+  tval=MSeqTime();
+  isc=intsc;
+  ius=intus;
+  intt=isc*1000000+ius;
+
+  /* the time already spent in the window since MSeqStart, mostly on
+     the clear frequency search, comes out of the sub-integrations */
+
+  tend=tval+intt*1e-6;
+  if (ptr->tstart>0) {
+    tend=ptr->tstart+intt*1e-6;
+    ptr->tstart=0;
+  }
+  left=(int) ((tend-tval)*1e6);
+  if (left>intt) left=intt;
+  if (left<ptr->num*MSEQ_MINSUB) left=ptr->num*MSEQ_MINSUB;
+
+  rounds=ptr->rounds;
+  if (left/(rounds*ptr->num)<MSEQ_MINSUB) rounds=left/(ptr->num*MSEQ_MINSUB);
+  if (rounds<1) rounds=1;
+  sub=left/(rounds*ptr->num);
+
+  for (s=0;s<ptr->num;s++) {
+    sq=&ptr->seq[s];
+    memset(sq->raw,0,sizeof(struct RawData));
+    sq->nave=0;
+    sq->noise=0;
+    sq->mean=0;
+  }
+
+  for (r=0;r<rounds;r++) {
+    for (s=0;s<ptr->num;s++) {
+      sq=&ptr->seq[s];
+      mppul=sq->mppul;
+      mplgs=sq->mplgs;
+      mpinc=sq->mpinc;
+      tsgid=TSGCacheSeq(tcache,sq->ptab);
+      SiteSetIntt(sub/1000000,sub % 1000000);
+      nave=SiteIntegrate(sq->lags);
+      if (nave<0) return nave;
+      ptr->stats.sub++;
+      if (nave==0) continue;
+      OpsBuildPrm(sq->prm,sq->ptab,sq->lags);
+      OpsBuildRaw(ptr->tmp);
+      MSeqSum(sq,ptr->tmp,nave);
+      total+=nave;
+    }
+  }
+
+  for (s=0;s<ptr->num;s++) {
+    sq=&ptr->seq[s];
+    if (sq->nave==0) ptr->stats.empty++;
+    MSeqAverage(sq);
+    sq->prm->intt.sc=isc;
+    sq->prm->intt.us=ius;
+  }
+
+  ptr->stats.beams++;
+  tval=MSeqTime()-tend;
+  if (tval>0) ptr->stats.tover+=tval;
+  return total;
+}
+
+
+void MSeqLog(struct MSeq *ptr,struct TaskID *errlog,char *progname) {
+  char logtxt[256];
+
+  if (ptr->stats.beams==0) return;
+  sprintf(logtxt,
+          "Interleaved integration: %d beams, %d sub-integrations, "
+          "%d empty records, mean overrun %.3fs",
+          ptr->stats.beams,ptr->stats.sub,ptr->stats.empty,
+          ptr->stats.tover/ptr->stats.beams);
+  ErrLog(errlog,progname,logtxt);
+}
@@ -39,9 +39,19 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "tsgcache.h"
+#include "mseq.h"
 
 /*
  $Log: twotsg.c,v $
+ Revision 1.03 2026/10/17
+ Added -interleave: both sequences are integrated together in every
+ slot (mseq.c) and sent as two records
+
+ Revision 1.02 2026/10/17
+ Both timing sequences are preloaded for the day and night first
+ range and switched through a cache (tsgcache.c)
+
  Revision 1.01 2013/02/12 16:00:00 KKrieger
  Fix for 7 pulse lag table: lag 4
  Moved SiteSetIntt after SiteFCLR; DAndre
@@ -138,6 +148,12 @@ int main(int argc,char *argv[]) {
   int n;
   pid_t sid;
   int exitpoll=0;
+  struct TSGCache tcache;
+  struct MSeq *mseq=NULL;
+  unsigned char interleave=0;
+  int rounds=MSEQ_ROUNDS;
+  int mixed=0;
+  int s;
 
   int cnt=0;
   int num_scans;
@@ -206,6 +222,8 @@ int main(int argc,char *argv[]) {
 
   OptionAdd( &opt,"fast",'x',&fast);
   OptionAdd( &opt, "bm", 'i', &bmnum);
+  OptionAdd( &opt,"interleave",'x',&interleave);
+  OptionAdd( &opt,"rounds",'i',&rounds);
 
   arg=OptionProcess(1,argc,argv,&opt,NULL);
 
@@ -244,6 +262,38 @@ int main(int argc,char *argv[]) {
 
   OpsFitACFStart();
 
+  if (interleave) {
+    mseq=MSeqMake(rounds);
+    if ((mseq==NULL) ||
+        (MSeqAdd(mseq,ptab_8,lags_8,mppul_8,mplgs_8,mpinc_8) !=0) ||
+        (MSeqAdd(mseq,ptab_7,lags_7,mppul_7,mplgs_7,mpinc_7) !=0)) {
+      ErrLog(errlog,progname,"Could not set up interleaved integration.");
+      MSeqFree(mseq);
+      mseq=NULL;
+      interleave=0;
+    } else {
+      sprintf(logtxt,"Interleaving 8 and 7 pulse sequences, %d rounds.",
+              mseq->rounds);
+      ErrLog(errlog,progname,logtxt);
+    }
+  }
+
+  /* make both sequences, day and night, before the first scan so
+     that switching between them costs nothing */
+  TSGCacheSet(&tcache);
+  TSGCacheAdd(&tcache,ptab_8,mppul_8,mpinc_8,dfrang);
+  TSGCacheAdd(&tcache,ptab_7,mppul_7,mpinc_7,dfrang);
+  TSGCacheAdd(&tcache,ptab_8,mppul_8,mpinc_8,nfrang);
+  TSGCacheAdd(&tcache,ptab_7,mppul_7,mpinc_7,nfrang);
+  n=TSGCachePreload(&tcache);
+  if (n<0) ErrLog(errlog,progname,
+                  "TSG cache: preload failed, sequences will be made as needed.");
+  else {
+    sprintf(logtxt,"TSG cache: %d sequences preloaded in %.3fs",n,
+            tcache.stats.tload);
+    ErrLog(errlog,progname,logtxt);
+  }
+
   OpsSetupTask(tasklist);
   for (n=0;n<tnum;n++) {
     RMsgSndReset(tlist[n]);
@@ -313,7 +363,7 @@ int main(int argc,char *argv[]) {
       SiteSetBeam(bmnum);
 
       /* only search for clear frequency once for the two pulse sequences */
-      if ( (skip % 2) == 0 ) {
+      if ( interleave || ((skip % 2) == 0) ) {
         ErrLog(errlog,progname,"Doing clear frequency search."); 
         sprintf(logtxt, "FRQ: %d %d", stfrq, frqrng);
         ErrLog( errlog, progname, logtxt);
@@ -323,14 +373,29 @@ int main(int argc,char *argv[]) {
       }
 
       SiteSetIntt( intsc, intus);
+      if (interleave) MSeqStart(mseq);
       sprintf(logtxt,"Transmitting on: %d (Noise=%g)",tfreq,noise);
       ErrLog(errlog,progname,logtxt);
 
-      if ( (skip % 2) == 0 ) {
+      mixed=0;
+      if (interleave) {
+        nave= MSeqIntegrate(mseq,&tcache);
+        if (nave<0) {
+          sprintf(logtxt,"Integration error:%d",nave);
+          ErrLog(errlog,progname,logtxt); 
+          /* restart the radar */
+          spawnl( P_WAIT, "/home/radar/script/restart.radar", NULL);
+          exit( nave);
+        }
+        sprintf(logtxt,"Number of sequences [8]: %d [7]: %d",
+                mseq->seq[0].nave,mseq->seq[1].nave);
+        ErrLog(errlog,progname,logtxt);
+        mixed=1;
+      } else if ( (skip % 2) == 0 ) {
         mppul= mppul_8;
         mplgs= mplgs_8;
         mpinc= mpinc_8;
-        tsgid= SiteTimeSeq(ptab_8);
+        tsgid= TSGCacheSeq(&tcache,ptab_8);
         nave= SiteIntegrate(lags_8);
         if (nave<0) {
           sprintf(logtxt,"Integration error:%d",nave);
@@ -347,7 +412,7 @@ int main(int argc,char *argv[]) {
         mppul= mppul_7;
         mplgs= mplgs_7;
         mpinc= mpinc_7;
-        tsgid= SiteTimeSeq(ptab_7);
+        tsgid= TSGCacheSeq(&tcache,ptab_7);
         nave= SiteIntegrate(lags_7);
         if (nave<0) {
           sprintf(logtxt,"Integration error:%d",nave);
@@ -362,21 +427,37 @@ int main(int argc,char *argv[]) {
         OpsBuildPrm(&prm,ptab_7,lags_7);
       }
 
-      OpsBuildIQ(&iq);
-      OpsBuildRaw(&raw);
-
-      FitACF(&prm,&raw,&fblk,&fit);
-      ErrLog(errlog,progname,"Sending messages."); 
-
-      msg.num=0;
-      msg.tsize=0;
-      RMsgSndAdd(&msg,sizeof(struct RadarParm),(unsigned char *) &prm,PRM_TYPE,0);
-      RMsgSndAdd(&msg,sizeof(struct IQData),(unsigned char *) &iq, IQ_TYPE,0);
-      RMsgSndAdd(&msg,strlen(sharedmemory)+1, sharedmemory, IQS_TYPE,0);
-      RMsgSndAdd(&msg,sizeof(struct RawData),(unsigned char *) &raw,RAW_TYPE,0);
-      RMsgSndAdd(&msg,sizeof(struct FitData),(unsigned char *) &fit,FIT_TYPE,0);
-      RMsgSndAdd(&msg,strlen(progname)+1,progname,NME_TYPE,0);
-      for (n=0;n<tnum;n++) RMsgSndSend(tlist[n],&msg); 
+      if (mixed) {
+        /* one record for each sequence; there are no I&Q samples */
+        ErrLog(errlog,progname,"Sending messages."); 
+        for (s=0;s<mseq->num;s++) {
+          if (mseq->seq[s].nave==0) continue;
+          FitACF(mseq->seq[s].prm,mseq->seq[s].raw,&fblk,&fit);
+          msg.num=0;
+          msg.tsize=0;
+          RMsgSndAdd(&msg,sizeof(struct RadarParm),(unsigned char *) mseq->seq[s].prm,PRM_TYPE,0);
+          RMsgSndAdd(&msg,sizeof(struct RawData),(unsigned char *) mseq->seq[s].raw,RAW_TYPE,0);
+          RMsgSndAdd(&msg,sizeof(struct FitData),(unsigned char *) &fit,FIT_TYPE,0);
+          RMsgSndAdd(&msg,strlen(progname)+1,progname,NME_TYPE,0);
+          for (n=0;n<tnum;n++) RMsgSndSend(tlist[n],&msg); 
+        }
+      } else {
+        OpsBuildIQ(&iq);
+        OpsBuildRaw(&raw);
+
+        FitACF(&prm,&raw,&fblk,&fit);
+        ErrLog(errlog,progname,"Sending messages."); 
+
+        msg.num=0;
+        msg.tsize=0;
+        RMsgSndAdd(&msg,sizeof(struct RadarParm),(unsigned char *) &prm,PRM_TYPE,0);
+        RMsgSndAdd(&msg,sizeof(struct IQData),(unsigned char *) &iq, IQ_TYPE,0);
+        RMsgSndAdd(&msg,strlen(sharedmemory)+1, sharedmemory, IQS_TYPE,0);
+        RMsgSndAdd(&msg,sizeof(struct RawData),(unsigned char *) &raw,RAW_TYPE,0);
+        RMsgSndAdd(&msg,sizeof(struct FitData),(unsigned char *) &fit,FIT_TYPE,0);
+        RMsgSndAdd(&msg,strlen(progname)+1,progname,NME_TYPE,0);
+        for (n=0;n<tnum;n++) RMsgSndSend(tlist[n],&msg); 
+      }
 
       ErrLog(errlog,progname,"Polling for exit."); 
       exitpoll=RadarShell(sid,&rstable);
@@ -393,6 +474,11 @@ int main(int argc,char *argv[]) {
   } while (exitpoll==0);
   SiteEnd();
   for (n=0;n<tnum;n++) RMsgSndClose(tlist[n]);
+  TSGCacheLog(&tcache,errlog,progname);
+  if (mseq !=NULL) {
+    MSeqLog(mseq,errlog,progname);
+    MSeqFree(mseq);
+  }
   ErrLog(errlog,progname,"Ending program.");
   RShellTerminate(sid);
   return 0;
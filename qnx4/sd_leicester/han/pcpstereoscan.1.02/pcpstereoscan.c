@@ -64,6 +64,7 @@
 #include "taskid.h"
 #include "errlog.h"
 #include "freq.h"
+#include "freqband.h"
 #include "rmsg.h"
 #include "radarshell.h"
 #include "rmsgsnd.h"
@@ -79,6 +80,7 @@
 #include "sync.h"
 #include "interface.h"
 #include "hdw.h"
+#include "stfclr.h"
 
 /*
  $Log: pcpstereoscan.c,v $
@@ -167,6 +169,22 @@
 	channel B scan, so that it is independent of the number of beams on
 	channel A.
 
+	Modified 17/10/26
+
+	The radar shell variable minsep keeps the two channels at least
+	that many kHz apart. If the clear frequency search puts them
+	closer, each channel searches again with the other's frequency cut
+	out of its band and the pair with the lowest combined noise is
+	used (stfclr.c). The search time and separation are logged for
+	every beam.
+
+	Modified 17/10/26
+
+	The frequency bands are read from the site's freqband database
+	(table cutlass) instead of being set in u_init_freq_bands, and
+	each band is cut down to its widest part clear of the restricted
+	frequencies, so the clear frequency search never covers them.
+
   Modified 7th Dec 2001 to add camp beam flags
   Modified 23 Nov 2001 to add new -ns and -fs flags and changed some defaults
   Modified 10th Aug to account for backwards scanning radars
@@ -211,6 +229,7 @@
 
 #define SCHEDULER "schedule"
 #define ERRLOG "errlog"
+#define FREQ_TABLE "cutlass"
 
 #define CONTROL_NAME "control_program"
 #define TASK_NAMES "echo_data","rawacfwrite","fitacfwrite"
@@ -319,6 +338,8 @@ int main(int argc,char *argv[]) {
   
   int cpidA=0,cpidB=0;
 
+  struct StFCLR sfclr;
+
   xcfA=xcfB=1;
  
   cpA=CPID_A;
@@ -335,8 +356,6 @@ int main(int argc,char *argv[]) {
     perror("cannot attach proxy");
   }
  
-  u_init_freq_bands();
-  
   strcpy(cmdlne,argv[0]);
   for (n=1;n<argc;n++) {
     strcat(cmdlne," ");
@@ -425,6 +444,9 @@ printf("** 1\n");
   RadarShellAdd(&rstable, "low_beamB",	var_LONG,&low_beam_B);
   RadarShellAdd(&rstable, "high_beamB",var_LONG,&high_beam_B);
   RadarShellAdd(&rstable, "scan_period",var_LONG,&scnsc);
+
+  StFCLRSet(&sfclr,0);
+  RadarShellAdd(&rstable, "minsep",var_LONG,&sfclr.minsep);
 printf("** 2\n");
 
   /* add new options - individual frequency bands */
@@ -438,6 +460,8 @@ printf("** 2\n");
   */
    
   sprintf(progname,"pcpstereoscan");
+
+  u_init_freq_bands();
 printf("** 3\n");
 
   OpsFitACFStart();
@@ -542,9 +566,10 @@ printf("** 11a\n");
       		SiteSetIntt(intsc,intus);
 printf("** 11b\n");
 printf("**stfrqA=%d, frqrngA=%d, stfrqB=%d, frqrngB=%d\n",stfrqA, frqrngA, stfrqB, frqrngB); 
-      		if (SiteFCLRS(stfrqA,stfrqA+frqrngA,stfrqB,
+      		if (StFCLRSearch(&sfclr,stfrqA,stfrqA+frqrngA,stfrqB,
                     stfrqB+frqrngB)==FREQ_LOCAL)
         		ErrLog(errlog,progname,"Frequency Synthesizer in local mode.");
+      		StFCLRLogLast(&sfclr,errlog,progname);
 printf("** 12\n");
       		if (tfreqA==-1) tfreqA=ftable->dfrq;
       		if (tfreqB==-1) tfreqB=ftable->dfrq;
@@ -663,9 +688,10 @@ printf("** 13\n");
       		SiteSetBeam(bmnumA);
  
       		SiteSetIntt(intsc,intus);
-      		if (SiteFCLRS(stfrqA,stfrqA+frqrngA,stfrqB,
+      		if (StFCLRSearch(&sfclr,stfrqA,stfrqA+frqrngA,stfrqB,
                     stfrqB+frqrngB)==FREQ_LOCAL)
         		ErrLog(errlog,progname,"Frequency Synthesizer in local mode.");
+      		StFCLRLogLast(&sfclr,errlog,progname);
 
       		if (tfreqA==-1) tfreqA=ftable->dfrq;
       		if (tfreqB==-1) tfreqB=ftable->dfrq;
@@ -764,6 +790,7 @@ printf("** 13\n");
     	}
   } while (exitpoll==0);
   SiteEnd();
+  StFCLRLog(&sfclr,errlog,progname);
   for (n=0;n<tnum;n++) RMsgSndClose(tlist[n]);
   ErrLog(errlog,progname,"Ending program.");
   RShellTerminate(sid);
@@ -773,95 +800,27 @@ printf("** 13\n");
 
 /***************************************************************************/
 
-/* Sets up the licenced frequency bands for Iceland & finland */
+/* Sets up the licenced frequency bands for Iceland & Finland from the site's
+   freqband database, with the restricted frequencies cut out */
 
 void u_init_freq_bands() {
-
-/* start freq of each band */
-
-   /* Finland */
-
-   usfreq[0] = 8305;
-   usfreq[1] = 8965;
-   usfreq[2] = 9900;
-   usfreq[3] = 11075;
-   usfreq[4] = 11550;
-   usfreq[5] = 12370;
-   usfreq[6] = 13200;
-   usfreq[7] = 15010;
-   usfreq[8] = 16210;
-   usfreq[9] = 16555;
-   usfreq[10] = 17970;
-   usfreq[11] = 18850;
-   usfreq[12] = 19415;
-   usfreq[13] = 19705;
-   usfreq[14] = 19800;
-
-   /* Iceland */
-
-   usfreq[20] = 8000;
-   usfreq[21] = 8430;
-   usfreq[22] = 8985;
-   usfreq[23] = 10155;
-   usfreq[24] = 10655;
-   usfreq[25] = 11290;
-   usfreq[26] = 11475;
-   usfreq[27] = 12105;
-   usfreq[28] = 12305;
-   usfreq[29] = 12590;
-   usfreq[30] = 13360;
-   usfreq[31] = 13875;
-   usfreq[32] = 14400;
-   usfreq[33] = 15805;
-   usfreq[34] = 16500;
-   usfreq[35] = 16820;
-   usfreq[36] = 18175;
-   usfreq[37] = 18835;
-   usfreq[38] = 19910;
-   usfreq[39] = 10155;
-
-   /* width of each band */
-
-   /* Finland */
-
-   ufreq_range[0] = 30;
-   ufreq_range[1] = 75;
-   ufreq_range[2] = 85;
-   ufreq_range[3] = 200;
-   ufreq_range[4] = 50;
-   ufreq_range[5] = 45;
-   ufreq_range[6] = 60;
-   ufreq_range[7] = 70;
-   ufreq_range[8] = 150;
-   ufreq_range[9] = 60;
-   ufreq_range[10] = 80;
-   ufreq_range[11] = 15;
-   ufreq_range[12] = 265;
-   ufreq_range[13] = 50;
-   ufreq_range[14] = 190; 
-
-   /* Iceland */
-
-   ufreq_range[20] = 195;
-   ufreq_range[21] = 420;
-   ufreq_range[22] = 410;
-   ufreq_range[23] = 500;
-   ufreq_range[24] = 520;
-   ufreq_range[25] = 160;
-   ufreq_range[26] = 120;
-   ufreq_range[27] = 130;
-   ufreq_range[28] = 205;
-   ufreq_range[29] = 690;
-   ufreq_range[30] = 205;
-   ufreq_range[31] = 120;
-   ufreq_range[32] = 615;
-   ufreq_range[33] = 560;
-   ufreq_range[34] = 185;
-   ufreq_range[35] = 655;
-   ufreq_range[36] = 595;
-   ufreq_range[37] = 50;
-   ufreq_range[38] = 90;
-   ufreq_range[39] = 1020;
+  struct FreqBandDB *fband;
+  struct FreqBandTab *tab;
+  char logtxt[256];
+
+  fband=FreqBandLoad(NULL);
+  tab=FreqBandTable(fband,FREQ_TABLE);
+  if (tab==NULL) {
+    fprintf(stderr,"Frequency band table %s missing from the freqband "
+                   "database.\n",FREQ_TABLE);
+    exit(-1);
+  }
+  FreqBandFill(fband,tab,usfreq,ufreq_range,sizeof(usfreq)/sizeof(int));
+  sprintf(logtxt,"Frequency bands from table %s: %d cut around restricted "
+          "frequencies, %d restricted throughout",tab->name,tab->bcut,
+          tab->bfull);
+  ErrLog(errlog,progname,logtxt);
+  FreqBandFree(fband);
 }
 
 /* Sends a proxy message to the microcontroller monitoring 
@@ -0,0 +1,41 @@
+/* stfclr.h
+   ========
+*/
+
+
+#ifndef _STFCLR_H
+#define _STFCLR_H
+
+#define STFCLR_KEEP 0        /* the first pass was far enough apart */
+#define STFCLR_MOVEA 1       /* channel A moved away from B */
+#define STFCLR_MOVEB 2       /* channel B moved away from A */
+#define STFCLR_MOVEAB 3      /* both moved */
+#define STFCLR_FAIL 4        /* no pair far enough apart was found */
+#define STFCLR_NRES 5
+
+struct StFCLRStats {
+  int num;
+  int res[STFCLR_NRES];      /* searches ending each way */
+  double tpass;              /* seconds in the first pass */
+  double tfix;               /* seconds in the second pass */
+  double sepsum;
+  int sepmin;
+};
+
+struct StFCLR {
+  int minsep;                /* kHz between the channels, 0 for none */
+  int res;                   /* how the last search ended */
+  int sep;                   /* separation it chose */
+  double tpass;
+  double tfix;
+  struct StFCLRStats stats;
+};
+
+void StFCLRSet(struct StFCLR *ptr,int minsep);
+int StFCLRSearch(struct StFCLR *ptr,int stfrqA,int edfrqA,
+                 int stfrqB,int edfrqB);
+void StFCLRLogLast(struct StFCLR *ptr,struct TaskID *errlog,
+                   char *progname);
+void StFCLRLog(struct StFCLR *ptr,struct TaskID *errlog,char *progname);
+
+#endif
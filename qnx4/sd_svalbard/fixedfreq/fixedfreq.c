@@ -80,6 +80,7 @@
 #include "taskid.h"
 #include "errlog.h"
 #include "freq.h"
+#include "freqband.h"
 #include "rmsg.h"
 #include "radarshell.h"
 #include "rmsgsnd.h"
@@ -98,6 +99,10 @@
 
 /*
  $Log: stereoscan.c,v $
+ Revision 2.1  2026/10/17 12:00:00  code
+ Frequency bands read from the freqband database; restricted fixed
+ frequencies are logged.
+
  Revision 2.0  2011/11/24 14:35:45  code
  Modified for use on Russian radars
 
@@ -251,6 +256,7 @@
 
 #define SCHEDULER "schedule"
 #define ERRLOG "errlog"
+#define FREQ_TABLE "lyr"
 
 #define CONTROL_NAME "control_program"
 #define TASK_NAMES "echo_data","iqwrite","rawacfwrite","fitacfwrite","raw_write","fit_write"
@@ -275,6 +281,7 @@ struct TaskID *errlog;
 
 int usfreq[121];
 int ufreq_range[121];
+struct FreqBandDB *fband;
 
 pid_t uucont_proxy;
 
@@ -400,8 +407,6 @@ int main(int argc,char *argv[]) {
 
   OpsSetupRadar();
 
-  u_init_freq_bands();
-
 //set up default frequencies
 
 	dfrqA=DEFAULT_DAY_BAND_A_LYR;
@@ -558,6 +563,8 @@ int main(int argc,char *argv[]) {
   errlog=TaskIDMake(ename);  
   OpsLogStart(errlog,progname,argc,argv);  
 
+  u_init_freq_bands();
+
   /* handle CTs */
   if ((cts2) || (cts4) || (cts6) || (cts8)) {
     cpA = 152;
@@ -835,6 +842,10 @@ printf("stfrqA=%d, frqrngA=%d, stfrqB=%d, frqrngB=%d\n",stfrqA,frqrngA,stfrqB,fr
 //fixed frequency bodge goes here
 	  tfreqA=stfrqA+10;
 	  tfreqB=tfreqA+50;
+      if (FreqBandTest(fband,tfreqA) || FreqBandTest(fband,tfreqB)) {
+        sprintf(logtxt,"Fixed frequency restricted: A %d, B %d",tfreqA,tfreqB);
+        ErrLog(errlog,progname,logtxt);
+      }
 
       sprintf(logtxt,"Channel A Transmitting on: %d (Noise=%g)",tfreqA,noiseA);
       ErrLog(errlog,progname,logtxt);
@@ -1017,54 +1028,25 @@ printf("stfrqA=%d, frqrngA=%d, stfrqB=%d, frqrngB=%d\n",stfrqA,frqrngA,stfrqB,fr
 
 /***************************************************************************/
 
-/* Sets up the licenced frequency bands for LYR                            */
+/* Sets up the licenced frequency bands for LYR from the site's
+   freqband database, with the restricted frequencies cut out */
 
 void u_init_freq_bands() {
+  struct FreqBandTab *tab;
+  char logtxt[256];
 
-/* start freq of each band */
-
-   /* LYR */
-
-   usfreq[0] = 8050;	//keep bands 0 and 1 the same to avoid use of 0
-   usfreq[1] = 8050;
-   usfreq[2] = 9400;
-   usfreq[3] = 9600;
-   usfreq[4] = 9800;
-   usfreq[5] = 11600;
-   usfreq[6] = 11800;
-   usfreq[7] = 12000;
-   usfreq[8] = 13570;
-   usfreq[9] = 13770;
-   usfreq[10] = 15100;
-   usfreq[11] = 15350;
-   usfreq[12] = 15700;
-   usfreq[13] = 17480;
-   usfreq[14] = 17600;
-   usfreq[15] = 17800;
-   usfreq[16] = 18900;
-
-   /* width of each band */
-
-   /* LYR */
-
-   ufreq_range[0] = 100;
-   ufreq_range[1] = 100;
-   ufreq_range[2] = 100;
-   ufreq_range[3] = 100;
-   ufreq_range[4] = 100;
-   ufreq_range[5] = 100;
-   ufreq_range[6] = 100;
-   ufreq_range[7] = 100;
-   ufreq_range[8] = 100;
-   ufreq_range[9] = 100;
-   ufreq_range[10] = 100;
-   ufreq_range[11] = 100;
-   ufreq_range[12] = 100;
-   ufreq_range[13] = 100;
-   ufreq_range[14] = 100; 
-   ufreq_range[15] = 100; 
-   ufreq_range[16] = 100; 
-   ufreq_range[17] = 100; 
+  fband=FreqBandLoad(NULL);
+  tab=FreqBandTable(fband,FREQ_TABLE);
+  if (tab==NULL) {
+    fprintf(stderr,"Frequency band table %s missing from the freqband "
+                   "database.\n",FREQ_TABLE);
+    exit(-1);
+  }
+  FreqBandFill(fband,tab,usfreq,ufreq_range,sizeof(usfreq)/sizeof(int));
+  sprintf(logtxt,"Frequency bands from table %s: %d cut around restricted "
+          "frequencies, %d restricted throughout",tab->name,tab->bcut,
+          tab->bfull);
+  ErrLog(errlog,progname,logtxt);
 }
 
 /* Sends a proxy message to the microcontroller monitoring 
@@ -0,0 +1,14 @@
+/* hdw.h
+   =====
+*/
+
+
+#ifndef _HDW_H
+#define _HDW_H
+
+/* the simulated radar has no hardware of its own; this stands in for
+   the station hdw.h so that control programs build unchanged */
+
+#define SIM_RADAR 1
+
+#endif
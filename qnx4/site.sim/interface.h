@@ -0,0 +1,28 @@
+/* interface.h
+   ===========
+*/
+
+
+#ifndef _INTERFACE_H
+#define _INTERFACE_H
+
+int SiteStart();
+int SiteSetupHardware();
+pid_t SiteInitProxy(char *name);
+int SiteStartScan();
+int SiteSetChannel(int chn);
+int SiteSetBeam(int bmnum);
+int SiteSetIntt(int intsc,int intus);
+int SiteSetFreq(int freq);
+int SiteSetFreqQuiet(int freq);
+int SiteSetFreqS(int freqA,int freqB);
+int SiteFCLR(int stfreq,int edfreq);
+int SiteFCLRS(int stfreqA,int edfreqA,int stfreqB,int edfreqB);
+int SiteTimeSeq(int *ptab);
+int SiteTimeSeqS(int chn,int *ptab);
+int SiteIntegrate(int (*lags)[2]);
+int SiteIntegrateex(int (*lags)[2]);
+int SiteIntegrateS(int (*lagsA)[2],int (*lagsB)[2]);
+void SiteEnd();
+
+#endif
@@ -0,0 +1,47 @@
+/* replay.h
+   ========
+*/
+
+
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#define REPLAY_RAWACF 1
+#define REPLAY_IQDAT 2
+
+#define REPLAY_MAXENT 256   /* fields in a record */
+#define REPLAY_AHEAD 2      /* records read ahead, one per stereo channel */
+
+struct ReplayRecord {
+  int bmnum;
+  int tfreq;
+  int channel;
+  int nave;
+  int nrang;
+  int mplgs;
+  int xcf;
+  int yr,mo,dy,hr,mt,sc,us;   /* time as written */
+  double time;
+  double noise;
+  float *pwr0;       /* nrang */
+  float *acfd;       /* 2*nrang*mplgs, zero for ranges not stored */
+  float *xcfd;
+};
+
+struct ReplayStats {
+  int rec;           /* records replayed */
+  int beam;          /* records replayed on another beam */
+  int freq;          /* records replayed on another frequency */
+  int shape;         /* records with a different nrang or mplgs */
+};
+
+int ReplayOpen(char *fname);
+void ReplayClose(void);
+int ReplayType(void);
+double ReplayTime(void);
+int ReplayClock(int *yr,int *mo,int *dy,int *hr,int *mt,int *sc,int *us);
+int ReplayFCLR(struct SimChannel *chn,int n);
+int ReplayACF(struct SimChannel *chn,int *pwr0,int *acfd,int *xcfd);
+void ReplayStatsGet(struct ReplayStats *stats);
+
+#endif
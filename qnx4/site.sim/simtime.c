@@ -0,0 +1,61 @@
+/* simtime.c
+   =========
+
+   Replacement for the rtime TimeReadClock that reads the virtual
+   clock, so the scan timing, OpsFindSkip and the file reopening in
+   the control program all follow the simulated radar. It is only
+   picked up when the program is linked statically with the site
+   library ahead of -lrtime.1.
+
+   OpsWaitBoundary and the C library delay are replaced in the same
+   way, ahead of -lops.1 and the C library, so that the wait for the
+   scan boundary and the delays a program makes of its own (such as
+   the start time synchronisation in themisscan) move the virtual
+   clock on instead of sleeping.
+*/
+
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "sim.h"
+
+
+int TimeReadClock(int *yr,int *mo,int *dy,int *hr,int *mt,int *sc,
+                  int *us) {
+  struct tm *tm;
+  time_t clock;
+  double t;
+
+  t=SimTime();
+  clock=(time_t) t;
+  tm=gmtime(&clock);
+  if (tm==NULL) return -1;
+
+  *yr=tm->tm_year+1900;
+  *mo=tm->tm_mon+1;
+  *dy=tm->tm_mday;
+  *hr=tm->tm_hour;
+  *mt=tm->tm_min;
+  *sc=tm->tm_sec;
+  *us=(int) ((t-floor(t))*1e6);
+  return 0;
+}
+
+
+/* waits for the next boundary of the scan period bsc seconds and
+   bus microseconds on the virtual clock */
+
+void OpsWaitBoundary(int bsc,int bus) {
+  double period,t;
+
+  period=bsc+bus*1e-6;
+  if (period<=0) return;
+  t=SimTime();
+  SimWait(period*(floor(t/period)+1));
+}
+
+
+void delay(unsigned int ms) {
+  SimAdvance(ms*1e-3);
+}
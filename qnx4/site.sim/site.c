@@ -0,0 +1,407 @@
+/* site.c
+   ======
+
+   Site library for a simulated radar. Built as site.sim it can be
+   selected with SD_RADARCODE=sim in place of a station's hardware
+   library, so that any control program, including the stereo ones,
+   can be run on a box without a radar: no DDS, receiver, timing card
+   or microcontroller is touched, the samples come from the model in
+   sim.c and time is kept by the virtual clock there.
+
+   The radar is configured through the SD_SIM_ environment variables
+   described in README.txt. With SD_SIM_REPLAY set the frequencies,
+   noise and ACFs come from a recorded file instead (replay.c); a
+   stereo program takes the records two at a time, channel A first.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "global.h"
+#include "globals.h"
+#include "sim.h"
+#include "replay.h"
+#include "interface.h"
+
+
+#define SIM_MAXTSG 16
+
+#define SIM_MONO 0
+#define SIM_CHNA 1
+#define SIM_CHNB 2
+
+/* the time the program last read, from which OpsBuildPrm sets the
+   parameter block */
+
+extern int yr,mo,dy,hr,mt,sc,us;
+
+static struct SimConfig simcfg;
+static struct SimChannel simchn[2];
+static int simcur=0;
+static double simdead=0;
+static int simarmed=0;
+
+static int simtsg[SIM_MAXTSG][SIM_MAXPUL+4];
+static int simtsgnum=0;
+static int simreplay=0;
+
+static int simscans=0,simintt=0,simnave=0,simunarmed=0;
+static double simscan=0,simlen=0,simjump=0;
+
+
+/* copies the operating parameters from the control program globals;
+   the beam and frequency come from SiteSetBeam and SiteSetFreq */
+
+static void SiteSimLoad(struct SimChannel *ptr,int set) {
+  switch (set) {
+  case SIM_CHNA:
+    ptr->mppul=mppulA;
+    ptr->mpinc=mpincA;
+    ptr->mplgs=mplgsA;
+    ptr->nrang=nrangA;
+    ptr->frang=frangA;
+    ptr->rsep=rsepA;
+    ptr->xcf=xcfA;
+    break;
+  case SIM_CHNB:
+    ptr->mppul=mppulB;
+    ptr->mpinc=mpincB;
+    ptr->mplgs=mplgsB;
+    ptr->nrang=nrangB;
+    ptr->frang=frangB;
+    ptr->rsep=rsepB;
+    ptr->xcf=xcfB;
+    break;
+  default:
+    ptr->mppul=mppul;
+    ptr->mpinc=mpinc;
+    ptr->mplgs=mplgs;
+    ptr->nrang=nrang;
+    ptr->frang=frang;
+    ptr->rsep=rsep;
+    ptr->xcf=xcf;
+  }
+  if (ptr->mppul>SIM_MAXPUL) ptr->mppul=SIM_MAXPUL;
+  if (ptr->mplgs>SIM_MAXLAG) ptr->mplgs=SIM_MAXLAG;
+}
+
+
+/* the sequence itself is never built; sequences with the same pulse
+   table and timing get the same identifier, as TSGMake would */
+
+static int SiteSimTSG(struct SimChannel *ptr,int *ptab) {
+  int key[SIM_MAXPUL+4];
+  int n,i;
+
+  memset(key,0,sizeof(key));
+  key[0]=ptr->mppul;
+  key[1]=ptr->mpinc;
+  key[2]=ptr->frang;
+  key[3]=ptr->rsep;
+  for (n=0;n<ptr->mppul;n++) key[4+n]=ptab[n];
+  memcpy(ptr->ptab,ptab,sizeof(int)*ptr->mppul);
+
+  for (i=0;i<simtsgnum;i++)
+    if (memcmp(simtsg[i],key,sizeof(key))==0) return i;
+  if (simtsgnum==SIM_MAXTSG) return -1;
+  memcpy(simtsg[simtsgnum],key,sizeof(key));
+  simtsgnum++;
+  return simtsgnum-1;
+}
+
+
+static void SiteSimLags(struct SimChannel *ptr,int (*lags)[2]) {
+  int n;
+
+  for (n=0;n<ptr->mplgs;n++) {
+    ptr->lag[n][0]=lags[n][0];
+    ptr->lag[n][1]=lags[n][1];
+  }
+}
+
+
+/* runs the integration on nchn channels; in stereo both are tied to
+   the longer of the two sequences. As on the radar, the integration
+   runs to the end of the window armed by SiteSetIntt, less whatever
+   the clear frequency search has already taken, and uses the window
+   up; without a fresh SiteSetIntt only one sequence is transmitted */
+
+static int SiteSimIntt(int nchn) {
+  double intt=0,tseq=0;
+  int n,nave;
+
+  for (n=0;n<nchn;n++)
+    if (SimSeqTime(&simchn[n])>tseq) tseq=SimSeqTime(&simchn[n]);
+
+  if (simarmed) intt=simdead-SimTime();
+  else simunarmed++;
+  simarmed=0;
+
+  nave=(int) (intt/tseq);
+  if (nave<1) nave=1;
+  if (nave>SIM_MAXSEQ) nave=SIM_MAXSEQ;
+  if (intt<nave*tseq) intt=nave*tseq;
+
+  SimAdvance(intt);
+  simjump+=intt;
+  simintt++;
+  simnave+=nave;
+  return nave;
+}
+
+
+/* in replay the program is given the time of the record it is about
+   to get, as if it had read the clock when the record was taken, so
+   the parameters it builds from yr..us carry the recorded time; the
+   clock is moved on to that time if it is behind */
+
+static void SiteSimRecTime(void) {
+  double t;
+
+  if (ReplayClock(&yr,&mo,&dy,&hr,&mt,&sc,&us) !=0) return;
+  t=ReplayTime()-SimTime();
+  if (t<=0) return;
+  SimAdvance(t);
+  simjump+=t;
+}
+
+
+/* the replay has run out; the program ends as it would at the end
+   of the day */
+
+static void SiteSimDone(void) {
+  SiteEnd();
+  exit(0);
+}
+
+
+int SiteStart() {
+  SimLoadConfig(&simcfg);
+
+  /* a replay starts the clock at the first record unless told not to */
+
+  simreplay=0;
+  if (simcfg.replay !=NULL) {
+    if (ReplayOpen(simcfg.replay) !=0) {
+      fprintf(stderr,"Unable to replay %s.\n",simcfg.replay);
+      exit(-1);
+    }
+    simreplay=1;
+    if (simcfg.start<=0) simcfg.start=ReplayTime();
+  }
+
+  SimStart(&simcfg);
+  memset(simchn,0,sizeof(simchn));
+  simcur=0;
+  simtsgnum=0;
+  simscans=0;
+  simintt=0;
+  simnave=0;
+  simunarmed=0;
+  simarmed=0;
+  simscan=0;
+  simlen=0;
+  simjump=0;
+
+  if (simreplay)
+    fprintf(stderr,"Simulated radar: speed %g, %s, replaying %s from %s\n",
+            simcfg.speed,(simcfg.pace) ? "paced" : "unpaced",
+            (ReplayType()==REPLAY_IQDAT) ? "iqdat" : "rawacf",
+            simcfg.replay);
+  else fprintf(stderr,"Simulated radar: speed %g, seed %u, noise %g, "
+               "power %g at %g km\n",simcfg.speed,simcfg.seed,simcfg.noise,
+               simcfg.power,simcfg.range);
+  return 0;
+}
+
+
+int SiteSetupHardware() {
+  return 0;
+}
+
+
+pid_t SiteInitProxy(char *name) {
+  return 0;
+}
+
+
+/* returns non-zero when the scan can go ahead */
+
+int SiteStartScan() {
+  double t;
+
+  t=SimTime();
+  if (simscan>0) simlen+=t-simscan;
+  simscan=t;
+  simscans++;
+  return 1;
+}
+
+
+int SiteSetChannel(int chn) {
+  simcur=(chn !=0);
+  return 0;
+}
+
+
+int SiteSetBeam(int bmnum) {
+  simchn[simcur].bmnum=bmnum;
+  return 0;
+}
+
+
+/* arms the integration window from now */
+
+int SiteSetIntt(int intsc,int intus) {
+  simdead=SimTime()+intsc+intus*1e-6;
+  simarmed=1;
+  return 0;
+}
+
+
+int SiteSetFreq(int freq) {
+  simchn[simcur].tfreq=freq;
+  return 0;
+}
+
+
+int SiteSetFreqQuiet(int freq) {
+  return SiteSetFreq(freq);
+}
+
+
+int SiteSetFreqS(int freqA,int freqB) {
+  simchn[0].tfreq=freqA;
+  simchn[1].tfreq=freqB;
+  return 0;
+}
+
+
+int SiteFCLR(int stfreq,int edfreq) {
+  SiteSimLoad(&simchn[0],SIM_MONO);
+  if ((simreplay==0) || (ReplayFCLR(&simchn[0],0)<0))
+    SimFCLR(&simchn[0],stfreq,edfreq);
+  tfreq=simchn[0].tfreq;
+  noise=simchn[0].noise;
+  SimAdvance(SIM_FCLR_TIME);
+  simjump+=SIM_FCLR_TIME;
+  return 0;
+}
+
+
+/* the two receivers search at the same time */
+
+int SiteFCLRS(int stfreqA,int edfreqA,int stfreqB,int edfreqB) {
+  SiteSimLoad(&simchn[0],SIM_CHNA);
+  SiteSimLoad(&simchn[1],SIM_CHNB);
+  if ((simreplay==0) || (ReplayFCLR(&simchn[0],0)<0))
+    SimFCLR(&simchn[0],stfreqA,edfreqA);
+  tfreqA=simchn[0].tfreq;
+  noiseA=simchn[0].noise;
+  if ((simreplay==0) || (ReplayFCLR(&simchn[1],1)<0))
+    SimFCLR(&simchn[1],stfreqB,edfreqB);
+  tfreqB=simchn[1].tfreq;
+  noiseB=simchn[1].noise;
+  SimAdvance(SIM_FCLR_TIME);
+  simjump+=SIM_FCLR_TIME;
+  return 0;
+}
+
+
+int SiteTimeSeq(int *ptab) {
+  SiteSimLoad(&simchn[0],SIM_MONO);
+  lagfr=frang*20/3;
+  smsep=rsep*20/3;
+  return SiteSimTSG(&simchn[0],ptab);
+}
+
+
+int SiteTimeSeqS(int chn,int *ptab) {
+  if (chn==0) {
+    SiteSimLoad(&simchn[0],SIM_CHNA);
+    lagfrA=frangA*20/3;
+    smsepA=rsepA*20/3;
+    return SiteSimTSG(&simchn[0],ptab);
+  }
+  SiteSimLoad(&simchn[1],SIM_CHNB);
+  lagfrB=frangB*20/3;
+  smsepB=rsepB*20/3;
+  return SiteSimTSG(&simchn[1],ptab);
+}
+
+
+int SiteIntegrate(int (*lags)[2]) {
+  int nave;
+
+  SiteSimLoad(&simchn[0],SIM_MONO);
+  SiteSimLags(&simchn[0],lags);
+
+  if (simreplay) SiteSimRecTime();
+  nave=SiteSimIntt(1);
+  if (simreplay) {
+    nave=ReplayACF(&simchn[0],pwr0,acfd,xcfd);
+    if (nave<0) SiteSimDone();
+    noise=simchn[0].noise;
+    return nave;
+  }
+  if (SimACF(&simchn[0],nave,pwr0,acfd,xcfd) !=0) return -1;
+  return nave;
+}
+
+
+int SiteIntegrateex(int (*lags)[2]) {
+  return SiteIntegrate(lags);
+}
+
+
+int SiteIntegrateS(int (*lagsA)[2],int (*lagsB)[2]) {
+  int nave;
+
+  SiteSimLoad(&simchn[0],SIM_CHNA);
+  SiteSimLoad(&simchn[1],SIM_CHNB);
+  SiteSimLags(&simchn[0],lagsA);
+  SiteSimLags(&simchn[1],lagsB);
+
+  if (simreplay) SiteSimRecTime();
+  nave=SiteSimIntt(2);
+  if (simreplay) {
+    naveA=ReplayACF(&simchn[0],pwr0A,acfdA,xcfdA);
+    naveB=ReplayACF(&simchn[1],pwr0B,acfdB,xcfdB);
+    if ((naveA<0) || (naveB<0)) SiteSimDone();
+    noiseA=simchn[0].noise;
+    noiseB=simchn[1].noise;
+    return 0;
+  }
+  naveA=nave;
+  naveB=nave;
+  if (SimACF(&simchn[0],nave,pwr0A,acfdA,xcfdA) !=0) naveA=-1;
+  if (SimACF(&simchn[1],nave,pwr0B,acfdB,xcfdB) !=0) naveB=-1;
+  return 0;
+}
+
+
+void SiteEnd() {
+  struct ReplayStats rstats;
+
+  fprintf(stderr,"Simulated radar: %d scans, mean length %.3fs, "
+          "%d integrations, %d sequences, %.1fs skipped\n",
+          simscans,(simscans>1) ? simlen/(simscans-1) : 0.0,
+          simintt,simnave,simjump);
+  if (simunarmed>0)
+    fprintf(stderr,"Simulated radar: %d integrations without SiteSetIntt\n",
+            simunarmed);
+  if (simreplay) {
+    ReplayStatsGet(&rstats);
+    fprintf(stderr,"Replay: %d records, %d on another beam, "
+            "%d on another frequency, %d with another range or lag count\n",
+            rstats.rec,rstats.beam,rstats.freq,rstats.shape);
+    ReplayClose();
+    simreplay=0;
+  }
+}
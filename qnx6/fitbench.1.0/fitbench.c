@@ -0,0 +1,361 @@
+/* fitbench.c
+   ==========
+
+   Benchmark for FitACF. For each of the pulse sequences used by the
+   control programs (the 7 pulse katscan, the 8 pulse normalscan, the
+   13 pulse tauscan and the 20 pulse pulse20_test sequences) and each
+   combination of number of ranges and lags, a batch of beams of
+   synthetic ACFs is fitted one after the other and then again on a
+   pool of threads, and the time per beam of each is listed. The
+   fitted values of the two runs are compared and any difference is
+   reported.
+
+   Both runs go through the fitpool library: the serial run on a pool
+   with no threads, one beam per FitPoolFit, and the parallel run on a
+   pool of -thr threads with the whole batch in one FitPoolFit.
+
+   The site is taken from the hardware files in the same way as
+   make_fit, so SD_RADAR and SD_HDWPATH must be set.
+
+     fitbench [-stid tst] [-thr n] [-beams n] [-rpt n]
+              [-nrang n] [-mplgs n]
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "radar.h"
+#include "rprm.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "fitacf.h"
+#include "fitpool.h"
+
+
+#define BENCH_MAXPUL 20
+#define BENCH_MAXLAG 48
+#define BENCH_MAXBEAM 64
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+struct BenchSeq {
+  char *name;
+  int mppul;
+  int mpinc;
+  int mplgs;
+  int ptab[BENCH_MAXPUL];
+};
+
+struct BenchSeq seq[]={
+  {"7-pulse",7,2400,18,{0,9,12,20,22,26,27}},
+  {"8-pulse",8,1500,23,{0,14,22,24,27,31,42,43}},
+  {"13-pulse",13,1800,17,{0,15,16,23,27,29,32,47,50,52,56,63,64}},
+  {"20-pulse",20,1800,24,{0,14,15,18,19,22,25,27,30,31,36,45,49,51,54,
+                          60,61,62,63,64}},
+  {NULL,0,0,0,{0}}
+};
+
+int nrangs[]={75,100,150,225,0};
+
+unsigned int seed=1;
+
+
+static double BenchGauss(void) {
+  double u,v;
+
+  do {
+    seed^=seed<<13;
+    seed^=seed>>17;
+    seed^=seed<<5;
+    u=(seed & 0xffffff)/16777216.0;
+  } while (u==0);
+  seed^=seed<<13;
+  seed^=seed>>17;
+  seed^=seed<<5;
+  v=(seed & 0xffffff)/16777216.0;
+  return sqrt(-2*log(u))*cos(2*PI*v);
+}
+
+
+/* the lag table lists each lag the sequence can measure once, taking
+   the first pair of pulses that gives it, up to mplgs lags */
+
+static int BenchLags(struct BenchSeq *s,int mplgs,int16 *lag) {
+  int l,i,j,n=0;
+
+  for (l=0;(l<=s->ptab[s->mppul-1]) && (n<mplgs);l++) {
+    for (i=0;i<s->mppul;i++) {
+      for (j=i;j<s->mppul;j++) if (s->ptab[j]-s->ptab[i]==l) break;
+      if (j<s->mppul) break;
+    }
+    if (i==s->mppul) continue;
+    lag[2*n]=s->ptab[i];
+    lag[2*n+1]=s->ptab[j];
+    n++;
+  }
+  lag[2*n]=s->ptab[s->mppul-1];
+  lag[2*n+1]=s->ptab[s->mppul-1];
+  return n;
+}
+
+
+/* one beam of a scattering layer with a Gaussian range profile and a
+   Lorentzian spectrum whose velocity varies across the beams */
+
+static void BenchBeam(struct RadarParm *prm,struct RawData *raw,
+                      float *pwr0,float *acfd,float *xcfd,int16 *lag) {
+  double lambda,vel,tau,amp,phi,pwr,sd;
+  double nse=100;
+  int r,l,off;
+
+  lambda=299792458.0/(prm->tfreq*1e3);
+  vel=300*cos(2*PI*prm->bmnum/16.0);
+
+  for (r=0;r<prm->nrang;r++) {
+    pwr=(prm->frang+r*prm->rsep-900)/300.0;
+    pwr=5000*exp(-pwr*pwr);
+    sd=(pwr+nse)/sqrt((double) prm->nave);
+    for (l=0;l<prm->mplgs;l++) {
+      tau=(lag[2*l+1]-lag[2*l])*prm->mpinc*1e-6;
+      amp=pwr*exp(-2*PI*100*tau/lambda);
+      phi=4*PI*vel*tau/lambda;
+      off=2*(r*prm->mplgs+l);
+      acfd[off]=amp*cos(phi)+sd*BenchGauss()/sqrt(2.0);
+      acfd[off+1]=amp*sin(phi)+sd*BenchGauss()/sqrt(2.0);
+      if (tau==0) {
+        acfd[off]+=nse;
+        acfd[off+1]=0;
+        pwr0[r]=(acfd[off]>0) ? acfd[off] : 0;
+      }
+      xcfd[off]=0.8*amp*cos(phi+0.5)+sd*BenchGauss()/sqrt(2.0);
+      xcfd[off+1]=0.8*amp*sin(phi+0.5)+sd*BenchGauss()/sqrt(2.0);
+    }
+  }
+
+  raw->thr=0;
+  RawSetPwr(raw,prm->nrang,pwr0,0,NULL);
+  RawSetACF(raw,prm->nrang,prm->mplgs,acfd,0,NULL);
+  RawSetXCF(raw,prm->nrang,prm->mplgs,xcfd,0,NULL);
+}
+
+
+static void BenchPrm(struct RadarParm *prm,struct BenchSeq *s,int stid,
+                     int yr,int nrang,int mplgs,int16 *lag,int bmnum) {
+  int16 pulse[BENCH_MAXPUL];
+  int n;
+
+  prm->revision.major=1;
+  prm->revision.minor=0;
+  prm->cp=999;
+  prm->stid=stid;
+  prm->time.yr=yr;
+  prm->time.mo=1;
+  prm->time.dy=1;
+  prm->nave=30;
+  prm->lagfr=1200;
+  prm->smsep=300;
+  prm->noise.search=100;
+  prm->noise.mean=100;
+  prm->bmnum=bmnum;
+  prm->intt.sc=3;
+  prm->txpl=300;
+  prm->mpinc=s->mpinc;
+  prm->mppul=s->mppul;
+  prm->mplgs=mplgs;
+  prm->nrang=nrang;
+  prm->frang=180;
+  prm->rsep=45;
+  prm->xcf=1;
+  prm->tfreq=12000;
+
+  for (n=0;n<s->mppul;n++) pulse[n]=s->ptab[n];
+  RadarParmSetPulse(prm,s->mppul,pulse);
+  RadarParmSetLag(prm,mplgs,lag);
+}
+
+
+static int BenchSame(struct FitData *a,struct FitData *b,int nrang) {
+  int r;
+
+  for (r=0;r<nrang;r++) {
+    if (a->rng[r].qflg !=b->rng[r].qflg) return 0;
+    if (a->rng[r].gsct !=b->rng[r].gsct) return 0;
+    if (a->rng[r].nump !=b->rng[r].nump) return 0;
+    if (a->rng[r].v !=b->rng[r].v) return 0;
+    if (a->rng[r].p_l !=b->rng[r].p_l) return 0;
+    if (a->rng[r].w_l !=b->rng[r].w_l) return 0;
+    if (a->rng[r].phi0 !=b->rng[r].phi0) return 0;
+    if ((a->elv !=NULL) && (b->elv !=NULL) &&
+        (a->elv[r].normal !=b->elv[r].normal)) return 0;
+  }
+  if (a->noise.vel !=b->noise.vel) return 0;
+  if (a->noise.skynoise !=b->noise.skynoise) return 0;
+  return 1;
+}
+
+
+int main(int argc,char *argv[]) {
+
+  char *ststr="tst";
+  char *envstr;
+  FILE *fp;
+  struct RadarNetwork *network;
+  struct Radar *radar;
+  struct RadarSite *site;
+  int stid,yr=2020;
+
+  struct FitPool *serial,*pool;
+  struct FitPoolStats sstats,pstats;
+  struct FitPoolJob sjob[BENCH_MAXBEAM],pjob[BENCH_MAXBEAM];
+  struct RawData *raw[BENCH_MAXBEAM];
+  float *pwr0,*acfd,*xcfd;
+  int16 lag[2*(BENCH_MAXLAG+1)];
+
+  int nthr=4,beams=16,rpt=4;
+  int onlynrang=0,onlymplgs=0;
+  int q,i,j,c,b,nrang,mplgs,last,mx,same;
+
+  for (c=1;c<argc;c++) {
+    if (c+1>=argc) break;
+    if (strcmp(argv[c],"-stid")==0) ststr=argv[++c];
+    else if (strcmp(argv[c],"-thr")==0) nthr=atoi(argv[++c]);
+    else if (strcmp(argv[c],"-beams")==0) beams=atoi(argv[++c]);
+    else if (strcmp(argv[c],"-rpt")==0) rpt=atoi(argv[++c]);
+    else if (strcmp(argv[c],"-nrang")==0) onlynrang=atoi(argv[++c]);
+    else if (strcmp(argv[c],"-mplgs")==0) onlymplgs=atoi(argv[++c]);
+  }
+  if (beams<1) beams=1;
+  if (beams>BENCH_MAXBEAM) beams=BENCH_MAXBEAM;
+  if (rpt<1) rpt=1;
+
+  envstr=getenv("SD_RADAR");
+  if (envstr==NULL) {
+    fprintf(stderr,"Environment variable 'SD_RADAR' must be defined.\n");
+    exit(-1);
+  }
+  fp=fopen(envstr,"r");
+  if (fp==NULL) {
+    fprintf(stderr,"Could not locate radar information file.\n");
+    exit(-1);
+  }
+  network=RadarLoad(fp);
+  fclose(fp);
+  if (network==NULL) {
+    fprintf(stderr,"Failed to read radar information.\n");
+    exit(-1);
+  }
+
+  envstr=getenv("SD_HDWPATH");
+  if (envstr==NULL) {
+    fprintf(stderr,"Environment variable 'SD_HDWPATH' must be defined.\n");
+    exit(-1);
+  }
+  RadarLoadHardware(envstr,network);
+
+  stid=RadarGetID(network,ststr);
+  radar=RadarGetRadar(network,stid);
+  if (radar==NULL) {
+    fprintf(stderr,"Unknown station %s.\n",ststr);
+    exit(-1);
+  }
+  site=RadarYMDHMSGetSite(radar,yr,1,1,0,0,0);
+  if (site==NULL) {
+    fprintf(stderr,"No hardware information for %s.\n",ststr);
+    exit(-1);
+  }
+
+  serial=FitPoolMake(0,site,yr);
+  pool=FitPoolMake(nthr,site,yr);
+  if ((serial==NULL) || (pool==NULL)) {
+    fprintf(stderr,"Could not start fit pool.\n");
+    exit(-1);
+  }
+
+  mx=2*nrangs[3]*BENCH_MAXLAG;
+  pwr0=malloc(sizeof(float)*nrangs[3]);
+  acfd=malloc(sizeof(float)*mx);
+  xcfd=malloc(sizeof(float)*mx);
+  if ((pwr0==NULL) || (acfd==NULL) || (xcfd==NULL)) exit(-1);
+
+  for (b=0;b<beams;b++) {
+    sjob[b].prm=RadarParmMake();
+    pjob[b].prm=RadarParmMake();
+    raw[b]=RawMake();
+    sjob[b].raw=raw[b];
+    pjob[b].raw=raw[b];
+    sjob[b].fit=FitMake();
+    pjob[b].fit=FitMake();
+  }
+
+  fprintf(stdout,"station %s  beams %d  threads %d+1  repeats %d\n",
+          ststr,beams,pool->nthr,rpt);
+  fprintf(stdout,"%-9s %5s %5s %12s %12s %8s %s\n","sequence","nrang",
+          "mplgs","serial ms","pool ms","speedup","same");
+
+  for (q=0;seq[q].name !=NULL;q++) {
+    for (i=0;nrangs[i] !=0;i++) {
+      nrang=nrangs[i];
+      if ((onlynrang !=0) && (nrang !=onlynrang)) continue;
+
+      last=0;
+      for (j=2;j<=4;j++) {
+        mplgs=BenchLags(&seq[q],seq[q].mplgs*j/4,lag);
+        if ((mplgs==last) ||
+            ((onlymplgs !=0) && (mplgs !=onlymplgs))) continue;
+        last=mplgs;
+
+        seed=1;
+        for (b=0;b<beams;b++) {
+          BenchPrm(sjob[b].prm,&seq[q],stid,yr,nrang,mplgs,lag,b % 16);
+          BenchPrm(pjob[b].prm,&seq[q],stid,yr,nrang,mplgs,lag,b % 16);
+          BenchBeam(sjob[b].prm,raw[b],pwr0,acfd,xcfd,lag);
+        }
+
+        FitPoolStatsGet(serial,NULL);
+        FitPoolStatsGet(pool,NULL);
+        for (c=0;c<rpt;c++) {
+          for (b=0;b<beams;b++) {
+            FitPoolFit(serial,1,&sjob[b]);
+            FitPoolWait(serial);
+          }
+          FitPoolFit(pool,beams,pjob);
+          FitPoolWait(pool);
+        }
+        FitPoolStatsGet(serial,&sstats);
+        FitPoolStatsGet(pool,&pstats);
+
+        same=1;
+        for (b=0;b<beams;b++)
+          if (!BenchSame(sjob[b].fit,pjob[b].fit,nrang)) same=0;
+
+        fprintf(stdout,"%-9s %5d %5d %12.3f %12.3f %8.2f %s\n",
+                seq[q].name,nrang,mplgs,1e3*sstats.wall/sstats.jobs,
+                1e3*pstats.wall/pstats.jobs,
+                (pstats.wall>0) ? sstats.wall/pstats.wall : 0.0,
+                (same) ? "yes" : "NO");
+      }
+    }
+  }
+
+  for (b=0;b<beams;b++) {
+    RadarParmFree(sjob[b].prm);
+    RadarParmFree(pjob[b].prm);
+    RawFree(raw[b]);
+    FitFree(sjob[b].fit);
+    FitFree(pjob[b].fit);
+  }
+  free(pwr0);
+  free(acfd);
+  free(xcfd);
+  FitPoolFree(serial);
+  FitPoolFree(pool);
+  return 0;
+}
@@ -0,0 +1,214 @@
+/* fitpool.c
+   =========
+
+   Fits several records at once on a pool of threads. FitPoolFit hands
+   the records to the threads and returns at once, so the caller can
+   get on with the next integration; FitPoolWait then fits whatever is
+   left in the calling thread and returns when every record is done.
+
+   Each thread, and the caller, has a FitBlock of its own made by
+   FitACFMake, and each record is fitted whole by a single FitACF call,
+   so the results are exactly those of fitting the records one after
+   the other; only the wall time changes.
+
+   The records are not split by range: FitACF works out the noise
+   level from every range of the beam before fitting any of them and
+   that step is internal to the library, so a fit of part of the
+   ranges would not give the same answer.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "radar.h"
+#include "rprm.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "fitacf.h"
+#include "fitpool.h"
+
+
+struct FitPoolArg {
+  struct FitPool *ptr;
+  int n;
+};
+
+
+static double FitPoolTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+/* takes jobs until there are none left; called with the lock held */
+
+static void FitPoolRun(struct FitPool *ptr,struct FitBlock *fblk) {
+  struct FitPoolJob *job;
+  double tval;
+
+  while (ptr->next<ptr->njob) {
+    job=&ptr->job[ptr->next];
+    ptr->next++;
+    pthread_mutex_unlock(&ptr->mtx);
+
+    tval=FitPoolTime();
+    FitACF(job->prm,job->raw,fblk,job->fit);
+    tval=FitPoolTime()-tval;
+
+    pthread_mutex_lock(&ptr->mtx);
+    ptr->busy+=tval;
+    ptr->done++;
+    if (ptr->done==ptr->njob) pthread_cond_broadcast(&ptr->fin);
+  }
+}
+
+
+static void *FitPoolWorker(void *arg) {
+  struct FitPool *ptr=((struct FitPoolArg *) arg)->ptr;
+  int n=((struct FitPoolArg *) arg)->n;
+  int gen=0;
+
+  free(arg);
+  pthread_mutex_lock(&ptr->mtx);
+  while (1) {
+    while ((ptr->gen==gen) && (ptr->quit==0))
+      pthread_cond_wait(&ptr->cnd,&ptr->mtx);
+    if (ptr->quit) break;
+    gen=ptr->gen;
+    FitPoolRun(ptr,ptr->fblk[n+1]);
+  }
+  pthread_mutex_unlock(&ptr->mtx);
+  return NULL;
+}
+
+
+/* nthr threads are started on top of the caller, which fits in
+   FitPoolWait; nthr=0 fits in the calling thread alone */
+
+struct FitPool *FitPoolMake(int nthr,struct RadarSite *site,int yr) {
+  struct FitPool *ptr;
+  struct FitPoolArg *arg;
+  int n;
+
+  if (nthr<0) nthr=0;
+  if (nthr>FITPOOL_MAXTHR) nthr=FITPOOL_MAXTHR;
+
+  ptr=malloc(sizeof(struct FitPool));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct FitPool));
+
+  for (n=0;n<=nthr;n++) {
+    ptr->fblk[n]=FitACFMake(site,yr);
+    if (ptr->fblk[n]==NULL) break;
+  }
+  if (n<=nthr) {
+    while (n>0) FitACFFree(ptr->fblk[--n]);
+    free(ptr);
+    return NULL;
+  }
+
+  pthread_mutex_init(&ptr->mtx,NULL);
+  pthread_cond_init(&ptr->cnd,NULL);
+  pthread_cond_init(&ptr->fin,NULL);
+
+  for (n=0;n<nthr;n++) {
+    arg=malloc(sizeof(struct FitPoolArg));
+    if (arg==NULL) break;
+    arg->ptr=ptr;
+    arg->n=n;
+    if (pthread_create(&ptr->thr[n],NULL,FitPoolWorker,arg) !=0) {
+      free(arg);
+      break;
+    }
+    ptr->nthr++;
+  }
+  return ptr;
+}
+
+
+void FitPoolFree(struct FitPool *ptr) {
+  int n;
+
+  if (ptr==NULL) return;
+
+  FitPoolWait(ptr);
+  pthread_mutex_lock(&ptr->mtx);
+  ptr->quit=1;
+  pthread_cond_broadcast(&ptr->cnd);
+  pthread_mutex_unlock(&ptr->mtx);
+  for (n=0;n<ptr->nthr;n++) pthread_join(ptr->thr[n],NULL);
+
+  pthread_cond_destroy(&ptr->fin);
+  pthread_cond_destroy(&ptr->cnd);
+  pthread_mutex_destroy(&ptr->mtx);
+  for (n=0;n<=FITPOOL_MAXTHR;n++)
+    if (ptr->fblk[n] !=NULL) FitACFFree(ptr->fblk[n]);
+  free(ptr);
+}
+
+
+/* starts fitting njob independent records and returns without
+   waiting; the records must not share a RadarParm, RawData or FitData
+   and must be left alone until FitPoolWait returns. A batch still
+   running is waited for first. */
+
+int FitPoolFit(struct FitPool *ptr,int njob,struct FitPoolJob *job) {
+  if ((ptr==NULL) || (job==NULL)) return -1;
+  if (njob<1) return 0;
+
+  FitPoolWait(ptr);
+  pthread_mutex_lock(&ptr->mtx);
+  ptr->job=job;
+  ptr->njob=njob;
+  ptr->next=0;
+  ptr->done=0;
+  ptr->busy=0;
+  ptr->start=FitPoolTime();
+  ptr->gen++;
+  pthread_cond_broadcast(&ptr->cnd);
+  pthread_mutex_unlock(&ptr->mtx);
+  return 0;
+}
+
+
+/* fits the records no thread has taken yet and returns when the
+   batch is complete; returns at once if there is nothing pending */
+
+int FitPoolWait(struct FitPool *ptr) {
+  if (ptr==NULL) return -1;
+
+  pthread_mutex_lock(&ptr->mtx);
+  if (ptr->job==NULL) {
+    pthread_mutex_unlock(&ptr->mtx);
+    return 0;
+  }
+  FitPoolRun(ptr,ptr->fblk[0]);
+  while (ptr->done<ptr->njob) pthread_cond_wait(&ptr->fin,&ptr->mtx);
+
+  ptr->stats.calls++;
+  ptr->stats.jobs+=ptr->njob;
+  ptr->stats.busy+=ptr->busy;
+  ptr->stats.wall+=FitPoolTime()-ptr->start;
+  ptr->job=NULL;
+  ptr->njob=0;
+  pthread_mutex_unlock(&ptr->mtx);
+  return 0;
+}
+
+
+/* copies out and resets the accumulated counters */
+
+void FitPoolStatsGet(struct FitPool *ptr,struct FitPoolStats *stats) {
+  pthread_mutex_lock(&ptr->mtx);
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct FitPoolStats));
+  memset(&ptr->stats,0,sizeof(struct FitPoolStats));
+  pthread_mutex_unlock(&ptr->mtx);
+}
@@ -0,0 +1,48 @@
+/* fitpool.h
+   =========
+*/
+
+
+#ifndef _FITPOOL_H
+#define _FITPOOL_H
+
+#define FITPOOL_MAXTHR 16
+
+struct FitPoolJob {
+  struct RadarParm *prm;
+  struct RawData *raw;
+  struct FitData *fit;
+};
+
+struct FitPoolStats {
+  int calls;
+  int jobs;
+  double wall;   /* seconds from FitPoolFit to the end of FitPoolWait */
+  double busy;   /* seconds spent in FitACF summed over the threads */
+};
+
+struct FitPool {
+  int nthr;
+  int quit;
+  int gen;
+  pthread_t thr[FITPOOL_MAXTHR];
+  struct FitBlock *fblk[FITPOOL_MAXTHR+1];
+  pthread_mutex_t mtx;
+  pthread_cond_t cnd;
+  pthread_cond_t fin;
+  struct FitPoolJob *job;
+  int njob;
+  int next;
+  int done;
+  double start;
+  double busy;
+  struct FitPoolStats stats;
+};
+
+struct FitPool *FitPoolMake(int nthr,struct RadarSite *site,int yr);
+void FitPoolFree(struct FitPool *ptr);
+int FitPoolFit(struct FitPool *ptr,int njob,struct FitPoolJob *job);
+int FitPoolWait(struct FitPool *ptr);
+void FitPoolStatsGet(struct FitPool *ptr,struct FitPoolStats *stats);
+
+#endif
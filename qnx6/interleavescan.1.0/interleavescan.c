@@ -23,6 +23,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <string.h>
 #include <time.h>
@@ -54,6 +55,10 @@
 #include "site.h"
 #include "sitebuild.h"
 #include "siteglobal.h"
+#include "shmring.h"
+#include "shmsnd.h"
+#include "msgarena.h"
+#include "scantime.h"
 
 char *ststr=NULL;
 char *dfststr="tst";
@@ -134,6 +139,24 @@ int main(int argc,char *argv[]) {
 	int status=0;
   int fixfrq=0;
 
+	unsigned char shmem=0;
+	int shmsze=4;
+	char shmname[64];
+	char *shmtask=NULL;
+	struct ShmSnd *shmsnd=NULL;
+	struct ShmSndStats sstats;
+
+	struct MsgArena *arena=NULL;
+	struct MsgArenaStats astats;
+
+	unsigned char timing=0;
+	struct ScanTime *stime=NULL;
+	struct ScanTimeStats tstats;
+	char *tim_dir=NULL;
+	char tim_path[1024];
+	double tprobe;
+	int p;
+
 	/* new variables for dynamically creating beam sequences */
 	int *bms;						/* scanning beams                                     */
 	int intgt[20];			/* start times of each integration period             */
@@ -181,6 +204,10 @@ int main(int argc,char *argv[]) {
 	OptionAdd(&opt,"bp",    'i',&baseport); 
 	OptionAdd(&opt,"stid",  't',&ststr);
 	OptionAdd(&opt,"fixfrq",'i',&fixfrq);		/* fix the transmit frequency */
+	OptionAdd(&opt,"shm",   'x',&shmem);		/* send to local tasks through shared memory */
+	OptionAdd(&opt,"shmsze",'i',&shmsze);		/* shared memory ring size [MB] */
+	OptionAdd(&opt,"shmtask",'t',&shmtask);		/* tasks that read SHM_TYPE references, e.g. 0,1 */
+	OptionAdd(&opt,"timing",'x',&timing);		/* time the calls in the beam loop */
 	OptionAdd(&opt,"-help", 'x',&hlp);			/* just dump some parameters */
 
 	/* Process all of the command line options
@@ -295,6 +322,30 @@ int main(int argc,char *argv[]) {
 	}
 	
 	OpsFitACFStart();
+
+	arena=MsgArenaMake(MsgArenaSize(nrang,mplgs,
+					(intsc*1000000+intus)/(mpinc*ptab[mppul-1])+1));
+	if (arena==NULL) {
+		ErrLog(errlog.sock,progname,"Unable to allocate message arena.");
+		exit(1);
+	}
+
+	if (timing) {
+		stime=ScanTimeMake();
+		if (stime==NULL)
+			ErrLog(errlog.sock,progname,"Unable to allocate timing probes.");
+		tim_dir=getenv("SD_TIM_PATH");
+		if (tim_dir==NULL) sprintf(tim_path,"/data/ros/tim");
+		else sprintf(tim_path,"%s",tim_dir);
+	}
+
+	if (shmem) {
+		sprintf(shmname,"/rmsg.%s",ststr);
+		shmsnd=ShmSndMake(shmname,shmsze*1024*1024,tnum,task,shmtask);
+		if (shmsnd==NULL)
+			ErrLog(errlog.sock,progname,
+				"No local task listed with -shmtask; sending over TCP.");
+	}
 	
 	tsgid=SiteTimeSeq(ptab);	/* get the timing sequence */
 	
@@ -313,6 +364,7 @@ int main(int argc,char *argv[]) {
 		scan=1;
 		
 		ErrLog(errlog.sock,progname,"Starting scan.");
+		ScanTimeStart(stime);
 		
 		if (xcnt>0) {
 			cnt++;
@@ -379,18 +431,24 @@ int main(int argc,char *argv[]) {
 			ErrLog(errlog.sock,progname,logtxt);
 				
 			ErrLog(errlog.sock,progname,"Starting Integration.");
+			tprobe=ScanTimeNow();
 			SiteStartIntt(intsc,intus);
+			ScanTimeAdd(stime,ST_INTT,bmnum,tprobe);
 			
 			ErrLog(errlog.sock,progname,"Doing clear frequency search."); 
 			sprintf(logtxt, "FRQ: %d %d", stfrq, frqrng);
 			ErrLog(errlog.sock,progname, logtxt);
+			tprobe=ScanTimeNow();
 			tfreq=SiteFCLR(stfrq,stfrq+frqrng);
+			ScanTimeAdd(stime,ST_FCLR,bmnum,tprobe);
 
 			if ( (fixfrq > 8000) && (fixfrq < 25000) ) tfreq = fixfrq; 
 			
 			sprintf(logtxt,"Transmitting on: %d (Noise=%g)",tfreq,noise);
 			ErrLog(errlog.sock,progname,logtxt);
+			tprobe=ScanTimeNow();
 			nave=SiteIntegrate(lags);   
+			ScanTimeAdd(stime,ST_INTEGRATE,bmnum,tprobe);
 			if (nave<0) {
 				sprintf(logtxt,"Integration error:%d",nave);
 				ErrLog(errlog.sock,progname,logtxt); 
@@ -399,19 +457,26 @@ int main(int argc,char *argv[]) {
 			sprintf(logtxt,"Number of sequences: %d",nave);
 			ErrLog(errlog.sock,progname,logtxt);
 			
+			tprobe=ScanTimeNow();
 			OpsBuildPrm(prm,ptab,lags);
 			OpsBuildIQ(iq,&badtr);
 			OpsBuildRaw(raw);
+			ScanTimeAdd(stime,ST_BUILD,bmnum,tprobe);
 			
+			tprobe=ScanTimeNow();
 			FitACF(prm,raw,fblk,fit);
+			ScanTimeAdd(stime,ST_FIT,bmnum,tprobe);
 
+			tprobe=ScanTimeNow();
 			msg.num=0;
 			msg.tsize=0;
 			
-			tmpbuf=RadarParmFlatten(prm,&tmpsze);
+			tmpbuf=MsgArenaPrmFlatten(arena,prm,&tmpsze);
+			if (tmpbuf==NULL) tmpbuf=RadarParmFlatten(prm,&tmpsze);
 			RMsgSndAdd(&msg,tmpsze,tmpbuf,PRM_TYPE,0); 
 			
-			tmpbuf=IQFlatten(iq,prm->nave,&tmpsze);
+			tmpbuf=MsgArenaIQFlatten(arena,iq,prm->nave,&tmpsze);
+			if (tmpbuf==NULL) tmpbuf=IQFlatten(iq,prm->nave,&tmpsze);
 			RMsgSndAdd(&msg,tmpsze,tmpbuf,IQ_TYPE,0);
 			
 			RMsgSndAdd(&msg,sizeof(unsigned int)*2*iq->tbadtr,
@@ -420,25 +485,27 @@ int main(int argc,char *argv[]) {
 			RMsgSndAdd(&msg,strlen(sharedmemory)+1,(unsigned char *) sharedmemory,
 				   	IQS_TYPE,0);
 			
-			tmpbuf=RawFlatten(raw,prm->nrang,prm->mplgs,&tmpsze);
+			tmpbuf=MsgArenaRawFlatten(arena,raw,prm->nrang,prm->mplgs,&tmpsze);
+			if (tmpbuf==NULL) tmpbuf=RawFlatten(raw,prm->nrang,prm->mplgs,&tmpsze);
 			RMsgSndAdd(&msg,tmpsze,tmpbuf,RAW_TYPE,0); 
 			
-			tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
+			tmpbuf=MsgArenaFitFlatten(arena,fit,prm->nrang,&tmpsze);
+			if (tmpbuf==NULL) tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
 			RMsgSndAdd(&msg,tmpsze,tmpbuf,FIT_TYPE,0); 
 		
 			RMsgSndAdd(&msg,strlen(progname)+1,(unsigned char *) progname,
 				   	NME_TYPE,0);   
 			
-			for (n=0;n<tnum;n++) RMsgSndSend(task[n].sock,&msg); 
+			if (shmsnd !=NULL) ShmSndSend(shmsnd,&msg);
+			else for (n=0;n<tnum;n++) RMsgSndSend(task[n].sock,&msg); 
 			
-			for (n=0;n<msg.num;n++) {
-				if (msg.data[n].type==PRM_TYPE) free(msg.ptr[n]);
-				if (msg.data[n].type==IQ_TYPE) free(msg.ptr[n]);
-				if (msg.data[n].type==RAW_TYPE) free(msg.ptr[n]);
-				if (msg.data[n].type==FIT_TYPE) free(msg.ptr[n]); 
-			}          
-		
+			MsgArenaFreeBlock(arena,&msg);
+			MsgArenaReset(arena);
+			ScanTimeAdd(stime,ST_SEND,bmnum,tprobe);
+
+			tprobe=ScanTimeNow();
 			RadarShell(shell.sock,&rstable);
+			ScanTimeAdd(stime,ST_SHELL,bmnum,tprobe);
 			
 			if (exitpoll !=0) break;
 			scan=0;
@@ -447,11 +514,45 @@ int main(int argc,char *argv[]) {
 			bmnum = bms[skip];
 
 		} while (1);
+
+		if ((shmsnd !=NULL) && (shmsnd->stats.beams>0)) {
+			ShmSndStatsGet(shmsnd,&sstats);
+			sprintf(logtxt,"Shared memory send: %d beams, %d over TCP, "
+							"%d tasks dropped, %.0f bytes/beam, %.2fms/beam",
+							sstats.beams,sstats.fallback,sstats.dropped,
+							sstats.copied/sstats.beams,
+							1e3*sstats.tsend/sstats.beams);
+			ErrLog(errlog.sock,progname,logtxt);
+		}
 		
+		if (stime !=NULL) {
+			ScanTimeEnd(stime,&tstats);
+			sprintf(logtxt,"Scan timing p50/p99 [ms]:");
+			for (p=0;p<ST_NPHASE;p++) {
+				if (tstats.num[p]==0) continue;
+				sprintf(logtxt+strlen(logtxt)," %s %.1f/%.1f",scantime_phase[p],
+								1e3*tstats.p50[p],1e3*tstats.p99[p]);
+			}
+			if (stime->lost>0)
+				sprintf(logtxt+strlen(logtxt)," (%u probes lost)",stime->lost);
+			ErrLog(errlog.sock,progname,logtxt);
+			ScanTimeWrite(stime,tim_path,ststr,stid,1);
+		}
+
+		MsgArenaStatsGet(arena,&astats);
+		sprintf(logtxt,"Message arena: %d allocations, peak %lu bytes, "
+						"capacity %lu bytes",astats.nalloc,
+						(unsigned long) astats.peak,(unsigned long) astats.sze);
+		ErrLog(errlog.sock,progname,logtxt);
+
 		ErrLog(errlog.sock,progname,"Waiting for scan boundary."); 
 		if ((exitpoll==0) && (scannowait==0)) SiteEndScan(scnsc,scnus);
 	} while (exitpoll==0);
 
+	ShmSndFree(shmsnd);
+	MsgArenaFree(arena);
+	ScanTimeFree(stime);
+
 	for (n=0;n<tnum;n++) RMsgSndClose(task[n].sock);
 
 	ErrLog(errlog.sock,progname,"Ending program.");
@@ -483,6 +584,11 @@ void usage(void)
 		printf("    -bp int : base port (must be set here for dual radars)\n");
 		printf("  -stid char: radar string (must be set here for dual radars)\n");
 		printf("-fixfrq int : transmit on fixed frequency (kHz)\n");
+		printf("    -shm    : send records to local tasks through shared memory\n");
+		printf("-shmsze int : size of the shared memory ring (MB) [4]\n");
+		printf("-shmtask str: tasks that read shared memory references, e.g. 0,1\n");
+		printf("-timing     : time the calls in the beam loop; p50/p99 to the error log\n");
+		printf("             and a binary record per scan to SD_TIM_PATH\n");
 		printf(" --help     : print this message and quit.\n");
 		printf("\n");
 }
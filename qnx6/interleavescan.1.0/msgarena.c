@@ -0,0 +1,341 @@
+/* msgarena.c
+   ==========
+
+   Reusable buffer for the records sent to the data tasks each beam.
+   The flatten functions here produce the same layout as the library
+   RadarParmFlatten, IQFlatten, RawFlatten and FitFlatten - a copy of
+   the structure with every pointer replaced by the byte offset of its
+   data within the block - so the tasks expand them unchanged, but
+   they write into the arena instead of a fresh malloc'd buffer.
+
+   If a message outgrows the arena the overflow goes to the heap and
+   the arena is enlarged at the next reset, so once the radar settles
+   down no allocations are made at all. Only MSGARENA_SPILL overflows
+   are kept track of; past that a flatten returns NULL and the caller
+   uses the library function instead, and MsgArenaFreeBlock frees
+   what it made once the message is sent.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "rprm.h"
+#include "iq.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "rmsg.h"
+#include "rmsgsnd.h"
+#include "msgarena.h"
+
+
+#define MSGARENA_ALIGN(x) (((x)+7) & ~((size_t) 7))
+
+
+/* upper bound on the bytes needed for one beam's records */
+
+size_t MsgArenaSize(int nrang,int mplgs,int nave) {
+  size_t s=0;
+
+  s+=MSGARENA_ALIGN(sizeof(struct RadarParm)+2*(mplgs+1)*sizeof(int16)+
+                    32*sizeof(int16)+1024);
+  s+=MSGARENA_ALIGN(sizeof(struct IQData)+
+                    nave*(sizeof(struct timespec)+sizeof(float)+
+                          4*sizeof(int)));
+  s+=MSGARENA_ALIGN(sizeof(struct RawData)+
+                    nrang*(1+4*mplgs)*sizeof(float));
+  s+=MSGARENA_ALIGN(sizeof(struct FitData)+
+                    nrang*(2*sizeof(struct FitRange)+sizeof(struct FitElv)));
+  return s;
+}
+
+
+struct MsgArena *MsgArenaMake(size_t sze) {
+  struct MsgArena *ptr;
+
+  ptr=malloc(sizeof(struct MsgArena));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct MsgArena));
+
+  sze=MSGARENA_ALIGN(sze);
+  ptr->buf=malloc(sze);
+  if (ptr->buf==NULL) {
+    free(ptr);
+    return NULL;
+  }
+  ptr->sze=sze;
+  ptr->stats.nalloc=1;
+  return ptr;
+}
+
+
+void MsgArenaFree(struct MsgArena *ptr) {
+  if (ptr==NULL) return;
+  MsgArenaReset(ptr);
+  free(ptr->buf);
+  free(ptr);
+}
+
+
+/* called once the message has been sent; everything handed out
+   since the last reset becomes invalid */
+
+void MsgArenaReset(struct MsgArena *ptr) {
+  unsigned char *tmp;
+  int n;
+
+  for (n=0;n<ptr->nspill;n++) free(ptr->spill[n]);
+  ptr->nspill=0;
+
+  if (ptr->want>ptr->stats.peak) ptr->stats.peak=ptr->want;
+
+  if (ptr->want>ptr->sze) {
+    tmp=malloc(MSGARENA_ALIGN(ptr->want));
+    if (tmp !=NULL) {
+      free(ptr->buf);
+      ptr->buf=tmp;
+      ptr->sze=MSGARENA_ALIGN(ptr->want);
+      ptr->stats.nalloc++;
+    }
+  }
+  ptr->len=0;
+  ptr->want=0;
+}
+
+
+void MsgArenaStatsGet(struct MsgArena *ptr,struct MsgArenaStats *stats) {
+  ptr->stats.sze=ptr->sze;
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct MsgArenaStats));
+  ptr->stats.nalloc=0;
+  ptr->stats.peak=0;
+}
+
+
+static unsigned char *MsgArenaAlloc(struct MsgArena *ptr,size_t s) {
+  unsigned char *b;
+
+  s=MSGARENA_ALIGN(s);
+  ptr->want+=s;
+
+  if (ptr->len+s<=ptr->sze) {
+    b=ptr->buf+ptr->len;
+    ptr->len+=s;
+    return b;
+  }
+
+  if (ptr->nspill==MSGARENA_SPILL) return NULL;
+  b=malloc(s);
+  if (b==NULL) return NULL;
+  ptr->spill[ptr->nspill]=b;
+  ptr->nspill++;
+  ptr->stats.nalloc++;
+  return b;
+}
+
+
+static size_t MsgArenaCopy(unsigned char *b,size_t p,void *src,size_t s) {
+  memcpy(b+p,src,s);
+  return p+s;
+}
+
+
+void *MsgArenaPrmFlatten(struct MsgArena *ptr,struct RadarParm *prm,
+                         size_t *size) {
+  struct RadarParm *r;
+  unsigned char *b;
+  size_t p,s;
+  int n;
+
+  s=sizeof(struct RadarParm);
+  if (prm->origin.time !=NULL) s+=strlen(prm->origin.time)+1;
+  if (prm->origin.command !=NULL) s+=strlen(prm->origin.command)+1;
+  if (prm->pulse !=NULL) s+=prm->mppul*sizeof(int16);
+  for (n=0;n<2;n++) if (prm->lag[n] !=NULL) s+=(prm->mplgs+1)*sizeof(int16);
+  if (prm->combf !=NULL) s+=strlen(prm->combf)+1;
+
+  *size=0;
+  b=MsgArenaAlloc(ptr,s);
+  if (b==NULL) return NULL;
+
+  r=(struct RadarParm *) b;
+  p=MsgArenaCopy(b,0,prm,sizeof(struct RadarParm));
+
+  if (prm->origin.time !=NULL) {
+    r->origin.time=(char *) p;
+    p=MsgArenaCopy(b,p,prm->origin.time,strlen(prm->origin.time)+1);
+  }
+  if (prm->origin.command !=NULL) {
+    r->origin.command=(char *) p;
+    p=MsgArenaCopy(b,p,prm->origin.command,strlen(prm->origin.command)+1);
+  }
+  if (prm->pulse !=NULL) {
+    r->pulse=(int16 *) p;
+    p=MsgArenaCopy(b,p,prm->pulse,prm->mppul*sizeof(int16));
+  }
+  for (n=0;n<2;n++) {
+    if (prm->lag[n]==NULL) continue;
+    r->lag[n]=(int16 *) p;
+    p=MsgArenaCopy(b,p,prm->lag[n],(prm->mplgs+1)*sizeof(int16));
+  }
+  if (prm->combf !=NULL) {
+    r->combf=(char *) p;
+    p=MsgArenaCopy(b,p,prm->combf,strlen(prm->combf)+1);
+  }
+
+  *size=s;
+  return b;
+}
+
+
+void *MsgArenaIQFlatten(struct MsgArena *ptr,struct IQData *iq,int nave,
+                        size_t *size) {
+  struct IQData *r;
+  unsigned char *b;
+  size_t p,s;
+
+  s=sizeof(struct IQData);
+  if (iq->tval !=NULL) s+=nave*sizeof(struct timespec);
+  if (iq->atten !=NULL) s+=nave*sizeof(int);
+  if (iq->noise !=NULL) s+=nave*sizeof(float);
+  if (iq->offset !=NULL) s+=nave*sizeof(int);
+  if (iq->size !=NULL) s+=nave*sizeof(int);
+  if (iq->badtr !=NULL) s+=nave*sizeof(int);
+
+  *size=0;
+  b=MsgArenaAlloc(ptr,s);
+  if (b==NULL) return NULL;
+
+  r=(struct IQData *) b;
+  p=MsgArenaCopy(b,0,iq,sizeof(struct IQData));
+
+  if (iq->tval !=NULL) {
+    r->tval=(struct timespec *) p;
+    p=MsgArenaCopy(b,p,iq->tval,nave*sizeof(struct timespec));
+  }
+  if (iq->atten !=NULL) {
+    r->atten=(int *) p;
+    p=MsgArenaCopy(b,p,iq->atten,nave*sizeof(int));
+  }
+  if (iq->noise !=NULL) {
+    r->noise=(float *) p;
+    p=MsgArenaCopy(b,p,iq->noise,nave*sizeof(float));
+  }
+  if (iq->offset !=NULL) {
+    r->offset=(int *) p;
+    p=MsgArenaCopy(b,p,iq->offset,nave*sizeof(int));
+  }
+  if (iq->size !=NULL) {
+    r->size=(int *) p;
+    p=MsgArenaCopy(b,p,iq->size,nave*sizeof(int));
+  }
+  if (iq->badtr !=NULL) {
+    r->badtr=(int *) p;
+    p=MsgArenaCopy(b,p,iq->badtr,nave*sizeof(int));
+  }
+
+  *size=s;
+  return b;
+}
+
+
+void *MsgArenaRawFlatten(struct MsgArena *ptr,struct RawData *raw,
+                         int nrang,int mplgs,size_t *size) {
+  struct RawData *r;
+  unsigned char *b;
+  size_t p,s;
+  int n;
+
+  s=sizeof(struct RawData);
+  if (raw->pwr0 !=NULL) s+=nrang*sizeof(float);
+  for (n=0;n<2;n++) {
+    if (raw->acfd[n] !=NULL) s+=nrang*mplgs*sizeof(float);
+    if (raw->xcfd[n] !=NULL) s+=nrang*mplgs*sizeof(float);
+  }
+
+  *size=0;
+  b=MsgArenaAlloc(ptr,s);
+  if (b==NULL) return NULL;
+
+  r=(struct RawData *) b;
+  p=MsgArenaCopy(b,0,raw,sizeof(struct RawData));
+
+  if (raw->pwr0 !=NULL) {
+    r->pwr0=(float *) p;
+    p=MsgArenaCopy(b,p,raw->pwr0,nrang*sizeof(float));
+  }
+  for (n=0;n<2;n++) {
+    if (raw->acfd[n]==NULL) continue;
+    r->acfd[n]=(float *) p;
+    p=MsgArenaCopy(b,p,raw->acfd[n],nrang*mplgs*sizeof(float));
+  }
+  for (n=0;n<2;n++) {
+    if (raw->xcfd[n]==NULL) continue;
+    r->xcfd[n]=(float *) p;
+    p=MsgArenaCopy(b,p,raw->xcfd[n],nrang*mplgs*sizeof(float));
+  }
+
+  *size=s;
+  return b;
+}
+
+
+void *MsgArenaFitFlatten(struct MsgArena *ptr,struct FitData *fit,
+                         int nrang,size_t *size) {
+  struct FitData *r;
+  unsigned char *b;
+  size_t p,s;
+
+  s=sizeof(struct FitData);
+  if (fit->rng !=NULL) s+=nrang*sizeof(struct FitRange);
+  if (fit->xrng !=NULL) s+=nrang*sizeof(struct FitRange);
+  if (fit->elv !=NULL) s+=nrang*sizeof(struct FitElv);
+
+  *size=0;
+  b=MsgArenaAlloc(ptr,s);
+  if (b==NULL) return NULL;
+
+  r=(struct FitData *) b;
+  p=MsgArenaCopy(b,0,fit,sizeof(struct FitData));
+
+  if (fit->rng !=NULL) {
+    r->rng=(struct FitRange *) p;
+    p=MsgArenaCopy(b,p,fit->rng,nrang*sizeof(struct FitRange));
+  }
+  if (fit->xrng !=NULL) {
+    r->xrng=(struct FitRange *) p;
+    p=MsgArenaCopy(b,p,fit->xrng,nrang*sizeof(struct FitRange));
+  }
+  if (fit->elv !=NULL) {
+    r->elv=(struct FitElv *) p;
+    p=MsgArenaCopy(b,p,fit->elv,nrang*sizeof(struct FitElv));
+  }
+
+  *size=s;
+  return b;
+}
+
+
+/* frees the records of blk that were not flattened into the arena;
+   called after the block is sent and before MsgArenaReset */
+
+void MsgArenaFreeBlock(struct MsgArena *ptr,struct RMsgBlock *blk) {
+  unsigned char *b;
+  int n,m;
+
+  for (n=0;n<blk->num;n++) {
+    if ((blk->data[n].type !=PRM_TYPE) && (blk->data[n].type !=IQ_TYPE) &&
+        (blk->data[n].type !=RAW_TYPE) && (blk->data[n].type !=FIT_TYPE))
+      continue;
+    b=blk->ptr[n];
+    if (b==NULL) continue;
+    if ((b>=ptr->buf) && (b<ptr->buf+ptr->sze)) continue;
+    for (m=0;m<ptr->nspill;m++) if (b==ptr->spill[m]) break;
+    if (m<ptr->nspill) continue;
+    free(b);
+    ptr->stats.nalloc++;
+  }
+}
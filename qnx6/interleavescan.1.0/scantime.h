@@ -0,0 +1,83 @@
+/* scantime.h
+   ==========
+*/
+
+
+#ifndef _SCANTIME_H
+#define _SCANTIME_H
+
+#define SCANTIME_MAGIC 0x4d495453
+#define SCANTIME_MAJOR 1
+#define SCANTIME_MINOR 0
+
+#define SCANTIME_SIZE 4096
+
+#define ST_INTT 0          /* SiteStartIntt */
+#define ST_FCLR 1          /* SiteFCLR */
+#define ST_INTEGRATE 2     /* SiteIntegrate */
+#define ST_BUILD 3         /* OpsBuildPrm, OpsBuildIQ and OpsBuildRaw */
+#define ST_FIT 4           /* FitACF */
+#define ST_SEND 5          /* flattening and RMsgSndSend to every task */
+#define ST_SHELL 6         /* RadarShell */
+#define ST_NPHASE 7
+
+/* one timed call; start is relative to the start of the scan */
+
+struct ScanTimeProbe {
+  int32 phase;
+  int32 bmnum;
+  double start;
+  double dur;
+};
+
+/* written to the timing file ahead of the num probes for each scan */
+
+struct ScanTimeHeader {
+  int32 magic;
+  int16 major;
+  int16 minor;
+  int16 stid;
+  int16 scan;
+  int32 num;
+  double time;       /* start of the scan (epoch seconds) */
+  double len;        /* seconds from the start of the scan to now */
+};
+
+struct ScanTimeStats {
+  int num[ST_NPHASE];
+  double p50[ST_NPHASE];
+  double p99[ST_NPHASE];
+  double sum[ST_NPHASE];
+};
+
+/* the slots are claimed with an atomic increment of head, so the beam
+   loop and a worker thread can both record without taking a lock */
+
+struct ScanTimeSlot {
+  volatile unsigned int seq;
+  struct ScanTimeProbe probe;
+};
+
+struct ScanTime {
+  volatile unsigned int head;
+  unsigned int tail;
+  unsigned int lost;
+  double start;
+  double epoch;
+  int num;
+  struct ScanTimeProbe scan[SCANTIME_SIZE];
+  struct ScanTimeSlot slot[SCANTIME_SIZE];
+};
+
+extern char *scantime_phase[ST_NPHASE];
+
+struct ScanTime *ScanTimeMake(void);
+void ScanTimeFree(struct ScanTime *ptr);
+double ScanTimeNow(void);
+void ScanTimeStart(struct ScanTime *ptr);
+void ScanTimeAdd(struct ScanTime *ptr,int phase,int bmnum,double tval);
+int ScanTimeEnd(struct ScanTime *ptr,struct ScanTimeStats *stats);
+int ScanTimeWrite(struct ScanTime *ptr,char *path,char *ststr,int stid,
+                  int scan);
+
+#endif
@@ -0,0 +1,174 @@
+/* shmsnd.c
+   ========
+
+   Sends a message block to the data tasks through a shared memory
+   ring. The block is copied into the ring once and every task on the
+   local host that is listed as reading SHM_TYPE references is sent a
+   short reference to it; every other task, and every task when the
+   ring is full, gets the block over TCP. A task that the ring has
+   dropped for not acknowledging gets the block over TCP from then on.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "tcpipmsg.h"
+#include "rmsg.h"
+#include "rmsgsnd.h"
+#include "shmring.h"
+#include "shmsnd.h"
+
+
+static double ShmSndTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static int ShmSndLocal(char *host) {
+  if (strcmp(host,"127.0.0.1")==0) return 1;
+  if (strcmp(host,"localhost")==0) return 1;
+  return 0;
+}
+
+
+/* turns a comma separated list of task numbers into a mask */
+
+static unsigned int ShmSndMask(char *list) {
+  unsigned int mask=0;
+  char *ep;
+  long n;
+
+  if (list==NULL) return 0;
+  while (*list !=0) {
+    n=strtol(list,&ep,10);
+    if (ep==list) break;
+    if ((n>=0) && (n<SHMRING_MAX_READER)) mask|=1U<<n;
+    list=ep;
+    if (*list==',') list++;
+  }
+  return mask;
+}
+
+
+/* list names the tasks that can read SHM_TYPE references; returns
+   NULL if none of them is on the local host */
+
+struct ShmSnd *ShmSndMake(char *name,size_t size,int tnum,
+                          struct TCPIPMsgHost *task,char *list) {
+  struct ShmSnd *ptr;
+  unsigned int mask;
+  int n,cnt=0;
+
+  mask=ShmSndMask(list);
+  for (n=0;(n<tnum) && (n<SHMRING_MAX_READER);n++)
+    if ((mask & (1U<<n)) && (ShmSndLocal(task[n].host))) cnt++;
+  if (cnt==0) return NULL;
+
+  ptr=malloc(sizeof(struct ShmSnd));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct ShmSnd));
+
+  ptr->ring=ShmRingMake(name,size);
+  if (ptr->ring==NULL) {
+    free(ptr);
+    return NULL;
+  }
+
+  ptr->tnum=tnum;
+  ptr->task=task;
+
+  for (n=0;(n<tnum) && (n<SHMRING_MAX_READER);n++) {
+    if ((mask & (1U<<n))==0) continue;
+    if (ShmSndLocal(task[n].host)==0) continue;
+    ptr->shm[n]=1;
+    ShmRingAttach(ptr->ring,n);
+  }
+  return ptr;
+}
+
+
+void ShmSndFree(struct ShmSnd *ptr) {
+  if (ptr==NULL) return;
+  ShmRingFree(ptr->ring);
+  free(ptr);
+}
+
+
+int ShmSndSend(struct ShmSnd *ptr,struct RMsgBlock *blk) {
+
+  struct ShmSndEntry ent[SHMSND_MAXENT];
+  void *buf[SHMSND_MAXENT+1];
+  size_t len[SHMSND_MAXENT+1];
+  struct ShmSndRef sref;
+  struct RMsgBlock rblk;
+  uint64_t seq=0,off=0;
+  double tval;
+  int n,status=-1;
+
+  tval=ShmSndTime();
+
+  if (blk->num<=SHMSND_MAXENT) {
+    buf[0]=ent;
+    len[0]=sizeof(struct ShmSndEntry)*blk->num;
+    for (n=0;n<blk->num;n++) {
+      ent[n].type=blk->data[n].type;
+      ent[n].tag=blk->data[n].tag;
+      ent[n].size=blk->data[n].size;
+      buf[n+1]=blk->ptr[n];
+      len[n+1]=blk->data[n].size;
+    }
+    status=ShmRingWrite(ptr->ring,blk->num+1,buf,len,&seq,&off);
+  }
+
+  if (status==0) {
+    for (n=0;n<blk->num+1;n++) ptr->stats.copied+=len[n];
+
+    memset(&sref,0,sizeof(struct ShmSndRef));
+    strncpy(sref.name,ptr->ring->name,sizeof(sref.name)-1);
+    sref.seq=seq;
+    sref.off=off;
+    sref.num=blk->num;
+    for (n=0;n<blk->num+1;n++) sref.size+=len[n];
+  } else ptr->stats.fallback++;
+
+  for (n=0;(n<ptr->tnum) && (n<SHMRING_MAX_READER);n++) {
+    if ((ptr->shm[n]==0) || (ShmRingLost(ptr->ring,n)==0)) continue;
+    ptr->shm[n]=0;
+    ptr->stats.dropped++;
+  }
+
+  for (n=0;n<ptr->tnum;n++) {
+    if ((status==0) && (n<SHMRING_MAX_READER) && (ptr->shm[n])) {
+      sref.reader=n;
+      rblk.num=0;
+      rblk.tsize=0;
+      RMsgSndAdd(&rblk,sizeof(struct ShmSndRef),(unsigned char *) &sref,
+                 SHM_TYPE,0);
+      RMsgSndSend(ptr->task[n].sock,&rblk);
+      ptr->stats.copied+=sizeof(struct ShmSndRef);
+    } else {
+      RMsgSndSend(ptr->task[n].sock,blk);
+      ptr->stats.copied+=blk->tsize;
+    }
+  }
+
+  ptr->stats.beams++;
+  ptr->stats.tsend+=ShmSndTime()-tval;
+  return status;
+}
+
+
+/* copies out and resets the accumulated counters */
+
+void ShmSndStatsGet(struct ShmSnd *ptr,struct ShmSndStats *stats) {
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct ShmSndStats));
+  memset(&ptr->stats,0,sizeof(struct ShmSndStats));
+}
@@ -11,6 +11,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <string.h>
 #include <time.h>
@@ -44,12 +45,21 @@
 #include "siteglobal.h"
 
 #include "sndwrite.h"
+#include "sndmap.h"
+#include "sndbudget.h"
+#include "shmring.h"
+#include "shmsnd.h"
+#include "msgarena.h"
+#include "scantime.h"
 
 #define MAX_SND_FREQS 12
 
 void write_snd_record(char *progname, struct RadarParm *prm,
                       struct FitData *fit);
 
+/* the sounding file stays open and mapped between records */
+struct SndMap *sndmap=NULL;
+
 #define RT_TASK 3
 
 char *ststr=NULL;
@@ -118,6 +128,24 @@ int main(int argc,char *argv[]) {
   int status=0;
   int fixfrq=0;
 
+  unsigned char shmem=0;
+  int shmsze=4;
+  char shmname[64];
+  char *shmtask=NULL;
+  struct ShmSnd *shmsnd=NULL;
+  struct ShmSndStats sstats;
+
+  struct MsgArena *arena=NULL;
+  struct MsgArenaStats astats;
+
+  unsigned char timing=0;
+  struct ScanTime *stime=NULL;
+  struct ScanTimeStats tstats;
+  char *tim_dir=NULL;
+  char tim_path[1024];
+  double tprobe;
+  int p;
+
   int def_nrang=0;
 
   /* new variables for dynamically creating beam sequences */
@@ -158,6 +186,9 @@ int main(int argc,char *argv[]) {
   int snd_intt_sc=1;
   int snd_intt_us=500000;
   float snd_time, snd_intt, time_needed=1.25;
+  float snd_q=0;
+  struct SndBudget *sbudget=NULL;
+  struct SndBudgetStats sbstats;
 
   char *snd_dir;
   char data_path[100];
@@ -196,6 +227,11 @@ int main(int argc,char *argv[]) {
   OptionAdd(&opt,"fixfrq",'i',&fixfrq);     /* fix the transmit frequency */
   OptionAdd(&opt,"frqrng",'i',&frqrng);     /* fix the FCLR window [kHz] */
   OptionAdd(&opt,"sfrqrng",'i',&snd_frqrng); /* sounding FCLR window [kHz] */
+  OptionAdd(&opt,"shm",   'x',&shmem);      /* send to local tasks through shared memory */
+  OptionAdd(&opt,"shmsze",'i',&shmsze);     /* shared memory ring size [MB] */
+  OptionAdd(&opt,"shmtask",'t',&shmtask);    /* tasks that read SHM_TYPE references, e.g. 0,1 */
+  OptionAdd(&opt,"timing",'x',&timing);     /* time the calls in the beam loop */
+  OptionAdd(&opt,"sndq",  'f',&snd_q);      /* learn time_needed for this quantile of the overhead */
   OptionAdd(&opt,"-help", 'x',&hlp);        /* just dump some parameters */
 
   /* Process all of the command line options
@@ -315,6 +351,36 @@ int main(int argc,char *argv[]) {
 
   OpsFitACFStart();
 
+  arena=MsgArenaMake(MsgArenaSize(nrang,mplgs,
+                     (intsc*1000000+intus)/(mpinc*ptab[mppul-1])+1));
+  if (arena==NULL) {
+    ErrLog(errlog.sock,progname,"Unable to allocate message arena.");
+    exit(1);
+  }
+
+  if (timing) {
+    stime=ScanTimeMake();
+    if (stime==NULL)
+      ErrLog(errlog.sock,progname,"Unable to allocate timing probes.");
+    tim_dir=getenv("SD_TIM_PATH");
+    if (tim_dir==NULL) sprintf(tim_path,"/data/ros/tim");
+    else sprintf(tim_path,"%s",tim_dir);
+  }
+
+  if (snd_q>0) {
+    sbudget=SndBudgetMake(time_needed,snd_q);
+    if (sbudget==NULL)
+      ErrLog(errlog.sock,progname,"Invalid sounding quantile; using a fixed time_needed.");
+  }
+
+  if (shmem) {
+    sprintf(shmname,"/rmsg.%s",ststr);
+    shmsnd=ShmSndMake(shmname,shmsze*1024*1024,tnum,task,shmtask);
+    if (shmsnd==NULL)
+      ErrLog(errlog.sock,progname,
+        "No local task listed with -shmtask; sending over TCP.");
+  }
+
   do {
 
     tsgid=SiteTimeSeq(ptab);  /* get the timing sequence */
@@ -332,6 +398,7 @@ int main(int argc,char *argv[]) {
     scan = 1;
 
     ErrLog(errlog.sock,progname,"Starting scan.");
+    ScanTimeStart(stime);
 
     if (xcnt>0) {
       cnt++;
@@ -364,18 +431,24 @@ int main(int argc,char *argv[]) {
       ErrLog(errlog.sock,progname,logtxt);
 
       ErrLog(errlog.sock,progname,"Starting Integration.");
+      tprobe=ScanTimeNow();
       SiteStartIntt(intsc,intus);
+      ScanTimeAdd(stime,ST_INTT,bmnum,tprobe);
 
       ErrLog(errlog.sock,progname,"Doing clear frequency search.");
       sprintf(logtxt, "FRQ: %d %d", stfrq, frqrng);
       ErrLog(errlog.sock,progname, logtxt);
+      tprobe=ScanTimeNow();
       tfreq=SiteFCLR(stfrq,stfrq+frqrng);
+      ScanTimeAdd(stime,ST_FCLR,bmnum,tprobe);
 
       if ( (fixfrq > 8000) && (fixfrq < 25000) ) tfreq = fixfrq;
 
       sprintf(logtxt,"Transmitting on: %d (Noise=%g)",tfreq,noise);
       ErrLog(errlog.sock,progname,logtxt);
+      tprobe=ScanTimeNow();
       nave=SiteIntegrate(lags);
+      ScanTimeAdd(stime,ST_INTEGRATE,bmnum,tprobe);
       if (nave<0) {
         sprintf(logtxt,"Integration error:%d",nave);
         ErrLog(errlog.sock,progname,logtxt);
@@ -384,19 +457,26 @@ int main(int argc,char *argv[]) {
       sprintf(logtxt,"Number of sequences: %d",nave);
       ErrLog(errlog.sock,progname,logtxt);
 
+      tprobe=ScanTimeNow();
       OpsBuildPrm(prm,ptab,lags);
       OpsBuildIQ(iq,&badtr);
       OpsBuildRaw(raw);
+      ScanTimeAdd(stime,ST_BUILD,bmnum,tprobe);
 
+      tprobe=ScanTimeNow();
       FitACF(prm,raw,fblk,fit);
+      ScanTimeAdd(stime,ST_FIT,bmnum,tprobe);
 
+      tprobe=ScanTimeNow();
       msg.num=0;
       msg.tsize=0;
 
-      tmpbuf=RadarParmFlatten(prm,&tmpsze);
+      tmpbuf=MsgArenaPrmFlatten(arena,prm,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=RadarParmFlatten(prm,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,PRM_TYPE,0);
 
-      tmpbuf=IQFlatten(iq,prm->nave,&tmpsze);
+      tmpbuf=MsgArenaIQFlatten(arena,iq,prm->nave,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=IQFlatten(iq,prm->nave,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,IQ_TYPE,0);
 
       RMsgSndAdd(&msg,sizeof(unsigned int)*2*iq->tbadtr,
@@ -405,25 +485,27 @@ int main(int argc,char *argv[]) {
       RMsgSndAdd(&msg,strlen(sharedmemory)+1,(unsigned char *) sharedmemory,
                  IQS_TYPE,0);
 
-      tmpbuf=RawFlatten(raw,prm->nrang,prm->mplgs,&tmpsze);
+      tmpbuf=MsgArenaRawFlatten(arena,raw,prm->nrang,prm->mplgs,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=RawFlatten(raw,prm->nrang,prm->mplgs,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,RAW_TYPE,0);
 
-      tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
+      tmpbuf=MsgArenaFitFlatten(arena,fit,prm->nrang,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,FIT_TYPE,0);
 
       RMsgSndAdd(&msg,strlen(progname)+1,(unsigned char *) progname,
                  NME_TYPE,0);
 
-      for (n=0;n<tnum;n++) RMsgSndSend(task[n].sock,&msg);
+      if (shmsnd !=NULL) ShmSndSend(shmsnd,&msg);
+      else for (n=0;n<tnum;n++) RMsgSndSend(task[n].sock,&msg);
 
-      for (n=0;n<msg.num;n++) {
-        if (msg.data[n].type==PRM_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==IQ_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==RAW_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==FIT_TYPE) free(msg.ptr[n]);
-      }
+      MsgArenaFreeBlock(arena,&msg);
+      MsgArenaReset(arena);
+      ScanTimeAdd(stime,ST_SEND,bmnum,tprobe);
 
+      tprobe=ScanTimeNow();
       RadarShell(shell.sock,&rstable);
+      ScanTimeAdd(stime,ST_SHELL,bmnum,tprobe);
 
       scan = 0;
       if (skip == (nintgs-1)) break;
@@ -432,6 +514,16 @@ int main(int argc,char *argv[]) {
 
     } while (1);
 
+    if ((shmsnd !=NULL) && (shmsnd->stats.beams>0)) {
+      ShmSndStatsGet(shmsnd,&sstats);
+      sprintf(logtxt,"Shared memory send: %d beams, %d over TCP, "
+                     "%d tasks dropped, %.0f bytes/beam, %.2fms/beam",
+                     sstats.beams,sstats.fallback,sstats.dropped,
+                     sstats.copied/sstats.beams,
+                     1e3*sstats.tsend/sstats.beams);
+      ErrLog(errlog.sock,progname,logtxt);
+    }
+
 
     /* In here comes the sounder code */
     /* set the "sounder mode" scan variable */
@@ -452,8 +544,13 @@ int main(int argc,char *argv[]) {
     /* minus a safety factor given in time_needed */
     TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
     snd_time = 60.0 - (sc + us*1e-6);
+    if (sbudget != NULL) {
+      SndBudgetStart(sbudget, snd_time);
+      time_needed = SndBudgetNeed(sbudget);
+    }
 
     while (snd_time-snd_intt > time_needed) {
+      if (sbudget != NULL) SndBudgetBegin(sbudget);
 
       /* set the beam */
       bmnum = snd_bms[snd_bm_cnt] + odd_beams;
@@ -493,19 +590,17 @@ int main(int argc,char *argv[]) {
       msg.num = 0;
       msg.tsize = 0;
 
-      tmpbuf=RadarParmFlatten(prm,&tmpsze);
+      tmpbuf=MsgArenaPrmFlatten(arena,prm,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=RadarParmFlatten(prm,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,PRM_TYPE,0);
 
-      tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
+      tmpbuf=MsgArenaFitFlatten(arena,fit,prm->nrang,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,FIT_TYPE,0);
 
       RMsgSndSend(task[RT_TASK].sock,&msg);
-      for (n=0;n<msg.num;n++) {
-        if (msg.data[n].type==PRM_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==IQ_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==RAW_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==FIT_TYPE) free(msg.ptr[n]);
-      }
+      MsgArenaFreeBlock(arena,&msg);
+      MsgArenaReset(arena);
 
       sprintf(logtxt, "SBC: %d  SFC: %d", snd_bm_cnt, snd_freq_cnt);
       ErrLog(errlog.sock, progname, logtxt);
@@ -519,6 +614,7 @@ int main(int argc,char *argv[]) {
 
       /* save the sounding mode data */
       write_snd_record(progname, prm, fit);
+      if (sbudget != NULL) SndBudgetEnd(sbudget, snd_intt);
 
       ErrLog(errlog.sock, progname, "Polling SND for exit.\n");
 
@@ -537,6 +633,20 @@ int main(int argc,char *argv[]) {
       /* see if we have enough time for another go round */
       TimeReadClock(&yr, &mo, &dy, &hr, &mt, &sc, &us);
       snd_time = 60.0 - (sc + us*1e-6);
+      if (sbudget != NULL) time_needed = SndBudgetNeed(sbudget);
+    }
+
+    if (sbudget != NULL) {
+      SndBudgetDone(sbudget, &sbstats);
+      sprintf(logtxt, "Sounding budget: %d soundings, overhead %.3f+/-%.3fs, "
+                      "allowing %.3fs, ", sbstats.num, sbstats.mean,
+                      sbstats.sdev, sbstats.need);
+      if (sbstats.slack < 0)
+        sprintf(logtxt+strlen(logtxt), "overran minute by %.3fs", -sbstats.slack);
+      else sprintf(logtxt+strlen(logtxt), "%.3fs slack", sbstats.slack);
+      sprintf(logtxt+strlen(logtxt), " (%d of %d minutes overran)",
+              sbstats.overrun, sbstats.minutes);
+      ErrLog(errlog.sock, progname, logtxt);
     }
 
     /* now wait for the next interleavescan */
@@ -546,10 +656,36 @@ int main(int argc,char *argv[]) {
     intus = fast_intt_us;
     nrang = def_nrang;
 
+    if (stime !=NULL) {
+      ScanTimeEnd(stime,&tstats);
+      sprintf(logtxt,"Scan timing p50/p99 [ms]:");
+      for (p=0;p<ST_NPHASE;p++) {
+        if (tstats.num[p]==0) continue;
+        sprintf(logtxt+strlen(logtxt)," %s %.1f/%.1f",scantime_phase[p],
+                1e3*tstats.p50[p],1e3*tstats.p99[p]);
+      }
+      if (stime->lost>0)
+        sprintf(logtxt+strlen(logtxt)," (%u probes lost)",stime->lost);
+      ErrLog(errlog.sock,progname,logtxt);
+      ScanTimeWrite(stime,tim_path,ststr,stid,1);
+    }
+
+    MsgArenaStatsGet(arena,&astats);
+    sprintf(logtxt,"Message arena: %d allocations, peak %lu bytes, "
+                   "capacity %lu bytes",astats.nalloc,
+                   (unsigned long) astats.peak,(unsigned long) astats.sze);
+    ErrLog(errlog.sock,progname,logtxt);
+
     SiteEndScan(scnsc,scnus,5000);
 
   } while (1);
 
+  ShmSndFree(shmsnd);
+  SndMapFree(sndmap);
+  MsgArenaFree(arena);
+  ScanTimeFree(stime);
+  SndBudgetFree(sbudget);
+
   for (n=0;n<tnum;n++) RMsgSndClose(task[n].sock);
 
   ErrLog(errlog.sock,progname,"Ending program.");
@@ -580,6 +716,12 @@ void usage(void)
     printf(" -fixfrq int : transmit on fixed frequency (kHz)\n");
     printf(" -frqrng int : set the clear frequency search window (kHz)\n");
     printf("-sfrqrng int : set the sounding FCLR search window (kHz)\n");
+    printf("     -shm    : send records to local tasks through shared memory\n");
+    printf(" -shmsze int : size of the shared memory ring (MB) [4]\n");
+    printf(" -shmtask str: tasks that read shared memory references, e.g. 0,1\n");
+    printf(" -timing     : time the calls in the beam loop; p50/p99 to the error log\n");
+    printf("               and a binary record per scan to SD_TIM_PATH\n");
+    printf(" -sndq float : learn the time a sounding needs, allowing for this quantile\n");
     printf("  --help     : print this message and quit.\n");
     printf("\n");
 }
@@ -593,7 +735,6 @@ void write_snd_record(char *progname, struct RadarParm *prm, struct FitData *fit
   char data_path[100], data_filename[50], filename[80];
 
   char *snd_dir;
-  FILE *out;
 
   char logtxt[1024]="";
   int status;
@@ -616,23 +757,27 @@ void write_snd_record(char *progname, struct RadarParm *prm, struct FitData *fit
   /* finally make the filename */
   sprintf(filename, "%s%s.snd", data_path, data_filename);
 
-  /* open the output file */
-  fprintf(stderr,"Sounding Data File: %s\n",filename);
-  out = fopen(filename,"a");
-  if (out == NULL) {
-    /* crap. might as well go home */
-    sprintf(logtxt,"Unable to open sounding file:%s",filename);
+  /* append to the mapped file; it is only reopened when the name changes */
+  if (sndmap == NULL) sndmap = SndMapMake();
+  if ((sndmap != NULL) && (SndMapOpen(sndmap, filename) == 0)) {
+    status = SndMapWrite(sndmap, prm, fit);
+    if (status != -1) {
+      ErrLog(errlog.sock,progname,"Sounding record successfully written.");
+      return;
+    }
+    sprintf(logtxt,"Unable to map sounding file:%s",filename);
     ErrLog(errlog.sock,progname,logtxt);
-    return;
+    SndMapClose(sndmap);
   }
 
-  /* write the sounding record */
-  status = SndFwrite(out, prm, fit);
+  /* fall back to appending the record, and its index entry, without
+     the mapping */
+  fprintf(stderr,"Sounding Data File: %s\n",filename);
+  status = SndMapAppend(filename, prm, fit);
   if (status == -1) {
-    ErrLog(errlog.sock,progname,"Error writing sounding record.");
+    sprintf(logtxt,"Unable to write sounding record to:%s",filename);
+    ErrLog(errlog.sock,progname,logtxt);
   } else {
     ErrLog(errlog.sock,progname,"Sounding record successfully written.");
   }
-
-  fclose(out);
 }
@@ -0,0 +1,44 @@
+/* msgarena.h
+   ==========
+*/
+
+
+#ifndef _MSGARENA_H
+#define _MSGARENA_H
+
+#define MSGARENA_SPILL 16
+
+struct MsgArenaStats {
+  int nalloc;      /* heap allocations since the last call */
+  size_t peak;     /* largest number of bytes used by one message */
+  size_t sze;      /* current capacity */
+};
+
+struct MsgArena {
+  unsigned char *buf;
+  size_t sze;
+  size_t len;
+  size_t want;
+  int nspill;
+  void *spill[MSGARENA_SPILL];
+  struct MsgArenaStats stats;
+};
+
+size_t MsgArenaSize(int nrang,int mplgs,int nave);
+
+struct MsgArena *MsgArenaMake(size_t sze);
+void MsgArenaFree(struct MsgArena *ptr);
+void MsgArenaReset(struct MsgArena *ptr);
+void MsgArenaStatsGet(struct MsgArena *ptr,struct MsgArenaStats *stats);
+
+void *MsgArenaPrmFlatten(struct MsgArena *ptr,struct RadarParm *prm,
+                         size_t *size);
+void *MsgArenaIQFlatten(struct MsgArena *ptr,struct IQData *iq,int nave,
+                        size_t *size);
+void *MsgArenaRawFlatten(struct MsgArena *ptr,struct RawData *raw,
+                         int nrang,int mplgs,size_t *size);
+void *MsgArenaFitFlatten(struct MsgArena *ptr,struct FitData *fit,
+                         int nrang,size_t *size);
+void MsgArenaFreeBlock(struct MsgArena *ptr,struct RMsgBlock *blk);
+
+#endif
@@ -0,0 +1,184 @@
+/* scantime.c
+   ==========
+
+   Timing probes for the calls made in the beam loop. Each probe is a
+   phase, the beam and the start and length of the call, kept in a
+   ring that can be written from more than one thread without a lock.
+   At the end of the scan the ring is drained, the median and 99th
+   percentile of each phase are worked out and the probes can be
+   appended to a binary timing file.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rtypes.h"
+#include "scantime.h"
+
+
+char *scantime_phase[ST_NPHASE]={"intt","fclr","integrate","build",
+                                 "fit","send","shell"};
+
+
+struct ScanTime *ScanTimeMake(void) {
+  struct ScanTime *ptr;
+
+  ptr=malloc(sizeof(struct ScanTime));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct ScanTime));
+  ScanTimeStart(ptr);
+  return ptr;
+}
+
+
+void ScanTimeFree(struct ScanTime *ptr) {
+  if (ptr==NULL) return;
+  free(ptr);
+}
+
+
+double ScanTimeNow(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+void ScanTimeStart(struct ScanTime *ptr) {
+  struct timespec tp;
+
+  if (ptr==NULL) return;
+  clock_gettime(CLOCK_REALTIME,&tp);
+  ptr->epoch=tp.tv_sec+tp.tv_nsec*1e-9;
+  ptr->start=ScanTimeNow();
+}
+
+
+/* records a call that started at tval (from ScanTimeNow) and has just
+   returned */
+
+void ScanTimeAdd(struct ScanTime *ptr,int phase,int bmnum,double tval) {
+  struct ScanTimeSlot *slot;
+  unsigned int idx;
+  double now;
+
+  if (ptr==NULL) return;
+  now=ScanTimeNow();
+
+  idx=__sync_fetch_and_add(&ptr->head,1);
+  slot=&ptr->slot[idx % SCANTIME_SIZE];
+  slot->probe.phase=phase;
+  slot->probe.bmnum=bmnum;
+  slot->probe.start=tval-ptr->start;
+  slot->probe.dur=now-tval;
+  __sync_synchronize();
+  slot->seq=idx+1;
+}
+
+
+static int ScanTimeSort(const void *a,const void *b) {
+  double x=*(double *) a,y=*(double *) b;
+  if (x<y) return -1;
+  if (x>y) return 1;
+  return 0;
+}
+
+
+/* drains the probes recorded since the last call; a probe still being
+   written is left for the next scan and any that were overwritten
+   before they could be read are counted as lost */
+
+int ScanTimeEnd(struct ScanTime *ptr,struct ScanTimeStats *stats) {
+  struct ScanTimeSlot *slot;
+  struct ScanTimeProbe probe;
+  double dur[SCANTIME_SIZE];
+  unsigned int s,head;
+  int p,n,c;
+
+  if (ptr==NULL) return -1;
+
+  ptr->num=0;
+  head=ptr->head;
+  while (ptr->tail !=head) {
+    slot=&ptr->slot[ptr->tail % SCANTIME_SIZE];
+    s=slot->seq;
+    __sync_synchronize();
+    memcpy(&probe,&slot->probe,sizeof(struct ScanTimeProbe));
+    __sync_synchronize();
+    if ((s !=ptr->tail+1) || (slot->seq !=s)) {
+      if ((int) (slot->seq-(ptr->tail+1))<=0) break;
+      ptr->lost++;
+      ptr->tail++;
+      continue;
+    }
+    if (ptr->num<SCANTIME_SIZE) {
+      memcpy(&ptr->scan[ptr->num],&probe,sizeof(struct ScanTimeProbe));
+      ptr->num++;
+    }
+    ptr->tail++;
+  }
+
+  if (stats==NULL) return ptr->num;
+
+  memset(stats,0,sizeof(struct ScanTimeStats));
+  for (p=0;p<ST_NPHASE;p++) {
+    c=0;
+    for (n=0;n<ptr->num;n++) {
+      if (ptr->scan[n].phase !=p) continue;
+      dur[c]=ptr->scan[n].dur;
+      stats->sum[p]+=dur[c];
+      c++;
+    }
+    stats->num[p]=c;
+    if (c==0) continue;
+    qsort(dur,c,sizeof(double),ScanTimeSort);
+    stats->p50[p]=dur[c/2];
+    stats->p99[p]=dur[(c*99)/100];
+  }
+  return ptr->num;
+}
+
+
+/* appends the probes drained by ScanTimeEnd to the day's timing file,
+   [path]/yyyymmdd.[rad].tim */
+
+int ScanTimeWrite(struct ScanTime *ptr,char *path,char *ststr,int stid,
+                  int scan) {
+  struct ScanTimeHeader hdr;
+  char fname[1024];
+  struct tm *tm;
+  time_t clock;
+  FILE *fp;
+  int s=0;
+
+  if (ptr==NULL) return -1;
+
+  clock=(time_t) ptr->epoch;
+  tm=gmtime(&clock);
+  if (tm==NULL) return -1;
+  sprintf(fname,"%s/%04d%02d%02d.%s.tim",path,tm->tm_year+1900,
+          tm->tm_mon+1,tm->tm_mday,ststr);
+
+  fp=fopen(fname,"a");
+  if (fp==NULL) return -1;
+
+  memset(&hdr,0,sizeof(struct ScanTimeHeader));
+  hdr.magic=SCANTIME_MAGIC;
+  hdr.major=SCANTIME_MAJOR;
+  hdr.minor=SCANTIME_MINOR;
+  hdr.stid=stid;
+  hdr.scan=scan;
+  hdr.num=ptr->num;
+  hdr.time=ptr->epoch;
+  hdr.len=ScanTimeNow()-ptr->start;
+
+  if (fwrite(&hdr,sizeof(struct ScanTimeHeader),1,fp) !=1) s=-1;
+  if ((s==0) && (ptr->num>0) &&
+      (fwrite(ptr->scan,sizeof(struct ScanTimeProbe),ptr->num,fp) !=
+       (size_t) ptr->num)) s=-1;
+  fclose(fp);
+  return s;
+}
@@ -0,0 +1,309 @@
+/* shmring.c
+   =========
+
+   Single writer, multiple reader ring buffer in POSIX shared memory.
+   The writer copies a record in once; each attached reader maps the
+   same object, reads the record in place and releases it by writing
+   the offset just past it into its acknowledgement slot.
+
+   A reader that holds back the writer without acknowledging anything
+   for SHMRING_TIMEOUT seconds is taken to have stalled or died; it is
+   detached and flagged as lost so that the writer can reuse its space.
+
+   Only the writer side is used in this tree; none of the data tasks
+   reads the ring yet, and shmbench.c is the only reader.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmring.h"
+
+
+#define SHMRING_ALIGN(x) (((x)+7) & ~((uint64_t) 7))
+
+
+static double ShmRingTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+static struct ShmRing *ShmRingMap(char *name,int fd,size_t len,int owner) {
+  struct ShmRing *ptr;
+  void *addr;
+
+  addr=mmap(NULL,len,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+  if (addr==MAP_FAILED) return NULL;
+
+  ptr=malloc(sizeof(struct ShmRing));
+  if (ptr==NULL) {
+    munmap(addr,len);
+    return NULL;
+  }
+  memset(ptr,0,sizeof(struct ShmRing));
+  strncpy(ptr->name,name,sizeof(ptr->name)-1);
+  ptr->fd=fd;
+  ptr->owner=owner;
+  ptr->len=len;
+  ptr->hdr=(struct ShmRingHeader *) addr;
+  ptr->data=(unsigned char *) addr+SHMRING_ALIGN(sizeof(struct ShmRingHeader));
+  return ptr;
+}
+
+
+/* creates the object; size is the data area in bytes */
+
+struct ShmRing *ShmRingMake(char *name,size_t size) {
+  struct ShmRing *ptr;
+  size_t len;
+  int fd;
+
+  size=SHMRING_ALIGN(size);
+  len=SHMRING_ALIGN(sizeof(struct ShmRingHeader))+size;
+
+  shm_unlink(name);
+  fd=shm_open(name,O_RDWR | O_CREAT,0666);
+  if (fd==-1) return NULL;
+  if (ftruncate(fd,len) !=0) {
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  ptr=ShmRingMap(name,fd,len,1);
+  if (ptr==NULL) {
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+
+  memset(ptr->hdr,0,sizeof(struct ShmRingHeader));
+  ptr->hdr->size=size;
+  ptr->hdr->version=SHMRING_VERSION;
+  __sync_synchronize();
+  ptr->hdr->magic=SHMRING_MAGIC;
+  return ptr;
+}
+
+
+/* maps an existing object from the reader side */
+
+struct ShmRing *ShmRingOpen(char *name) {
+  struct ShmRing *ptr;
+  struct stat st;
+  int fd;
+
+  fd=shm_open(name,O_RDWR,0);
+  if (fd==-1) return NULL;
+  if ((fstat(fd,&st) !=0) ||
+      (st.st_size<(off_t) sizeof(struct ShmRingHeader))) {
+    close(fd);
+    return NULL;
+  }
+
+  ptr=ShmRingMap(name,fd,st.st_size,0);
+  if (ptr==NULL) {
+    close(fd);
+    return NULL;
+  }
+
+  if ((ptr->hdr->magic !=SHMRING_MAGIC) ||
+      (ptr->hdr->version !=SHMRING_VERSION)) {
+    ShmRingFree(ptr);
+    return NULL;
+  }
+  return ptr;
+}
+
+
+void ShmRingFree(struct ShmRing *ptr) {
+  if (ptr==NULL) return;
+  munmap(ptr->hdr,ptr->len);
+  close(ptr->fd);
+  if (ptr->owner) shm_unlink(ptr->name);
+  free(ptr);
+}
+
+
+/* readers that are attached hold back the writer until they
+   acknowledge or time out; a reader starts from the current head */
+
+int ShmRingAttach(struct ShmRing *ptr,int reader) {
+  if ((reader<0) || (reader>=SHMRING_MAX_READER)) return -1;
+  ptr->hdr->ack[reader]=ptr->hdr->head;
+  __sync_fetch_and_and(&ptr->hdr->lost,~(1U<<reader));
+  __sync_synchronize();
+  __sync_fetch_and_or(&ptr->hdr->active,1U<<reader);
+  return 0;
+}
+
+
+int ShmRingDetach(struct ShmRing *ptr,int reader) {
+  if ((reader<0) || (reader>=SHMRING_MAX_READER)) return -1;
+  __sync_fetch_and_and(&ptr->hdr->active,~(1U<<reader));
+  return 0;
+}
+
+
+/* offset of the oldest byte still held by an attached reader */
+
+static uint64_t ShmRingTail(struct ShmRing *ptr) {
+  uint64_t tail;
+  uint32_t active;
+  int n;
+
+  tail=ptr->hdr->head;
+  active=ptr->hdr->active;
+  for (n=0;n<SHMRING_MAX_READER;n++) {
+    if ((active & (1U<<n))==0) continue;
+    if (ptr->hdr->ack[n]<tail) tail=ptr->hdr->ack[n];
+  }
+  return tail;
+}
+
+
+/* detaches the readers that are holding back the tail short of want
+   and have not moved for SHMRING_TIMEOUT seconds, and returns the
+   new tail; a reader is timed from the first write it blocks */
+
+static uint64_t ShmRingDrop(struct ShmRing *ptr,uint64_t want) {
+  uint64_t ack;
+  uint32_t active;
+  double tval;
+  int n;
+
+  tval=ShmRingTime();
+  active=ptr->hdr->active;
+  for (n=0;n<SHMRING_MAX_READER;n++) {
+    if ((active & (1U<<n))==0) continue;
+    ack=ptr->hdr->ack[n];
+    if (ack>=want) {
+      ptr->since[n]=0;
+      continue;
+    }
+    if ((ptr->since[n]==0) || (ack !=ptr->hold[n])) {
+      ptr->hold[n]=ack;
+      ptr->since[n]=tval;
+      continue;
+    }
+    if (tval-ptr->since[n]<SHMRING_TIMEOUT) continue;
+    __sync_fetch_and_or(&ptr->hdr->lost,1U<<n);
+    __sync_fetch_and_and(&ptr->hdr->active,~(1U<<n));
+    ptr->since[n]=0;
+  }
+  return ShmRingTail(ptr);
+}
+
+
+/* gathers nbuf buffers into a single record; returns zero on success
+   or -1 if the record does not fit in the space the slowest reader
+   has released, in which case nothing is written */
+
+int ShmRingWrite(struct ShmRing *ptr,int nbuf,void **buf,size_t *len,
+                 uint64_t *seq,uint64_t *off) {
+
+  struct ShmRingRecord *rec;
+  uint64_t head,tail,size,need,pad,pos;
+  unsigned char *dst;
+  int n;
+
+  size=ptr->hdr->size;
+  need=sizeof(struct ShmRingRecord);
+  for (n=0;n<nbuf;n++) need+=len[n];
+  need=SHMRING_ALIGN(need);
+
+  head=ptr->hdr->head;
+  tail=ShmRingTail(ptr);
+
+  /* records are never split across the end of the data area; a
+     remainder too short for a record header is skipped without one */
+
+  pad=0;
+  if ((head % size)+need>size) pad=size-(head % size);
+  if (need>size) return -1;
+  if ((head+pad+need)-tail>size) {
+    tail=ShmRingDrop(ptr,head+pad+need-size);
+    if ((head+pad+need)-tail>size) return -1;
+  }
+
+  if (pad>=sizeof(struct ShmRingRecord)) {
+    rec=(struct ShmRingRecord *) (ptr->data+(head % size));
+    rec->seq=0;
+    rec->size=pad;
+  }
+  head+=pad;
+
+  pos=head % size;
+  rec=(struct ShmRingRecord *) (ptr->data+pos);
+  dst=(unsigned char *) (rec+1);
+  for (n=0;n<nbuf;n++) {
+    memcpy(dst,buf[n],len[n]);
+    dst+=len[n];
+  }
+  rec->size=need-sizeof(struct ShmRingRecord);
+  rec->seq=ptr->hdr->seq+1;
+
+  __sync_synchronize();
+  ptr->hdr->seq=rec->seq;
+  ptr->hdr->head=head+need;
+
+  if (seq !=NULL) *seq=rec->seq;
+  if (off !=NULL) *off=head;
+  return 0;
+}
+
+
+/* returns the record at or after a running offset, skipping any
+   padding, and moves off to the start of that record; returns NULL
+   if nothing has been written there yet or it has been recycled */
+
+struct ShmRingRecord *ShmRingRead(struct ShmRing *ptr,uint64_t *off) {
+  struct ShmRingRecord *rec;
+  uint64_t head,size,pos;
+
+  head=ptr->hdr->head;
+  size=ptr->hdr->size;
+  __sync_synchronize();
+
+  while (1) {
+    if ((*off>=head) || (head-*off>size)) return NULL;
+    pos=*off % size;
+    if (size-pos<sizeof(struct ShmRingRecord)) {
+      *off+=size-pos;
+      continue;
+    }
+    rec=(struct ShmRingRecord *) (ptr->data+pos);
+    if (rec->seq !=0) break;
+    *off+=rec->size;
+  }
+  return rec;
+}
+
+
+int ShmRingAck(struct ShmRing *ptr,int reader,uint64_t off) {
+  if ((reader<0) || (reader>=SHMRING_MAX_READER)) return -1;
+  __sync_synchronize();
+  if (off>ptr->hdr->ack[reader]) ptr->hdr->ack[reader]=off;
+  return 0;
+}
+
+
+/* returns 1 if the writer has dropped the reader; anything it read
+   in place since its last acknowledgement may have been overwritten
+   and should be discarded, and it must attach again to carry on */
+
+int ShmRingLost(struct ShmRing *ptr,int reader) {
+  if ((reader<0) || (reader>=SHMRING_MAX_READER)) return -1;
+  __sync_synchronize();
+  return (ptr->hdr->lost & (1U<<reader)) !=0;
+}
@@ -0,0 +1,62 @@
+/* shmring.h
+   =========
+*/
+
+
+#ifndef _SHMRING_H
+#define _SHMRING_H
+
+#define SHMRING_MAGIC 0x52534d52
+#define SHMRING_VERSION 2
+#define SHMRING_MAX_READER 8
+#define SHMRING_TIMEOUT 10.0
+
+/* the header sits at the start of the shared memory object and is
+   followed by the data area; all offsets are running byte counts
+   that are reduced modulo size when the data area is addressed */
+
+struct ShmRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;
+  volatile uint64_t head;
+  volatile uint64_t seq;
+  volatile uint32_t active;
+  volatile uint32_t lost;   /* readers dropped by the writer */
+  volatile uint64_t ack[SHMRING_MAX_READER];
+};
+
+/* every record starts on an eight byte boundary; a record with a
+   sequence number of zero is padding to the end of the data area,
+   and so is a remainder too short to hold a record header */
+
+struct ShmRingRecord {
+  uint64_t seq;
+  uint64_t size;
+};
+
+struct ShmRing {
+  char name[64];
+  int fd;
+  int owner;
+  size_t len;
+  struct ShmRingHeader *hdr;
+  unsigned char *data;
+  uint64_t hold[SHMRING_MAX_READER];  /* writer side only */
+  double since[SHMRING_MAX_READER];
+};
+
+struct ShmRing *ShmRingMake(char *name,size_t size);
+struct ShmRing *ShmRingOpen(char *name);
+void ShmRingFree(struct ShmRing *ptr);
+
+int ShmRingAttach(struct ShmRing *ptr,int reader);
+int ShmRingDetach(struct ShmRing *ptr,int reader);
+
+int ShmRingWrite(struct ShmRing *ptr,int nbuf,void **buf,size_t *len,
+                 uint64_t *seq,uint64_t *off);
+struct ShmRingRecord *ShmRingRead(struct ShmRing *ptr,uint64_t *off);
+int ShmRingAck(struct ShmRing *ptr,int reader,uint64_t off);
+int ShmRingLost(struct ShmRing *ptr,int reader);
+
+#endif
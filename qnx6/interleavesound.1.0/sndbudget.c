@@ -0,0 +1,123 @@
+/* sndbudget.c
+   ===========
+
+   Time budget for the sounding loop. Another sounding is only started
+   if the time left in the minute, less the sounding integration, is
+   more than the time needed for the rest of the sounding: the clear
+   frequency search, the overhead of the integration, the fit and
+   writing the record. Rather than a fixed allowance, the overhead of
+   each sounding is measured and smoothed with exponential weights,
+   and the time needed is the smoothed mean plus enough standard
+   deviations to cover the chosen quantile of a normal distribution.
+
+   The end of the minute is fixed on the clock when the loop starts,
+   so a sounding that runs past it is counted as an overrun rather
+   than being seen as the start of a new minute.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "sndbudget.h"
+
+
+static double SndBudgetTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+/* standard normal deviate for the quantile q; Abramowitz and Stegun
+   26.2.23, good to 4.5e-4 */
+
+static double SndBudgetDeviate(double q) {
+  double p,t,z;
+
+  p=(q>0.5) ? 1-q : q;
+  t=sqrt(-2*log(p));
+  z=t-(2.515517+0.802853*t+0.010328*t*t)/
+      (1+1.432788*t+0.189269*t*t+0.001308*t*t*t);
+  return (q>0.5) ? z : -z;
+}
+
+
+/* quant is the quantile of the overhead to allow for, between 0.5
+   and 0.9999 */
+
+struct SndBudget *SndBudgetMake(double init,double quant) {
+  struct SndBudget *ptr;
+
+  if ((quant<0.5) || (quant>0.9999)) return NULL;
+  ptr=malloc(sizeof(struct SndBudget));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct SndBudget));
+  ptr->init=init;
+  ptr->z=SndBudgetDeviate(quant);
+  return ptr;
+}
+
+
+void SndBudgetFree(struct SndBudget *ptr) {
+  if (ptr==NULL) return;
+  free(ptr);
+}
+
+
+double SndBudgetNeed(struct SndBudget *ptr) {
+  if (ptr->samp<SNDBUDGET_MINSAMP) return ptr->init;
+  return ptr->mean+ptr->z*sqrt(ptr->var);
+}
+
+
+/* left is the time to the end of the minute [s] */
+
+void SndBudgetStart(struct SndBudget *ptr,double left) {
+  ptr->end=SndBudgetTime()+left;
+  ptr->num=0;
+}
+
+
+void SndBudgetBegin(struct SndBudget *ptr) {
+  ptr->tval=SndBudgetTime();
+}
+
+
+/* intt is the sounding integration time [s] */
+
+void SndBudgetEnd(struct SndBudget *ptr,double intt) {
+  double over,dif;
+
+  over=SndBudgetTime()-ptr->tval-intt;
+  if (ptr->samp==0) {
+    ptr->mean=over;
+    ptr->var=0;
+  } else {
+    dif=over-ptr->mean;
+    ptr->mean+=SNDBUDGET_GAIN*dif;
+    ptr->var=(1-SNDBUDGET_GAIN)*(ptr->var+SNDBUDGET_GAIN*dif*dif);
+  }
+  ptr->samp++;
+  ptr->num++;
+}
+
+
+void SndBudgetDone(struct SndBudget *ptr,struct SndBudgetStats *stats) {
+  double slack;
+
+  slack=ptr->end-SndBudgetTime();
+  ptr->minutes++;
+  if (slack<0) ptr->overrun++;
+  if (stats==NULL) return;
+  stats->num=ptr->num;
+  stats->need=SndBudgetNeed(ptr);
+  stats->mean=ptr->mean;
+  stats->sdev=sqrt(ptr->var);
+  stats->slack=slack;
+  stats->overrun=ptr->overrun;
+  stats->minutes=ptr->minutes;
+}
@@ -0,0 +1,43 @@
+/* sndbudget.h
+   ===========
+*/
+
+
+#ifndef _SNDBUDGET_H
+#define _SNDBUDGET_H
+
+#define SNDBUDGET_MINSAMP 4     /* soundings timed before the estimate is used */
+#define SNDBUDGET_GAIN 0.125    /* weight given to each new sounding */
+
+struct SndBudgetStats {
+  int num;           /* soundings timed this minute */
+  double need;       /* time allowed for the overhead of a sounding [s] */
+  double mean;       /* smoothed overhead of a sounding [s] */
+  double sdev;       /* smoothed standard deviation of the overhead [s] */
+  double slack;      /* time left to the boundary, negative if overrun [s] */
+  int overrun;       /* minutes overrun since the program started */
+  int minutes;
+};
+
+struct SndBudget {
+  double init;       /* overhead allowed until enough soundings are timed */
+  double z;          /* standard deviations to add for the quantile */
+  double mean;
+  double var;
+  int samp;
+  double tval;
+  double end;
+  int num;
+  int overrun;
+  int minutes;
+};
+
+struct SndBudget *SndBudgetMake(double init,double quant);
+void SndBudgetFree(struct SndBudget *ptr);
+double SndBudgetNeed(struct SndBudget *ptr);
+void SndBudgetStart(struct SndBudget *ptr,double left);
+void SndBudgetBegin(struct SndBudget *ptr);
+void SndBudgetEnd(struct SndBudget *ptr,double intt);
+void SndBudgetDone(struct SndBudget *ptr,struct SndBudgetStats *stats);
+
+#endif
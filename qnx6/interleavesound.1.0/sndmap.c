@@ -0,0 +1,377 @@
+/* sndmap.c
+   ========
+
+   Writes the sounding records to a file that is held open and mapped
+   into memory. The mapping is reserved SNDMAP_CHUNK bytes at a time
+   and each record is copied into it, so a record costs a memcpy and
+   an ftruncate rather than an open, a write and a close. The file
+   itself is only ever extended to the end of the last record, so
+   while it is being written it is still exactly the sequence of
+   DataMap records that the existing readers expect.
+
+   Alongside each file "name.snd" an index "name.snd.idx" is kept,
+   with one entry giving the time, beam, frequency, offset and size of
+   every record. The index is kept in a separate file rather than at
+   the end of the sounding file for the same reason. SndMapAppend
+   writes a record and its entry without the mapping, for when the
+   file cannot be mapped.
+
+   If the program stops part way through a record the end of the last
+   whole record is found on the next open by walking the record
+   headers, the file is cut back to it, and any index entries for
+   records that did not make it are dropped.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "rtypes.h"
+#include "rtime.h"
+#include "dmap.h"
+#include "limit.h"
+#include "rprm.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "sndwrite.h"
+#include "sndmap.h"
+
+
+#define DATAMAP_CODE 0x00010001
+
+
+static size_t SndMapRound(size_t sze) {
+  return ((sze/SNDMAP_CHUNK)+1)*SNDMAP_CHUNK;
+}
+
+
+/* walks the DataMap headers to find where the last whole record ends */
+
+static size_t SndMapEnd(unsigned char *buf,size_t len) {
+  size_t off=0;
+  int32_t code,size;
+
+  while (off+2*sizeof(int32_t)<=len) {
+    memcpy(&code,buf+off,sizeof(int32_t));
+    memcpy(&size,buf+off+sizeof(int32_t),sizeof(int32_t));
+    if (code !=DATAMAP_CODE) break;
+    if (size<=(int32_t) (2*sizeof(int32_t))) break;
+    if (off+size>len) break;
+    off+=size;
+  }
+  return off;
+}
+
+
+/* the mapping may run past the end of the file; only the pages up to
+   the end of the file are ever touched */
+
+static int SndMapMap(struct SndMap *ptr,size_t len) {
+  if (ptr->buf !=NULL) munmap(ptr->buf,ptr->len);
+  ptr->buf=NULL;
+  ptr->buf=mmap(NULL,len,PROT_READ | PROT_WRITE,MAP_SHARED,ptr->fd,0);
+  if (ptr->buf==MAP_FAILED) {
+    ptr->buf=NULL;
+    return -1;
+  }
+  ptr->len=len;
+  return 0;
+}
+
+
+/* opens the index of the sounding file fname, writing the header if
+   it is new; returns the descriptor and sets end to the file length */
+
+static int SndMapIndexOpen(char *fname,off_t *end) {
+  char iname[264];
+  struct SndMapHeader hdr;
+  struct stat buf;
+  int ifd;
+
+  if (strlen(fname)+5>sizeof(iname)) return -1;
+  sprintf(iname,"%s.idx",fname);
+  ifd=open(iname,O_RDWR | O_CREAT,0644);
+  if (ifd==-1) return -1;
+  if (fstat(ifd,&buf) !=0) {
+    close(ifd);
+    return -1;
+  }
+
+  if (buf.st_size<(off_t) sizeof(struct SndMapHeader)) {
+    hdr.magic=SNDMAP_MAGIC;
+    hdr.version=SNDMAP_VERSION;
+    if ((ftruncate(ifd,0) !=0) ||
+        (pwrite(ifd,&hdr,sizeof(hdr),0) !=sizeof(hdr))) {
+      close(ifd);
+      return -1;
+    }
+    buf.st_size=sizeof(hdr);
+  } else {
+    if ((pread(ifd,&hdr,sizeof(hdr),0) !=sizeof(hdr)) ||
+        (hdr.magic !=SNDMAP_MAGIC) || (hdr.version !=SNDMAP_VERSION)) {
+      close(ifd);
+      return -1;
+    }
+  }
+  *end=buf.st_size;
+  return ifd;
+}
+
+
+static void SndMapEntrySet(struct SndMapEntry *ent,struct RadarParm *prm,
+                           int64_t off,int64_t size) {
+  memset(ent,0,sizeof(struct SndMapEntry));
+  ent->time=TimeYMDHMSToEpoch(prm->time.yr,prm->time.mo,prm->time.dy,
+                              prm->time.hr,prm->time.mt,
+                              prm->time.sc+prm->time.us/1.0e6);
+  ent->bmnum=prm->bmnum;
+  ent->tfreq=prm->tfreq;
+  ent->off=off;
+  ent->size=size;
+}
+
+
+/* opens the index and drops any entries past the end of the records */
+
+static int SndMapIndex(struct SndMap *ptr) {
+  struct SndMapHeader hdr;
+  struct SndMapEntry ent;
+  off_t off,end;
+
+  ptr->ifd=SndMapIndexOpen(ptr->fname,&end);
+  if (ptr->ifd==-1) return -1;
+
+  ptr->nrec=(end-sizeof(hdr))/sizeof(struct SndMapEntry);
+  while (ptr->nrec>0) {
+    off=sizeof(hdr)+(ptr->nrec-1)*sizeof(struct SndMapEntry);
+    if (pread(ptr->ifd,&ent,sizeof(ent),off) !=sizeof(ent)) return -1;
+    if (ent.off+ent.size<=(int64_t) ptr->sze) break;
+    ptr->nrec--;
+  }
+  off=sizeof(hdr)+ptr->nrec*sizeof(struct SndMapEntry);
+  if (off !=end) {
+    if (ftruncate(ptr->ifd,off) !=0) return -1;
+  }
+  if (lseek(ptr->ifd,off,SEEK_SET) !=off) return -1;
+  return 0;
+}
+
+
+struct SndMap *SndMapMake(void) {
+  struct SndMap *ptr;
+
+  ptr=malloc(sizeof(struct SndMap));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct SndMap));
+  ptr->fd=-1;
+  ptr->ifd=-1;
+  return ptr;
+}
+
+
+void SndMapFree(struct SndMap *ptr) {
+  if (ptr==NULL) return;
+  SndMapClose(ptr);
+  free(ptr);
+}
+
+
+/* unmaps the file; it already ends at the last record */
+
+void SndMapClose(struct SndMap *ptr) {
+
+  if (ptr->buf !=NULL) {
+    if (ptr->sze>0) msync(ptr->buf,ptr->sze,MS_SYNC);
+    munmap(ptr->buf,ptr->len);
+  }
+  if (ptr->fd !=-1) close(ptr->fd);
+  if (ptr->ifd !=-1) close(ptr->ifd);
+  ptr->buf=NULL;
+  ptr->fd=-1;
+  ptr->ifd=-1;
+  ptr->len=0;
+  ptr->sze=0;
+  ptr->nrec=0;
+  ptr->fname[0]=0;
+}
+
+
+/* makes fname the current file; does nothing if it already is */
+
+int SndMapOpen(struct SndMap *ptr,char *fname) {
+  struct stat buf;
+  size_t len;
+
+  if ((ptr->fd !=-1) && (strcmp(ptr->fname,fname)==0)) return 0;
+  SndMapClose(ptr);
+
+  if (strlen(fname)>=sizeof(ptr->fname)) return -1;
+  ptr->fd=open(fname,O_RDWR | O_CREAT,0644);
+  if (ptr->fd==-1) return -1;
+  strcpy(ptr->fname,fname);
+
+  if (fstat(ptr->fd,&buf) !=0) {
+    SndMapClose(ptr);
+    return -1;
+  }
+
+  len=buf.st_size;
+  if (len>0) {
+    ptr->buf=mmap(NULL,len,PROT_READ | PROT_WRITE,MAP_SHARED,ptr->fd,0);
+    if (ptr->buf==MAP_FAILED) {
+      ptr->buf=NULL;
+      SndMapClose(ptr);
+      return -1;
+    }
+    ptr->len=len;
+    ptr->sze=SndMapEnd(ptr->buf,len);
+  }
+
+  /* drop a record that was cut short, or the zero tail left by an
+     earlier version of this program */
+  if ((ptr->sze !=len) && (ftruncate(ptr->fd,ptr->sze) !=0)) {
+    SndMapClose(ptr);
+    return -1;
+  }
+
+  if ((SndMapMap(ptr,SndMapRound(ptr->sze)) !=0) ||
+      (SndMapIndex(ptr) !=0)) {
+    SndMapClose(ptr);
+    return -1;
+  }
+  return 0;
+}
+
+
+int SndMapWrite(struct SndMap *ptr,struct RadarParm *prm,
+                struct FitData *fit) {
+  unsigned char *rec;
+  int size;
+  struct SndMapEntry ent;
+
+  if (ptr->buf==NULL) return -1;
+
+  rec=SndEncode(prm,fit,&size);
+  if (rec==NULL) return -1;
+
+  if ((ptr->sze+size>ptr->len) &&
+      (SndMapMap(ptr,SndMapRound(ptr->sze+size)) !=0)) {
+    free(rec);
+    return -1;
+  }
+  if (ftruncate(ptr->fd,ptr->sze+size) !=0) {
+    free(rec);
+    return -1;
+  }
+
+  memcpy(ptr->buf+ptr->sze,rec,size);
+  free(rec);
+
+  SndMapEntrySet(&ent,prm,ptr->sze,size);
+  ptr->sze+=size;
+
+  /* the record is in place before the entry that points at it */
+  if (write(ptr->ifd,&ent,sizeof(ent)) !=sizeof(ent)) return -1;
+  ptr->nrec++;
+  return size;
+}
+
+
+/* appends a record to the sounding file fname, and its entry to the
+   index, without mapping the file; the file must not be open in a
+   SndMap. Returns the size of the record, or -1 if either the record
+   or its entry could not be written */
+
+int SndMapAppend(char *fname,struct RadarParm *prm,struct FitData *fit) {
+  unsigned char *rec;
+  struct SndMapEntry ent;
+  struct stat buf;
+  int fd,ifd,size;
+  off_t end;
+
+  rec=SndEncode(prm,fit,&size);
+  if (rec==NULL) return -1;
+
+  fd=open(fname,O_WRONLY | O_CREAT,0644);
+  if (fd==-1) {
+    free(rec);
+    return -1;
+  }
+  if ((fstat(fd,&buf) !=0) ||
+      (pwrite(fd,rec,size,buf.st_size) !=size)) {
+    close(fd);
+    free(rec);
+    return -1;
+  }
+  close(fd);
+  free(rec);
+
+  ifd=SndMapIndexOpen(fname,&end);
+  if (ifd==-1) return -1;
+  SndMapEntrySet(&ent,prm,buf.st_size,size);
+  /* a short write is dropped by SndMapIndex on the next open */
+  if (pwrite(ifd,&ent,sizeof(ent),end) !=sizeof(ent)) size=-1;
+  close(ifd);
+  return size;
+}
+
+
+/* finds the record for a beam and frequency at or just after time in
+   the sounding file fname; returns its offset or -1. The entries are
+   in time order so the first candidate is found by bisection. */
+
+int64_t SndMapLookup(char *fname,double time,int bmnum,int tfreq,
+                     int64_t *size) {
+  char iname[264];
+  struct SndMapHeader hdr;
+  struct SndMapEntry *ent=NULL;
+  struct stat buf;
+  int fd,n,lo,hi,mid;
+  int64_t off=-1;
+
+  if (strlen(fname)+5>sizeof(iname)) return -1;
+  sprintf(iname,"%s.idx",fname);
+  fd=open(iname,O_RDONLY);
+  if (fd==-1) return -1;
+
+  if ((fstat(fd,&buf) !=0) ||
+      (read(fd,&hdr,sizeof(hdr)) !=sizeof(hdr)) ||
+      (hdr.magic !=SNDMAP_MAGIC) || (hdr.version !=SNDMAP_VERSION)) {
+    close(fd);
+    return -1;
+  }
+
+  n=(buf.st_size-sizeof(hdr))/sizeof(struct SndMapEntry);
+  if (n>0) ent=malloc(n*sizeof(struct SndMapEntry));
+  if ((ent==NULL) ||
+      (read(fd,ent,n*sizeof(struct SndMapEntry)) !=
+       (ssize_t) (n*sizeof(struct SndMapEntry)))) {
+    if (ent !=NULL) free(ent);
+    close(fd);
+    return -1;
+  }
+  close(fd);
+
+  lo=0;
+  hi=n;
+  while (lo<hi) {
+    mid=(lo+hi)/2;
+    if (ent[mid].time<time) lo=mid+1;
+    else hi=mid;
+  }
+
+  for (;(lo<n) && (ent[lo].time<time+SNDMAP_TOL);lo++) {
+    if ((ent[lo].bmnum !=bmnum) || (ent[lo].tfreq !=tfreq)) continue;
+    off=ent[lo].off;
+    if (size !=NULL) *size=ent[lo].size;
+    break;
+  }
+  free(ent);
+  return off;
+}
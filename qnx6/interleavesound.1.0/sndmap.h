@@ -0,0 +1,50 @@
+/* sndmap.h
+   ========
+*/
+
+
+#ifndef _SNDMAP_H
+#define _SNDMAP_H
+
+#define SNDMAP_CHUNK 1048576
+#define SNDMAP_MAGIC 0x534e4458
+#define SNDMAP_VERSION 1
+#define SNDMAP_TOL 1.0
+
+/* the index file is this header followed by one entry per record in
+   the order the records were written */
+
+struct SndMapHeader {
+  int32_t magic;
+  int32_t version;
+};
+
+struct SndMapEntry {
+  double time;
+  int32_t bmnum;
+  int32_t tfreq;
+  int64_t off;
+  int64_t size;
+};
+
+struct SndMap {
+  char fname[256];
+  int fd;
+  int ifd;
+  unsigned char *buf;
+  size_t len;      /* bytes mapped */
+  size_t sze;      /* bytes of records written */
+  int nrec;
+};
+
+struct SndMap *SndMapMake(void);
+void SndMapFree(struct SndMap *ptr);
+int SndMapOpen(struct SndMap *ptr,char *fname);
+void SndMapClose(struct SndMap *ptr);
+int SndMapWrite(struct SndMap *ptr,struct RadarParm *prm,
+                struct FitData *fit);
+int SndMapAppend(char *fname,struct RadarParm *prm,struct FitData *fit);
+int64_t SndMapLookup(char *fname,double time,int bmnum,int tfreq,
+                     int64_t *size);
+
+#endif
@@ -9,5 +9,6 @@
 
 int SndFwrite(FILE *fp,struct RadarParm *,struct FitData *);
 int SndWrite(int fid,struct RadarParm *,struct FitData *);
+unsigned char *SndEncode(struct RadarParm *,struct FitData *,int *size);
 
 #endif
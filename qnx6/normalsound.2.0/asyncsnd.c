@@ -0,0 +1,363 @@
+/* asyncsnd.c
+   ==========
+
+   Sends message blocks to the data tasks without the beam loop ever
+   waiting on them. Each task has a bounded queue emptied by a sender
+   thread of its own, so a slow disk behind rawacfwrite or a stalled
+   rtserver client only backs up that task's queue.
+
+   A block is copied once and the copy is shared by every queue it is
+   put on. When a queue is full its policy decides what happens:
+   ASYNCSND_OLDEST drops the oldest message and ASYNCSND_NEWEST the
+   one being queued, while ASYNCSND_NEVER lets the queue grow to
+   ASYNCSND_MAXDEPTH and then makes the caller wait until its sender
+   has taken a message off, so nothing is lost and the memory held by
+   the queue is bounded.
+
+   The files are reopened in order with the data: AsyncSndReopen marks
+   each queue so that its sender closes and reopens the task before it
+   sends the next message.
+
+   An IQS_TYPE message only names the shared memory that holds the
+   samples, and the next integration writes over that memory long
+   before a queued message might be sent. The samples are therefore
+   copied into a shared memory segment of the message's own, named
+   after the original with a sequence number added, and the IQS_TYPE
+   message in the copy names that instead; iqwrite reads it as it
+   would the original. The segment is removed once every queue has
+   sent the message. If it cannot be made the record goes without its
+   samples and is counted.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rtypes.h"
+#include "tcpipmsg.h"
+#include "rmsg.h"
+#include "rmsgsnd.h"
+#include "asyncsnd.h"
+
+
+static double AsyncSndTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+/* called with the lock held */
+
+static void AsyncSndRelease(struct AsyncSndMsg *msg) {
+  msg->ref--;
+  if (msg->ref>0) return;
+  if (msg->shm[0] !=0) shm_unlink(msg->shm);
+  free(msg->buf);
+  free(msg);
+}
+
+
+/* copies the shared memory segment src into a new one called dst */
+
+static int AsyncSndShm(char *src,char *dst) {
+  struct stat buf;
+  void *in=MAP_FAILED,*out=MAP_FAILED;
+  int ifd,ofd=-1,s=-1;
+
+  ifd=shm_open(src,O_RDONLY,0);
+  if (ifd==-1) return -1;
+  if ((fstat(ifd,&buf) !=0) || (buf.st_size<=0)) {
+    close(ifd);
+    return -1;
+  }
+
+  shm_unlink(dst);
+  ofd=shm_open(dst,O_RDWR | O_CREAT | O_EXCL,0666);
+  if ((ofd !=-1) && (ftruncate(ofd,buf.st_size)==0)) {
+    in=mmap(NULL,buf.st_size,PROT_READ,MAP_SHARED,ifd,0);
+    out=mmap(NULL,buf.st_size,PROT_READ | PROT_WRITE,MAP_SHARED,ofd,0);
+    if ((in !=MAP_FAILED) && (out !=MAP_FAILED)) {
+      memcpy(out,in,buf.st_size);
+      s=0;
+    }
+  }
+  if (in !=MAP_FAILED) munmap(in,buf.st_size);
+  if (out !=MAP_FAILED) munmap(out,buf.st_size);
+  if (ofd !=-1) close(ofd);
+  close(ifd);
+  if ((s !=0) && (ofd !=-1)) shm_unlink(dst);
+  return s;
+}
+
+
+static struct AsyncSndMsg *AsyncSndCopy(struct RMsgBlock *blk,int seq) {
+  struct AsyncSndMsg *msg;
+  size_t off=0;
+  int n;
+
+  msg=malloc(sizeof(struct AsyncSndMsg));
+  if (msg==NULL) return NULL;
+  msg->blk.num=0;
+  msg->blk.tsize=0;
+  msg->ref=0;
+  msg->shm[0]=0;
+
+  for (n=0;n<blk->num;n++) off+=blk->data[n].size;
+  off+=sizeof(msg->shm);
+  msg->buf=malloc(off);
+  if (msg->buf==NULL) {
+    free(msg);
+    return NULL;
+  }
+
+  off=0;
+  for (n=0;n<blk->num;n++) {
+    if (blk->data[n].type==IQS_TYPE) {
+      if ((msg->shm[0] !=0) ||
+          (strlen((char *) blk->ptr[n])+12>sizeof(msg->shm))) continue;
+      sprintf(msg->shm,"%s.q%d",(char *) blk->ptr[n],seq);
+      if (AsyncSndShm((char *) blk->ptr[n],msg->shm) !=0) {
+        msg->shm[0]=0;
+        continue;
+      }
+      strcpy((char *) msg->buf+off,msg->shm);
+      RMsgSndAdd(&msg->blk,strlen(msg->shm)+1,msg->buf+off,
+                 IQS_TYPE,blk->data[n].tag);
+      off+=strlen(msg->shm)+1;
+      continue;
+    }
+    memcpy(msg->buf+off,blk->ptr[n],blk->data[n].size);
+    RMsgSndAdd(&msg->blk,blk->data[n].size,msg->buf+off,
+               blk->data[n].type,blk->data[n].tag);
+    off+=blk->data[n].size;
+  }
+  return msg;
+}
+
+
+static int AsyncSndHasIQ(struct RMsgBlock *blk) {
+  int n;
+
+  for (n=0;n<blk->num;n++) if (blk->data[n].type==IQS_TYPE) return 1;
+  return 0;
+}
+
+
+static void *AsyncSndWorker(void *arg) {
+  struct AsyncSndQueue *q=(struct AsyncSndQueue *) arg;
+  struct AsyncSnd *ptr=q->snd;
+  struct AsyncSndEnt ent;
+  double tval;
+
+  pthread_mutex_lock(&ptr->mtx);
+  while (1) {
+    while ((q->num==0) && (ptr->quit==0))
+      pthread_cond_wait(&q->cnd,&ptr->mtx);
+    if (q->num==0) break;
+
+    ent=q->ent[q->head];
+    q->head=(q->head+1) % ASYNCSND_MAXDEPTH;
+    q->num--;
+    pthread_cond_signal(&q->spc);
+    pthread_mutex_unlock(&ptr->mtx);
+
+    tval=AsyncSndTime();
+    if (ent.reopen) {
+      RMsgSndClose(q->sock);
+      RMsgSndOpen(q->sock,strlen((char *) ptr->command),ptr->command);
+    }
+    RMsgSndSend(q->sock,&ent.msg->blk);
+    tval=AsyncSndTime()-tval;
+
+    pthread_mutex_lock(&ptr->mtx);
+    q->stats.sent++;
+    q->stats.tsend+=tval;
+    AsyncSndRelease(ent.msg);
+  }
+
+  /* a reopen with nothing left to send still has to happen */
+  if (q->reopen) {
+    pthread_mutex_unlock(&ptr->mtx);
+    RMsgSndClose(q->sock);
+    RMsgSndOpen(q->sock,strlen((char *) ptr->command),ptr->command);
+    pthread_mutex_lock(&ptr->mtx);
+  }
+  pthread_mutex_unlock(&ptr->mtx);
+  return NULL;
+}
+
+
+/* policy gives the drop policy of each task; NULL means ASYNCSND_NEVER
+   for all of them */
+
+struct AsyncSnd *AsyncSndMake(int tnum,struct TCPIPMsgHost *task,
+                              int *policy,unsigned char *command) {
+  struct AsyncSnd *ptr;
+  struct AsyncSndQueue *q;
+  int n;
+
+  if (tnum>ASYNCSND_MAXTASK) return NULL;
+
+  ptr=malloc(sizeof(struct AsyncSnd));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct AsyncSnd));
+  ptr->tnum=tnum;
+  ptr->command=command;
+  pthread_mutex_init(&ptr->mtx,NULL);
+
+  for (n=0;n<tnum;n++) {
+    q=&ptr->queue[n];
+    q->snd=ptr;
+    q->sock=task[n].sock;
+    q->policy=(policy !=NULL) ? policy[n] : ASYNCSND_NEVER;
+    if (q->policy==ASYNCSND_NEVER) q->depth=ASYNCSND_MAXDEPTH;
+    else q->depth=ASYNCSND_DEPTH;
+    pthread_cond_init(&q->cnd,NULL);
+    pthread_cond_init(&q->spc,NULL);
+    if (pthread_create(&q->thr,NULL,AsyncSndWorker,q) !=0) {
+      pthread_cond_destroy(&q->spc);
+      pthread_cond_destroy(&q->cnd);
+      break;
+    }
+    q->run=1;
+  }
+
+  /* only the queues that were started are stopped */
+
+  if (n<tnum) {
+    ptr->tnum=n;
+    AsyncSndFree(ptr);
+    return NULL;
+  }
+  return ptr;
+}
+
+
+/* sends what is still queued, then stops the senders */
+
+void AsyncSndFree(struct AsyncSnd *ptr) {
+  int n;
+
+  if (ptr==NULL) return;
+  pthread_mutex_lock(&ptr->mtx);
+  ptr->quit=1;
+  for (n=0;n<ptr->tnum;n++)
+    if (ptr->queue[n].run) pthread_cond_signal(&ptr->queue[n].cnd);
+  pthread_mutex_unlock(&ptr->mtx);
+
+  for (n=0;n<ptr->tnum;n++) {
+    if (ptr->queue[n].run) pthread_join(ptr->queue[n].thr,NULL);
+    pthread_cond_destroy(&ptr->queue[n].spc);
+    pthread_cond_destroy(&ptr->queue[n].cnd);
+  }
+  pthread_mutex_destroy(&ptr->mtx);
+  free(ptr);
+}
+
+
+/* called with the lock held; returns 0 if the message was queued */
+
+static int AsyncSndPush(struct AsyncSndQueue *q,struct AsyncSndMsg *msg) {
+  struct AsyncSndEnt *ent;
+  double tval;
+
+  if ((q->num>=q->depth) && (q->policy==ASYNCSND_NEVER)) {
+    tval=AsyncSndTime();
+    q->stats.blocked++;
+    while (q->num>=q->depth) pthread_cond_wait(&q->spc,&q->snd->mtx);
+    q->stats.tblock+=AsyncSndTime()-tval;
+  }
+
+  if (q->num>=q->depth) {
+    if (q->policy !=ASYNCSND_OLDEST) {
+      q->stats.dropped++;
+      return -1;
+    }
+    ent=&q->ent[q->head];
+    q->head=(q->head+1) % ASYNCSND_MAXDEPTH;
+    q->num--;
+    q->stats.dropped++;
+    if (ent->reopen) {
+      if (q->num>0) q->ent[q->head].reopen=1;
+      else q->reopen=1;
+    }
+    AsyncSndRelease(ent->msg);
+  }
+
+  ent=&q->ent[(q->head+q->num) % ASYNCSND_MAXDEPTH];
+  ent->msg=msg;
+  ent->reopen=q->reopen;
+  q->reopen=0;
+  msg->ref++;
+  q->num++;
+  if (q->num>q->stats.peak) q->stats.peak=q->num;
+  pthread_cond_signal(&q->cnd);
+  return 0;
+}
+
+
+/* queues blk for task n, or for every task if n is -1; the block is
+   copied, so its buffers can be reused as soon as this returns. Waits
+   if an ASYNCSND_NEVER queue is full */
+
+int AsyncSndSend(struct AsyncSnd *ptr,int n,struct RMsgBlock *blk) {
+  struct AsyncSndMsg *msg;
+  int i,seq,s=0;
+
+  if ((n<-1) || (n>=ptr->tnum)) return -1;
+
+  /* no more messages than this can be held at once, so the sample
+     copies never share a name */
+  pthread_mutex_lock(&ptr->mtx);
+  seq=ptr->seq;
+  ptr->seq=(ptr->seq+1) % (2*ASYNCSND_MAXDEPTH*ASYNCSND_MAXTASK);
+  pthread_mutex_unlock(&ptr->mtx);
+
+  msg=AsyncSndCopy(blk,seq);
+  if (msg==NULL) return -1;
+
+  pthread_mutex_lock(&ptr->mtx);
+  msg->ref++;
+  for (i=0;i<ptr->tnum;i++) {
+    if ((n !=-1) && (i !=n)) continue;
+    if ((msg->shm[0]==0) && (AsyncSndHasIQ(blk)))
+      ptr->queue[i].stats.noiq++;
+    if (AsyncSndPush(&ptr->queue[i],msg) !=0) s=-1;
+  }
+  AsyncSndRelease(msg);
+  pthread_mutex_unlock(&ptr->mtx);
+  return s;
+}
+
+
+void AsyncSndReopen(struct AsyncSnd *ptr) {
+  int n;
+
+  pthread_mutex_lock(&ptr->mtx);
+  for (n=0;n<ptr->tnum;n++) ptr->queue[n].reopen=1;
+  pthread_mutex_unlock(&ptr->mtx);
+}
+
+
+/* copies out and resets the counters of task n */
+
+void AsyncSndStatsGet(struct AsyncSnd *ptr,int n,
+                      struct AsyncSndStats *stats) {
+  struct AsyncSndQueue *q=&ptr->queue[n];
+
+  pthread_mutex_lock(&ptr->mtx);
+  if (stats !=NULL) memcpy(stats,&q->stats,sizeof(struct AsyncSndStats));
+  memset(&q->stats,0,sizeof(struct AsyncSndStats));
+  q->stats.peak=q->num;
+  pthread_mutex_unlock(&ptr->mtx);
+}
@@ -0,0 +1,74 @@
+/* asyncsnd.h
+   ==========
+*/
+
+
+#ifndef _ASYNCSND_H
+#define _ASYNCSND_H
+
+#define ASYNCSND_MAXTASK 8
+#define ASYNCSND_DEPTH 4       /* queue length for the dropping policies */
+#define ASYNCSND_MAXDEPTH 64   /* queue length that is never exceeded */
+
+#define ASYNCSND_NEVER 0       /* keep everything; wait when the queue is full */
+#define ASYNCSND_OLDEST 1      /* drop the oldest queued message */
+#define ASYNCSND_NEWEST 2      /* drop the message being queued */
+
+/* a copy of a message block, shared by the queues it is on */
+
+struct AsyncSndMsg {
+  int ref;
+  struct RMsgBlock blk;
+  unsigned char *buf;
+  char shm[64];    /* copy of the samples named by IQS_TYPE, or empty */
+};
+
+struct AsyncSndEnt {
+  struct AsyncSndMsg *msg;
+  int reopen;
+};
+
+struct AsyncSndStats {
+  int sent;
+  int dropped;   /* dropped under the queue's policy */
+  int blocked;   /* times the beam loop waited for room in the queue */
+  int noiq;      /* records sent without their I&Q samples */
+  int peak;      /* deepest the queue got */
+  double tsend;  /* seconds the sender spent in RMsgSndSend */
+  double tblock; /* seconds the beam loop waited for room */
+};
+
+struct AsyncSndQueue {
+  struct AsyncSnd *snd;
+  int sock;
+  int policy;
+  int depth;
+  int head;
+  int num;
+  int reopen;    /* reopen before the next message queued */
+  struct AsyncSndEnt ent[ASYNCSND_MAXDEPTH];
+  pthread_t thr;
+  pthread_cond_t cnd;
+  pthread_cond_t spc;    /* signalled when a message is taken off */
+  int run;
+  struct AsyncSndStats stats;
+};
+
+struct AsyncSnd {
+  int tnum;
+  int quit;
+  int seq;
+  unsigned char *command;
+  pthread_mutex_t mtx;
+  struct AsyncSndQueue queue[ASYNCSND_MAXTASK];
+};
+
+struct AsyncSnd *AsyncSndMake(int tnum,struct TCPIPMsgHost *task,
+                              int *policy,unsigned char *command);
+void AsyncSndFree(struct AsyncSnd *ptr);
+int AsyncSndSend(struct AsyncSnd *ptr,int n,struct RMsgBlock *blk);
+void AsyncSndReopen(struct AsyncSnd *ptr);
+void AsyncSndStatsGet(struct AsyncSnd *ptr,int n,
+                      struct AsyncSndStats *stats);
+
+#endif
@@ -0,0 +1,171 @@
+/* bndbench.c
+   ==========
+
+   Jitter harness for the scan boundary wait. A short scan period is
+   run over and over; each simulated scan busies the processor for a
+   random part of the period and then waits for the boundary three
+   ways: with a relative sleep polled in 5 ms steps, as SiteEndScan
+   does in normalsound, with the same poll in BNDWAIT_STEP steps, and
+   with the absolute deadline sleep of bndwait.c followed by the
+   BNDWAIT_STEP poll, which is what -bndwait does. The error of each
+   wake-up against the boundary and the processor time spent waiting
+   are recorded and printed for each.
+
+   Only needs POSIX, so it can be built on any box:
+
+     cc -O2 -o bndbench bndbench.c bndwait.c -lm -lrt
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "bndwait.h"
+
+
+static double BenchTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_REALTIME,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static void BenchLoad(double sec) {
+  double tval;
+
+  tval=BenchTime()+sec;
+  while (BenchTime()<tval);
+}
+
+
+static double BenchCPU(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+/* relative sleeps of step us at a time until the boundary is passed */
+
+static double BenchPoll(double bnd,int step) {
+  struct timespec tp;
+  double left,tval;
+
+  while (1) {
+    tval=BenchTime();
+    if (tval>=bnd) break;
+    left=bnd-tval;
+    if (left>step*1e-6) left=step*1e-6;
+    tp.tv_sec=(time_t) left;
+    tp.tv_nsec=(long) ((left-tp.tv_sec)*1e9);
+    nanosleep(&tp,NULL);
+  }
+  return tval-bnd;
+}
+
+
+static int BenchCompare(const void *a,const void *b) {
+  double x=*(double *) a,y=*(double *) b;
+  if (x<y) return -1;
+  if (x>y) return 1;
+  return 0;
+}
+
+
+static void BenchReport(char *label,double *err,int scans,double cpu) {
+  double sum=0;
+  int n;
+
+  for (n=0;n<scans;n++) {
+    sum+=err[n];
+    err[n]=fabs(err[n]);
+  }
+  qsort(err,scans,sizeof(double),BenchCompare);
+  fprintf(stdout,"%-9s error mean %+9.1fus  |error| p50 %8.1fus  p99 %8.1fus"
+          "  max %8.1fus  cpu/scan %6.1fus\n",label,1e6*sum/scans,
+          1e6*err[scans/2],1e6*err[(scans*99)/100],1e6*err[scans-1],
+          1e6*cpu/scans);
+}
+
+
+int main(int argc,char *argv[]) {
+
+  struct BndWait *bwait;
+  struct BndWaitStats bstats;
+  double *err;
+  double bnd,tval,cpu;
+  double period=20,load=0.5;
+  int scans=2000,step=5000;
+  int scnsc,scnus;
+  int n,c;
+
+  for (c=1;c<argc-1;c+=2) {
+    if (strcmp(argv[c],"-period")==0) period=atof(argv[c+1]);
+    else if (strcmp(argv[c],"-scans")==0) scans=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-step")==0) step=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-load")==0) load=atof(argv[c+1]);
+  }
+  if (scans<1) scans=1;
+  if (period<1) period=1;
+  if ((load<0) || (load>0.9)) load=0.5;
+
+  scnsc=(int) (period/1000);
+  scnus=(int) ((period-scnsc*1000)*1000);
+
+  fprintf(stdout,"period %gms  scans %d  load %g  poll step %dus\n",
+          period,scans,load,step);
+  fflush(stdout);
+
+  err=malloc(sizeof(double)*scans);
+  bwait=BndWaitMake();
+  if ((err==NULL) || (bwait==NULL)) return -1;
+
+  srand(1);
+  BenchPoll(BndWaitNext(scnsc,scnus),step);
+  cpu=0;
+  for (n=0;n<scans;n++) {
+    BenchLoad(load*period*1e-3*rand()/RAND_MAX);
+    tval=BenchCPU();
+    err[n]=BenchPoll(BndWaitNext(scnsc,scnus),step);
+    cpu+=BenchCPU()-tval;
+  }
+  BenchReport("poll",err,scans,cpu);
+
+  srand(1);
+  BenchPoll(BndWaitNext(scnsc,scnus),BNDWAIT_STEP);
+  cpu=0;
+  for (n=0;n<scans;n++) {
+    BenchLoad(load*period*1e-3*rand()/RAND_MAX);
+    tval=BenchCPU();
+    err[n]=BenchPoll(BndWaitNext(scnsc,scnus),BNDWAIT_STEP);
+    cpu+=BenchCPU()-tval;
+  }
+  BenchReport("poll fine",err,scans,cpu);
+
+  srand(1);
+  bnd=BndWaitNext(scnsc,scnus);
+  if (BndWaitApproach(bwait,bnd)) BenchPoll(bnd,BNDWAIT_STEP);
+  BndWaitDone(bwait,bnd);
+  BndWaitStatsGet(bwait,&bstats);
+  cpu=0;
+  for (n=0;n<scans;n++) {
+    BenchLoad(load*period*1e-3*rand()/RAND_MAX);
+    tval=BenchCPU();
+    bnd=BndWaitNext(scnsc,scnus);
+    if (BndWaitApproach(bwait,bnd)) BenchPoll(bnd,BNDWAIT_STEP);
+    err[n]=BndWaitDone(bwait,bnd);
+    cpu+=BenchCPU()-tval;
+  }
+  BenchReport("deadline",err,scans,cpu);
+  BndWaitStatsGet(bwait,&bstats);
+  fprintf(stdout,"lead %.1fus  left to poll %.1fus  missed %d\n",
+          1e6*bstats.lead,1e6*bstats.poll,bstats.miss);
+
+  BndWaitFree(bwait);
+  free(err);
+  return 0;
+}
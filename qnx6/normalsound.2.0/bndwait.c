@@ -0,0 +1,175 @@
+/* bndwait.c
+   =========
+
+   Brings the wait for the scan boundary close before SiteEndScan is
+   called. The boundary is found from the real time clock, converted
+   once to a deadline on the monotonic clock, and the thread sleeps
+   with clock_nanosleep until a short lead before it. SiteEndScan is
+   then called as before, but with a poll step of BNDWAIT_STEP rather
+   than 5 ms, so it only has the last few milliseconds to cover and
+   its final sleep is short. Nothing spins on the clock.
+
+   The lead has to keep the wake-up ahead of the boundary, or
+   SiteEndScan would wait for the next one and a whole scan would be
+   lost. If the sleep does run past the boundary, or ends within
+   BNDWAIT_GUARD of it, BndWaitApproach says so and SiteEndScan is not
+   called; the scan starts a little late instead, and the miss is
+   counted. The lead is calibrated from how late the timer wakes: the oversleep is smoothed the way TCP smooths
+   round trip times, and the lead is the running mean plus four times
+   the running mean deviation plus one poll step.
+
+   Each wake-up error is kept and BndWaitStatsGet gives the
+   distribution since it was last called.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include "bndwait.h"
+
+
+static double BndWaitTime(clockid_t clk) {
+  struct timespec tp;
+
+  clock_gettime(clk,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static int BndWaitCmp(const void *a,const void *b) {
+  double x=*((double *) a),y=*((double *) b);
+
+  if (x<y) return -1;
+  if (x>y) return 1;
+  return 0;
+}
+
+
+struct BndWait *BndWaitMake(void) {
+  struct BndWait *ptr;
+
+  ptr=malloc(sizeof(struct BndWait));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct BndWait));
+  ptr->lead=BNDWAIT_LEAD;
+  return ptr;
+}
+
+
+void BndWaitFree(struct BndWait *ptr) {
+  if (ptr==NULL) return;
+  free(ptr);
+}
+
+
+/* returns the next scan boundary (epoch seconds); the boundaries are
+   those used by SiteEndScan, multiples of the scan period from
+   midnight */
+
+double BndWaitNext(int scnsc,int scnus) {
+  struct timespec tp;
+  double bnd,tod;
+
+  bnd=scnsc+scnus*1e-6;
+  clock_gettime(CLOCK_REALTIME,&tp);
+  if (bnd<=0) return tp.tv_sec+tp.tv_nsec*1e-9;
+  tod=(tp.tv_sec % (24*3600))+tp.tv_nsec*1e-9;
+  return (tp.tv_sec-(tp.tv_sec % (24*3600)))+(floor(tod/bnd)+1)*bnd;
+}
+
+
+/* sleeps until the lead before tval (epoch seconds); returns 1 if
+   SiteEndScan should be called to finish the wait, or 0 if the
+   boundary is already too close or past */
+
+int BndWaitApproach(struct BndWait *ptr,double tval) {
+  struct timespec tp;
+  double mono,dl,wake,over,t;
+  int s;
+
+  mono=BndWaitTime(CLOCK_MONOTONIC);
+  dl=mono+(tval-BndWaitTime(CLOCK_REALTIME));
+
+  t=dl-ptr->lead;
+  if (t>mono) {
+    tp.tv_sec=(time_t) t;
+    tp.tv_nsec=(long) ((t-tp.tv_sec)*1e9);
+    do {
+      s=clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&tp,NULL);
+    } while (s==EINTR);
+
+    wake=BndWaitTime(CLOCK_MONOTONIC);
+    over=wake-t;
+    if (ptr->init==0) {
+      ptr->over=over;
+      ptr->dev=over/2;
+      ptr->init=1;
+    } else {
+      ptr->dev+=0.25*(fabs(over-ptr->over)-ptr->dev);
+      ptr->over+=0.125*(over-ptr->over);
+    }
+    ptr->lead=ptr->over+4*ptr->dev+BNDWAIT_STEP*1e-6;
+    if (ptr->lead<BNDWAIT_MINLEAD) ptr->lead=BNDWAIT_MINLEAD;
+    if (ptr->lead>BNDWAIT_MAXLEAD) ptr->lead=BNDWAIT_MAXLEAD;
+  } else wake=mono;
+
+  ptr->wake=dl-wake;
+  if (ptr->wake<BNDWAIT_GUARD) {
+    ptr->miss++;
+    return 0;
+  }
+  return 1;
+}
+
+
+/* called once SiteEndScan returns; records and returns the error
+   against tval, late positive */
+
+double BndWaitDone(struct BndWait *ptr,double tval) {
+  double err;
+
+  err=BndWaitTime(CLOCK_REALTIME)-tval;
+  ptr->err[ptr->num % BNDWAIT_SIZE]=err;
+  ptr->num++;
+  ptr->sum+=err;
+  ptr->poll+=ptr->wake;
+  return err;
+}
+
+
+/* copies out and resets the accumulated counters */
+
+void BndWaitStatsGet(struct BndWait *ptr,struct BndWaitStats *stats) {
+  double *tmp;
+  int n,num;
+
+  memset(stats,0,sizeof(struct BndWaitStats));
+  if (ptr==NULL) return;
+  stats->lead=ptr->lead;
+  if (ptr->num==0) return;
+
+  num=(ptr->num>BNDWAIT_SIZE) ? BNDWAIT_SIZE : ptr->num;
+  stats->num=ptr->num;
+  stats->miss=ptr->miss;
+  stats->mean=ptr->sum/ptr->num;
+  stats->poll=ptr->poll/ptr->num;
+
+  tmp=malloc(sizeof(double)*num);
+  if (tmp !=NULL) {
+    for (n=0;n<num;n++) tmp[n]=fabs(ptr->err[n]);
+    qsort(tmp,num,sizeof(double),BndWaitCmp);
+    stats->p50=tmp[num/2];
+    stats->p99=tmp[(int) (0.99*(num-1))];
+    stats->max=tmp[num-1];
+    free(tmp);
+  }
+
+  ptr->num=0;
+  ptr->miss=0;
+  ptr->sum=0;
+  ptr->poll=0;
+}
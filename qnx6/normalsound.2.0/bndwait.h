@@ -0,0 +1,47 @@
+/* bndwait.h
+   =========
+*/
+
+
+#ifndef _BNDWAIT_H
+#define _BNDWAIT_H
+
+#define BNDWAIT_LEAD 0.005     /* wake-up lead before calibration [s] */
+#define BNDWAIT_MINLEAD 0.002
+#define BNDWAIT_MAXLEAD 0.02
+#define BNDWAIT_STEP 1000      /* SiteEndScan poll step after waking [us] */
+#define BNDWAIT_GUARD 0.0002   /* closer than this SiteEndScan is skipped [s] */
+#define BNDWAIT_SIZE 4096      /* wake-ups kept for the statistics */
+
+struct BndWaitStats {
+  int num;
+  int miss;          /* wake-ups too close to or past the boundary */
+  double mean;       /* mean wake-up error, late positive [s] */
+  double p50;        /* median of the absolute error [s] */
+  double p99;
+  double max;
+  double lead;       /* current wake-up lead [s] */
+  double poll;       /* mean time left to SiteEndScan after waking [s] */
+};
+
+struct BndWait {
+  double lead;
+  double over;       /* smoothed oversleep of the timer [s] */
+  double dev;        /* smoothed deviation of the oversleep [s] */
+  int init;
+  int num;
+  int miss;
+  double sum;
+  double poll;
+  double wake;
+  double err[BNDWAIT_SIZE];
+};
+
+struct BndWait *BndWaitMake(void);
+void BndWaitFree(struct BndWait *ptr);
+double BndWaitNext(int scnsc,int scnus);
+int BndWaitApproach(struct BndWait *ptr,double tval);
+double BndWaitDone(struct BndWait *ptr,double tval);
+void BndWaitStatsGet(struct BndWait *ptr,struct BndWaitStats *stats);
+
+#endif
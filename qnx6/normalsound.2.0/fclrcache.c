@@ -0,0 +1,172 @@
+/* fclrcache.c
+   ===========
+
+   Keeps the results of recent clear frequency searches so that a beam
+   can reuse one instead of searching again. Every search made, in the
+   main scan or in the sounding, is kept with the beam, the band that
+   was searched, the frequency chosen, its noise and when it was made.
+
+   A search of the band start-end on a beam is answered from a result
+   that is no older than maxage seconds, was made on the same beam
+   over a band containing start-end, and chose a frequency inside
+   start-end. Such a frequency was the quietest of a band containing
+   the one asked for, so it is also the quietest of that band and the
+   answer is the same one a search would have given at that time.
+   Otherwise SiteFCLR is called and the result is kept.
+
+   A hit is answered from the cache alone, without touching the
+   receiver, so it saves the whole search. What keeps it honest is
+   the age limit and the noise seen on the frequency since:
+   FclrCacheNoise is given the lag-zero power of every integration,
+   and the noise floor of the first one made on a searched frequency
+   becomes the reference for that result. If a later integration on it
+   finds the floor more than FCLRCACHE_NOISE times higher, the result
+   is dropped and the next search of that band goes to SiteFCLR.
+
+   The search is left to SiteFCLR rather than run in the background:
+   the receiver is shared with the integration, and the search only
+   returns the frequency chosen and its noise, not the spectrum.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "radar.h"
+#include "rprm.h"
+#include "iq.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "global.h"
+#include "site.h"
+#include "fclrcache.h"
+
+
+static double FclrCacheTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+struct FclrCache *FclrCacheMake(double maxage) {
+  struct FclrCache *ptr;
+
+  ptr=malloc(sizeof(struct FclrCache));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct FclrCache));
+  ptr->maxage=maxage;
+  return ptr;
+}
+
+
+void FclrCacheFree(struct FclrCache *ptr) {
+  if (ptr==NULL) return;
+  free(ptr);
+}
+
+
+/* sets tfreq and noise as SiteFCLR does and returns tfreq */
+
+int FclrCacheFCLR(struct FclrCache *ptr,int bmnum,int start,int end) {
+  struct FclrCacheEnt *ent,*best=NULL;
+  double tval;
+  int n;
+
+  tval=FclrCacheTime();
+
+  for (n=0;n<ptr->num;n++) {
+    ent=&ptr->ent[n];
+    if (ent->bmnum !=bmnum) continue;
+    if ((ent->start>start) || (ent->end<end)) continue;
+    if ((ent->tfreq<start) || (ent->tfreq>end)) continue;
+    if (tval-ent->time>ptr->maxage) continue;
+    if ((best==NULL) || (ent->time>best->time)) best=ent;
+  }
+
+  if (best !=NULL) {
+    ptr->stats.hits++;
+    tfreq=best->tfreq;
+    noise=best->noise;
+    return tfreq;
+  }
+
+  tfreq=SiteFCLR(start,end);
+  ptr->stats.searches++;
+  ptr->stats.tsearch+=FclrCacheTime()-tval;
+
+  /* the same search replaces its old result, otherwise the oldest goes */
+  best=NULL;
+  for (n=0;n<ptr->num;n++) {
+    ent=&ptr->ent[n];
+    if ((ent->bmnum==bmnum) && (ent->start==start) && (ent->end==end)) {
+      best=ent;
+      break;
+    }
+    if ((best==NULL) || (ent->time<best->time)) best=ent;
+  }
+  if ((n==ptr->num) && (ptr->num<FCLRCACHE_MAX)) best=&ptr->ent[ptr->num++];
+
+  best->bmnum=bmnum;
+  best->start=start;
+  best->end=end;
+  best->tfreq=tfreq;
+  best->noise=noise;
+  best->floor=0;
+  best->time=tval;
+  return tfreq;
+}
+
+
+/* the mean of the FCLRCACHE_FLOOR weakest ranges, as FitACF takes it */
+
+static float FclrCacheFloor(float *pwr0,int nrang) {
+  float low[FCLRCACHE_FLOOR];
+  float sum=0;
+  int n,m,num=0;
+
+  for (n=0;n<nrang;n++) {
+    if ((num==FCLRCACHE_FLOOR) && (pwr0[n]>=low[num-1])) continue;
+    if (num<FCLRCACHE_FLOOR) num++;
+    for (m=num-1;(m>0) && (low[m-1]>pwr0[n]);m--) low[m]=low[m-1];
+    low[m]=pwr0[n];
+  }
+  for (n=0;n<num;n++) sum+=low[n];
+  return (num>0) ? sum/num : 0;
+}
+
+
+/* called with the lag-zero power of each integration made on tfreq */
+
+void FclrCacheNoise(struct FclrCache *ptr,int bmnum,int tfreq,
+                    float *pwr0,int nrang) {
+  struct FclrCacheEnt *ent;
+  float lvl;
+  int n;
+
+  if ((pwr0==NULL) || (nrang<=0)) return;
+  lvl=FclrCacheFloor(pwr0,nrang);
+  for (n=0;n<ptr->num;n++) {
+    ent=&ptr->ent[n];
+    if ((ent->bmnum !=bmnum) || (ent->tfreq !=tfreq)) continue;
+    if (ent->floor<=0) ent->floor=lvl;
+    else if (lvl>FCLRCACHE_NOISE*ent->floor) {
+      ent->bmnum=-1;
+      ptr->stats.stale++;
+    }
+  }
+}
+
+
+/* copies out and resets the accumulated counters */
+
+void FclrCacheStatsGet(struct FclrCache *ptr,struct FclrCacheStats *stats) {
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct FclrCacheStats));
+  memset(&ptr->stats,0,sizeof(struct FclrCacheStats));
+}
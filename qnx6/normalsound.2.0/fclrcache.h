@@ -0,0 +1,44 @@
+/* fclrcache.h
+   ===========
+*/
+
+
+#ifndef _FCLRCACHE_H
+#define _FCLRCACHE_H
+
+#define FCLRCACHE_MAX 64
+#define FCLRCACHE_NOISE 2.0    /* rise in the noise floor that drops a result */
+#define FCLRCACHE_FLOOR 10     /* weakest ranges averaged for the floor */
+
+struct FclrCacheEnt {
+  int bmnum;
+  int start;
+  int end;
+  int tfreq;
+  float noise;
+  float floor;      /* noise floor of the first integration, or 0 */
+  double time;
+};
+
+struct FclrCacheStats {
+  int hits;
+  int stale;        /* results dropped as the noise floor rose */
+  int searches;
+  double tsearch;   /* seconds spent in SiteFCLR */
+};
+
+struct FclrCache {
+  double maxage;
+  int num;
+  struct FclrCacheEnt ent[FCLRCACHE_MAX];
+  struct FclrCacheStats stats;
+};
+
+struct FclrCache *FclrCacheMake(double maxage);
+void FclrCacheFree(struct FclrCache *ptr);
+int FclrCacheFCLR(struct FclrCache *ptr,int bmnum,int start,int end);
+void FclrCacheNoise(struct FclrCache *ptr,int bmnum,int tfreq,
+                    float *pwr0,int nrang);
+void FclrCacheStatsGet(struct FclrCache *ptr,struct FclrCacheStats *stats);
+
+#endif
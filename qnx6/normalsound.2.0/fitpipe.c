@@ -0,0 +1,377 @@
+/* fitpipe.c
+   =========
+
+   Runs FitACF and the message fan-out for one beam on a worker thread
+   while the beam loop moves on to the next integration. The beam loop
+   builds each record into one of two slots; the worker owns the other.
+
+   The next integration writes over the site library's sample buffer
+   while the worker is still sending, so each slot has a shared memory
+   segment of its own (the buffer's name with ".pipe" and the slot
+   number added). The samples of the beam are copied into it before
+   the slot is handed over, and the IQS message names that segment, so
+   iqwrite always reads the samples of the record it was sent.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "rtypes.h"
+#include "dmap.h"
+#include "limit.h"
+#include "radar.h"
+#include "rprm.h"
+#include "iq.h"
+#include "rawdata.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "fitacf.h"
+#include "tcpipmsg.h"
+#include "rmsg.h"
+#include "rmsgsnd.h"
+#include "global.h"
+#include "siteglobal.h"
+#include "shmring.h"
+#include "shmsnd.h"
+#include "asyncsnd.h"
+#include "msgarena.h"
+#include "scantime.h"
+#include "fitpipe.h"
+
+
+static double FitPipeTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static void FitPipeSend(struct FitPipe *ptr,struct FitPipeSlot *slot) {
+
+  struct RMsgBlock blk;
+  void *tmpbuf;
+  size_t tmpsze;
+  double tprobe;
+  int n;
+
+  tprobe=ScanTimeNow();
+  FitACF(slot->prm,slot->raw,fblk,slot->fit);
+  ScanTimeAdd(ptr->stime,ST_FIT,slot->prm->bmnum,tprobe);
+
+  tprobe=ScanTimeNow();
+
+  blk.num=0;
+  blk.tsize=0;
+
+  tmpbuf=MsgArenaPrmFlatten(ptr->arena,slot->prm,&tmpsze);
+  if (tmpbuf==NULL) tmpbuf=RadarParmFlatten(slot->prm,&tmpsze);
+  RMsgSndAdd(&blk,tmpsze,tmpbuf,PRM_TYPE,0);
+
+  tmpbuf=MsgArenaIQFlatten(ptr->arena,slot->iq,slot->prm->nave,&tmpsze);
+  if (tmpbuf==NULL) tmpbuf=IQFlatten(slot->iq,slot->prm->nave,&tmpsze);
+  RMsgSndAdd(&blk,tmpsze,tmpbuf,IQ_TYPE,0);
+
+  RMsgSndAdd(&blk,sizeof(unsigned int)*2*slot->tbadtr,
+             (unsigned char *) slot->badtr,BADTR_TYPE,0);
+
+  RMsgSndAdd(&blk,strlen(slot->shmname)+1,(unsigned char *)slot->shmname,
+             IQS_TYPE,0);
+
+  tmpbuf=MsgArenaRawFlatten(ptr->arena,slot->raw,slot->prm->nrang,slot->prm->mplgs,&tmpsze);
+  if (tmpbuf==NULL) tmpbuf=RawFlatten(slot->raw,slot->prm->nrang,slot->prm->mplgs,&tmpsze);
+  RMsgSndAdd(&blk,tmpsze,tmpbuf,RAW_TYPE,0);
+
+  tmpbuf=MsgArenaFitFlatten(ptr->arena,slot->fit,slot->prm->nrang,&tmpsze);
+  if (tmpbuf==NULL) tmpbuf=FitFlatten(slot->fit,slot->prm->nrang,&tmpsze);
+  RMsgSndAdd(&blk,tmpsze,tmpbuf,FIT_TYPE,0);
+
+  RMsgSndAdd(&blk,strlen(ptr->progname)+1,(unsigned char *)ptr->progname,
+             NME_TYPE,0);
+
+  if (ptr->snd !=NULL) ShmSndSend(ptr->snd,&blk);
+  else if (ptr->asnd !=NULL) AsyncSndSend(ptr->asnd,-1,&blk);
+  else for (n=0;n<ptr->tnum;n++) RMsgSndSend(ptr->task[n].sock,&blk);
+
+  MsgArenaFreeBlock(ptr->arena,&blk);
+  MsgArenaReset(ptr->arena);
+  ScanTimeAdd(ptr->stime,ST_SEND,slot->prm->bmnum,tprobe);
+}
+
+
+static void *FitPipeWorker(void *arg) {
+
+  struct FitPipe *ptr=(struct FitPipe *) arg;
+  struct FitPipeSlot *slot;
+  double tval;
+
+  pthread_mutex_lock(&ptr->mtx);
+  while (1) {
+    while ((ptr->busy==-1) && (ptr->quit==0))
+      pthread_cond_wait(&ptr->cnd,&ptr->mtx);
+    if (ptr->busy==-1) break;
+
+    slot=&ptr->slot[ptr->busy];
+    pthread_mutex_unlock(&ptr->mtx);
+
+    tval=FitPipeTime();
+    FitPipeSend(ptr,slot);
+    tval=FitPipeTime()-tval;
+
+    pthread_mutex_lock(&ptr->mtx);
+    ptr->stats.tail+=tval;
+    ptr->stats.beams++;
+    ptr->busy=-1;
+    pthread_cond_broadcast(&ptr->cnd);
+  }
+  pthread_mutex_unlock(&ptr->mtx);
+  return NULL;
+}
+
+
+static int FitPipeSlotShm(struct FitPipeSlot *slot,char *shmname,int n,
+                          size_t sze) {
+  void *shm;
+  int fd;
+
+  if (strlen(shmname)+16>FITPIPE_NAME) return -1;
+  sprintf(slot->shmname,"%s.pipe%d",shmname,n);
+  fd=shm_open(slot->shmname,O_RDWR | O_CREAT,0644);
+  if (fd==-1) return -1;
+  if (ftruncate(fd,sze) !=0) {
+    close(fd);
+    shm_unlink(slot->shmname);
+    return -1;
+  }
+  shm=mmap(NULL,sze,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  if (shm==MAP_FAILED) {
+    shm_unlink(slot->shmname);
+    return -1;
+  }
+  slot->shm=shm;
+  return 0;
+}
+
+
+static void FitPipeSlotFree(struct FitPipeSlot *slot,size_t sze) {
+  if (slot->shm !=NULL) {
+    munmap(slot->shm,sze);
+    shm_unlink(slot->shmname);
+  }
+  if (slot->prm !=NULL) RadarParmFree(slot->prm);
+  if (slot->iq !=NULL) IQFree(slot->iq);
+  if (slot->raw !=NULL) RawFree(slot->raw);
+  if (slot->fit !=NULL) FitFree(slot->fit);
+  if (slot->badtr !=NULL) free(slot->badtr);
+  memset(slot,0,sizeof(struct FitPipeSlot));
+}
+
+
+struct FitPipe *FitPipeMake(int tnum,struct TCPIPMsgHost *task,
+                            struct ShmSnd *snd,struct AsyncSnd *asnd,
+                            struct MsgArena *arena,
+                            struct ScanTime *stime,char *progname,
+                            char *shmname) {
+
+  struct FitPipe *ptr;
+  struct FitPipeSlot *slot;
+  struct stat buf;
+  void *src;
+  int fd,n;
+
+  if (shmname==NULL) return NULL;
+  fd=shm_open(shmname,O_RDONLY,0);
+  if (fd==-1) return NULL;
+  if ((fstat(fd,&buf) !=0) || (buf.st_size<=0)) {
+    close(fd);
+    return NULL;
+  }
+  src=mmap(NULL,buf.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (src==MAP_FAILED) return NULL;
+
+  ptr=malloc(sizeof(struct FitPipe));
+  if (ptr==NULL) {
+    munmap(src,buf.st_size);
+    return NULL;
+  }
+  memset(ptr,0,sizeof(struct FitPipe));
+  ptr->src=src;
+  ptr->shmsze=buf.st_size;
+
+  ptr->busy=-1;
+  ptr->tnum=tnum;
+  ptr->task=task;
+  ptr->snd=snd;
+  ptr->asnd=asnd;
+  ptr->arena=arena;
+  ptr->stime=stime;
+  ptr->progname=progname;
+
+  for (n=0;n<FITPIPE_SLOTS;n++) {
+    slot=&ptr->slot[n];
+    slot->prm=RadarParmMake();
+    slot->iq=IQMake();
+    slot->raw=RawMake();
+    slot->fit=FitMake();
+    if ((slot->prm==NULL) || (slot->iq==NULL) ||
+        (slot->raw==NULL) || (slot->fit==NULL)) break;
+    if (FitPipeSlotShm(slot,shmname,n,ptr->shmsze) !=0) break;
+  }
+
+  if (n !=FITPIPE_SLOTS) {
+    for (n=0;n<FITPIPE_SLOTS;n++)
+      FitPipeSlotFree(&ptr->slot[n],ptr->shmsze);
+    munmap(ptr->src,ptr->shmsze);
+    free(ptr);
+    return NULL;
+  }
+
+  pthread_mutex_init(&ptr->mtx,NULL);
+  pthread_cond_init(&ptr->cnd,NULL);
+
+  if (pthread_create(&ptr->thr,NULL,FitPipeWorker,ptr) !=0) {
+    pthread_cond_destroy(&ptr->cnd);
+    pthread_mutex_destroy(&ptr->mtx);
+    for (n=0;n<FITPIPE_SLOTS;n++)
+      FitPipeSlotFree(&ptr->slot[n],ptr->shmsze);
+    munmap(ptr->src,ptr->shmsze);
+    free(ptr);
+    return NULL;
+  }
+  ptr->run=1;
+  return ptr;
+}
+
+
+void FitPipeFree(struct FitPipe *ptr) {
+  int n;
+
+  if (ptr==NULL) return;
+
+  if (ptr->run) {
+    pthread_mutex_lock(&ptr->mtx);
+    ptr->quit=1;
+    pthread_cond_broadcast(&ptr->cnd);
+    pthread_mutex_unlock(&ptr->mtx);
+    pthread_join(ptr->thr,NULL);
+  }
+
+  pthread_cond_destroy(&ptr->cnd);
+  pthread_mutex_destroy(&ptr->mtx);
+  for (n=0;n<FITPIPE_SLOTS;n++) FitPipeSlotFree(&ptr->slot[n],ptr->shmsze);
+  munmap(ptr->src,ptr->shmsze);
+  free(ptr);
+}
+
+
+/* returns the slot the beam loop should build the next record into;
+   the worker never touches this slot until it is submitted */
+
+struct FitPipeSlot *FitPipeNext(struct FitPipe *ptr) {
+  return &ptr->slot[ptr->cur];
+}
+
+
+/* the bad transmit sample table belongs to the site library and is
+   rewritten by the next integration, so keep a private copy */
+
+int FitPipeSaveBadTR(struct FitPipeSlot *slot,unsigned int *badtr) {
+  unsigned int *tmp;
+  int tbadtr;
+
+  tbadtr=slot->iq->tbadtr;
+  if (tbadtr>slot->mxbadtr) {
+    tmp=realloc(slot->badtr,sizeof(unsigned int)*2*tbadtr);
+    if (tmp==NULL) {
+      slot->tbadtr=0;
+      return -1;
+    }
+    slot->badtr=tmp;
+    slot->mxbadtr=tbadtr;
+  }
+  if ((tbadtr>0) && (badtr !=NULL))
+    memcpy(slot->badtr,badtr,sizeof(unsigned int)*2*tbadtr);
+  else tbadtr=0;
+  slot->tbadtr=tbadtr;
+  return 0;
+}
+
+
+/* the samples are rewritten by the next integration too, so copy each
+   sequence the record names into the slot's own segment, at the same
+   offset; a sequence that does not fit in the buffer is dropped from
+   the record */
+
+int FitPipeSaveIQ(struct FitPipe *ptr,struct FitPipeSlot *slot) {
+  struct IQData *iq=slot->iq;
+  int n,bad=0;
+
+  for (n=0;n<iq->seqnum;n++) {
+    if ((iq->offset[n]<0) || (iq->size[n]<=0) ||
+        ((size_t) iq->offset[n]+iq->size[n]>ptr->shmsze)) {
+      iq->size[n]=0;
+      bad++;
+      continue;
+    }
+    memcpy(slot->shm+iq->offset[n],ptr->src+iq->offset[n],iq->size[n]);
+  }
+  return (bad==0) ? 0 : -1;
+}
+
+
+/* waits for the worker to go idle; returns 1 if the caller blocked */
+
+int FitPipeDrain(struct FitPipe *ptr) {
+  double tval;
+  int blocked=0;
+
+  pthread_mutex_lock(&ptr->mtx);
+  if (ptr->busy !=-1) {
+    blocked=1;
+    tval=FitPipeTime();
+    while (ptr->busy !=-1) pthread_cond_wait(&ptr->cnd,&ptr->mtx);
+    ptr->stats.wait+=FitPipeTime()-tval;
+  }
+  pthread_mutex_unlock(&ptr->mtx);
+  return blocked;
+}
+
+
+/* hands the current slot to the worker and flips to the other one;
+   returns 1 if the previous beam was still being processed, i.e. the
+   fit and send tail took longer than an integration */
+
+int FitPipeSubmit(struct FitPipe *ptr) {
+  int blocked;
+
+  blocked=FitPipeDrain(ptr);
+
+  pthread_mutex_lock(&ptr->mtx);
+  ptr->busy=ptr->cur;
+  ptr->cur=(ptr->cur+1) % FITPIPE_SLOTS;
+  pthread_cond_broadcast(&ptr->cnd);
+  pthread_mutex_unlock(&ptr->mtx);
+  return blocked;
+}
+
+
+/* copies out and resets the accumulated counters */
+
+void FitPipeStatsGet(struct FitPipe *ptr,struct FitPipeStats *stats) {
+  pthread_mutex_lock(&ptr->mtx);
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct FitPipeStats));
+  memset(&ptr->stats,0,sizeof(struct FitPipeStats));
+  pthread_mutex_unlock(&ptr->mtx);
+}
@@ -0,0 +1,64 @@
+/* fitpipe.h
+   =========
+*/
+
+
+#ifndef _FITPIPE_H
+#define _FITPIPE_H
+
+#define FITPIPE_SLOTS 2
+#define FITPIPE_NAME 256
+
+struct FitPipeSlot {
+  struct RadarParm *prm;
+  struct IQData *iq;
+  struct RawData *raw;
+  struct FitData *fit;
+  unsigned int *badtr;
+  int tbadtr;
+  int mxbadtr;
+  char shmname[FITPIPE_NAME];  /* private copy of the I&Q samples */
+  unsigned char *shm;
+};
+
+struct FitPipeStats {
+  int beams;
+  double tail;   /* seconds spent fitting and sending on the worker */
+  double wait;   /* seconds the beam loop blocked on the worker */
+};
+
+struct FitPipe {
+  pthread_t thr;
+  pthread_mutex_t mtx;
+  pthread_cond_t cnd;
+  int run;
+  int busy;
+  int quit;
+  int cur;
+  int tnum;
+  struct TCPIPMsgHost *task;
+  struct ShmSnd *snd;
+  struct AsyncSnd *asnd;
+  struct MsgArena *arena;
+  struct ScanTime *stime;
+  char *progname;
+  unsigned char *src;          /* the site library's sample buffer */
+  size_t shmsze;
+  struct FitPipeSlot slot[FITPIPE_SLOTS];
+  struct FitPipeStats stats;
+};
+
+struct FitPipe *FitPipeMake(int tnum,struct TCPIPMsgHost *task,
+                            struct ShmSnd *snd,struct AsyncSnd *asnd,
+                            struct MsgArena *arena,
+                            struct ScanTime *stime,char *progname,
+                            char *shmname);
+void FitPipeFree(struct FitPipe *ptr);
+struct FitPipeSlot *FitPipeNext(struct FitPipe *ptr);
+int FitPipeSaveBadTR(struct FitPipeSlot *slot,unsigned int *badtr);
+int FitPipeSaveIQ(struct FitPipe *ptr,struct FitPipeSlot *slot);
+int FitPipeSubmit(struct FitPipe *ptr);
+int FitPipeDrain(struct FitPipe *ptr);
+void FitPipeStatsGet(struct FitPipe *ptr,struct FitPipeStats *stats);
+
+#endif
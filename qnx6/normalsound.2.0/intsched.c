@@ -0,0 +1,143 @@
+/* intsched.c
+   ==========
+
+   Integration time scheduler. The default integration time divides
+   the part of the scan given to the beams evenly, but every beam also
+   spends time outside the integration (the build, fit, send and shell
+   calls) so a scan run at the default drifts late. The scheduler
+   measures that overhead for each beam and gives the next beam the
+   time left to the target divided by the beams still to go, less the
+   expected overhead, so that the last beam ends just before the
+   target instead of the radar waiting idle at the boundary or running
+   over it.
+
+   The overhead is smoothed the way TCP smooths round trip times: a
+   running mean plus twice the running mean deviation.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rtime.h"
+#include "intsched.h"
+
+
+struct IntSched *IntSchedMake(double scan,double span,double intt) {
+  struct IntSched *ptr;
+
+  if ((scan<=0) || (intt<=0)) return NULL;
+  ptr=malloc(sizeof(struct IntSched));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct IntSched));
+  ptr->scan=scan;
+  ptr->span=(span>scan) ? scan : span;
+  ptr->intt=intt;
+  IntSchedStart(ptr);
+  return ptr;
+}
+
+
+void IntSchedFree(struct IntSched *ptr) {
+  if (ptr==NULL) return;
+  free(ptr);
+}
+
+
+/* seconds since the start of the scan; the scan boundaries are those
+   used by SiteEndScan, multiples of the scan period from midnight */
+
+static double IntSchedPosition(struct IntSched *ptr) {
+  int yr,mo,dy,hr,mt,sc,us;
+  double tod;
+
+  TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
+  tod=hr*3600.0+mt*60.0+sc+us*1e-6;
+  return fmod(tod,ptr->scan);
+}
+
+
+double IntSchedClock(struct IntSched *ptr) {
+  double t;
+
+  if (ptr==NULL) return 0;
+  t=IntSchedPosition(ptr);
+  if (t+ptr->scan/2<ptr->last) ptr->wrap++;
+  ptr->last=t;
+  return t+ptr->wrap*ptr->scan;
+}
+
+
+void IntSchedStart(struct IntSched *ptr) {
+  double t;
+
+  if (ptr==NULL) return;
+  memset(&ptr->stats,0,sizeof(struct IntSchedStats));
+
+  /* the boundary wait can return a fraction early */
+  t=IntSchedPosition(ptr);
+  ptr->wrap=(t>ptr->scan-1.0) ? -1 : 0;
+  ptr->last=t;
+}
+
+
+void IntSchedNext(struct IntSched *ptr,int left,int *intsc,int *intus) {
+  double t,rem,x;
+
+  if (ptr==NULL) return;
+  if (left<1) left=1;
+
+  t=IntSchedClock(ptr);
+  rem=ptr->span-t;
+  if (rem<0) rem=0;
+  x=rem/left-(ptr->over+2*ptr->dev);
+
+  if (x<INTSCHED_MIN*ptr->intt) x=INTSCHED_MIN*ptr->intt;
+  if (x>INTSCHED_MAX*ptr->intt) x=INTSCHED_MAX*ptr->intt;
+
+  *intsc=(int) x;
+  *intus=(int) ((x-*intsc)*1e6);
+
+  ptr->tbeam=t;
+  ptr->tintt=*intsc+*intus*1e-6;
+  if ((ptr->stats.beams==0) || (ptr->tintt<ptr->stats.mnintt))
+    ptr->stats.mnintt=ptr->tintt;
+  if (ptr->tintt>ptr->stats.mxintt) ptr->stats.mxintt=ptr->tintt;
+}
+
+
+/* called once the beam given its time by IntSchedNext is finished */
+
+void IntSchedBeam(struct IntSched *ptr) {
+  double t,s,err;
+
+  if (ptr==NULL) return;
+
+  t=IntSchedClock(ptr);
+  s=t-ptr->tbeam-ptr->tintt;
+  if (s<0) s=0;
+
+  if (ptr->init==0) {
+    ptr->over=s;
+    ptr->dev=s/2;
+    ptr->init=1;
+  } else {
+    err=s-ptr->over;
+    ptr->over+=err/8;
+    ptr->dev+=(fabs(err)-ptr->dev)/4;
+  }
+
+  ptr->stats.beams++;
+  ptr->stats.over+=s;
+  ptr->stats.late=t-ptr->span;
+}
+
+
+/* called just before waiting for the scan boundary */
+
+void IntSchedEnd(struct IntSched *ptr,struct IntSchedStats *stats) {
+  if (ptr==NULL) return;
+  ptr->stats.idle=ptr->scan-IntSchedClock(ptr);
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct IntSchedStats));
+}
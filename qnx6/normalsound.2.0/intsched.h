@@ -0,0 +1,43 @@
+/* intsched.h
+   ==========
+*/
+
+
+#ifndef _INTSCHED_H
+#define _INTSCHED_H
+
+#define INTSCHED_MIN 0.5   /* shortest integration, fraction of default */
+#define INTSCHED_MAX 1.5   /* longest integration, fraction of default */
+
+struct IntSchedStats {
+  int beams;
+  double mnintt;     /* shortest integration given this scan [s] */
+  double mxintt;     /* longest integration given this scan [s] */
+  double over;       /* overhead summed over the beams [s] */
+  double late;       /* end of the last beam less the target [s] */
+  double idle;       /* time left to the scan boundary [s] */
+};
+
+struct IntSched {
+  double scan;       /* scan period [s] */
+  double span;       /* part of the scan given to the beams [s] */
+  double intt;       /* default integration time [s] */
+  double over;       /* smoothed overhead per beam [s] */
+  double dev;        /* smoothed deviation of the overhead [s] */
+  double last;
+  double tbeam;
+  double tintt;
+  int wrap;
+  int init;
+  struct IntSchedStats stats;
+};
+
+struct IntSched *IntSchedMake(double scan,double span,double intt);
+void IntSchedFree(struct IntSched *ptr);
+double IntSchedClock(struct IntSched *ptr);
+void IntSchedStart(struct IntSched *ptr);
+void IntSchedNext(struct IntSched *ptr,int left,int *intsc,int *intus);
+void IntSchedBeam(struct IntSched *ptr);
+void IntSchedEnd(struct IntSched *ptr,struct IntSchedStats *stats);
+
+#endif
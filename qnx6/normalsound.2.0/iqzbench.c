@@ -0,0 +1,170 @@
+/* iqzbench.c
+   ==========
+
+   Round trip and throughput harness for the I&Q sample coder. A beam
+   of synthetic samples is made - receiver noise with a few echoes
+   that fade across the integration - and each sequence is coded and
+   decoded again. The decoded samples are checked against the original,
+   exactly if lossless or to within the error bound, and the ratio
+   and rates are printed against a plain copy of the samples, which is
+   what the IQS_TYPE path costs.
+
+   Only needs POSIX, so it can be built on any box:
+
+     cc -O2 -o iqzbench iqzbench.c iqzip.c -lm -lpthread -lrt
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "iqzip.h"
+
+
+static double BenchTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static double BenchGauss(void) {
+  double u,v;
+
+  u=(rand()+1.0)/(RAND_MAX+2.0);
+  v=(rand()+1.0)/(RAND_MAX+2.0);
+  return sqrt(-2*log(u))*cos(2*M_PI*v);
+}
+
+
+static int16_t BenchClip(double x) {
+  if (x>32767) return 32767;
+  if (x<-32768) return -32768;
+  return (int16_t) floor(x+0.5);
+}
+
+
+/* smpnum complex samples for each of two channels */
+
+static void BenchMake(int16_t *buf,int smpnum,int seq,double sdev) {
+  double amp[3]={3000,800,200};
+  double rng[3]={0.2,0.45,0.7};
+  double vel[3]={0.3,-0.8,1.7};
+  double re,im,ph,a;
+  int n,c,e;
+
+  for (c=0;c<2;c++) {
+    for (n=0;n<smpnum;n++) {
+      re=sdev*BenchGauss();
+      im=sdev*BenchGauss();
+      for (e=0;e<3;e++) {
+        a=(n-rng[e]*smpnum)/4.0;
+        a=amp[e]*exp(-a*a);
+        ph=vel[e]*(n+0.05*seq)+c;
+        re+=a*cos(ph);
+        im+=a*sin(ph);
+      }
+      buf[2*(c*smpnum+n)]=BenchClip(re);
+      buf[2*(c*smpnum+n)+1]=BenchClip(im);
+    }
+  }
+}
+
+
+int main(int argc,char *argv[]) {
+  int16_t *in,*out,*cpy;
+  unsigned char *zbuf;
+  size_t *zsze;
+  double size,zsize,tcpy,tenc,tdec,tval;
+  double sdev=20;
+  int nave=60,smpnum=300,err=0,loops=20;
+  int cnt,seq,l,n,c,d,dmax,bad;
+
+  for (c=1;c<argc-1;c+=2) {
+    if (strcmp(argv[c],"-nave")==0) nave=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-smpnum")==0) smpnum=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-err")==0) err=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-sdev")==0) sdev=atof(argv[c+1]);
+    else if (strcmp(argv[c],"-loops")==0) loops=atoi(argv[c+1]);
+  }
+  if ((err<0) || (err>IQZIP_MAXERR)) err=0;
+  if (nave<1) nave=1;
+  if (smpnum<1) smpnum=1;
+  if (loops<1) loops=1;
+
+  cnt=4*smpnum;
+  in=malloc(sizeof(int16_t)*cnt*nave);
+  out=malloc(sizeof(int16_t)*cnt*nave);
+  cpy=malloc(sizeof(int16_t)*cnt*nave);
+  zbuf=malloc(IQZipBound(cnt)*nave);
+  zsze=malloc(sizeof(size_t)*nave);
+  if ((in==NULL) || (out==NULL) || (cpy==NULL) ||
+      (zbuf==NULL) || (zsze==NULL)) {
+    fprintf(stderr,"Out of memory.\n");
+    exit(1);
+  }
+
+  srand(1);
+  for (seq=0;seq<nave;seq++) BenchMake(in+seq*cnt,smpnum,seq,sdev);
+
+  fprintf(stdout,"nave %d  smpnum %d  sdev %g  err %d  loops %d\n",
+          nave,smpnum,sdev,err,loops);
+
+  tcpy=0;
+  tenc=0;
+  tdec=0;
+  zsize=0;
+  for (l=0;l<loops;l++) {
+    tval=BenchTime();
+    memcpy(cpy,in,sizeof(int16_t)*cnt*nave);
+    tcpy+=BenchTime()-tval;
+
+    tval=BenchTime();
+    zsize=0;
+    for (seq=0;seq<nave;seq++) {
+      zsze[seq]=IQZipEncode(in+seq*cnt,cnt,err,
+                            zbuf+seq*IQZipBound(cnt));
+      zsize+=zsze[seq];
+    }
+    tenc+=BenchTime()-tval;
+
+    tval=BenchTime();
+    for (seq=0;seq<nave;seq++) {
+      if (IQZipDecode(zbuf+seq*IQZipBound(cnt),zsze[seq],err,
+                      out+seq*cnt,cnt) !=0) {
+        fprintf(stderr,"Sequence %d failed to decode.\n",seq);
+        exit(1);
+      }
+    }
+    tdec+=BenchTime()-tval;
+  }
+
+  dmax=0;
+  bad=0;
+  for (n=0;n<cnt*nave;n++) {
+    d=abs(out[n]-in[n]);
+    if (d>dmax) dmax=d;
+    if (d>err) bad++;
+  }
+  if (cpy[cnt*nave-1] !=in[cnt*nave-1]) bad++;
+
+  size=sizeof(int16_t)*cnt*nave;
+  fprintf(stdout,"samples %10.0f bytes  coded %10.0f bytes  ratio %6.3f\n",
+          size,zsize,size/zsize);
+  fprintf(stdout,"copy   %8.1f MB/s\n",1e-6*size*loops/tcpy);
+  fprintf(stdout,"encode %8.1f MB/s\n",1e-6*size*loops/tenc);
+  fprintf(stdout,"decode %8.1f MB/s\n",1e-6*size*loops/tdec);
+  fprintf(stdout,"largest error %d  samples out of bound %d\n",dmax,bad);
+
+  free(zsze);
+  free(zbuf);
+  free(cpy);
+  free(out);
+  free(in);
+  return (bad !=0);
+}
@@ -0,0 +1,405 @@
+/* iqzip.c
+   =======
+
+   Compresses the I&Q samples of a beam for the IQZ_TYPE message. The
+   samples of each sequence are 16-bit I and Q values interleaved, so
+   each value is predicted from the one two places before it (the
+   previous sample of the same component) and the difference is Rice
+   coded: the differences are folded to positive numbers and each
+   block of IQZIP_BLOCK of them is sent with the Rice parameter that
+   codes the block in the fewest bits. With err set the differences
+   are quantized in steps of 2*err+1 against the decoded values, so
+   that no sample is more than err from the original.
+
+   The samples are coded from the shared memory segment on a thread of
+   its own: IQZipPost starts it once the sequences are known and
+   IQZipWait collects the message before it is sent, so the coding
+   runs alongside FitACF. The samples must not change in between,
+   which holds as long as the next integration has not started.
+
+   The programs do not send the message until iqwrite can decode it;
+   for now the coder is only run by iqzbench.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "iqzip.h"
+
+
+struct IQZipBits {
+  unsigned char *out;
+  size_t p;
+  uint64_t acc;
+  int nbit;
+};
+
+
+static double IQZipTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static void IQZipPut(struct IQZipBits *b,uint32_t val,int n) {
+  b->acc=(b->acc<<n) | (val & ((((uint64_t) 1)<<n)-1));
+  b->nbit+=n;
+  while (b->nbit>=8) {
+    b->nbit-=8;
+    b->out[b->p++]=(unsigned char) (b->acc>>b->nbit);
+  }
+}
+
+
+static void IQZipFlush(struct IQZipBits *b) {
+  if (b->nbit>0) IQZipPut(b,0,8-b->nbit);
+}
+
+
+static int IQZipGet(struct IQZipBits *b,size_t sze,int n,uint32_t *val) {
+  while (b->nbit<n) {
+    if (b->p>=sze) return -1;
+    b->acc=(b->acc<<8) | b->out[b->p++];
+    b->nbit+=8;
+  }
+  b->nbit-=n;
+  *val=(uint32_t) ((b->acc>>b->nbit) & ((((uint64_t) 1)<<n)-1));
+  return 0;
+}
+
+
+/* the difference between v and its prediction, quantized when err is
+   set; rec is updated to the value the decoder will see */
+
+static uint32_t IQZipFold(int32_t v,int32_t *rec,int err) {
+  int32_t d,q,step;
+
+  d=v-*rec;
+  if (err==0) q=d;
+  else {
+    step=2*err+1;
+    if (d>=0) q=(d+err)/step;
+    else q=-((-d+err)/step);
+    d=q*step;
+  }
+  *rec+=d;
+  return (q>=0) ? ((uint32_t) q)<<1 : (((uint32_t) -q)<<1)-1;
+}
+
+
+static int32_t IQZipUnfold(uint32_t u,int32_t *rec,int err) {
+  int32_t q;
+
+  q=(u & 1) ? -(int32_t) ((u+1)>>1) : (int32_t) (u>>1);
+  *rec+=(err==0) ? q : q*(2*err+1);
+  if (*rec>32767) return 32767;
+  if (*rec<-32768) return -32768;
+  return *rec;
+}
+
+
+/* worst case size of cnt coded values */
+
+size_t IQZipBound(int cnt) {
+  return (size_t) cnt*(IQZIP_ESCAPE+IQZIP_RAW+7)/8+
+         (cnt/IQZIP_BLOCK+1)+8;
+}
+
+
+size_t IQZipEncode(int16_t *in,int cnt,int err,unsigned char *out) {
+  struct IQZipBits b;
+  uint32_t u[IQZIP_BLOCK];
+  int32_t rec[2]={0,0};
+  uint64_t bits,best,sum;
+  int i,j,n,k,k0,k1,bk;
+
+  memset(&b,0,sizeof(struct IQZipBits));
+  b.out=out;
+
+  for (i=0;i<cnt;i+=IQZIP_BLOCK) {
+    n=(cnt-i<IQZIP_BLOCK) ? cnt-i : IQZIP_BLOCK;
+    for (j=0;j<n;j++) u[j]=IQZipFold(in[i+j],&rec[(i+j) & 1],err);
+
+    /* the best parameter is close to log2 of the mean value, so only
+       its neighbours are tried */
+
+    sum=0;
+    for (j=0;j<n;j++) sum+=u[j];
+    sum/=n;
+    for (k0=0;(k0<15) && ((((uint64_t) 2)<<k0)<=sum);k0++);
+    k1=(k0<15) ? k0+1 : 15;
+    k0=(k0>0) ? k0-1 : 0;
+
+    best=0;
+    bk=k0;
+    for (k=k0;k<=k1;k++) {
+      bits=0;
+      for (j=0;j<n;j++) {
+        if ((u[j]>>k)>=IQZIP_ESCAPE) bits+=IQZIP_ESCAPE+IQZIP_RAW;
+        else bits+=(u[j]>>k)+1+k;
+      }
+      if ((k==k0) || (bits<best)) {
+        best=bits;
+        bk=k;
+      }
+    }
+
+    IQZipPut(&b,bk,4);
+    for (j=0;j<n;j++) {
+      if ((u[j]>>bk)>=IQZIP_ESCAPE) {
+        IQZipPut(&b,(1<<IQZIP_ESCAPE)-1,IQZIP_ESCAPE);
+        IQZipPut(&b,u[j],IQZIP_RAW);
+        continue;
+      }
+      IQZipPut(&b,((1<<(u[j]>>bk))-1)<<1,(u[j]>>bk)+1);
+      if (bk>0) IQZipPut(&b,u[j],bk);
+    }
+  }
+  IQZipFlush(&b);
+  return b.p;
+}
+
+
+int IQZipDecode(unsigned char *in,size_t sze,int err,int16_t *out,int cnt) {
+  struct IQZipBits b;
+  int32_t rec[2]={0,0};
+  uint32_t k,q,bit,u;
+  int i,j,n;
+
+  memset(&b,0,sizeof(struct IQZipBits));
+  b.out=in;
+
+  for (i=0;i<cnt;i+=IQZIP_BLOCK) {
+    n=(cnt-i<IQZIP_BLOCK) ? cnt-i : IQZIP_BLOCK;
+    if (IQZipGet(&b,sze,4,&k) !=0) return -1;
+    for (j=0;j<n;j++) {
+      q=0;
+      while (q<IQZIP_ESCAPE) {
+        if (IQZipGet(&b,sze,1,&bit) !=0) return -1;
+        if (bit==0) break;
+        q++;
+      }
+      if (q==IQZIP_ESCAPE) {
+        if (IQZipGet(&b,sze,IQZIP_RAW,&u) !=0) return -1;
+      } else {
+        u=q<<k;
+        if (k>0) {
+          if (IQZipGet(&b,sze,k,&bit) !=0) return -1;
+          u|=bit;
+        }
+      }
+      out[i+j]=IQZipUnfold(u,&rec[(i+j) & 1],err);
+    }
+  }
+  return 0;
+}
+
+
+/* codes the sequences posted into ptr->buf */
+
+static void IQZipRun(struct IQZip *ptr) {
+  struct IQZipHeader *hdr;
+  struct IQZipSeq *seq;
+  unsigned char *tmp;
+  size_t need,p;
+  int n,cnt;
+
+  need=sizeof(struct IQZipHeader)+ptr->seqnum*sizeof(struct IQZipSeq);
+  for (n=0;n<ptr->seqnum;n++) need+=IQZipBound(ptr->size[n]/2);
+  if (need>ptr->bufsze) {
+    tmp=realloc(ptr->buf,need);
+    if (tmp==NULL) {
+      ptr->len=0;
+      return;
+    }
+    ptr->buf=tmp;
+    ptr->bufsze=need;
+  }
+
+  hdr=(struct IQZipHeader *) ptr->buf;
+  seq=(struct IQZipSeq *) (ptr->buf+sizeof(struct IQZipHeader));
+  hdr->magic=IQZIP_MAGIC;
+  hdr->major=IQZIP_MAJOR;
+  hdr->minor=IQZIP_MINOR;
+  hdr->seqnum=ptr->seqnum;
+  hdr->err=ptr->err;
+  hdr->size=0;
+  hdr->zsize=0;
+
+  p=sizeof(struct IQZipHeader)+ptr->seqnum*sizeof(struct IQZipSeq);
+  for (n=0;n<ptr->seqnum;n++) {
+    seq[n].offset=ptr->offset[n];
+    seq[n].size=ptr->size[n];
+    seq[n].zsize=0;
+    if ((ptr->offset[n]<0) || (ptr->size[n]<=0) ||
+        ((size_t) ptr->offset[n]+ptr->size[n]>ptr->shmsze)) continue;
+    cnt=ptr->size[n]/2;
+    seq[n].zsize=IQZipEncode((int16_t *) (ptr->shm+ptr->offset[n]),cnt,
+                             ptr->err,ptr->buf+p);
+    p+=seq[n].zsize;
+    hdr->size+=ptr->size[n];
+    hdr->zsize+=seq[n].zsize;
+  }
+  ptr->len=p;
+}
+
+
+static void *IQZipWorker(void *arg) {
+  struct IQZip *ptr=(struct IQZip *) arg;
+  double tval;
+
+  pthread_mutex_lock(&ptr->mtx);
+  while (1) {
+    while ((ptr->busy==0) && (ptr->quit==0))
+      pthread_cond_wait(&ptr->cnd,&ptr->mtx);
+    if (ptr->busy==0) break;
+    pthread_mutex_unlock(&ptr->mtx);
+
+    tval=IQZipTime();
+    IQZipRun(ptr);
+    tval=IQZipTime()-tval;
+
+    pthread_mutex_lock(&ptr->mtx);
+    ptr->stats.tzip+=tval;
+    ptr->busy=0;
+    pthread_cond_broadcast(&ptr->cnd);
+  }
+  pthread_mutex_unlock(&ptr->mtx);
+  return NULL;
+}
+
+
+/* shmname is the shared memory segment holding the samples and err
+   the largest error allowed in a sample (0 for lossless) */
+
+struct IQZip *IQZipMake(char *shmname,int err) {
+  struct IQZip *ptr;
+  struct stat buf;
+  void *shm;
+  int fd;
+
+  if ((err<0) || (err>IQZIP_MAXERR)) return NULL;
+
+  fd=shm_open(shmname,O_RDONLY,0);
+  if (fd==-1) return NULL;
+  if (fstat(fd,&buf) !=0) {
+    close(fd);
+    return NULL;
+  }
+  shm=mmap(NULL,buf.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (shm==MAP_FAILED) return NULL;
+
+  ptr=malloc(sizeof(struct IQZip));
+  if (ptr==NULL) {
+    munmap(shm,buf.st_size);
+    return NULL;
+  }
+  memset(ptr,0,sizeof(struct IQZip));
+  ptr->shm=shm;
+  ptr->shmsze=buf.st_size;
+  ptr->err=err;
+
+  pthread_mutex_init(&ptr->mtx,NULL);
+  pthread_cond_init(&ptr->cnd,NULL);
+  if (pthread_create(&ptr->thr,NULL,IQZipWorker,ptr) !=0) {
+    pthread_cond_destroy(&ptr->cnd);
+    pthread_mutex_destroy(&ptr->mtx);
+    munmap(ptr->shm,ptr->shmsze);
+    free(ptr);
+    return NULL;
+  }
+  ptr->run=1;
+  return ptr;
+}
+
+
+void IQZipFree(struct IQZip *ptr) {
+  if (ptr==NULL) return;
+  if (ptr->run) {
+    pthread_mutex_lock(&ptr->mtx);
+    ptr->quit=1;
+    pthread_cond_broadcast(&ptr->cnd);
+    pthread_mutex_unlock(&ptr->mtx);
+    pthread_join(ptr->thr,NULL);
+    pthread_cond_destroy(&ptr->cnd);
+    pthread_mutex_destroy(&ptr->mtx);
+  }
+  munmap(ptr->shm,ptr->shmsze);
+  if (ptr->offset !=NULL) free(ptr->offset);
+  if (ptr->size !=NULL) free(ptr->size);
+  if (ptr->buf !=NULL) free(ptr->buf);
+  free(ptr);
+}
+
+
+/* starts coding the samples of seqnum sequences, given by their offset
+   and size in the shared memory; pair with IQZipWait */
+
+int IQZipPost(struct IQZip *ptr,int seqnum,int *offset,int *size) {
+  int *tmp;
+
+  ptr->len=0;
+  if ((offset==NULL) || (size==NULL)) seqnum=0;
+  if (seqnum>ptr->mxseq) {
+    tmp=realloc(ptr->offset,sizeof(int)*seqnum);
+    if (tmp==NULL) return -1;
+    ptr->offset=tmp;
+    tmp=realloc(ptr->size,sizeof(int)*seqnum);
+    if (tmp==NULL) return -1;
+    ptr->size=tmp;
+    ptr->mxseq=seqnum;
+  }
+  if (seqnum>0) {
+    memcpy(ptr->offset,offset,sizeof(int)*seqnum);
+    memcpy(ptr->size,size,sizeof(int)*seqnum);
+  }
+
+  pthread_mutex_lock(&ptr->mtx);
+  ptr->seqnum=seqnum;
+  ptr->busy=1;
+  pthread_cond_broadcast(&ptr->cnd);
+  pthread_mutex_unlock(&ptr->mtx);
+  return 0;
+}
+
+
+/* returns the IQZ_TYPE message, or NULL if it could not be made */
+
+unsigned char *IQZipWait(struct IQZip *ptr,size_t *size) {
+  struct IQZipHeader *hdr;
+  double tval;
+
+  tval=IQZipTime();
+  pthread_mutex_lock(&ptr->mtx);
+  while (ptr->busy) pthread_cond_wait(&ptr->cnd,&ptr->mtx);
+  pthread_mutex_unlock(&ptr->mtx);
+  ptr->stats.wait+=IQZipTime()-tval;
+
+  *size=ptr->len;
+  if (ptr->len==0) return NULL;
+  hdr=(struct IQZipHeader *) ptr->buf;
+  ptr->stats.beams++;
+  ptr->stats.size+=hdr->size;
+  ptr->stats.zsize+=ptr->len;
+  return ptr->buf;
+}
+
+
+/* copies out and resets the accumulated counters */
+
+void IQZipStatsGet(struct IQZip *ptr,struct IQZipStats *stats) {
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct IQZipStats));
+  memset(&ptr->stats,0,sizeof(struct IQZipStats));
+}
@@ -0,0 +1,79 @@
+/* iqzip.h
+   =======
+*/
+
+
+#ifndef _IQZIP_H
+#define _IQZIP_H
+
+#ifndef IQZ_TYPE
+#define IQZ_TYPE 33
+#endif
+
+#define IQZIP_MAGIC 0x5a4f5149
+#define IQZIP_MAJOR 1
+#define IQZIP_MINOR 0
+
+#define IQZIP_BLOCK 32      /* values coded with the same Rice parameter */
+#define IQZIP_ESCAPE 24     /* quotients this large are sent in full */
+#define IQZIP_RAW 18        /* bits in a value sent in full */
+#define IQZIP_MAXERR 255
+
+/* the IQZ_TYPE message is the header, one IQZipSeq for each sequence
+   and then the coded samples of each sequence in turn */
+
+struct IQZipHeader {
+  int32_t magic;
+  int16_t major;
+  int16_t minor;
+  int32_t seqnum;
+  int32_t err;         /* largest error allowed in a sample, 0 if lossless */
+  int32_t size;        /* bytes of samples before coding */
+  int32_t zsize;       /* bytes of coded samples */
+};
+
+struct IQZipSeq {
+  int32_t offset;      /* offset of the samples in the shared memory */
+  int32_t size;        /* bytes of samples before coding */
+  int32_t zsize;       /* bytes of coded samples */
+};
+
+struct IQZipStats {
+  int beams;
+  double size;       /* bytes of samples */
+  double zsize;      /* bytes sent */
+  double tzip;       /* seconds spent coding on the worker */
+  double wait;       /* seconds the beam loop waited for the worker */
+};
+
+struct IQZip {
+  pthread_t thr;
+  pthread_mutex_t mtx;
+  pthread_cond_t cnd;
+  int run;
+  int busy;
+  int quit;
+  int err;
+  unsigned char *shm;
+  size_t shmsze;
+  int seqnum;
+  int *offset;
+  int *size;
+  int mxseq;
+  unsigned char *buf;
+  size_t bufsze;
+  size_t len;
+  struct IQZipStats stats;
+};
+
+size_t IQZipBound(int cnt);
+size_t IQZipEncode(int16_t *in,int cnt,int err,unsigned char *out);
+int IQZipDecode(unsigned char *in,size_t sze,int err,int16_t *out,int cnt);
+
+struct IQZip *IQZipMake(char *shmname,int err);
+void IQZipFree(struct IQZip *ptr);
+int IQZipPost(struct IQZip *ptr,int seqnum,int *offset,int *size);
+unsigned char *IQZipWait(struct IQZip *ptr,size_t *size);
+void IQZipStatsGet(struct IQZip *ptr,struct IQZipStats *stats);
+
+#endif
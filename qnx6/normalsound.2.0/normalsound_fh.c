@@ -10,6 +10,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <string.h>
 #include <time.h>
@@ -40,17 +42,34 @@
 #include "sync.h"
 #include "site.h"
 #include "sitebuild.h"
+#include "site.sim.h"
 #include "siteglobal.h"
 #include "rosmsg.h"
 #include "tsg.h"
 
 #include "sndwrite.h"
+#include "sndmap.h"
+#include "sndbatch.h"
+#include "shmring.h"
+#include "shmsnd.h"
+#include "msgarena.h"
+#include "scantime.h"
+#include "intsched.h"
+#include "fitpipe.h"
+#include "asyncsnd.h"
+#include "fclrcache.h"
+#include "sndscore.h"
+#include "bndwait.h"
+#include "sndbudget.h"
 
 #define MAX_SND_FREQS 12
 
 void write_snd_record(char *progname, struct RadarParm *prm,
                       struct FitData *fit);
 
+/* the sounding file stays open and mapped between records */
+struct SndMap *sndmap=NULL;
+
 #define RT_TASK 3
 
 
@@ -79,6 +98,14 @@ struct TCPIPMsgHost task[4]={
   {"127.0.0.1",4,-1}  /* rtserver */
 };
 
+/* what each task loses when its queue is full under -async */
+int task_policy[4]={
+  ASYNCSND_NEVER,    /* iqwrite */
+  ASYNCSND_NEVER,    /* rawacfwrite */
+  ASYNCSND_NEVER,    /* fitacfwrite */
+  ASYNCSND_OLDEST    /* rtserver */
+};
+
 char *roshost=NULL;	
 char *droshost={"127.0.0.1"};
 
@@ -139,6 +166,55 @@ int main(int argc,char *argv[])
   int def_nrang=0;
   int debug=0;
 
+  unsigned char pipeline=0;
+  struct FitPipe *fitpipe=NULL;
+  struct FitPipeSlot *fslot=NULL;
+  struct FitPipeStats fstats;
+
+  unsigned char shmem=0;
+  int shmsze=4;
+  char shmname[64];
+  char *shmtask=NULL;
+  struct ShmSnd *shmsnd=NULL;
+  struct ShmSndStats sstats;
+
+  unsigned char async=0;
+  struct AsyncSnd *asnd=NULL;
+  struct AsyncSndStats qstats;
+
+  int fclrage=0;
+  struct FclrCache *fcache=NULL;
+  struct FclrCacheStats cstats;
+
+  unsigned char sndsel=0;
+  struct SndScore *sscore=NULL;
+  struct SndScoreRank srank;
+  unsigned char bndwait=0;
+  struct BndWait *bwait=NULL;
+  struct BndWaitStats wstats;
+  double bnd_time;
+  int sel_frq=0,last_frq=0;
+  int fclr_rng;
+
+  struct MsgArena *arena=NULL;
+  struct MsgArenaStats astats;
+
+  unsigned char timing=0;
+  struct ScanTime *stime=NULL;
+  struct ScanTimeStats tstats;
+  char *tim_dir=NULL;
+  char tim_path[1024];
+  double tprobe;
+  int p;
+
+  unsigned char adapt=0;
+  struct IntSched *isched=NULL;
+  struct IntSchedStats istats;
+
+  unsigned char sndbatch=0;
+  struct SndBatch *sbatch=NULL;
+  struct SndBatchStats bstats;
+
   unsigned char hlp=0;
 
   if (debug) {
@@ -177,6 +253,10 @@ int main(int argc,char *argv[])
   int snd_intt_sc=1;
   int snd_intt_us=500000;
   float snd_time, snd_intt, time_needed=1.25;
+  float snd_q=0;
+  struct SndBudget *sbudget=NULL;
+  struct SndBudgetStats sbstats;
+
 
   char *snd_dir;
   char data_path[100];
@@ -222,6 +302,18 @@ int main(int argc,char *argv[])
   OptionAdd(&opt, "frqrng", 'i', &frqrng);     /* fix the FCLR window [kHz] */
   OptionAdd(&opt, "sfrqrng",'i', &snd_frqrng); /* sounding FCLR window [kHz] */
   OptionAdd(&opt, "sndsc",  'i', &snd_sc);     /* sounding duration per scan [sec] */
+  OptionAdd(&opt, "pipe",   'x', &pipeline);   /* fit and send on a worker thread */
+  OptionAdd(&opt, "shm",    'x', &shmem);      /* send to local tasks through shared memory */
+  OptionAdd(&opt, "async",  'x', &async);      /* queue the sends for each task on its own thread */
+  OptionAdd(&opt, "shmsze", 'i', &shmsze);     /* shared memory ring size [MB] */
+  OptionAdd(&opt, "shmtask",'t', &shmtask);    /* tasks that read SHM_TYPE references, e.g. 0,1 */
+  OptionAdd(&opt, "timing", 'x', &timing);     /* time the calls in the beam loop */
+  OptionAdd(&opt, "adapt",  'x', &adapt);      /* fit the integrations to the scan */
+  OptionAdd(&opt, "sndbatch",'x', &sndbatch);  /* write each sounding sweep as one block */
+  OptionAdd(&opt, "fclrage",'i', &fclrage);    /* reuse FCLR results up to this old [sec] */
+  OptionAdd(&opt, "sndsel", 'x', &sndsel);     /* run on the frequency the soundings rank best */
+  OptionAdd(&opt, "bndwait",'x', &bndwait);    /* sleep to just before the scan boundary first */
+  OptionAdd(&opt, "sndq",   'f', &snd_q);      /* learn time_needed for this quantile of the overhead */
   OptionAdd(&opt, "-help",  'x', &hlp);        /* just dump some parameters */
 
   /* process the commandline; need this for setting errlog port */
@@ -291,7 +383,9 @@ int main(int argc,char *argv[])
 
   OpsStart(ststr);
 
-  status=SiteBuild(ststr,NULL); /* second argument is version string */
+  /* the simulated radar of site.sim stands in for a station */
+  if (strcmp(ststr,"sim")==0) status=SiteSimBuild();
+  else status=SiteBuild(ststr,NULL); /* second argument is version string */
   if (status==-1) {
     fprintf(stderr,"Could not identify station.\n");
     exit(1);
@@ -363,6 +457,82 @@ int main(int argc,char *argv[])
   printf("Preparing OpsFitACFStart Station ID: %s  %d\n",ststr,stid);
   OpsFitACFStart();
 
+  arena=MsgArenaMake(MsgArenaSize(nrang,mplgs,
+                     (intsc*1000000+intus)/(mpinc*ptab[mppul-1])+1));
+  if (arena==NULL) {
+    ErrLog(errlog.sock,progname,"Unable to allocate message arena.");
+    exit(1);
+  }
+
+  if (adapt) {
+    isched=IntSchedMake(scnsc+scnus*1e-6,total_scan_usecs*1e-6,
+                        def_intt_sc+def_intt_us*1e-6);
+    if (isched==NULL)
+      ErrLog(errlog.sock,progname,"Unable to start integration scheduler.");
+  }
+
+  if (fclrage>0) {
+    fcache=FclrCacheMake(fclrage);
+    if (fcache==NULL)
+      ErrLog(errlog.sock,progname,"Unable to allocate FCLR cache.");
+  }
+
+  if (sndsel) {
+    sscore=SndScoreMake(snd_freqs_tot,snd_freqs,SNDSCORE_MAXAGE);
+    if (sscore==NULL)
+      ErrLog(errlog.sock,progname,"Unable to allocate sounding scoreboard.");
+  }
+
+  if (bndwait) {
+    bwait=BndWaitMake();
+    if (bwait==NULL)
+      ErrLog(errlog.sock,progname,"Unable to allocate boundary timer.");
+  }
+
+  if (snd_q>0) {
+    sbudget=SndBudgetMake(time_needed,snd_q);
+    if (sbudget==NULL)
+      ErrLog(errlog.sock,progname,"Invalid sounding quantile; using a fixed time_needed.");
+  }
+
+  if (sndbatch) {
+    sbatch=SndBatchMake(data_path,ststr);
+    if (sbatch==NULL)
+      ErrLog(errlog.sock,progname,"Unable to allocate sounding batch.");
+  }
+
+  if (timing) {
+    stime=ScanTimeMake();
+    if (stime==NULL)
+      ErrLog(errlog.sock,progname,"Unable to allocate timing probes.");
+    tim_dir=getenv("SD_TIM_PATH");
+    if (tim_dir==NULL) sprintf(tim_path,"/data/ros/tim");
+    else sprintf(tim_path,"%s",tim_dir);
+  }
+
+  if (shmem) {
+    sprintf(shmname,"/rmsg.%s",ststr);
+    shmsnd=ShmSndMake(shmname,shmsze*1024*1024,tnum,task,shmtask);
+    if (shmsnd==NULL)
+      ErrLog(errlog.sock,progname,
+        "No local task listed with -shmtask; sending over TCP.");
+  }
+
+  if ((async) && (shmsnd !=NULL))
+    ErrLog(errlog.sock,progname,"Ignoring -async with -shm.");
+  else if (async) {
+    asnd=AsyncSndMake(tnum,task,task_policy,command);
+    if (asnd==NULL)
+      ErrLog(errlog.sock,progname,"Unable to start send queues.");
+  }
+
+  if (pipeline) {
+    fitpipe=FitPipeMake(tnum,task,shmsnd,asnd,arena,stime,progname,
+                        sharedmemory);
+    if (fitpipe==NULL)
+      ErrLog(errlog.sock,progname,"Unable to start fit pipeline.");
+  }
+
   printf("Entering Scan loop Station ID: %s  %d\n",ststr,stid);
   do {
 
@@ -374,7 +544,8 @@ int main(int argc,char *argv[])
 
     if (OpsReOpen(2,0,0) !=0) {
       ErrLog(errlog.sock,progname,"Opening new files.");
-      for (n=0;n<tnum;n++) {
+      if (asnd !=NULL) AsyncSndReopen(asnd);
+      else for (n=0;n<tnum;n++) {
         RMsgSndClose(task[n].sock);
         RMsgSndOpen(task[n].sock,strlen( (char *) command),command);
       }
@@ -383,6 +554,24 @@ int main(int argc,char *argv[])
     scan = 1;   /* scan flagg */
 
     ErrLog(errlog.sock,progname,"Starting scan.");
+
+    if (sscore !=NULL) {
+      sel_frq=SndScoreSelect(sscore);
+      sprintf(logtxt,"Sounding scoreboard [ranges/beam, dB]:");
+      for (n=0;n<snd_freqs_tot;n++) {
+        if (SndScoreRank(sscore,snd_freqs[n],&srank) !=0) continue;
+        sprintf(logtxt+strlen(logtxt)," %d:%.1f/%.1f",srank.freq,
+                srank.ngood,srank.pwr);
+      }
+      ErrLog(errlog.sock,progname,logtxt);
+      if (sel_frq !=last_frq) {
+        sprintf(logtxt,"Sounding selected frequency: %d",sel_frq);
+        ErrLog(errlog.sock,progname,logtxt);
+        last_frq=sel_frq;
+      }
+    }
+    ScanTimeStart(stime);
+    IntSchedStart(isched);
     if (xcnt>0) {
       cnt++;
       if (cnt==xcnt) {
@@ -414,6 +603,20 @@ int main(int argc,char *argv[])
         mpinc=nmpinc;
         frang=nfrang;
       }
+      fclr_rng=frqrng;
+
+      if (sel_frq>0) {
+        /* search the band the soundings found best; frqrng is left
+           alone for when the selection lapses */
+        stfrq=sel_frq;
+        fclr_rng=snd_frqrng;
+      }
+
+      if (isched !=NULL) {
+        /* shorten or stretch this beam so that the last one ends on time */
+        if (backward) IntSchedNext(isched,bmnum-ebm+1,&intsc,&intus);
+        else IntSchedNext(isched,ebm-bmnum+1,&intsc,&intus);
+      }
 
       sprintf(logtxt,"Integrating beam:%d intt:%ds.%dus (%d:%d:%d:%d)",
                      bmnum,intsc,intus,hr,mt,sc,us);
@@ -421,20 +624,27 @@ int main(int argc,char *argv[])
 
       ErrLog(errlog.sock,progname,"Starting Integration.");
       printf("Entering Site Start Intt Station ID: %s  %d\n",ststr,stid);
+      tprobe=ScanTimeNow();
       SiteStartIntt(intsc,intus);
+      ScanTimeAdd(stime,ST_INTT,bmnum,tprobe);
 
       /* clear frequency search business */
       ErrLog(errlog.sock,progname,"Doing clear frequency search.");
-      sprintf(logtxt, "FRQ: %d %d", stfrq, frqrng);
+      sprintf(logtxt, "FRQ: %d %d", stfrq, fclr_rng);
       ErrLog(errlog.sock,progname, logtxt);
-      tfreq=SiteFCLR(stfrq,stfrq+frqrng);
+      tprobe=ScanTimeNow();
+      if (fcache !=NULL) tfreq=FclrCacheFCLR(fcache,bmnum,stfrq,stfrq+fclr_rng);
+      else tfreq=SiteFCLR(stfrq,stfrq+fclr_rng);
+      ScanTimeAdd(stime,ST_FCLR,bmnum,tprobe);
 
       if ( (fixfrq > 8000) && (fixfrq < 25000) ) tfreq = fixfrq;
 
       sprintf(logtxt,"Transmitting on: %d (Noise=%g)",tfreq,noise);
       ErrLog(errlog.sock,progname,logtxt);
 
+      tprobe=ScanTimeNow();
       nave=SiteIntegrate(lags);
+      ScanTimeAdd(stime,ST_INTEGRATE,bmnum,tprobe);
       if (nave < 0) {
         sprintf(logtxt,"Integration error:%d",nave);
         ErrLog(errlog.sock,progname,logtxt);
@@ -443,46 +653,79 @@ int main(int argc,char *argv[])
       sprintf(logtxt,"Number of sequences: %d",nave);
       ErrLog(errlog.sock,progname,logtxt);
 
-      OpsBuildPrm(prm,ptab,lags);
-      OpsBuildIQ(iq,&badtr);
-      OpsBuildRaw(raw);
-
-      FitACF(prm,raw,fblk,fit);
-
-      msg.num=0;
-      msg.tsize=0;
-
-      tmpbuf=RadarParmFlatten(prm,&tmpsze);
-      RMsgSndAdd(&msg,tmpsze,tmpbuf, PRM_TYPE,0);
-
-      tmpbuf=IQFlatten(iq,prm->nave,&tmpsze);
-      RMsgSndAdd(&msg,tmpsze,tmpbuf,IQ_TYPE,0);
-
-      RMsgSndAdd(&msg,sizeof(unsigned int)*2*iq->tbadtr,
-                 (unsigned char *) badtr,BADTR_TYPE,0);
-
-      RMsgSndAdd(&msg,strlen(sharedmemory)+1,(unsigned char *)sharedmemory,
-                 IQS_TYPE,0);
-
-      tmpbuf=RawFlatten(raw,prm->nrang,prm->mplgs,&tmpsze);
-      RMsgSndAdd(&msg,tmpsze,tmpbuf,RAW_TYPE,0);
-
-      tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
-      RMsgSndAdd(&msg,tmpsze,tmpbuf,FIT_TYPE,0);
-
-      RMsgSndAdd(&msg,strlen(progname)+1,(unsigned char *)progname,
-                 NME_TYPE,0);
-
-      for (n=0;n<tnum;n++) RMsgSndSend(task[n].sock,&msg);
-
-      for (n=0; n<msg.num; n++) {
-        if ( (msg.data[n].type == PRM_TYPE) ||
-             (msg.data[n].type == IQ_TYPE)  ||
-             (msg.data[n].type == RAW_TYPE) ||
-             (msg.data[n].type == FIT_TYPE) )  free(msg.ptr[n]);
+      if (fitpipe !=NULL) {
+        /* hand the fit and the send to the worker thread so that the
+           next integration can start straight away */
+        tprobe=ScanTimeNow();
+        fslot=FitPipeNext(fitpipe);
+        OpsBuildPrm(fslot->prm,ptab,lags);
+        OpsBuildIQ(fslot->iq,&badtr);
+        OpsBuildRaw(fslot->raw);
+        if (fcache !=NULL)
+          FclrCacheNoise(fcache,bmnum,tfreq,fslot->raw->pwr0,
+                         fslot->prm->nrang);
+        FitPipeSaveBadTR(fslot,badtr);
+        if (FitPipeSaveIQ(fitpipe,fslot) !=0)
+          ErrLog(errlog.sock,progname,"I&Q samples outside the buffer.");
+        ScanTimeAdd(stime,ST_BUILD,bmnum,tprobe);
+
+        if (FitPipeSubmit(fitpipe) !=0)
+          ErrLog(errlog.sock,progname,"Fit pipeline overran integration.");
+      } else {
+        tprobe=ScanTimeNow();
+        OpsBuildPrm(prm,ptab,lags);
+        OpsBuildIQ(iq,&badtr);
+        OpsBuildRaw(raw);
+        if (fcache !=NULL)
+          FclrCacheNoise(fcache,bmnum,tfreq,raw->pwr0,prm->nrang);
+        ScanTimeAdd(stime,ST_BUILD,bmnum,tprobe);
+
+        tprobe=ScanTimeNow();
+        FitACF(prm,raw,fblk,fit);
+        ScanTimeAdd(stime,ST_FIT,bmnum,tprobe);
+
+        tprobe=ScanTimeNow();
+        msg.num=0;
+        msg.tsize=0;
+
+        tmpbuf=MsgArenaPrmFlatten(arena,prm,&tmpsze);
+        if (tmpbuf==NULL) tmpbuf=RadarParmFlatten(prm,&tmpsze);
+        RMsgSndAdd(&msg,tmpsze,tmpbuf, PRM_TYPE,0);
+
+        tmpbuf=MsgArenaIQFlatten(arena,iq,prm->nave,&tmpsze);
+        if (tmpbuf==NULL) tmpbuf=IQFlatten(iq,prm->nave,&tmpsze);
+        RMsgSndAdd(&msg,tmpsze,tmpbuf,IQ_TYPE,0);
+
+        RMsgSndAdd(&msg,sizeof(unsigned int)*2*iq->tbadtr,
+                   (unsigned char *) badtr,BADTR_TYPE,0);
+
+        RMsgSndAdd(&msg,strlen(sharedmemory)+1,(unsigned char *)sharedmemory,
+                   IQS_TYPE,0);
+
+        tmpbuf=MsgArenaRawFlatten(arena,raw,prm->nrang,prm->mplgs,&tmpsze);
+        if (tmpbuf==NULL) tmpbuf=RawFlatten(raw,prm->nrang,prm->mplgs,&tmpsze);
+        RMsgSndAdd(&msg,tmpsze,tmpbuf,RAW_TYPE,0);
+
+        tmpbuf=MsgArenaFitFlatten(arena,fit,prm->nrang,&tmpsze);
+        if (tmpbuf==NULL) tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
+        RMsgSndAdd(&msg,tmpsze,tmpbuf,FIT_TYPE,0);
+
+        RMsgSndAdd(&msg,strlen(progname)+1,(unsigned char *)progname,
+                   NME_TYPE,0);
+
+        if (shmsnd !=NULL) ShmSndSend(shmsnd,&msg);
+        else if (asnd !=NULL) AsyncSndSend(asnd,-1,&msg);
+        else for (n=0;n<tnum;n++) RMsgSndSend(task[n].sock,&msg);
+
+        MsgArenaFreeBlock(arena,&msg);
+        MsgArenaReset(arena);
+        ScanTimeAdd(stime,ST_SEND,bmnum,tprobe);
       }
 
+      tprobe=ScanTimeNow();
       RadarShell(shell.sock,&rstable);
+      ScanTimeAdd(stime,ST_SHELL,bmnum,tprobe);
+      IntSchedBeam(isched);
 
       scan = 0;
       if (bmnum == ebm) break;
@@ -492,6 +735,61 @@ int main(int argc,char *argv[])
 
     } while (1);
 
+    if (fitpipe !=NULL) {
+      FitPipeDrain(fitpipe);
+      FitPipeStatsGet(fitpipe,&fstats);
+      sprintf(logtxt,"Fit pipeline: %d beams, fit+send %.3fs, "
+                     "blocked %.3fs, dwell recovered %.3fs",
+                     fstats.beams,fstats.tail,fstats.wait,
+                     fstats.tail-fstats.wait);
+      ErrLog(errlog.sock,progname,logtxt);
+    }
+
+    if ((shmsnd !=NULL) && (shmsnd->stats.beams>0)) {
+      ShmSndStatsGet(shmsnd,&sstats);
+      sprintf(logtxt,"Shared memory send: %d beams, %d over TCP, "
+                     "%d tasks dropped, %.0f bytes/beam, %.2fms/beam",
+                     sstats.beams,sstats.fallback,sstats.dropped,
+                     sstats.copied/sstats.beams,
+                     1e3*sstats.tsend/sstats.beams);
+      ErrLog(errlog.sock,progname,logtxt);
+    }
+
+    if (fcache !=NULL) {
+      FclrCacheStatsGet(fcache,&cstats);
+      sprintf(logtxt,"FCLR cache: %d hits, %d stale, %d searches",
+              cstats.hits,cstats.stale,cstats.searches);
+      if (cstats.searches>0)
+        sprintf(logtxt+strlen(logtxt)," (%.0fms/search)",
+                1e3*cstats.tsearch/cstats.searches);
+      ErrLog(errlog.sock,progname,logtxt);
+    }
+
+    if (asnd !=NULL) {
+      sprintf(logtxt,"Send queues sent/dropped/blocked(ms)/noiq/peak:");
+      for (n=0;n<tnum;n++) {
+        AsyncSndStatsGet(asnd,n,&qstats);
+        sprintf(logtxt+strlen(logtxt)," %d/%d/%d(%.0f)/%d/%d",qstats.sent,
+                qstats.dropped,qstats.blocked,1e3*qstats.tblock,
+                qstats.noiq,qstats.peak);
+      }
+      ErrLog(errlog.sock,progname,logtxt);
+    }
+
+    if (stime !=NULL) {
+      ScanTimeEnd(stime,&tstats);
+      sprintf(logtxt,"Scan timing p50/p99 [ms]:");
+      for (p=0;p<ST_NPHASE;p++) {
+        if (tstats.num[p]==0) continue;
+        sprintf(logtxt+strlen(logtxt)," %s %.1f/%.1f",scantime_phase[p],
+                1e3*tstats.p50[p],1e3*tstats.p99[p]);
+      }
+      if (stime->lost>0)
+        sprintf(logtxt+strlen(logtxt)," (%u probes lost)",stime->lost);
+      ErrLog(errlog.sock,progname,logtxt);
+      ScanTimeWrite(stime,tim_path,ststr,stid,1);
+    }
+
 
     /* In here comes the sounder code */
     /* set the "sounder mode" scan variable */
@@ -512,8 +810,13 @@ int main(int argc,char *argv[])
     /* minus a safety factor given in time_needed */
     TimeReadClock(&yr,&mo,&dy,&hr,&mt,&sc,&us);
     snd_time = 60.0 - (sc + us*1e-6);
+    if (sbudget != NULL) {
+      SndBudgetStart(sbudget, snd_time);
+      time_needed = SndBudgetNeed(sbudget);
+    }
 
     while (snd_time-snd_intt > time_needed) {
+      if (sbudget != NULL) SndBudgetBegin(sbudget);
 
       /* set the beam */
       bmnum = snd_bms[snd_bm_cnt] + odd_beams;
@@ -530,7 +833,9 @@ int main(int argc,char *argv[])
       ErrLog(errlog.sock, progname, "Doing SND clear frequency search.");
       sprintf(logtxt, "FRQ: %d %d", snd_freq, snd_frqrng);
       ErrLog(errlog.sock,progname, logtxt);
-      tfreq = SiteFCLR(snd_freq, snd_freq + snd_frqrng);
+      if (fcache != NULL)
+        tfreq = FclrCacheFCLR(fcache, bmnum, snd_freq, snd_freq + snd_frqrng);
+      else tfreq = SiteFCLR(snd_freq, snd_freq + snd_frqrng);
 
       sprintf(logtxt,"Transmitting SND on: %d (Noise=%g)",tfreq,noise);
       ErrLog(errlog.sock, progname, logtxt);
@@ -547,25 +852,27 @@ int main(int argc,char *argv[])
       OpsBuildPrm(prm,ptab,lags);
       OpsBuildIQ(iq,&badtr);
       OpsBuildRaw(raw);
+      if (fcache !=NULL)
+        FclrCacheNoise(fcache,bmnum,tfreq,raw->pwr0,prm->nrang);
       FitACF(prm,raw,fblk,fit);
+      if (sscore != NULL) SndScoreAdd(sscore, snd_freq, prm, fit);
 
       ErrLog(errlog.sock, progname, "Sending SND messages.");
       msg.num = 0;
       msg.tsize = 0;
 
-      tmpbuf=RadarParmFlatten(prm,&tmpsze);
+      tmpbuf=MsgArenaPrmFlatten(arena,prm,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=RadarParmFlatten(prm,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,PRM_TYPE,0);
 
-      tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
+      tmpbuf=MsgArenaFitFlatten(arena,fit,prm->nrang,&tmpsze);
+      if (tmpbuf==NULL) tmpbuf=FitFlatten(fit,prm->nrang,&tmpsze);
       RMsgSndAdd(&msg,tmpsze,tmpbuf,FIT_TYPE,0);
 
-      RMsgSndSend(task[RT_TASK].sock,&msg);
-      for (n=0;n<msg.num;n++) {
-        if (msg.data[n].type==PRM_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==IQ_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==RAW_TYPE) free(msg.ptr[n]);
-        if (msg.data[n].type==FIT_TYPE) free(msg.ptr[n]);
-      }
+      if (asnd !=NULL) AsyncSndSend(asnd,RT_TASK,&msg);
+      else RMsgSndSend(task[RT_TASK].sock,&msg);
+      MsgArenaFreeBlock(arena,&msg);
+      MsgArenaReset(arena);
 
       sprintf(logtxt, "SBC: %d  SFC: %d", snd_bm_cnt, snd_freq_cnt);
       ErrLog(errlog.sock, progname, logtxt);
@@ -577,8 +884,15 @@ int main(int argc,char *argv[])
         prm->scan = 0;
       }
 
-      /* save the sounding mode data */
-      write_snd_record(progname, prm, fit);
+      /* save the sounding mode data; with -sndbatch it goes in the
+         block for the sweep, and only to the .snd file if it cannot */
+      if (sbatch != NULL) {
+        if (SndBatchAdd(sbatch, prm, fit) != 0) {
+          ErrLog(errlog.sock, progname, "Sounding record left out of block.");
+          write_snd_record(progname, prm, fit);
+        }
+      } else write_snd_record(progname, prm, fit);
+      if (sbudget != NULL) SndBudgetEnd(sbudget, snd_intt);
 
       ErrLog(errlog.sock, progname, "Polling SND for exit.\n");
 
@@ -591,12 +905,43 @@ int main(int argc,char *argv[])
         if (snd_bm_cnt >= snd_bms_tot) {
           snd_bm_cnt = 0;
           odd_beams = !odd_beams;
+          if (sbatch != NULL) {
+            /* the sweep is complete */
+            if (SndBatchFlush(sbatch) != 0)
+              ErrLog(errlog.sock, progname, "Error writing sounding block.");
+            SndBatchStatsGet(sbatch, &bstats);
+            if (bstats.recs > 0) {
+              sprintf(logtxt, "Sounding block: %d records, %.0f bytes and "
+                              "%.3fms per record", bstats.recs,
+                              bstats.bytes/bstats.recs,
+                              1e3*bstats.twrite/bstats.recs);
+              ErrLog(errlog.sock, progname, logtxt);
+            }
+            if (bstats.lost > 0) {
+              sprintf(logtxt, "Sounding block: %d records lost", bstats.lost);
+              ErrLog(errlog.sock, progname, logtxt);
+            }
+          }
         }
       }
 
       /* see if we have enough time for another go round */
       TimeReadClock(&yr, &mo, &dy, &hr, &mt, &sc, &us);
       snd_time = 60.0 - (sc + us*1e-6);
+      if (sbudget != NULL) time_needed = SndBudgetNeed(sbudget);
+    }
+
+    if (sbudget != NULL) {
+      SndBudgetDone(sbudget, &sbstats);
+      sprintf(logtxt, "Sounding budget: %d soundings, overhead %.3f+/-%.3fs, "
+                      "allowing %.3fs, ", sbstats.num, sbstats.mean,
+                      sbstats.sdev, sbstats.need);
+      if (sbstats.slack < 0)
+        sprintf(logtxt+strlen(logtxt), "overran minute by %.3fs", -sbstats.slack);
+      else sprintf(logtxt+strlen(logtxt), "%.3fs slack", sbstats.slack);
+      sprintf(logtxt+strlen(logtxt), " (%d of %d minutes overran)",
+              sbstats.overrun, sbstats.minutes);
+      ErrLog(errlog.sock, progname, logtxt);
     }
 
     /* now wait for the next normalscan */
@@ -606,10 +951,57 @@ int main(int argc,char *argv[])
     intus = def_intt_us;
     nrang = def_nrang;
 
-    SiteEndScan(scnsc,scnus);
+    MsgArenaStatsGet(arena,&astats);
+    sprintf(logtxt,"Message arena: %d allocations, peak %lu bytes, "
+                   "capacity %lu bytes",astats.nalloc,
+                   (unsigned long) astats.peak,(unsigned long) astats.sze);
+    ErrLog(errlog.sock,progname,logtxt);
+
+    if (isched !=NULL) {
+      IntSchedEnd(isched,&istats);
+      sprintf(logtxt,"Integration schedule: %d beams, intt %.3f-%.3fs, "
+                     "overhead %.0fms/beam, beams ended %+.3fs from target, ",
+                     istats.beams,istats.mnintt,istats.mxintt,
+                     (istats.beams>0) ? 1e3*istats.over/istats.beams : 0.0,
+                     istats.late);
+      if (istats.idle<0)
+        sprintf(logtxt+strlen(logtxt),"overran boundary by %.3fs",
+                -istats.idle);
+      else sprintf(logtxt+strlen(logtxt),"%.3fs idle at boundary",istats.idle);
+      ErrLog(errlog.sock,progname,logtxt);
+    }
+
+    if (bwait !=NULL) {
+      BndWaitStatsGet(bwait,&wstats);
+      if (wstats.num>0) {
+        sprintf(logtxt,"Boundary error: mean %+.1fus, p50 %.1fus, "
+                "p99 %.1fus, max %.1fus, lead %.0fus, polled %.0fus, "
+                "missed %d",1e6*wstats.mean,1e6*wstats.p50,1e6*wstats.p99,
+                1e6*wstats.max,1e6*wstats.lead,1e6*wstats.poll,wstats.miss);
+        ErrLog(errlog.sock,progname,logtxt);
+      }
+      bnd_time=BndWaitNext(scnsc,scnus);
+      if (BndWaitApproach(bwait,bnd_time))
+        SiteEndScan(scnsc,scnus);
+      BndWaitDone(bwait,bnd_time);
+    } else SiteEndScan(scnsc,scnus);
 
   } while (1);
 
+  FitPipeFree(fitpipe);
+  AsyncSndFree(asnd);
+  FclrCacheFree(fcache);
+  SndScoreFree(sscore);
+  BndWaitFree(bwait);
+  SndBudgetFree(sbudget);
+  ShmSndFree(shmsnd);
+  SndMapFree(sndmap);
+  MsgArenaFree(arena);
+  ScanTimeFree(stime);
+  IntSchedFree(isched);
+  if (sbatch != NULL) SndBatchFlush(sbatch);
+  SndBatchFree(sbatch);
+
   for (n=0; n<tnum; n++) RMsgSndClose(task[n].sock);
 
   ErrLog(errlog.sock,progname,"Ending program.");
@@ -644,6 +1036,21 @@ void usage(void)
     printf("-frqrng int : set the clear frequency search window (kHz)\n");
     printf("-sfrqrng int: set the sounding FCLR search window (kHz)\n");
     printf(" -sndsc int : set the sounding duration per scan (sec)\n");
+    printf("  -pipe     : fit and send each beam while the next integrates\n");
+    printf("   -shm     : send records to local tasks through shared memory\n");
+    printf("-shmsze int : size of the shared memory ring (MB) [4]\n");
+    printf("-shmtask str: tasks that read shared memory references, e.g. 0,1\n");
+    printf(" -async     : queue the records for each task and send them on its own\n");
+    printf("              thread; rtserver drops the oldest record when behind,\n");
+    printf("              the others make the beam loop wait\n");
+    printf("-timing     : time the calls in the beam loop; p50/p99 to the error log\n");
+    printf("              and a binary record per scan to SD_TIM_PATH\n");
+    printf(" -adapt     : adjust each integration so the last beam ends on time\n");
+    printf(" -sndbatch  : write each sounding sweep as one block to a .sndb file\n");
+    printf("-fclrage int: reuse a clear frequency search for up to this many seconds\n");
+    printf(" -sndsel    : run the scan on the sounding frequency with the most echoes\n");
+    printf(" -bndwait   : sleep to just before the scan boundary, then SiteEndScan\n");
+    printf(" -sndq float: learn the time a sounding needs, allowing for this quantile\n");
     printf(" --help     : print this message and quit.\n");
     printf("\n");
 }
@@ -657,7 +1064,6 @@ void write_snd_record(char *progname, struct RadarParm *prm, struct FitData *fit
   char data_path[100], data_filename[50], filename[80];
 
   char *snd_dir;
-  FILE *out;
 
   char logtxt[1024]="";
   int status;
@@ -680,23 +1086,25 @@ void write_snd_record(char *progname, struct RadarParm *prm, struct FitData *fit
   /* finally make the filename */
   sprintf(filename, "%s%s.snd", data_path, data_filename);
 
-  /* open the output file */
-  fprintf(stderr,"Sounding Data File: %s\n",filename);
-  out = fopen(filename,"a");
-  if (out == NULL) {
-    /* crap. might as well go home */
-    sprintf(logtxt,"Unable to open sounding file:%s",filename);
+  /* append to the mapped file; it is only reopened when the name changes */
+  if (sndmap == NULL) sndmap = SndMapMake();
+  if ((sndmap != NULL) && (SndMapOpen(sndmap, filename) == 0)) {
+    status = SndMapWrite(sndmap, prm, fit);
+    if (status != -1) {
+      ErrLog(errlog.sock,progname,"Sounding record successfully written.");
+      return;
+    }
+    sprintf(logtxt,"Unable to map sounding file:%s",filename);
     ErrLog(errlog.sock,progname,logtxt);
-    return;
+    SndMapClose(sndmap);
   }
 
-  /* write the sounding record */
-  status = SndFwrite(out, prm, fit);
+  /* fall back to appending the record, and its index entry, without
+     the mapping */
+  fprintf(stderr,"Sounding Data File: %s\n",filename);
+  status = SndMapAppend(filename, prm, fit);
   if (status == -1) {
-    ErrLog(errlog.sock,progname,"Error writing sounding record.");
-  } else {
-    ErrLog(errlog.sock,progname,"Sounding record successfully written.");
-  }
-
-  fclose(out);
+    sprintf(logtxt,"Unable to write sounding record to:%s",filename);
+    ErrLog(errlog.sock,progname,logtxt);
+  } else ErrLog(errlog.sock,progname,"Sounding record successfully written.");
 }
@@ -0,0 +1,290 @@
+/* shmbench.c
+   ==========
+
+   Loopback benchmark for the shared memory send path. A record the
+   size of one beam is sent to a number of consumer processes, first
+   as a full copy over a TCP socket to each consumer (the RMsgSndSend
+   path) and then copied once into a shared memory ring with a short
+   reference sent to each consumer. Each consumer reads the whole
+   record and replies, as the data tasks do, before the next beam.
+
+   Only needs POSIX, so it can be built on any box:
+
+     cc -O2 -o shmbench shmbench.c shmring.c -lrt
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "shmring.h"
+
+
+#define BENCH_FULL 0
+#define BENCH_REF 1
+
+struct BenchHdr {
+  uint32_t mode;
+  uint32_t pad;
+  uint64_t size;
+  uint64_t off;
+};
+
+
+static double BenchTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static int BenchRead(int sock,void *buf,size_t sze) {
+  unsigned char *ptr=buf;
+  ssize_t s;
+
+  while (sze>0) {
+    s=read(sock,ptr,sze);
+    if (s<=0) return -1;
+    ptr+=s;
+    sze-=s;
+  }
+  return 0;
+}
+
+
+static int BenchWrite(int sock,void *buf,size_t sze) {
+  unsigned char *ptr=buf;
+  ssize_t s;
+
+  while (sze>0) {
+    s=write(sock,ptr,sze);
+    if (s<=0) return -1;
+    ptr+=s;
+    sze-=s;
+  }
+  return 0;
+}
+
+
+static void BenchConsumer(int port,int reader,char *name) {
+
+  struct sockaddr_in addr;
+  struct BenchHdr hdr;
+  struct ShmRing *ring=NULL;
+  struct ShmRingRecord *rec=NULL;
+  unsigned char *buf=NULL;
+  size_t mxbuf=0;
+  unsigned char *src;
+  unsigned int sum=0;
+  uint64_t i;
+  char ack=1;
+  int sock,flag=1;
+
+  sock=socket(AF_INET,SOCK_STREAM,0);
+  memset(&addr,0,sizeof(addr));
+  addr.sin_family=AF_INET;
+  addr.sin_port=htons(port);
+  addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+  if (connect(sock,(struct sockaddr *) &addr,sizeof(addr)) !=0) exit(1);
+  setsockopt(sock,IPPROTO_TCP,TCP_NODELAY,&flag,sizeof(flag));
+
+  while (BenchRead(sock,&hdr,sizeof(hdr))==0) {
+    if (hdr.mode==BENCH_FULL) {
+      if (hdr.size>mxbuf) {
+        buf=realloc(buf,hdr.size);
+        mxbuf=hdr.size;
+      }
+      if (BenchRead(sock,buf,hdr.size) !=0) break;
+      src=buf;
+    } else {
+      if (ring==NULL) ring=ShmRingOpen(name);
+      if (ring==NULL) break;
+      rec=ShmRingRead(ring,&hdr.off);
+      if (rec==NULL) break;
+      src=(unsigned char *) (rec+1);
+    }
+
+    /* read every byte, as a writer task would */
+
+    for (i=0;i<hdr.size;i++) sum+=src[i];
+
+    if (hdr.mode==BENCH_REF)
+      ShmRingAck(ring,reader,hdr.off+sizeof(struct ShmRingRecord)+rec->size);
+    if (BenchWrite(sock,&ack,1) !=0) break;
+  }
+
+  if (ring !=NULL) ShmRingFree(ring);
+  free(buf);
+  close(sock);
+  exit(sum==0xffffffff);
+}
+
+
+static int BenchCompare(const void *a,const void *b) {
+  double x=*(double *) a,y=*(double *) b;
+  if (x<y) return -1;
+  if (x>y) return 1;
+  return 0;
+}
+
+
+static void BenchReport(char *label,double *lat,int beams,double copied) {
+  double sum=0;
+  int n;
+
+  for (n=0;n<beams;n++) sum+=lat[n];
+  qsort(lat,beams,sizeof(double),BenchCompare);
+  fprintf(stdout,"%-6s copied/beam %10.0f bytes  latency/beam mean %8.1fus"
+          "  p50 %8.1fus  p99 %8.1fus\n",label,copied/beams,
+          1e6*sum/beams,1e6*lat[beams/2],1e6*lat[(beams*99)/100]);
+}
+
+
+int main(int argc,char *argv[]) {
+
+  struct sockaddr_in addr;
+  socklen_t alen;
+  struct BenchHdr hdr;
+  struct ShmRing *ring;
+  pid_t pid[SHMRING_MAX_READER];
+  int sock[SHMRING_MAX_READER];
+  unsigned char *rec;
+  double *lat;
+  double copied,tval;
+  void *buf[1];
+  size_t len[1];
+  uint64_t off;
+  char name[64];
+  char ack;
+  int nrang=100,mplgs=23,nave=60,mppul=8,smpnum=0;
+  int beams=2000,tnum=4;
+  int lsock,port,flag=1;
+  size_t size;
+  int n,c;
+
+  for (c=1;c<argc-1;c+=2) {
+    if (strcmp(argv[c],"-nrang")==0) nrang=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-mplgs")==0) mplgs=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-nave")==0) nave=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-smpnum")==0) smpnum=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-beams")==0) beams=atoi(argv[c+1]);
+    else if (strcmp(argv[c],"-tasks")==0) tnum=atoi(argv[c+1]);
+  }
+  if (tnum>SHMRING_MAX_READER) tnum=SHMRING_MAX_READER;
+  if (beams<1) beams=1;
+
+  /* approximate flattened sizes of the parameter, I&Q, bad transmit,
+     raw and fit records; smpnum adds the I&Q samples themselves */
+
+  size=1024;
+  size+=nave*64;
+  size+=nave*mppul*2*sizeof(unsigned int);
+  size+=nrang*(1+4*mplgs)*sizeof(float);
+  size+=2*nrang*160;
+  size+=(size_t) nave*smpnum*2*2*sizeof(int16_t);
+
+  fprintf(stdout,"record %lu bytes  nrang %d  mplgs %d  nave %d  tasks %d"
+          "  beams %d\n",(unsigned long) size,nrang,mplgs,nave,tnum,beams);
+
+  fflush(stdout);
+  signal(SIGPIPE,SIG_IGN);
+
+  rec=malloc(size);
+  lat=malloc(sizeof(double)*beams);
+  if ((rec==NULL) || (lat==NULL)) return -1;
+  for (n=0;n<(int) size;n++) rec[n]=n & 0xff;
+
+  sprintf(name,"/shmbench.%d",(int) getpid());
+  ring=ShmRingMake(name,4*size+4096);
+  if (ring==NULL) {
+    fprintf(stderr,"Could not create shared memory ring.\n");
+    return -1;
+  }
+
+  lsock=socket(AF_INET,SOCK_STREAM,0);
+  memset(&addr,0,sizeof(addr));
+  addr.sin_family=AF_INET;
+  addr.sin_port=0;
+  addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+  if ((bind(lsock,(struct sockaddr *) &addr,sizeof(addr)) !=0) ||
+      (listen(lsock,tnum) !=0)) {
+    fprintf(stderr,"Could not open loopback socket.\n");
+    ShmRingFree(ring);
+    return -1;
+  }
+  alen=sizeof(addr);
+  getsockname(lsock,(struct sockaddr *) &addr,&alen);
+  port=ntohs(addr.sin_port);
+
+  for (n=0;n<tnum;n++) {
+    pid[n]=fork();
+    if (pid[n]==0) {
+      close(lsock);
+      BenchConsumer(port,n,name);
+    }
+    sock[n]=accept(lsock,NULL,NULL);
+    setsockopt(sock[n],IPPROTO_TCP,TCP_NODELAY,&flag,sizeof(flag));
+    ShmRingAttach(ring,n);
+  }
+
+  /* current path: the whole record to every task */
+
+  copied=0;
+  for (c=0;c<beams;c++) {
+    tval=BenchTime();
+    for (n=0;n<tnum;n++) {
+      hdr.mode=BENCH_FULL;
+      hdr.size=size;
+      hdr.off=0;
+      BenchWrite(sock[n],&hdr,sizeof(hdr));
+      BenchWrite(sock[n],rec,size);
+      BenchRead(sock[n],&ack,1);
+      copied+=sizeof(hdr)+size;
+    }
+    lat[c]=BenchTime()-tval;
+  }
+  BenchReport("tcp",lat,beams,copied);
+
+  /* shared memory path: one copy into the ring, a reference to each */
+
+  copied=0;
+  for (c=0;c<beams;c++) {
+    tval=BenchTime();
+    buf[0]=rec;
+    len[0]=size;
+    if (ShmRingWrite(ring,1,buf,len,NULL,&off) !=0) {
+      fprintf(stderr,"Ring full at beam %d.\n",c);
+      break;
+    }
+    copied+=size;
+    for (n=0;n<tnum;n++) {
+      hdr.mode=BENCH_REF;
+      hdr.size=size;
+      hdr.off=off;
+      BenchWrite(sock[n],&hdr,sizeof(hdr));
+      BenchRead(sock[n],&ack,1);
+      copied+=sizeof(hdr);
+    }
+    lat[c]=BenchTime()-tval;
+  }
+  if (c==beams) BenchReport("shm",lat,beams,copied);
+
+  for (n=0;n<tnum;n++) close(sock[n]);
+  for (n=0;n<tnum;n++) waitpid(pid[n],NULL,0);
+  close(lsock);
+  ShmRingFree(ring);
+  free(lat);
+  free(rec);
+  return 0;
+}
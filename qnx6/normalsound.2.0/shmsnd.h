@@ -0,0 +1,58 @@
+/* shmsnd.h
+   ========
+*/
+
+
+#ifndef _SHMSND_H
+#define _SHMSND_H
+
+#ifndef SHM_TYPE
+#define SHM_TYPE 32
+#endif
+
+#define SHMSND_MAXENT 32
+
+/* sent over TCP in place of the record itself; the reader maps the
+   named ring, reads the record at off and acknowledges it */
+
+struct ShmSndRef {
+  char name[64];
+  uint64_t seq;
+  uint64_t off;
+  uint64_t size;
+  int32_t reader;
+  int32_t num;
+};
+
+/* the record in the ring is num of these followed by the payloads
+   in the same order */
+
+struct ShmSndEntry {
+  int32_t type;
+  int32_t tag;
+  uint64_t size;
+};
+
+struct ShmSndStats {
+  int beams;
+  int fallback;
+  int dropped;     /* tasks dropped by the ring for not acknowledging */
+  double copied;   /* bytes copied by the sender */
+  double tsend;    /* seconds spent sending */
+};
+
+struct ShmSnd {
+  struct ShmRing *ring;
+  int tnum;
+  struct TCPIPMsgHost *task;
+  int shm[SHMRING_MAX_READER];
+  struct ShmSndStats stats;
+};
+
+struct ShmSnd *ShmSndMake(char *name,size_t size,int tnum,
+                          struct TCPIPMsgHost *task,char *list);
+void ShmSndFree(struct ShmSnd *ptr);
+int ShmSndSend(struct ShmSnd *ptr,struct RMsgBlock *blk);
+void ShmSndStatsGet(struct ShmSnd *ptr,struct ShmSndStats *stats);
+
+#endif
@@ -0,0 +1,588 @@
+/* sndbatch.c
+   ==========
+
+   Collects the sounding records of a whole sweep and writes them as a
+   single DataMap block. The fields that are the same for every record
+   of the sweep (the radar and origin details, cp, stid, the range
+   gates and the integration time) are written once, from the first
+   record; the rest are written as arrays with one entry per record.
+   The range data of all the records are put end to end, with soff
+   giving the offset of the first range of each record, so record n
+   has soff[n+1]-soff[n] entries in slist, qflg, v and the rest.
+
+   The block is flagged by snd.revision.major=2. It is appended to
+   YYYYMMDD.HH.rad.sndb, named from the time of its first record.
+   A record whose shared fields differ from those already held, or
+   that would overfill the block, causes the block to be written out
+   first so that nothing is lost.
+
+   SndBatchRead reads a block back into a SndBatch and SndBatchGet
+   unpacks one of its records into a RadarParm and FitData, from which
+   SndWrite gives the same record as the program would have written
+   to the .snd file; sndbsplit uses them to turn a .sndb file into a
+   .snd file.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "dmap.h"
+#include "rprm.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "sndbatch.h"
+
+#define SNDBATCH_MAJOR_REVISION 2
+#define SNDBATCH_MINOR_REVISION 0
+
+
+static double SndBatchTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static void SndBatchStr(char *dst,char *src,size_t sze) {
+  if (src==NULL) src="";
+  strncpy(dst,src,sze-1);
+  dst[sze-1]=0;
+}
+
+
+static int SndBatchStrCmp(char *a,char *b) {
+  if (a==NULL) a="";
+  if (b==NULL) b="";
+  return strcmp(a,b);
+}
+
+
+/* tests whether a record can go in the same block as those held */
+
+static int SndBatchSame(struct SndBatch *ptr,struct RadarParm *prm,
+                        struct FitData *fit) {
+  struct RadarParm *shr=&ptr->shr;
+
+  if (prm->revision.major !=shr->revision.major) return 0;
+  if (prm->revision.minor !=shr->revision.minor) return 0;
+  if (prm->origin.code !=shr->origin.code) return 0;
+  if (prm->cp !=shr->cp) return 0;
+  if (prm->stid !=shr->stid) return 0;
+  if (prm->lagfr !=shr->lagfr) return 0;
+  if (prm->smsep !=shr->smsep) return 0;
+  if (prm->rxrise !=shr->rxrise) return 0;
+  if (prm->intt.sc !=shr->intt.sc) return 0;
+  if (prm->intt.us !=shr->intt.us) return 0;
+  if (prm->nrang !=shr->nrang) return 0;
+  if (prm->frang !=shr->frang) return 0;
+  if (prm->rsep !=shr->rsep) return 0;
+  if (prm->xcf !=shr->xcf) return 0;
+  if (fit->revision.major !=ptr->fit_major) return 0;
+  if (fit->revision.minor !=ptr->fit_minor) return 0;
+  if (SndBatchStrCmp(prm->origin.command,ptr->ocommand) !=0) return 0;
+  if (SndBatchStrCmp(prm->combf,ptr->combf) !=0) return 0;
+  return 1;
+}
+
+
+static int SndBatchGrow(struct SndBatch *ptr,int num) {
+  int smax;
+  void *tmp;
+
+  if (ptr->snum+num<=ptr->smax) return 0;
+  smax=(ptr->smax==0) ? 1024 : ptr->smax;
+  while (smax<ptr->snum+num) smax*=2;
+
+  if ((tmp=realloc(ptr->slist,smax*sizeof(int16)))==NULL) return -1;
+  ptr->slist=tmp;
+  if ((tmp=realloc(ptr->qflg,smax))==NULL) return -1;
+  ptr->qflg=tmp;
+  if ((tmp=realloc(ptr->gflg,smax))==NULL) return -1;
+  ptr->gflg=tmp;
+  if ((tmp=realloc(ptr->x_qflg,smax))==NULL) return -1;
+  ptr->x_qflg=tmp;
+  if ((tmp=realloc(ptr->v,smax*sizeof(float)))==NULL) return -1;
+  ptr->v=tmp;
+  if ((tmp=realloc(ptr->v_e,smax*sizeof(float)))==NULL) return -1;
+  ptr->v_e=tmp;
+  if ((tmp=realloc(ptr->p_l,smax*sizeof(float)))==NULL) return -1;
+  ptr->p_l=tmp;
+  if ((tmp=realloc(ptr->w_l,smax*sizeof(float)))==NULL) return -1;
+  ptr->w_l=tmp;
+  if ((tmp=realloc(ptr->phi0,smax*sizeof(float)))==NULL) return -1;
+  ptr->phi0=tmp;
+  if ((tmp=realloc(ptr->phi0_e,smax*sizeof(float)))==NULL) return -1;
+  ptr->phi0_e=tmp;
+  ptr->smax=smax;
+  return 0;
+}
+
+
+struct SndBatch *SndBatchMake(char *path,char *ststr) {
+  struct SndBatch *ptr;
+
+  ptr=malloc(sizeof(struct SndBatch));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct SndBatch));
+  SndBatchStr(ptr->path,path,sizeof(ptr->path));
+  SndBatchStr(ptr->ststr,ststr,sizeof(ptr->ststr));
+  return ptr;
+}
+
+
+void SndBatchFree(struct SndBatch *ptr) {
+  if (ptr==NULL) return;
+  if (ptr->slist !=NULL) free(ptr->slist);
+  if (ptr->qflg !=NULL) free(ptr->qflg);
+  if (ptr->gflg !=NULL) free(ptr->gflg);
+  if (ptr->x_qflg !=NULL) free(ptr->x_qflg);
+  if (ptr->v !=NULL) free(ptr->v);
+  if (ptr->v_e !=NULL) free(ptr->v_e);
+  if (ptr->p_l !=NULL) free(ptr->p_l);
+  if (ptr->w_l !=NULL) free(ptr->w_l);
+  if (ptr->phi0 !=NULL) free(ptr->phi0);
+  if (ptr->phi0_e !=NULL) free(ptr->phi0_e);
+  free(ptr);
+}
+
+
+/* adds a record; returns -1 if there was no memory to hold it, in
+   which case it is not in any block. The records of a block that had
+   to be written out first and could not be are counted as lost */
+
+int SndBatchAdd(struct SndBatch *ptr,struct RadarParm *prm,
+                struct FitData *fit) {
+  int c,n,x;
+
+  if ((ptr->nrec>0) &&
+      ((ptr->nrec>=SNDBATCH_MAXREC) || (!SndBatchSame(ptr,prm,fit))))
+    SndBatchFlush(ptr);
+
+  if (SndBatchGrow(ptr,prm->nrang) !=0) {
+    ptr->stats.lost++;
+    return -1;
+  }
+
+  if (ptr->nrec==0) {
+    memcpy(&ptr->shr,prm,sizeof(struct RadarParm));
+    SndBatchStr(ptr->otime,prm->origin.time,sizeof(ptr->otime));
+    SndBatchStr(ptr->ocommand,prm->origin.command,sizeof(ptr->ocommand));
+    SndBatchStr(ptr->combf,prm->combf,sizeof(ptr->combf));
+    ptr->fit_major=fit->revision.major;
+    ptr->fit_minor=fit->revision.minor;
+    ptr->snum=0;
+    ptr->soff[0]=0;
+  }
+
+  n=ptr->nrec;
+  ptr->yr[n]=prm->time.yr;
+  ptr->mo[n]=prm->time.mo;
+  ptr->dy[n]=prm->time.dy;
+  ptr->hr[n]=prm->time.hr;
+  ptr->mt[n]=prm->time.mt;
+  ptr->sc[n]=prm->time.sc;
+  ptr->us[n]=prm->time.us;
+  ptr->nave[n]=prm->nave;
+  ptr->search[n]=prm->noise.search;
+  ptr->mean[n]=prm->noise.mean;
+  ptr->sky[n]=fit->noise.skynoise;
+  ptr->channel[n]=prm->channel;
+  ptr->bmnum[n]=prm->bmnum;
+  ptr->bmazm[n]=prm->bmazm;
+  ptr->scan[n]=prm->scan;
+  ptr->tfreq[n]=prm->tfreq;
+
+  x=ptr->snum;
+  for (c=0;c<prm->nrang;c++) {
+    if ( (fit->rng[c].qflg !=1) &&
+         ((fit->xrng==NULL) || (fit->xrng[c].qflg !=1))) continue;
+    ptr->slist[x]=c;
+    ptr->qflg[x]=fit->rng[c].qflg;
+    ptr->gflg[x]=fit->rng[c].gsct;
+    ptr->p_l[x]=fit->rng[c].p_l;
+    ptr->v[x]=fit->rng[c].v;
+    ptr->v_e[x]=fit->rng[c].v_err;
+    ptr->w_l[x]=fit->rng[c].w_l;
+    if (prm->xcf !=0) {
+      ptr->x_qflg[x]=fit->xrng[c].qflg;
+      ptr->phi0[x]=fit->xrng[c].phi0;
+      ptr->phi0_e[x]=fit->xrng[c].phi0_err;
+    }
+    x++;
+  }
+  ptr->snum=x;
+  ptr->nrec++;
+  ptr->soff[ptr->nrec]=x;
+  return 0;
+}
+
+
+/* writes out the records held, if any, as one block; they are let go
+   whether or not it could be written */
+
+int SndBatchFlush(struct SndBatch *ptr) {
+  struct DataMap *map;
+  struct RadarParm *shr=&ptr->shr;
+  char fname[512];
+  char *otime,*ocommand,*combf;
+  int16 major_rev,minor_rev;
+  int32 nrec,snum,onum;
+  double tval;
+  int fd,s;
+
+  if (ptr->nrec==0) return 0;
+  tval=SndBatchTime();
+
+  map=DataMapMake();
+  if (map==NULL) {
+    ptr->stats.lost+=ptr->nrec;
+    ptr->nrec=0;
+    ptr->snum=0;
+    return -1;
+  }
+
+  major_rev=SNDBATCH_MAJOR_REVISION;
+  minor_rev=SNDBATCH_MINOR_REVISION;
+  otime=ptr->otime;
+  ocommand=ptr->ocommand;
+  combf=ptr->combf;
+  nrec=ptr->nrec;
+  onum=ptr->nrec+1;
+  snum=ptr->snum;
+
+  DataMapAddScalar(map,"radar.revision.major",DATACHAR,&shr->revision.major);
+  DataMapAddScalar(map,"radar.revision.minor",DATACHAR,&shr->revision.minor);
+  DataMapAddScalar(map,"origin.code",DATACHAR,&shr->origin.code);
+  DataMapAddScalar(map,"origin.time",DATASTRING,&otime);
+  DataMapAddScalar(map,"origin.command",DATASTRING,&ocommand);
+  DataMapAddScalar(map,"cp",DATASHORT,&shr->cp);
+  DataMapAddScalar(map,"stid",DATASHORT,&shr->stid);
+  DataMapAddScalar(map,"lagfr",DATASHORT,&shr->lagfr);
+  DataMapAddScalar(map,"smsep",DATASHORT,&shr->smsep);
+  DataMapAddScalar(map,"rxrise",DATASHORT,&shr->rxrise);
+  DataMapAddScalar(map,"intt.sc",DATASHORT,&shr->intt.sc);
+  DataMapAddScalar(map,"intt.us",DATAINT,&shr->intt.us);
+  DataMapAddScalar(map,"nrang",DATASHORT,&shr->nrang);
+  DataMapAddScalar(map,"frang",DATASHORT,&shr->frang);
+  DataMapAddScalar(map,"rsep",DATASHORT,&shr->rsep);
+  DataMapAddScalar(map,"xcf",DATASHORT,&shr->xcf);
+  DataMapAddScalar(map,"combf",DATASTRING,&combf);
+  DataMapAddScalar(map,"fitacf.revision.major",DATAINT,&ptr->fit_major);
+  DataMapAddScalar(map,"fitacf.revision.minor",DATAINT,&ptr->fit_minor);
+  DataMapAddScalar(map,"snd.revision.major",DATASHORT,&major_rev);
+  DataMapAddScalar(map,"snd.revision.minor",DATASHORT,&minor_rev);
+
+  DataMapAddArray(map,"time.yr",DATASHORT,1,&nrec,ptr->yr);
+  DataMapAddArray(map,"time.mo",DATASHORT,1,&nrec,ptr->mo);
+  DataMapAddArray(map,"time.dy",DATASHORT,1,&nrec,ptr->dy);
+  DataMapAddArray(map,"time.hr",DATASHORT,1,&nrec,ptr->hr);
+  DataMapAddArray(map,"time.mt",DATASHORT,1,&nrec,ptr->mt);
+  DataMapAddArray(map,"time.sc",DATASHORT,1,&nrec,ptr->sc);
+  DataMapAddArray(map,"time.us",DATAINT,1,&nrec,ptr->us);
+  DataMapAddArray(map,"nave",DATASHORT,1,&nrec,ptr->nave);
+  DataMapAddArray(map,"noise.search",DATAFLOAT,1,&nrec,ptr->search);
+  DataMapAddArray(map,"noise.mean",DATAFLOAT,1,&nrec,ptr->mean);
+  DataMapAddArray(map,"noise.sky",DATAFLOAT,1,&nrec,ptr->sky);
+  DataMapAddArray(map,"channel",DATASHORT,1,&nrec,ptr->channel);
+  DataMapAddArray(map,"bmnum",DATASHORT,1,&nrec,ptr->bmnum);
+  DataMapAddArray(map,"bmazm",DATAFLOAT,1,&nrec,ptr->bmazm);
+  DataMapAddArray(map,"scan",DATASHORT,1,&nrec,ptr->scan);
+  DataMapAddArray(map,"tfreq",DATASHORT,1,&nrec,ptr->tfreq);
+  DataMapAddArray(map,"soff",DATAINT,1,&onum,ptr->soff);
+
+  if (snum !=0) {
+    DataMapAddArray(map,"slist",DATASHORT,1,&snum,ptr->slist);
+    DataMapAddArray(map,"qflg",DATACHAR,1,&snum,ptr->qflg);
+    DataMapAddArray(map,"gflg",DATACHAR,1,&snum,ptr->gflg);
+    DataMapAddArray(map,"v",DATAFLOAT,1,&snum,ptr->v);
+    DataMapAddArray(map,"v_e",DATAFLOAT,1,&snum,ptr->v_e);
+    DataMapAddArray(map,"p_l",DATAFLOAT,1,&snum,ptr->p_l);
+    DataMapAddArray(map,"w_l",DATAFLOAT,1,&snum,ptr->w_l);
+    if (shr->xcf !=0) {
+      DataMapAddArray(map,"x_qflg",DATACHAR,1,&snum,ptr->x_qflg);
+      DataMapAddArray(map,"phi0",DATAFLOAT,1,&snum,ptr->phi0);
+      DataMapAddArray(map,"phi0_e",DATAFLOAT,1,&snum,ptr->phi0_e);
+    }
+  }
+
+  /* YYYYMMDD.HH.rad.sndb */
+  sprintf(fname,"%s/%04d%02d%02d.%02d.%s.sndb",ptr->path,ptr->yr[0],
+          ptr->mo[0],ptr->dy[0],(ptr->hr[0]/2)*2,ptr->ststr);
+
+  s=-1;
+  fd=open(fname,O_WRONLY | O_CREAT | O_APPEND,0644);
+  if (fd !=-1) {
+    s=DataMapWrite(fd,map);
+    close(fd);
+  }
+  DataMapFree(map);
+
+  if (s>0) {
+    ptr->stats.blocks++;
+    ptr->stats.recs+=ptr->nrec;
+    ptr->stats.bytes+=s;
+  } else ptr->stats.lost+=ptr->nrec;
+  ptr->stats.twrite+=SndBatchTime()-tval;
+  ptr->nrec=0;
+  ptr->snum=0;
+  return (s>0) ? 0 : -1;
+}
+
+
+/* reads the next block from fid into ptr, replacing any records it
+   holds; returns the number of records, 0 at the end of the file or
+   -1 if what was read is not a block */
+
+int SndBatchRead(int fid,struct SndBatch *ptr) {
+  struct DataMap *map;
+  struct DataMapScalar *s;
+  struct DataMapArray *a;
+  struct RadarParm *shr=&ptr->shr;
+  int c,n,num,snum=-1,major_rev=0;
+
+  map=DataMapRead(fid);
+  if (map==NULL) return 0;
+
+  ptr->nrec=0;
+  ptr->snum=0;
+  memset(shr,0,sizeof(struct RadarParm));
+  ptr->otime[0]=0;
+  ptr->ocommand[0]=0;
+  ptr->combf[0]=0;
+
+  for (c=0;c<map->snum;c++) {
+    s=map->scl[c];
+    if ((strcmp(s->name,"radar.revision.major")==0) && (s->type==DATACHAR))
+      shr->revision.major=*(s->data.cptr);
+    if ((strcmp(s->name,"radar.revision.minor")==0) && (s->type==DATACHAR))
+      shr->revision.minor=*(s->data.cptr);
+    if ((strcmp(s->name,"origin.code")==0) && (s->type==DATACHAR))
+      shr->origin.code=*(s->data.cptr);
+    if ((strcmp(s->name,"origin.time")==0) && (s->type==DATASTRING))
+      SndBatchStr(ptr->otime,*((char **) s->data.vptr),sizeof(ptr->otime));
+    if ((strcmp(s->name,"origin.command")==0) && (s->type==DATASTRING))
+      SndBatchStr(ptr->ocommand,*((char **) s->data.vptr),
+                  sizeof(ptr->ocommand));
+    if ((strcmp(s->name,"cp")==0) && (s->type==DATASHORT))
+      shr->cp=*(s->data.sptr);
+    if ((strcmp(s->name,"stid")==0) && (s->type==DATASHORT))
+      shr->stid=*(s->data.sptr);
+    if ((strcmp(s->name,"lagfr")==0) && (s->type==DATASHORT))
+      shr->lagfr=*(s->data.sptr);
+    if ((strcmp(s->name,"smsep")==0) && (s->type==DATASHORT))
+      shr->smsep=*(s->data.sptr);
+    if ((strcmp(s->name,"rxrise")==0) && (s->type==DATASHORT))
+      shr->rxrise=*(s->data.sptr);
+    if ((strcmp(s->name,"intt.sc")==0) && (s->type==DATASHORT))
+      shr->intt.sc=*(s->data.sptr);
+    if ((strcmp(s->name,"intt.us")==0) && (s->type==DATAINT))
+      shr->intt.us=*(s->data.iptr);
+    if ((strcmp(s->name,"nrang")==0) && (s->type==DATASHORT))
+      shr->nrang=*(s->data.sptr);
+    if ((strcmp(s->name,"frang")==0) && (s->type==DATASHORT))
+      shr->frang=*(s->data.sptr);
+    if ((strcmp(s->name,"rsep")==0) && (s->type==DATASHORT))
+      shr->rsep=*(s->data.sptr);
+    if ((strcmp(s->name,"xcf")==0) && (s->type==DATASHORT))
+      shr->xcf=*(s->data.sptr);
+    if ((strcmp(s->name,"combf")==0) && (s->type==DATASTRING))
+      SndBatchStr(ptr->combf,*((char **) s->data.vptr),sizeof(ptr->combf));
+    if ((strcmp(s->name,"fitacf.revision.major")==0) && (s->type==DATAINT))
+      ptr->fit_major=*(s->data.iptr);
+    if ((strcmp(s->name,"fitacf.revision.minor")==0) && (s->type==DATAINT))
+      ptr->fit_minor=*(s->data.iptr);
+    if ((strcmp(s->name,"snd.revision.major")==0) && (s->type==DATASHORT))
+      major_rev=*(s->data.sptr);
+  }
+
+  num=-1;
+  for (c=0;c<map->anum;c++) {
+    a=map->arr[c];
+    if ((strcmp(a->name,"soff")==0) && (a->type==DATAINT) &&
+        (a->dim==1)) num=a->rng[0]-1;
+    if ((strcmp(a->name,"slist")==0) && (a->type==DATASHORT) &&
+        (a->dim==1)) snum=a->rng[0];
+  }
+  if (snum<0) snum=0;
+
+  if ((major_rev !=SNDBATCH_MAJOR_REVISION) || (num<1) ||
+      (num>SNDBATCH_MAXREC) || (SndBatchGrow(ptr,snum) !=0)) {
+    DataMapFree(map);
+    return -1;
+  }
+  if (snum>0) {
+    memset(ptr->x_qflg,0,snum);
+    memset(ptr->phi0,0,snum*sizeof(float));
+    memset(ptr->phi0_e,0,snum*sizeof(float));
+  }
+
+  for (c=0;c<map->anum;c++) {
+    a=map->arr[c];
+    if (a->dim !=1) continue;
+    n=a->rng[0];
+    if (a->type==DATASHORT) {
+      if (n==num) {
+        if (strcmp(a->name,"time.yr")==0)
+          memcpy(ptr->yr,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"time.mo")==0)
+          memcpy(ptr->mo,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"time.dy")==0)
+          memcpy(ptr->dy,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"time.hr")==0)
+          memcpy(ptr->hr,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"time.mt")==0)
+          memcpy(ptr->mt,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"time.sc")==0)
+          memcpy(ptr->sc,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"nave")==0)
+          memcpy(ptr->nave,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"channel")==0)
+          memcpy(ptr->channel,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"bmnum")==0)
+          memcpy(ptr->bmnum,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"scan")==0)
+          memcpy(ptr->scan,a->data.sptr,n*sizeof(int16));
+        if (strcmp(a->name,"tfreq")==0)
+          memcpy(ptr->tfreq,a->data.sptr,n*sizeof(int16));
+      }
+      if ((n==snum) && (strcmp(a->name,"slist")==0))
+        memcpy(ptr->slist,a->data.sptr,n*sizeof(int16));
+    } else if (a->type==DATAINT) {
+      if ((n==num) && (strcmp(a->name,"time.us")==0))
+        memcpy(ptr->us,a->data.iptr,n*sizeof(int32));
+      if ((n==num+1) && (strcmp(a->name,"soff")==0))
+        memcpy(ptr->soff,a->data.iptr,n*sizeof(int32));
+    } else if (a->type==DATAFLOAT) {
+      if (n==num) {
+        if (strcmp(a->name,"noise.search")==0)
+          memcpy(ptr->search,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"noise.mean")==0)
+          memcpy(ptr->mean,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"noise.sky")==0)
+          memcpy(ptr->sky,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"bmazm")==0)
+          memcpy(ptr->bmazm,a->data.fptr,n*sizeof(float));
+      }
+      if (n==snum) {
+        if (strcmp(a->name,"v")==0)
+          memcpy(ptr->v,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"v_e")==0)
+          memcpy(ptr->v_e,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"p_l")==0)
+          memcpy(ptr->p_l,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"w_l")==0)
+          memcpy(ptr->w_l,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"phi0")==0)
+          memcpy(ptr->phi0,a->data.fptr,n*sizeof(float));
+        if (strcmp(a->name,"phi0_e")==0)
+          memcpy(ptr->phi0_e,a->data.fptr,n*sizeof(float));
+      }
+    } else if ((a->type==DATACHAR) && (n==snum)) {
+      if (strcmp(a->name,"qflg")==0) memcpy(ptr->qflg,a->data.cptr,n);
+      if (strcmp(a->name,"gflg")==0) memcpy(ptr->gflg,a->data.cptr,n);
+      if (strcmp(a->name,"x_qflg")==0) memcpy(ptr->x_qflg,a->data.cptr,n);
+    }
+  }
+  DataMapFree(map);
+
+  /* the offsets must run from the start to the end of the ranges */
+  if ((ptr->soff[0] !=0) || (ptr->soff[num] !=snum)) return -1;
+  for (n=0;n<num;n++) {
+    if (ptr->soff[n]>ptr->soff[n+1]) return -1;
+    for (c=ptr->soff[n];c<ptr->soff[n+1];c++)
+      if ((ptr->slist[c]<0) || (ptr->slist[c]>=shr->nrang)) return -1;
+  }
+
+  ptr->nrec=num;
+  ptr->snum=snum;
+  return num;
+}
+
+
+/* unpacks record n of the block held into prm and fit. A range that
+   was written only because its XCF was good is given a good XCF flag
+   so that SndWrite puts it back in slist. */
+
+int SndBatchGet(struct SndBatch *ptr,int n,struct RadarParm *prm,
+                struct FitData *fit) {
+  struct RadarParm *shr=&ptr->shr;
+  int c,x;
+
+  if ((n<0) || (n>=ptr->nrec)) return -1;
+
+  prm->revision.major=shr->revision.major;
+  prm->revision.minor=shr->revision.minor;
+  prm->origin.code=shr->origin.code;
+  RadarParmSetOriginTime(prm,ptr->otime);
+  RadarParmSetOriginCommand(prm,ptr->ocommand);
+  RadarParmSetCombf(prm,ptr->combf);
+  prm->cp=shr->cp;
+  prm->stid=shr->stid;
+  prm->lagfr=shr->lagfr;
+  prm->smsep=shr->smsep;
+  prm->rxrise=shr->rxrise;
+  prm->intt.sc=shr->intt.sc;
+  prm->intt.us=shr->intt.us;
+  prm->nrang=shr->nrang;
+  prm->frang=shr->frang;
+  prm->rsep=shr->rsep;
+  prm->xcf=shr->xcf;
+
+  prm->time.yr=ptr->yr[n];
+  prm->time.mo=ptr->mo[n];
+  prm->time.dy=ptr->dy[n];
+  prm->time.hr=ptr->hr[n];
+  prm->time.mt=ptr->mt[n];
+  prm->time.sc=ptr->sc[n];
+  prm->time.us=ptr->us[n];
+  prm->nave=ptr->nave[n];
+  prm->noise.search=ptr->search[n];
+  prm->noise.mean=ptr->mean[n];
+  prm->channel=ptr->channel[n];
+  prm->bmnum=ptr->bmnum[n];
+  prm->bmazm=ptr->bmazm[n];
+  prm->scan=ptr->scan[n];
+  prm->tfreq=ptr->tfreq[n];
+
+  fit->revision.major=ptr->fit_major;
+  fit->revision.minor=ptr->fit_minor;
+  fit->noise.skynoise=ptr->sky[n];
+  if ((FitSetRng(fit,shr->nrang) !=0) ||
+      (FitSetXrng(fit,shr->nrang) !=0)) return -1;
+  memset(fit->rng,0,shr->nrang*sizeof(struct FitRange));
+  memset(fit->xrng,0,shr->nrang*sizeof(struct FitRange));
+
+  for (x=ptr->soff[n];x<ptr->soff[n+1];x++) {
+    c=ptr->slist[x];
+    fit->rng[c].qflg=ptr->qflg[x];
+    fit->rng[c].gsct=ptr->gflg[x];
+    fit->rng[c].p_l=ptr->p_l[x];
+    fit->rng[c].v=ptr->v[x];
+    fit->rng[c].v_err=ptr->v_e[x];
+    fit->rng[c].w_l=ptr->w_l[x];
+    if (shr->xcf !=0) {
+      fit->xrng[c].qflg=ptr->x_qflg[x];
+      fit->xrng[c].phi0=ptr->phi0[x];
+      fit->xrng[c].phi0_err=ptr->phi0_e[x];
+    }
+    if ((fit->rng[c].qflg !=1) && (fit->xrng[c].qflg !=1))
+      fit->xrng[c].qflg=1;
+  }
+  return 0;
+}
+
+
+/* copies out and resets the accumulated counters */
+
+void SndBatchStatsGet(struct SndBatch *ptr,struct SndBatchStats *stats) {
+  if (stats !=NULL) memcpy(stats,&ptr->stats,sizeof(struct SndBatchStats));
+  memset(&ptr->stats,0,sizeof(struct SndBatchStats));
+}
@@ -0,0 +1,63 @@
+/* sndbatch.h
+   ==========
+*/
+
+
+#ifndef _SNDBATCH_H
+#define _SNDBATCH_H
+
+#define SNDBATCH_MAXREC 120
+
+struct SndBatchStats {
+  int blocks;
+  int recs;
+  int lost;        /* records in no block that was written */
+  double bytes;    /* bytes written */
+  double twrite;   /* seconds spent encoding and writing */
+};
+
+struct SndBatch {
+  char path[256];
+  char ststr[16];
+  int nrec;
+
+  /* stored once per block, from the first record */
+  struct RadarParm shr;
+  char otime[64];
+  char ocommand[256];
+  char combf[128];
+  int32 fit_major,fit_minor;
+
+  /* one entry per record */
+  int16 yr[SNDBATCH_MAXREC],mo[SNDBATCH_MAXREC],dy[SNDBATCH_MAXREC];
+  int16 hr[SNDBATCH_MAXREC],mt[SNDBATCH_MAXREC],sc[SNDBATCH_MAXREC];
+  int32 us[SNDBATCH_MAXREC];
+  int16 nave[SNDBATCH_MAXREC];
+  float search[SNDBATCH_MAXREC],mean[SNDBATCH_MAXREC],sky[SNDBATCH_MAXREC];
+  int16 channel[SNDBATCH_MAXREC],bmnum[SNDBATCH_MAXREC];
+  float bmazm[SNDBATCH_MAXREC];
+  int16 scan[SNDBATCH_MAXREC],tfreq[SNDBATCH_MAXREC];
+  int32 soff[SNDBATCH_MAXREC+1];
+
+  /* the ranges of every record, record after record; record n has
+     soff[n+1]-soff[n] of them starting at soff[n] */
+  int snum;
+  int smax;
+  int16 *slist;
+  char *qflg,*gflg,*x_qflg;
+  float *v,*v_e,*p_l,*w_l,*phi0,*phi0_e;
+
+  struct SndBatchStats stats;
+};
+
+struct SndBatch *SndBatchMake(char *path,char *ststr);
+void SndBatchFree(struct SndBatch *ptr);
+int SndBatchAdd(struct SndBatch *ptr,struct RadarParm *prm,
+                struct FitData *fit);
+int SndBatchFlush(struct SndBatch *ptr);
+int SndBatchRead(int fid,struct SndBatch *ptr);
+int SndBatchGet(struct SndBatch *ptr,int n,struct RadarParm *prm,
+                struct FitData *fit);
+void SndBatchStatsGet(struct SndBatch *ptr,struct SndBatchStats *stats);
+
+#endif
@@ -0,0 +1,80 @@
+/* sndbsplit.c
+   ===========
+
+   Turns the sounding blocks written with -sndbatch back into
+   sounding records. Each record of each block in the .sndb file is
+   written to standard output in the .snd format, in the order it was
+   taken, so the output is the .snd file the program would have
+   written without -sndbatch.
+
+     sndbsplit YYYYMMDD.HH.rad.sndb > YYYYMMDD.HH.rad.snd
+
+     cc -O2 -o sndbsplit sndbsplit.c sndbatch.c sndwrite.c \
+        -lfit.1 -lradar.1 -ldmap.1 -lrcnv.1 -lz
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "dmap.h"
+#include "rprm.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "sndwrite.h"
+#include "sndbatch.h"
+
+
+int main(int argc,char *argv[]) {
+
+  struct SndBatch *sbatch;
+  struct RadarParm *prm;
+  struct FitData *fit;
+  int fid=0;
+  int blocks=0,recs=0;
+  int n,num;
+
+  if (argc>1) {
+    fid=open(argv[1],O_RDONLY);
+    if (fid==-1) {
+      fprintf(stderr,"File not found.\n");
+      exit(-1);
+    }
+  }
+
+  sbatch=SndBatchMake("",NULL);
+  prm=RadarParmMake();
+  fit=FitMake();
+  if ((sbatch==NULL) || (prm==NULL) || (fit==NULL)) {
+    fprintf(stderr,"Could not allocate memory.\n");
+    exit(-1);
+  }
+
+  while ((num=SndBatchRead(fid,sbatch)) !=0) {
+    if (num<0) {
+      fprintf(stderr,"Block %d is not a sounding block.\n",blocks+1);
+      exit(-1);
+    }
+    for (n=0;n<num;n++) {
+      if ((SndBatchGet(sbatch,n,prm,fit) !=0) ||
+          (SndWrite(fileno(stdout),prm,fit)==-1)) {
+        fprintf(stderr,"Error writing record %d of block %d.\n",n+1,
+                blocks+1);
+        exit(-1);
+      }
+    }
+    blocks++;
+    recs+=num;
+  }
+
+  fprintf(stderr,"%d blocks, %d records\n",blocks,recs);
+  if (fid !=0) close(fid);
+  SndBatchFree(sbatch);
+  RadarParmFree(prm);
+  FitFree(fit);
+  return 0;
+}
@@ -0,0 +1,164 @@
+/* sndscore.c
+   ==========
+
+   Ranks the sounding frequencies by what the soundings saw on them so
+   that the main scan can be run on the best one. For every frequency
+   and beam the number of good ranges (qflg set) and their mean lambda
+   power are averaged over the soundings, a sounding counting for half
+   of the average. Soundings older than maxage seconds are forgotten.
+
+   A frequency is ranked by the mean number of good ranges per beam
+   over the beams sounded on it, with the mean power breaking ties,
+   once at least SNDSCORE_MINBEAM beams have been sounded. To limit
+   frequency switching, SndScoreSelect only moves off the frequency in
+   use after SNDSCORE_HOLD scans, and only to one that is better by
+   SNDSCORE_MARGIN and by SNDSCORE_MINGAIN good ranges per beam.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "rprm.h"
+#include "fitblk.h"
+#include "fitdata.h"
+#include "sndscore.h"
+
+
+static double SndScoreTime(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static int SndScoreFind(struct SndScore *ptr,int freq) {
+  int n;
+
+  for (n=0;n<ptr->nfreq;n++) if (ptr->freq[n]==freq) return n;
+  return -1;
+}
+
+
+struct SndScore *SndScoreMake(int nfreq,int *freq,double maxage) {
+  struct SndScore *ptr;
+
+  if (nfreq>SNDSCORE_MAXFREQ) nfreq=SNDSCORE_MAXFREQ;
+
+  ptr=malloc(sizeof(struct SndScore));
+  if (ptr==NULL) return NULL;
+  memset(ptr,0,sizeof(struct SndScore));
+  ptr->nfreq=nfreq;
+  memcpy(ptr->freq,freq,sizeof(int)*nfreq);
+  ptr->maxage=maxage;
+  ptr->cur=-1;
+  return ptr;
+}
+
+
+void SndScoreFree(struct SndScore *ptr) {
+  if (ptr==NULL) return;
+  free(ptr);
+}
+
+
+/* adds a sounding made at the sounding frequency freq */
+
+int SndScoreAdd(struct SndScore *ptr,int freq,struct RadarParm *prm,
+                struct FitData *fit) {
+  struct SndScoreCell *cell;
+  double tval,pwr=0;
+  int f,c,ngood=0;
+
+  f=SndScoreFind(ptr,freq);
+  if (f==-1) return -1;
+  if ((prm->bmnum<0) || (prm->bmnum>=SNDSCORE_MAXBEAM)) return -1;
+
+  for (c=0;c<prm->nrang;c++) {
+    if (fit->rng[c].qflg !=1) continue;
+    ngood++;
+    pwr+=fit->rng[c].p_l;
+  }
+  if (ngood>0) pwr=pwr/ngood;
+
+  tval=SndScoreTime();
+  cell=&ptr->cell[f][prm->bmnum];
+  if ((cell->num==0) || (tval-cell->time>ptr->maxage)) {
+    cell->num=0;
+    cell->ngood=ngood;
+    cell->pwr=pwr;
+  } else {
+    cell->ngood=0.5*(cell->ngood+ngood);
+    cell->pwr=0.5*(cell->pwr+pwr);
+  }
+  cell->num++;
+  cell->time=tval;
+  return 0;
+}
+
+
+/* fills in the rank of freq; returns -1 if it has too few beams */
+
+int SndScoreRank(struct SndScore *ptr,int freq,struct SndScoreRank *rank) {
+  struct SndScoreCell *cell;
+  double tval;
+  int f,b;
+
+  memset(rank,0,sizeof(struct SndScoreRank));
+  rank->freq=freq;
+  f=SndScoreFind(ptr,freq);
+  if (f==-1) return -1;
+
+  tval=SndScoreTime();
+  for (b=0;b<SNDSCORE_MAXBEAM;b++) {
+    cell=&ptr->cell[f][b];
+    if ((cell->num==0) || (tval-cell->time>ptr->maxage)) continue;
+    rank->nbeam++;
+    rank->ngood+=cell->ngood;
+    rank->pwr+=cell->pwr;
+  }
+  if (rank->nbeam==0) return -1;
+  rank->ngood=rank->ngood/rank->nbeam;
+  rank->pwr=rank->pwr/rank->nbeam;
+  if (rank->nbeam<SNDSCORE_MINBEAM) return -1;
+  return 0;
+}
+
+
+/* called once a scan; returns the frequency to use, or 0 if none has
+   been sounded enough to be ranked */
+
+int SndScoreSelect(struct SndScore *ptr) {
+  struct SndScoreRank rank,best,cur;
+  int f,b=-1;
+
+  for (f=0;f<ptr->nfreq;f++) {
+    if (SndScoreRank(ptr,ptr->freq[f],&rank) !=0) continue;
+    if ((b==-1) || (rank.ngood>best.ngood) ||
+        ((rank.ngood==best.ngood) && (rank.pwr>best.pwr))) {
+      b=f;
+      best=rank;
+    }
+  }
+
+  ptr->held++;
+  if ((ptr->cur==-1) ||
+      (SndScoreRank(ptr,ptr->freq[ptr->cur],&cur) !=0)) {
+    /* nothing in use, or what is in use is no longer known */
+    if (b !=ptr->cur) ptr->held=0;
+    ptr->cur=b;
+  } else if ((b !=-1) && (b !=ptr->cur) && (ptr->held>=SNDSCORE_HOLD) &&
+             (best.ngood>=cur.ngood*(1+SNDSCORE_MARGIN)) &&
+             (best.ngood-cur.ngood>=SNDSCORE_MINGAIN)) {
+    ptr->cur=b;
+    ptr->held=0;
+  }
+
+  if (ptr->cur==-1) return 0;
+  return ptr->freq[ptr->cur];
+}
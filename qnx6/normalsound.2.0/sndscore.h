@@ -0,0 +1,47 @@
+/* sndscore.h
+   ==========
+*/
+
+
+#ifndef _SNDSCORE_H
+#define _SNDSCORE_H
+
+#define SNDSCORE_MAXFREQ 12
+#define SNDSCORE_MAXBEAM 32
+#define SNDSCORE_MINBEAM 3     /* beams needed before a frequency is ranked */
+#define SNDSCORE_MARGIN 0.2    /* fractional gain needed to switch */
+#define SNDSCORE_MINGAIN 2.0   /* gain in good ranges per beam needed to switch */
+#define SNDSCORE_HOLD 3        /* scans to stay on a frequency once chosen */
+#define SNDSCORE_MAXAGE 900.0  /* seconds a sounding is remembered */
+
+struct SndScoreCell {
+  int num;
+  double ngood;   /* good ranges, averaged over the soundings */
+  double pwr;     /* mean lambda power of the good ranges [dB] */
+  double time;
+};
+
+struct SndScoreRank {
+  int freq;
+  int nbeam;
+  double ngood;
+  double pwr;
+};
+
+struct SndScore {
+  int nfreq;
+  int freq[SNDSCORE_MAXFREQ];
+  double maxage;
+  int cur;
+  int held;
+  struct SndScoreCell cell[SNDSCORE_MAXFREQ][SNDSCORE_MAXBEAM];
+};
+
+struct SndScore *SndScoreMake(int nfreq,int *freq,double maxage);
+void SndScoreFree(struct SndScore *ptr);
+int SndScoreAdd(struct SndScore *ptr,int freq,struct RadarParm *prm,
+                struct FitData *fit);
+int SndScoreRank(struct SndScore *ptr,int freq,struct SndScoreRank *rank);
+int SndScoreSelect(struct SndScore *ptr);
+
+#endif
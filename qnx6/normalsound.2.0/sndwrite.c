@@ -18,9 +18,11 @@
 #define SND_MAJOR_REVISION 1
 #define SND_MINOR_REVISION 1
 
-int SndWrite(int fid, struct RadarParm *prm, struct FitData *fit) {
+/* the revision numbers are stored rather than added so that the map
+   can be used after this returns */
+
+static struct DataMap *SndMake(struct RadarParm *prm, struct FitData *fit) {
 
-  int s;
   struct DataMap *ptr=NULL;
 
   int c,x;
@@ -47,7 +49,7 @@ int SndWrite(int fid, struct RadarParm *prm, struct FitData *fit) {
   int16 minor_rev[1];
 
   ptr=DataMapMake();
-  if (ptr==NULL) return -1;
+  if (ptr==NULL) return NULL;
 
   major_rev[0] = SND_MAJOR_REVISION;
   minor_rev[0] = SND_MINOR_REVISION;
@@ -97,8 +99,8 @@ int SndWrite(int fid, struct RadarParm *prm, struct FitData *fit) {
   DataMapAddScalar(ptr,"fitacf.revision.major",DATAINT,&fit->revision.major);
   DataMapAddScalar(ptr,"fitacf.revision.minor",DATAINT,&fit->revision.minor);
 
-  DataMapAddScalar(ptr,"snd.revision.major",DATASHORT,major_rev);
-  DataMapAddScalar(ptr,"snd.revision.minor",DATASHORT,minor_rev);
+  DataMapStoreScalar(ptr,"snd.revision.major",DATASHORT,major_rev);
+  DataMapStoreScalar(ptr,"snd.revision.minor",DATASHORT,minor_rev);
 
   snum=0;
   for (c=0;c<prm->nrang;c++) {
@@ -154,6 +156,18 @@ int SndWrite(int fid, struct RadarParm *prm, struct FitData *fit) {
     }
   }
 
+  return ptr;
+}
+
+
+int SndWrite(int fid, struct RadarParm *prm, struct FitData *fit) {
+
+  int s;
+  struct DataMap *ptr=NULL;
+
+  ptr=SndMake(prm,fit);
+  if (ptr==NULL) return -1;
+
   if (fid !=-1) s=DataMapWrite(fid,ptr);
   else s=DataMapSize(ptr);
 
@@ -163,6 +177,26 @@ int SndWrite(int fid, struct RadarParm *prm, struct FitData *fit) {
 }
 
 
+/* encodes the record into a buffer that the caller must free */
+
+unsigned char *SndEncode(struct RadarParm *prm, struct FitData *fit,
+                         int *size) {
+
+  unsigned char *buf;
+  struct DataMap *ptr=NULL;
+
+  *size=0;
+  ptr=SndMake(prm,fit);
+  if (ptr==NULL) return NULL;
+
+  buf=DataMapEncodeBuffer(ptr,size);
+
+  DataMapFree(ptr);
+  return buf;
+
+}
+
+
 int SndFwrite(FILE *fp, struct RadarParm *prm, struct FitData *fit) {
   return SndWrite(fileno(fp),prm,fit);
 }
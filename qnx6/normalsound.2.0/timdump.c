@@ -0,0 +1,94 @@
+/* timdump.c
+   =========
+
+   Lists the scan timing records written with -timing. Each scan is
+   summarized by the median and 99th percentile of each phase; with
+   -p the individual probes are listed as well.
+
+     cc -O2 -o timdump timdump.c scantime.c
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rtypes.h"
+#include "scantime.h"
+
+
+static int TimDumpSort(const void *a,const void *b) {
+  double x=*(double *) a,y=*(double *) b;
+  if (x<y) return -1;
+  if (x>y) return 1;
+  return 0;
+}
+
+
+int main(int argc,char *argv[]) {
+
+  struct ScanTimeHeader hdr;
+  struct ScanTimeProbe *probe=NULL;
+  double dur[SCANTIME_SIZE];
+  struct tm *tm;
+  time_t clock;
+  FILE *fp;
+  int probes=0;
+  int mx=0;
+  int c,n,p,i;
+
+  for (c=1;c<argc;c++) {
+    if (strcmp(argv[c],"-p")==0) {
+      probes=1;
+      continue;
+    }
+
+    fp=fopen(argv[c],"r");
+    if (fp==NULL) {
+      fprintf(stderr,"Could not open %s.\n",argv[c]);
+      continue;
+    }
+
+    while (fread(&hdr,sizeof(struct ScanTimeHeader),1,fp)==1) {
+      if ((hdr.magic !=SCANTIME_MAGIC) || (hdr.num<0)) {
+        fprintf(stderr,"Bad record in %s.\n",argv[c]);
+        break;
+      }
+      if (hdr.num>mx) {
+        probe=realloc(probe,sizeof(struct ScanTimeProbe)*hdr.num);
+        if (probe==NULL) return -1;
+        mx=hdr.num;
+      }
+      if (fread(probe,sizeof(struct ScanTimeProbe),hdr.num,fp) !=
+          (size_t) hdr.num) break;
+
+      clock=(time_t) hdr.time;
+      tm=gmtime(&clock);
+      fprintf(stdout,"%04d-%02d-%02d %02d:%02d:%02d stid %d scan %d "
+              "length %.3fs\n",tm->tm_year+1900,tm->tm_mon+1,
+              tm->tm_mday,tm->tm_hour,tm->tm_min,tm->tm_sec,hdr.stid,
+              hdr.scan,hdr.len);
+
+      for (p=0;p<ST_NPHASE;p++) {
+        i=0;
+        for (n=0;(n<hdr.num) && (i<SCANTIME_SIZE);n++)
+          if (probe[n].phase==p) dur[i++]=probe[n].dur;
+        if (i==0) continue;
+        qsort(dur,i,sizeof(double),TimDumpSort);
+        fprintf(stdout,"  %-10s %4d calls  p50 %9.3fms  p99 %9.3fms\n",
+                scantime_phase[p],i,1e3*dur[i/2],1e3*dur[(i*99)/100]);
+      }
+
+      if (probes==0) continue;
+      for (n=0;n<hdr.num;n++) {
+        if ((probe[n].phase<0) || (probe[n].phase>=ST_NPHASE)) continue;
+        fprintf(stdout,"  %9.3fs beam %2d %-10s %9.3fms\n",
+                probe[n].start,probe[n].bmnum,
+                scantime_phase[probe[n].phase],1e3*probe[n].dur);
+      }
+    }
+    fclose(fp);
+  }
+  free(probe);
+  return 0;
+}
@@ -0,0 +1,543 @@
+/* replay.c
+   ========
+
+   Plays back a recorded rawacf or iqdat file in place of the
+   simulated echo, so that a control program can be run against the
+   data a radar actually saw: to reproduce a problem from the field,
+   or to time and check the processing chain on known input.
+
+   Records are taken in the order they were written. The clear
+   frequency search returns the frequency and noise of the next
+   record and each integration returns its ACFs and number of
+   sequences, whatever beam the control program asked for; records
+   that come back on another beam, frequency or range and lag count
+   are counted so that a run that has drifted from the recording is
+   obvious.
+
+   The files are read with a small DataMap parser of our own, so that
+   the same code serves the qnx4 and qnx6 libraries whatever version
+   of the RST structures they are built against. A rawacf record is
+   returned as it was written, so FitACF sees the same input it saw
+   on the day; an iqdat record is turned into ACFs by summing the lag
+   products of each sequence, which follows the recording closely but
+   not to the bit.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "sim.h"
+#include "replay.h"
+
+
+#define REPLAY_CODE 0x00010001
+
+#define DM_CHAR 1
+#define DM_SHORT 2
+#define DM_INT 3
+#define DM_FLOAT 4
+#define DM_DOUBLE 8
+#define DM_STRING 9
+#define DM_LONG 10
+#define DM_UCHAR 16
+#define DM_USHORT 17
+#define DM_UINT 18
+#define DM_ULONG 19
+
+struct ReplayEntry {
+  char *name;
+  int type;
+  int num;           /* elements, 1 for a scalar */
+  unsigned char *data;
+};
+
+static FILE *replayfp=NULL;
+static int replaytype=0;
+static unsigned char *replaybuf=NULL;
+static int replaybufsze=0;
+static struct ReplayEntry replayent[REPLAY_MAXENT];
+static int replayentnum=0;
+
+static struct ReplayRecord replayrec[REPLAY_AHEAD];
+static int replayrecnum=0;
+static struct ReplayStats replaystats;
+
+
+static int ReplaySize(int type) {
+  switch (type) {
+  case DM_CHAR:
+  case DM_UCHAR:
+    return 1;
+  case DM_SHORT:
+  case DM_USHORT:
+    return 2;
+  case DM_INT:
+  case DM_UINT:
+  case DM_FLOAT:
+    return 4;
+  case DM_DOUBLE:
+  case DM_LONG:
+  case DM_ULONG:
+    return 8;
+  }
+  return 0;
+}
+
+
+/* splits the record in replaybuf into its fields; the data is left
+   where it is and read through ReplayValue */
+
+static int ReplayParse(int sze) {
+  int32_t snum,anum,dim,rng;
+  int p=0,n,d,len,num,esze;
+  unsigned char *end;
+
+  replayentnum=0;
+  if (sze<8) return -1;
+  memcpy(&snum,replaybuf,4);
+  memcpy(&anum,replaybuf+4,4);
+  p=8;
+
+  for (n=0;n<snum+anum;n++) {
+    end=memchr(replaybuf+p,0,sze-p);
+    if (end==NULL) return -1;
+    if (replayentnum==REPLAY_MAXENT) return -1;
+    replayent[replayentnum].name=(char *) (replaybuf+p);
+    p=end-replaybuf+1;
+    if (p>=sze) return -1;
+    replayent[replayentnum].type=replaybuf[p++];
+
+    num=1;
+    if (n>=snum) {
+      if (p+4>sze) return -1;
+      memcpy(&dim,replaybuf+p,4);
+      p+=4;
+      if ((dim<1) || (p+4*dim>sze)) return -1;
+      for (d=0;d<dim;d++) {
+        memcpy(&rng,replaybuf+p,4);
+        p+=4;
+        if (rng<0) return -1;
+        num*=rng;
+      }
+    }
+    replayent[replayentnum].num=num;
+    replayent[replayentnum].data=replaybuf+p;
+
+    if (replayent[replayentnum].type==DM_STRING) {
+      for (d=0;d<num;d++) {
+        end=memchr(replaybuf+p,0,sze-p);
+        if (end==NULL) return -1;
+        p=end-replaybuf+1;
+      }
+    } else {
+      esze=ReplaySize(replayent[replayentnum].type);
+      if (esze==0) return -1;
+      len=esze*num;
+      if ((len<0) || (p+len>sze)) return -1;
+      p+=len;
+    }
+    replayentnum++;
+  }
+  return 0;
+}
+
+
+static struct ReplayEntry *ReplayFind(char *name) {
+  int n;
+
+  for (n=0;n<replayentnum;n++)
+    if (strcmp(replayent[n].name,name)==0) return &replayent[n];
+  return NULL;
+}
+
+
+static double ReplayValue(struct ReplayEntry *ent,int i) {
+  unsigned char *ptr;
+  int16_t s;
+  uint16_t us;
+  int32_t l;
+  uint32_t ul;
+  int64_t ll;
+  uint64_t ull;
+  float f;
+  double d;
+
+  if ((ent==NULL) || (i<0) || (i>=ent->num)) return 0;
+  ptr=ent->data+i*ReplaySize(ent->type);
+  switch (ent->type) {
+  case DM_CHAR:
+    return (signed char) ptr[0];
+  case DM_UCHAR:
+    return ptr[0];
+  case DM_SHORT:
+    memcpy(&s,ptr,2);
+    return s;
+  case DM_USHORT:
+    memcpy(&us,ptr,2);
+    return us;
+  case DM_INT:
+    memcpy(&l,ptr,4);
+    return l;
+  case DM_UINT:
+    memcpy(&ul,ptr,4);
+    return ul;
+  case DM_FLOAT:
+    memcpy(&f,ptr,4);
+    return f;
+  case DM_DOUBLE:
+    memcpy(&d,ptr,8);
+    return d;
+  case DM_LONG:
+    memcpy(&ll,ptr,8);
+    return (double) ll;
+  case DM_ULONG:
+    memcpy(&ull,ptr,8);
+    return (double) ull;
+  }
+  return 0;
+}
+
+
+static int ReplayInt(char *name,int def) {
+  struct ReplayEntry *ent;
+
+  ent=ReplayFind(name);
+  if (ent==NULL) return def;
+  return (int) ReplayValue(ent,0);
+}
+
+
+static double ReplayEpoch(void) {
+  struct tm tm;
+
+  memset(&tm,0,sizeof(struct tm));
+  tm.tm_year=ReplayInt("time.yr",1970)-1900;
+  tm.tm_mon=ReplayInt("time.mo",1)-1;
+  tm.tm_mday=ReplayInt("time.dy",1);
+  tm.tm_hour=ReplayInt("time.hr",0);
+  tm.tm_min=ReplayInt("time.mt",0);
+  tm.tm_sec=ReplayInt("time.sc",0);
+  return (double) (mktime(&tm)-timezone)+ReplayInt("time.us",0)*1e-6;
+}
+
+
+static int ReplayAlloc(struct ReplayRecord *rec) {
+  size_t sze;
+
+  sze=sizeof(float)*2*rec->nrang*rec->mplgs;
+  rec->pwr0=calloc(rec->nrang,sizeof(float));
+  rec->acfd=malloc(sze);
+  rec->xcfd=malloc(sze);
+  if ((rec->pwr0==NULL) || (rec->acfd==NULL) || (rec->xcfd==NULL))
+    return -1;
+  memset(rec->acfd,0,sze);
+  memset(rec->xcfd,0,sze);
+  return 0;
+}
+
+
+static void ReplayFree(struct ReplayRecord *rec) {
+  if (rec->pwr0 !=NULL) free(rec->pwr0);
+  if (rec->acfd !=NULL) free(rec->acfd);
+  if (rec->xcfd !=NULL) free(rec->xcfd);
+  memset(rec,0,sizeof(struct ReplayRecord));
+}
+
+
+/* the ranges that were stored are listed in slist; acfd and xcfd
+   hold mplgs complex lags for each of them */
+
+static int ReplayRawacf(struct ReplayRecord *rec) {
+  struct ReplayEntry *pwr0,*slist,*acfd,*xcfd;
+  int n,r,l,off;
+
+  pwr0=ReplayFind("pwr0");
+  slist=ReplayFind("slist");
+  acfd=ReplayFind("acfd");
+  xcfd=ReplayFind("xcfd");
+
+  for (r=0;r<rec->nrang;r++) rec->pwr0[r]=ReplayValue(pwr0,r);
+  if (slist==NULL) return 0;
+
+  for (n=0;n<slist->num;n++) {
+    r=(int) ReplayValue(slist,n);
+    if ((r<0) || (r>=rec->nrang)) continue;
+    for (l=0;l<rec->mplgs;l++) {
+      off=2*(r*rec->mplgs+l);
+      rec->acfd[off]=ReplayValue(acfd,2*(n*rec->mplgs+l));
+      rec->acfd[off+1]=ReplayValue(acfd,2*(n*rec->mplgs+l)+1);
+      if (rec->xcf==0) continue;
+      rec->xcfd[off]=ReplayValue(xcfd,2*(n*rec->mplgs+l));
+      rec->xcfd[off+1]=ReplayValue(xcfd,2*(n*rec->mplgs+l)+1);
+    }
+  }
+  return 0;
+}
+
+
+/* each sequence holds smpnum complex samples for each channel, main
+   array first, starting skpnum samples before the first pulse; the
+   lag products are averaged over the sequences */
+
+static int ReplayIQ(struct ReplayRecord *rec) {
+  struct ReplayEntry *data,*ptab,*ltab;
+  int seqnum,chnnum,smpnum,skpnum,mpinc,lagfr,smsep;
+  int n,r,l,i1,i2,off,base;
+  double i[4],acf[2],xcf[2];
+  double *sum;
+
+  data=ReplayFind("data");
+  ptab=ReplayFind("ptab");
+  ltab=ReplayFind("ltab");
+  if ((data==NULL) || (ptab==NULL) || (ltab==NULL)) return -1;
+
+  seqnum=ReplayInt("seqnum",0);
+  chnnum=ReplayInt("chnnum",1);
+  smpnum=ReplayInt("smpnum",0);
+  skpnum=ReplayInt("skpnum",0);
+  mpinc=ReplayInt("mpinc",0);
+  lagfr=ReplayInt("lagfr",0);
+  smsep=ReplayInt("smsep",0);
+  if ((seqnum<1) || (smpnum<1) || (smsep<=0)) return -1;
+  if (ltab->num<2*rec->mplgs) return -1;
+
+  sum=calloc(4*rec->nrang*rec->mplgs,sizeof(double));
+  if (sum==NULL) return -1;
+
+  for (n=0;n<seqnum;n++) {
+    base=2*n*chnnum*smpnum;
+    for (l=0;l<rec->mplgs;l++) {
+      i1=(int) ReplayValue(ptab,(int) ReplayValue(ltab,2*l));
+      i2=(int) ReplayValue(ptab,(int) ReplayValue(ltab,2*l+1));
+      i1=skpnum+(i1*mpinc+lagfr)/smsep;
+      i2=skpnum+(i2*mpinc+lagfr)/smsep;
+      for (r=0;r<rec->nrang;r++) {
+        if ((i1+r>=smpnum) || (i2+r>=smpnum)) break;
+        i[0]=ReplayValue(data,base+2*(i1+r));
+        i[1]=ReplayValue(data,base+2*(i1+r)+1);
+        i[2]=ReplayValue(data,base+2*(i2+r));
+        i[3]=ReplayValue(data,base+2*(i2+r)+1);
+        acf[0]=i[0]*i[2]+i[1]*i[3];
+        acf[1]=i[0]*i[3]-i[1]*i[2];
+        off=4*(r*rec->mplgs+l);
+        sum[off]+=acf[0];
+        sum[off+1]+=acf[1];
+        if ((chnnum<2) || (rec->xcf==0)) continue;
+        i[2]=ReplayValue(data,base+2*(smpnum+i2+r));
+        i[3]=ReplayValue(data,base+2*(smpnum+i2+r)+1);
+        xcf[0]=i[0]*i[2]+i[1]*i[3];
+        xcf[1]=i[0]*i[3]-i[1]*i[2];
+        sum[off+2]+=xcf[0];
+        sum[off+3]+=xcf[1];
+      }
+    }
+  }
+
+  for (r=0;r<rec->nrang;r++) {
+    for (l=0;l<rec->mplgs;l++) {
+      off=2*(r*rec->mplgs+l);
+      rec->acfd[off]=floor(sum[2*off]/seqnum+0.5);
+      rec->acfd[off+1]=floor(sum[2*off+1]/seqnum+0.5);
+      rec->xcfd[off]=floor(sum[2*off+2]/seqnum+0.5);
+      rec->xcfd[off+1]=floor(sum[2*off+3]/seqnum+0.5);
+    }
+    rec->pwr0[r]=rec->acfd[2*r*rec->mplgs];
+  }
+  free(sum);
+  return 0;
+}
+
+
+/* reads the next record into rec; returns -1 at the end of the file */
+
+static int ReplayRead(struct ReplayRecord *rec) {
+  int32_t hdr[2];
+  unsigned char *tmp;
+  int sze;
+
+  while (1) {
+    if (fread(hdr,4,2,replayfp) !=2) return -1;
+    if (hdr[0] !=REPLAY_CODE) return -1;
+    sze=hdr[1]-8;
+    if (sze<8) return -1;
+    if (sze>replaybufsze) {
+      tmp=realloc(replaybuf,sze);
+      if (tmp==NULL) return -1;
+      replaybuf=tmp;
+      replaybufsze=sze;
+    }
+    if (fread(replaybuf,1,sze,replayfp) !=(size_t) sze) return -1;
+    if (ReplayParse(sze)==0) break;
+  }
+
+  memset(rec,0,sizeof(struct ReplayRecord));
+  rec->bmnum=ReplayInt("bmnum",0);
+  rec->tfreq=ReplayInt("tfreq",0);
+  rec->channel=ReplayInt("channel",0);
+  rec->nave=ReplayInt("nave",1);
+  rec->nrang=ReplayInt("nrang",0);
+  rec->mplgs=ReplayInt("mplgs",0);
+  rec->xcf=ReplayInt("xcf",0);
+  rec->noise=ReplayValue(ReplayFind("noise.search"),0);
+  rec->yr=ReplayInt("time.yr",1970);
+  rec->mo=ReplayInt("time.mo",1);
+  rec->dy=ReplayInt("time.dy",1);
+  rec->hr=ReplayInt("time.hr",0);
+  rec->mt=ReplayInt("time.mt",0);
+  rec->sc=ReplayInt("time.sc",0);
+  rec->us=ReplayInt("time.us",0);
+  rec->time=ReplayEpoch();
+  if ((rec->nrang<1) || (rec->mplgs<1)) return -1;
+  if (ReplayAlloc(rec) !=0) {
+    ReplayFree(rec);
+    return -1;
+  }
+
+  if (replaytype==0) {
+    if (ReplayFind("data") !=NULL) replaytype=REPLAY_IQDAT;
+    else replaytype=REPLAY_RAWACF;
+  }
+  if (replaytype==REPLAY_IQDAT) {
+    if (ReplayIQ(rec) !=0) {
+      ReplayFree(rec);
+      return -1;
+    }
+  } else ReplayRawacf(rec);
+  return 0;
+}
+
+
+/* keeps n records read ahead; returns how many there are */
+
+static int ReplayFill(int n) {
+  if (n>REPLAY_AHEAD) n=REPLAY_AHEAD;
+  while ((replayfp !=NULL) && (replayrecnum<n)) {
+    if (ReplayRead(&replayrec[replayrecnum]) !=0) {
+      fclose(replayfp);
+      replayfp=NULL;
+      break;
+    }
+    replayrecnum++;
+  }
+  return replayrecnum;
+}
+
+
+int ReplayOpen(char *fname) {
+  ReplayClose();
+  tzset();
+  replayfp=fopen(fname,"r");
+  if (replayfp==NULL) return -1;
+  if (ReplayFill(1)==0) return -1;
+  return 0;
+}
+
+
+void ReplayClose(void) {
+  int n;
+
+  if (replayfp !=NULL) fclose(replayfp);
+  replayfp=NULL;
+  for (n=0;n<replayrecnum;n++) ReplayFree(&replayrec[n]);
+  replayrecnum=0;
+  replaytype=0;
+  if (replaybuf !=NULL) free(replaybuf);
+  replaybuf=NULL;
+  replaybufsze=0;
+  memset(&replaystats,0,sizeof(struct ReplayStats));
+}
+
+
+int ReplayType(void) {
+  return replaytype;
+}
+
+
+/* time of the next record, or 0 if there are none left */
+
+double ReplayTime(void) {
+  if (ReplayFill(1)==0) return 0;
+  return replayrec[0].time;
+}
+
+
+/* the time of the next record exactly as it was written; returns -1
+   if there are none left */
+
+int ReplayClock(int *yr,int *mo,int *dy,int *hr,int *mt,int *sc,int *us) {
+  if (ReplayFill(1)==0) return -1;
+  *yr=replayrec[0].yr;
+  *mo=replayrec[0].mo;
+  *dy=replayrec[0].dy;
+  *hr=replayrec[0].hr;
+  *mt=replayrec[0].mt;
+  *sc=replayrec[0].sc;
+  *us=replayrec[0].us;
+  return 0;
+}
+
+
+/* the frequency and noise of the n'th record ahead; stereo programs
+   search for both channels at once */
+
+int ReplayFCLR(struct SimChannel *chn,int n) {
+  if (ReplayFill(n+1)<=n) return -1;
+  chn->tfreq=replayrec[n].tfreq;
+  chn->noise=replayrec[n].noise;
+  return chn->tfreq;
+}
+
+
+/* fills pwr0, acfd and xcfd for the channel from the next record and
+   returns its number of sequences, or -1 once the file is done */
+
+int ReplayACF(struct SimChannel *chn,int *pwr0,int *acfd,int *xcfd) {
+  struct ReplayRecord *rec;
+  int r,l,off,roff;
+
+  if (ReplayFill(1)==0) return -1;
+  rec=&replayrec[0];
+
+  replaystats.rec++;
+  if (rec->bmnum !=chn->bmnum) replaystats.beam++;
+  if (rec->tfreq !=chn->tfreq) replaystats.freq++;
+  if ((rec->nrang !=chn->nrang) || (rec->mplgs !=chn->mplgs))
+    replaystats.shape++;
+
+  for (r=0;r<chn->nrang;r++) {
+    pwr0[r]=(r<rec->nrang) ? (int) floor(rec->pwr0[r]+0.5) : 0;
+    for (l=0;l<chn->mplgs;l++) {
+      off=2*(r*chn->mplgs+l);
+      if ((r>=rec->nrang) || (l>=rec->mplgs)) {
+        acfd[off]=acfd[off+1]=0;
+        if (xcfd !=NULL) xcfd[off]=xcfd[off+1]=0;
+        continue;
+      }
+      roff=2*(r*rec->mplgs+l);
+      acfd[off]=(int) floor(rec->acfd[roff]+0.5);
+      acfd[off+1]=(int) floor(rec->acfd[roff+1]+0.5);
+      if (xcfd==NULL) continue;
+      xcfd[off]=(int) floor(rec->xcfd[roff]+0.5);
+      xcfd[off+1]=(int) floor(rec->xcfd[roff+1]+0.5);
+    }
+  }
+  chn->noise=rec->noise;
+  r=rec->nave;
+
+  ReplayFree(rec);
+  if (replayrecnum>1)
+    memcpy(&replayrec[0],&replayrec[1],
+           sizeof(struct ReplayRecord)*(replayrecnum-1));
+  replayrecnum--;
+  memset(&replayrec[replayrecnum],0,sizeof(struct ReplayRecord));
+  return r;
+}
+
+
+void ReplayStatsGet(struct ReplayStats *stats) {
+  if (stats !=NULL) memcpy(stats,&replaystats,sizeof(struct ReplayStats));
+}
@@ -0,0 +1,282 @@
+/* sim.c
+   =====
+
+   Core of the simulated radar: a virtual clock and synthetic noise
+   and ACF generation.
+
+   The virtual clock only moves with real time while the control
+   program is doing its own work (scaled by the speed setting);
+   integrations, clear frequency searches and boundary waits jump it
+   forward instead of sleeping, so a scan runs as fast as the control
+   program can process it while the timing it sees is still that of
+   the real radar. With SD_SIM_PACE set they sleep instead, so the
+   program runs at the speed of the radar.
+
+   The echo is a single scattering layer with a Gaussian range profile
+   whose line of sight velocity varies across the beams. Each ACF lag
+   is that of a Lorentzian spectrum plus Gaussian noise reduced by the
+   number of averages, so FitACF recovers the configured power,
+   velocity and width.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include "sim.h"
+
+
+#define SIM_C 299792458.0
+
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC CLOCK_REALTIME
+#endif
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
+
+static struct SimConfig simcfg;
+static double simbase=0;
+static double simreal=0;
+static unsigned int simseed=1;
+
+
+static double SimReal(void) {
+  struct timespec tp;
+
+  clock_gettime(CLOCK_MONOTONIC,&tp);
+  return tp.tv_sec+tp.tv_nsec*1e-9;
+}
+
+
+static double SimRandom(void) {
+  simseed^=simseed<<13;
+  simseed^=simseed>>17;
+  simseed^=simseed<<5;
+  return (simseed & 0xffffff)/16777216.0;
+}
+
+
+static double SimGauss(void) {
+  double u,v;
+
+  do u=SimRandom(); while (u==0);
+  v=SimRandom();
+  return sqrt(-2*log(u))*cos(2*PI*v);
+}
+
+
+static double SimEnv(char *name,double def) {
+  char *env;
+
+  env=getenv(name);
+  if (env==NULL) return def;
+  return atof(env);
+}
+
+
+/* SD_SIM_START is either epoch seconds or "yyyy-mm-dd hh:mm:ss" */
+
+static double SimEnvTime(char *name) {
+  struct tm tm;
+  char *env;
+  int yr,mo,dy,hr,mt,sc;
+
+  env=getenv(name);
+  if (env==NULL) return 0;
+  if (sscanf(env,"%d-%d-%d %d:%d:%d",&yr,&mo,&dy,&hr,&mt,&sc) !=6)
+    return atof(env);
+
+  memset(&tm,0,sizeof(struct tm));
+  tm.tm_year=yr-1900;
+  tm.tm_mon=mo-1;
+  tm.tm_mday=dy;
+  tm.tm_hour=hr;
+  tm.tm_min=mt;
+  tm.tm_sec=sc;
+  return (double) (mktime(&tm)-timezone);
+}
+
+
+void SimLoadConfig(struct SimConfig *cfg) {
+  tzset();
+  cfg->speed=SimEnv("SD_SIM_SPEED",1.0);
+  cfg->start=SimEnvTime("SD_SIM_START");
+  cfg->seed=(unsigned int) SimEnv("SD_SIM_SEED",1);
+  cfg->noise=SimEnv("SD_SIM_NOISE",100);
+  cfg->power=SimEnv("SD_SIM_POWER",5000);
+  cfg->range=SimEnv("SD_SIM_RANGE",900);
+  cfg->depth=SimEnv("SD_SIM_DEPTH",300);
+  cfg->vel=SimEnv("SD_SIM_VEL",300);
+  cfg->width=SimEnv("SD_SIM_WIDTH",100);
+  cfg->phi0=SimEnv("SD_SIM_PHI0",0.5);
+  cfg->pace=(int) SimEnv("SD_SIM_PACE",0);
+  cfg->replay=getenv("SD_SIM_REPLAY");
+}
+
+
+void SimStart(struct SimConfig *cfg) {
+  struct timespec tp;
+
+  memcpy(&simcfg,cfg,sizeof(struct SimConfig));
+  if (simcfg.speed<0) simcfg.speed=0;
+  simseed=(simcfg.seed !=0) ? simcfg.seed : 1;
+
+  simreal=SimReal();
+  if (simcfg.start>0) simbase=simcfg.start;
+  else {
+    clock_gettime(CLOCK_REALTIME,&tp);
+    simbase=tp.tv_sec+tp.tv_nsec*1e-9;
+  }
+}
+
+
+double SimTime(void) {
+  struct SimConfig cfg;
+
+  if (simreal==0) {
+    /* clock read before the site library was started */
+    SimLoadConfig(&cfg);
+    SimStart(&cfg);
+  }
+  return simbase+simcfg.speed*(SimReal()-simreal);
+}
+
+
+/* when paced the clock is left to run, so the program keeps the
+   timing of the real radar */
+
+void SimAdvance(double dt) {
+  struct timespec tp;
+
+  if (dt<=0) return;
+  if ((simcfg.pace==0) || (simcfg.speed<=0)) {
+    simbase+=dt;
+    return;
+  }
+  dt=dt/simcfg.speed;
+  tp.tv_sec=(time_t) dt;
+  tp.tv_nsec=(long) ((dt-floor(dt))*1e9);
+  while ((nanosleep(&tp,&tp) !=0) && (errno==EINTR));
+}
+
+
+void SimWait(double t) {
+  SimAdvance(t-SimTime());
+}
+
+
+/* length of one pulse sequence, including the sampling of the last
+   range and the dead time before the next sequence */
+
+double SimSeqTime(struct SimChannel *chn) {
+  double us;
+
+  us=chn->ptab[chn->mppul-1]*(double) chn->mpinc;
+  us+=(chn->frang+chn->nrang*chn->rsep)*20.0/3.0;
+  us+=SIM_SEQ_DEAD;
+  return us*1e-6;
+}
+
+
+int SimSeqNum(struct SimChannel *chn,double intt) {
+  int nave;
+
+  nave=(int) (intt/SimSeqTime(chn));
+  if (nave<1) nave=1;
+  if (nave>SIM_MAXSEQ) nave=SIM_MAXSEQ;
+  return nave;
+}
+
+
+/* noise seen at a frequency; mostly the receiver noise with the odd
+   interferer that moves around from minute to minute */
+
+static double SimNoise(int freq,double t) {
+  unsigned int h;
+  double x;
+
+  h=(unsigned int) (freq/25)*2654435761U;
+  h^=(unsigned int) (t/60)*40503U;
+  h^=simcfg.seed*2246822519U;
+  h^=h>>15;
+  h*=2246822519U;
+  h^=h>>13;
+
+  x=(h & 0xffff)/65536.0;
+  return simcfg.noise*(1+20*pow(x,8)+0.1*SimRandom());
+}
+
+
+int SimFCLR(struct SimChannel *chn,int stfreq,int edfreq) {
+  double t,n,min=-1;
+  int f,step,freq;
+
+  if (edfreq<stfreq) edfreq=stfreq;
+  step=(edfreq-stfreq)/50;
+  if (step<1) step=1;
+
+  t=SimTime();
+  freq=stfreq;
+  for (f=stfreq;f<=edfreq;f+=step) {
+    n=SimNoise(f,t);
+    if ((min<0) || (n<min)) {
+      min=n;
+      freq=f;
+    }
+  }
+
+  chn->tfreq=freq;
+  chn->noise=min;
+  return freq;
+}
+
+
+int SimACF(struct SimChannel *chn,int nave,int *pwr0,int *acfd,int *xcfd) {
+  double lambda,vel,tau,amp,phi,pwr,nse,sd;
+  double re,im;
+  int r,l,mplgs,off;
+
+  if ((chn->tfreq<=0) || (nave<1)) return -1;
+
+  mplgs=chn->mplgs;
+  if (mplgs>SIM_MAXLAG) mplgs=SIM_MAXLAG;
+
+  lambda=SIM_C/(chn->tfreq*1e3);
+  vel=simcfg.vel*cos(2*PI*chn->bmnum/16.0);
+  nse=(chn->noise>0) ? chn->noise : simcfg.noise;
+
+  for (r=0;r<chn->nrang;r++) {
+    pwr=(chn->frang+r*chn->rsep-simcfg.range)/simcfg.depth;
+    pwr=simcfg.power*exp(-pwr*pwr);
+    sd=(pwr+nse)/sqrt((double) nave);
+
+    for (l=0;l<mplgs;l++) {
+      tau=(chn->lag[l][1]-chn->lag[l][0])*chn->mpinc*1e-6;
+      amp=pwr*exp(-2*PI*simcfg.width*tau/lambda);
+      phi=4*PI*vel*tau/lambda;
+      off=2*(r*chn->mplgs+l);
+
+      re=amp*cos(phi)+sd*SimGauss()/sqrt(2.0);
+      im=amp*sin(phi)+sd*SimGauss()/sqrt(2.0);
+      if (tau==0) {
+        re+=nse;
+        im=0;
+      }
+      acfd[off]=(int) re;
+      acfd[off+1]=(int) im;
+      if (l==0) pwr0[r]=(re>0) ? (int) re : 0;
+
+      if ((xcfd==NULL) || (chn->xcf==0)) continue;
+      re=0.8*amp*cos(phi+simcfg.phi0)+sd*SimGauss()/sqrt(2.0);
+      im=0.8*amp*sin(phi+simcfg.phi0)+sd*SimGauss()/sqrt(2.0);
+      xcfd[off]=(int) re;
+      xcfd[off+1]=(int) im;
+    }
+  }
+  return 0;
+}
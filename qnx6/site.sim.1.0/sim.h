@@ -0,0 +1,63 @@
+/* sim.h
+   =====
+*/
+
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#define SIM_MAXPUL 32
+#define SIM_MAXLAG 64
+#define SIM_MAXSEQ 1024
+
+#define SIM_FCLR_TIME 0.1     /* seconds taken by a clear frequency search */
+#define SIM_SEQ_DEAD 1500     /* dead time between sequences [us] */
+
+struct SimConfig {
+  double speed;      /* virtual seconds per real second of processing */
+  double start;      /* virtual start time (epoch seconds) */
+  unsigned int seed;
+  double noise;      /* receiver noise power */
+  double power;      /* peak echo power */
+  double range;      /* range of peak echo [km] */
+  double depth;      /* range extent of the echo [km] */
+  double vel;        /* peak line of sight velocity [m/s] */
+  double width;      /* spectral width [m/s] */
+  double phi0;       /* cross correlation phase [rad] */
+  int pace;          /* sleep through integrations rather than skip them */
+  char *replay;      /* rawacf or iqdat file to play back */
+};
+
+/* one receiver channel; filled in from the control program globals
+   before each call */
+
+struct SimChannel {
+  int bmnum;
+  int tfreq;
+  int mppul;
+  int mpinc;
+  int mplgs;
+  int nrang;
+  int frang;
+  int rsep;
+  int xcf;
+  int ptab[SIM_MAXPUL];
+  int lag[SIM_MAXLAG][2];
+  int atten;
+  double noise;
+};
+
+void SimLoadConfig(struct SimConfig *cfg);
+void SimStart(struct SimConfig *cfg);
+
+double SimTime(void);
+void SimAdvance(double dt);
+void SimWait(double t);
+
+double SimSeqTime(struct SimChannel *chn);
+int SimSeqNum(struct SimChannel *chn,double intt);
+
+int SimFCLR(struct SimChannel *chn,int stfreq,int edfreq);
+int SimACF(struct SimChannel *chn,int nave,int *pwr0,int *acfd,int *xcfd);
+
+#endif
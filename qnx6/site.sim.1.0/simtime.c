@@ -0,0 +1,37 @@
+/* simtime.c
+   =========
+
+   Replacement for the rtime TimeReadClock that reads the virtual
+   clock, so the scan timing, OpsFindSkip and the file reopening in
+   the control program all follow the simulated radar. It is only
+   picked up when the program is linked statically with the site
+   library ahead of -lrtime.1.
+*/
+
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "sim.h"
+
+
+int TimeReadClock(int *yr,int *mo,int *dy,int *hr,int *mt,int *sc,
+                  int *us) {
+  struct tm *tm;
+  time_t clock;
+  double t;
+
+  t=SimTime();
+  clock=(time_t) t;
+  tm=gmtime(&clock);
+  if (tm==NULL) return -1;
+
+  *yr=tm->tm_year+1900;
+  *mo=tm->tm_mon+1;
+  *dy=tm->tm_mday;
+  *hr=tm->tm_hour;
+  *mt=tm->tm_min;
+  *sc=tm->tm_sec;
+  *us=(int) ((t-floor(t))*1e6);
+  return 0;
+}
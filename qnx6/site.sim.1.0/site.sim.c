@@ -0,0 +1,281 @@
+/* site.sim.c
+   ==========
+
+   Site library for a simulated radar. It takes the place of the
+   hardware site libraries so that a control program can be run on
+   any Linux box: no DDS, receiver or timing card is touched, the
+   samples come from the model in sim.c and time is kept by the
+   virtual clock there.
+
+   The radar is configured through the SD_SIM_ environment variables
+   described in README.txt. With SD_SIM_REPLAY set the frequencies,
+   noise and ACFs come from a recorded file instead (replay.c).
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "rtypes.h"
+#include "limit.h"
+#include "tsg.h"
+#include "global.h"
+#include "site.h"
+#include "siteglobal.h"
+#include "sim.h"
+#include "replay.h"
+#include "site.sim.h"
+
+
+#define SIM_MAXTSG 16
+
+static struct SimConfig simcfg;
+static struct SimChannel simchn;
+static struct SiteSimStats simstats;
+
+static double simintt=0;
+static double simbnd=0;
+static int simtsg[SIM_MAXTSG][SIM_MAXPUL+4];
+static int simtsgnum=0;
+static int simreplay=0;
+
+
+/* copies the operating parameters the control program has set into
+   the simulated channel */
+
+static void SiteSimChannel(void) {
+  simchn.bmnum=bmnum;
+  simchn.tfreq=tfreq;
+  simchn.mppul=(mppul<SIM_MAXPUL) ? mppul : SIM_MAXPUL;
+  simchn.mpinc=mpinc;
+  simchn.mplgs=(mplgs<SIM_MAXLAG) ? mplgs : SIM_MAXLAG;
+  simchn.nrang=nrang;
+  simchn.frang=frang;
+  simchn.rsep=rsep;
+  simchn.xcf=xcf;
+}
+
+
+int SiteSimStart(char *host) {
+  SimLoadConfig(&simcfg);
+
+  /* a replay starts the clock at the first record unless told not to */
+
+  simreplay=0;
+  if (simcfg.replay !=NULL) {
+    if (ReplayOpen(simcfg.replay) !=0) {
+      fprintf(stderr,"Unable to replay %s.\n",simcfg.replay);
+      exit(-1);
+    }
+    simreplay=1;
+    if (simcfg.start<=0) simcfg.start=ReplayTime();
+  }
+
+  SimStart(&simcfg);
+  memset(&simchn,0,sizeof(struct SimChannel));
+  memset(&simstats,0,sizeof(struct SiteSimStats));
+  simtsgnum=0;
+  simbnd=0;
+
+  if (simreplay)
+    fprintf(stderr,"Simulated radar: speed %g, %s, replaying %s from %s\n",
+            simcfg.speed,(simcfg.pace) ? "paced" : "unpaced",
+            (ReplayType()==REPLAY_IQDAT) ? "iqdat" : "rawacf",
+            simcfg.replay);
+  else fprintf(stderr,"Simulated radar: speed %g, seed %u, noise %g, "
+               "power %g at %g km\n",simcfg.speed,simcfg.seed,simcfg.noise,
+               simcfg.power,simcfg.range);
+  return 0;
+}
+
+
+int SiteSimSetupRadar(void) {
+  return 0;
+}
+
+
+int SiteSimStartScan(void) {
+  return 0;
+}
+
+
+int SiteSimStartIntt(int intsc,int intus) {
+  simintt=SimTime()+intsc+intus*1e-6;
+  return 0;
+}
+
+
+int SiteSimFCLR(int stfreq,int edfreq) {
+  SiteSimChannel();
+  if ((simreplay==0) || (ReplayFCLR(&simchn,0)<0))
+    SimFCLR(&simchn,stfreq,edfreq);
+  noise=simchn.noise;
+  SimAdvance(SIM_FCLR_TIME);
+  simstats.jump+=SIM_FCLR_TIME;
+  return simchn.tfreq;
+}
+
+
+/* the sequence itself is never built; sequences with the same pulse
+   table and timing get the same identifier, as TSGMake would */
+
+int SiteSimTimeSeq(int *ptab) {
+  int key[SIM_MAXPUL+4];
+  int n,i;
+
+  SiteSimChannel();
+  memset(key,0,sizeof(key));
+  key[0]=simchn.mppul;
+  key[1]=mpinc;
+  key[2]=frang;
+  key[3]=rsep;
+  for (n=0;n<simchn.mppul;n++) key[4+n]=ptab[n];
+
+  memcpy(simchn.ptab,ptab,sizeof(int)*simchn.mppul);
+
+  lagfr=frang*20/3;
+  smsep=rsep*20/3;
+
+  for (i=0;i<simtsgnum;i++)
+    if (memcmp(simtsg[i],key,sizeof(key))==0) return i;
+  if (simtsgnum==SIM_MAXTSG) return -1;
+  memcpy(simtsg[simtsgnum],key,sizeof(key));
+  simtsgnum++;
+  return simtsgnum-1;
+}
+
+
+/* in replay the program is given the time of the record it is about
+   to get, as if it had read the clock when the record was taken, so
+   the parameters it builds from yr..us carry the recorded time; the
+   clock is moved on to that time if it is behind */
+
+static void SiteSimRecTime(void) {
+  double t;
+
+  if (ReplayClock(&yr,&mo,&dy,&hr,&mt,&sc,&us) !=0) return;
+  t=ReplayTime()-SimTime();
+  if (t<=0) return;
+  simstats.jump+=t;
+  SimAdvance(t);
+}
+
+
+int SiteSimIntegrate(int (*lags)[2]) {
+  double t,dt,tseq;
+  int n,nave;
+
+  SiteSimChannel();
+  simchn.tfreq=tfreq;
+  for (n=0;n<simchn.mplgs;n++) {
+    simchn.lag[n][0]=lags[n][0];
+    simchn.lag[n][1]=lags[n][1];
+  }
+
+  if (simreplay) SiteSimRecTime();
+  t=SimTime();
+  tseq=SimSeqTime(&simchn);
+  nave=SimSeqNum(&simchn,simintt-t);
+  if (nave>MAXNAVE) nave=MAXNAVE;
+
+  if (pwr0 !=NULL) free(pwr0);
+  if (acfd !=NULL) free(acfd);
+  if (xcfd !=NULL) free(xcfd);
+  pwr0=malloc(sizeof(int)*nrang);
+  acfd=malloc(sizeof(int)*2*nrang*mplgs);
+  xcfd=malloc(sizeof(int)*2*nrang*mplgs);
+  if ((pwr0==NULL) || (acfd==NULL) || (xcfd==NULL)) return -1;
+  memset(xcfd,0,sizeof(int)*2*nrang*mplgs);
+
+  if (simreplay) {
+    nave=ReplayACF(&simchn,pwr0,acfd,xcfd);
+    if (nave<0) SiteSimExit(0);
+    noise=simchn.noise;
+    if (nave>MAXNAVE) nave=MAXNAVE;
+  } else if (SimACF(&simchn,nave,pwr0,acfd,xcfd) !=0) return -1;
+
+  for (n=0;n<nave;n++) {
+    dt=t+n*tseq;
+    seqtval[n].tv_sec=(time_t) dt;
+    seqtval[n].tv_nsec=(long) ((dt-floor(dt))*1e9);
+    seqatten[n]=0;
+    seqnoise[n]=simchn.noise;
+    seqoff[n]=0;
+    seqsze[n]=0;
+  }
+
+  /* the integration runs to the end of the period, or for one
+     sequence if it started too late to fit one in */
+
+  dt=t+nave*tseq;
+  if (dt<simintt) dt=simintt;
+  if (dt>SimTime()) simstats.jump+=dt-SimTime();
+  SimWait(dt);
+  simstats.intt++;
+  simstats.nave+=nave;
+  return nave;
+}
+
+
+int SiteSimEndScan(int bsc,int bus) {
+  double period,t,bnd;
+
+  simstats.scans++;
+  period=bsc+bus*1e-6;
+  if (period<=0) return 0;
+
+  /* a scan that runs past its boundary waits for the next one */
+
+  t=SimTime();
+  if ((simbnd>0) && (t>simbnd)) {
+    simstats.late++;
+    simstats.overrun+=t-simbnd;
+  }
+  bnd=period*(floor(t/period)+1);
+  simstats.jump+=bnd-t;
+  SimWait(bnd);
+  simbnd=bnd+period;
+  return 0;
+}
+
+
+void SiteSimExit(int error) {
+  struct ReplayStats rstats;
+
+  fprintf(stderr,"Simulated radar: %d scans, %d integrations, "
+          "%d sequences, %d scans late by %.3fs, %.1fs skipped\n",
+          simstats.scans,simstats.intt,simstats.nave,simstats.late,
+          simstats.overrun,simstats.jump);
+  if (simreplay) {
+    ReplayStatsGet(&rstats);
+    fprintf(stderr,"Replay: %d records, %d on another beam, "
+            "%d on another frequency, %d with another range or lag count\n",
+            rstats.rec,rstats.beam,rstats.freq,rstats.shape);
+    ReplayClose();
+  }
+  exit(error);
+}
+
+
+/* hooks the simulated radar into the generic Site functions, as
+   SiteBuild does for a station */
+
+int SiteSimBuild(void) {
+  SiteStart=SiteSimStart;
+  SiteSetupRadar=SiteSimSetupRadar;
+  SiteStartScan=SiteSimStartScan;
+  SiteStartIntt=SiteSimStartIntt;
+  SiteFCLR=SiteSimFCLR;
+  SiteTimeSeq=SiteSimTimeSeq;
+  SiteIntegrate=SiteSimIntegrate;
+  SiteEndScan=SiteSimEndScan;
+  SiteExit=SiteSimExit;
+  return 0;
+}
+
+
+void SiteSimStatsGet(struct SiteSimStats *stats) {
+  if (stats !=NULL) memcpy(stats,&simstats,sizeof(struct SiteSimStats));
+}
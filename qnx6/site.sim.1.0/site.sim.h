@@ -0,0 +1,31 @@
+/* site.sim.h
+   ==========
+*/
+
+
+#ifndef _SITESIM_H
+#define _SITESIM_H
+
+struct SiteSimStats {
+  int scans;
+  int intt;          /* integrations */
+  int nave;          /* sequences */
+  int late;          /* scans that ended after their boundary */
+  double overrun;    /* seconds past the boundary, summed over scans */
+  double jump;       /* virtual seconds skipped rather than waited for */
+};
+
+int SiteSimStart(char *host);
+int SiteSimSetupRadar(void);
+int SiteSimStartScan(void);
+int SiteSimStartIntt(int intsc,int intus);
+int SiteSimFCLR(int stfreq,int edfreq);
+int SiteSimTimeSeq(int *ptab);
+int SiteSimIntegrate(int (*lags)[2]);
+int SiteSimEndScan(int bsc,int bus);
+void SiteSimExit(int error);
+
+int SiteSimBuild(void);
+void SiteSimStatsGet(struct SiteSimStats *stats);
+
+#endif